@@ -0,0 +1,93 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "analysis/bonds.h"
+
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "analysis/cell_list.h"
+#include "utils/trace.h"
+
+std::vector<double> species_radii(const SpeciesTable& species_table, atomsciflow::AtomicRadius& atomic_radius) {
+    std::vector<double> radii;
+    radii.reserve(species_table.names.size());
+    for (const auto& name : species_table.names) {
+        radii.push_back(atomic_radius.calculated[name]);
+    }
+    return radii;
+}
+
+std::vector<Bond> detect_bonds(const Frame& frame, const std::vector<double>& radii, double tolerance) {
+    TRACE_SCOPE_CAT("detect_bonds", "analysis");
+    std::vector<Bond> bonds;
+    const int natom = frame.natom();
+    if (natom < 2 || radii.empty()) {
+        return bonds;
+    }
+
+    const int nspecies = static_cast<int>(radii.size());
+    std::vector<double> max_r2(nspecies * nspecies);
+    double max_radius = 0.0;
+    for (int a = 0; a < nspecies; a++) {
+        max_radius = std::max(max_radius, radii[a]);
+        for (int b = 0; b < nspecies; b++) {
+            // species without a known radius, e.g. the numeric types of a
+            // LAMMPS dump, get no bonds; a zero limit never matches
+            if (false == (radii[a] > 0.0 && radii[b] > 0.0)) {
+                continue;
+            }
+            const double r = tolerance * (radii[a] + radii[b]);
+            max_r2[a * nspecies + b] = r * r;
+        }
+    }
+    // a zero cutoff would leave the cell list a single bin and every
+    // frame an all pairs scan for nothing
+    if (false == (max_radius > 0.0)) {
+        return bonds;
+    }
+
+    CellList cell_list;
+    cell_list.build(frame.positions.data(), natom, Lattice::from_cell(frame.cell), 2.0 * tolerance * max_radius);
+
+    const int nbins = cell_list.bin_count();
+#pragma omp parallel
+    {
+        std::vector<Bond> local_bonds;
+#pragma omp for schedule(dynamic, 64) nowait
+        for (int bin = 0; bin < nbins; bin++) {
+            cell_list.for_each_pair_of_bin(bin, [&](int i, int j, double, double, double, double r2) {
+                if (r2 < max_r2[frame.species[i] * nspecies + frame.species[j]]) {
+                    local_bonds.push_back(i < j ? Bond{i, j} : Bond{j, i});
+                }
+            });
+        }
+#pragma omp critical
+        bonds.insert(bonds.end(), local_bonds.begin(), local_bonds.end());
+    }
+
+    std::sort(bonds.begin(), bonds.end(), [](const Bond& lhs, const Bond& rhs) {
+        return lhs.i != rhs.i ? lhs.i < rhs.i : lhs.j < rhs.j;
+    });
+    return bonds;
+}
@@ -0,0 +1,49 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Bond detection from interatomic distances: atoms i and j are bonded
+/// when |r_ij| < tolerance * (radius_i + radius_j). Species without a
+/// positive radius are never bonded.
+
+#ifndef ANALYSIS_BONDS_H
+#define ANALYSIS_BONDS_H
+
+#include <vector>
+
+#include <atomsciflow/base/atomic_radius.h>
+
+#include "analysis/frame.h"
+
+struct Bond {
+    int i;
+    int j;
+};
+
+// radii per species index, looked up once instead of per pair
+std::vector<double> species_radii(const SpeciesTable& species_table, atomsciflow::AtomicRadius& atomic_radius);
+
+// bonds with i < j, sorted; periodic frames use the minimum image
+std::vector<Bond> detect_bonds(
+    const Frame& frame,
+    const std::vector<double>& radii,
+    double tolerance = 1.2
+);
+
+#endif // ANALYSIS_BONDS_H
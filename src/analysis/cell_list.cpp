@@ -0,0 +1,198 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "analysis/cell_list.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+void cross(const double* u, const double* v, double* w) {
+    w[0] = u[1] * v[2] - u[2] * v[1];
+    w[1] = u[2] * v[0] - u[0] * v[2];
+    w[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+double norm(const double* u) {
+    return std::sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+}
+
+} // namespace
+
+Lattice Lattice::from_cell(const std::vector<std::vector<double>>& cell) {
+    Lattice lattice;
+    if (3 != cell.size() || 3 != cell[0].size() || 3 != cell[1].size() || 3 != cell[2].size()) {
+        return lattice;
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int k = 0; k < 3; k++) {
+            lattice.a[i][k] = cell[i][k];
+        }
+    }
+    const double det = lattice.volume();
+    if (std::abs(det) < 1.0e-8) {
+        return Lattice{};
+    }
+    // inverse by the adjugate, the columns are the reciprocal vectors
+    double bc[3], ca[3], ab[3];
+    cross(lattice.a[1], lattice.a[2], bc);
+    cross(lattice.a[2], lattice.a[0], ca);
+    cross(lattice.a[0], lattice.a[1], ab);
+    for (int k = 0; k < 3; k++) {
+        lattice.inverse[k][0] = bc[k] / det;
+        lattice.inverse[k][1] = ca[k] / det;
+        lattice.inverse[k][2] = ab[k] / det;
+    }
+    lattice.periodic = true;
+    return lattice;
+}
+
+Lattice Lattice::bounding_box(const double* positions, int natom, double padding) {
+    double lower[3], upper[3];
+    for (int k = 0; k < 3; k++) {
+        lower[k] = natom > 0 ? std::numeric_limits<double>::max() : 0.0;
+        upper[k] = natom > 0 ? std::numeric_limits<double>::lowest() : 0.0;
+    }
+    for (int i = 0; i < natom; i++) {
+        for (int k = 0; k < 3; k++) {
+            lower[k] = std::min(lower[k], positions[3 * i + k]);
+            upper[k] = std::max(upper[k], positions[3 * i + k]);
+        }
+    }
+    Lattice lattice;
+    for (int k = 0; k < 3; k++) {
+        const double length = upper[k] - lower[k] + 2 * padding;
+        lattice.origin[k] = lower[k] - padding;
+        lattice.a[k][k] = length;
+        lattice.inverse[k][k] = 1.0 / length;
+    }
+    lattice.periodic = false;
+    return lattice;
+}
+
+double Lattice::volume() const {
+    double bc[3];
+    cross(a[1], a[2], bc);
+    return a[0][0] * bc[0] + a[0][1] * bc[1] + a[0][2] * bc[2];
+}
+
+double Lattice::width(int k) const {
+    double w[3];
+    cross(a[(k + 1) % 3], a[(k + 2) % 3], w);
+    return std::abs(this->volume()) / norm(w);
+}
+
+void CellList::build(const double* positions, int natom, const Lattice& lattice, double cutoff) {
+    m_cutoff2 = cutoff * cutoff;
+    m_lattice = lattice;
+    if (false == m_lattice.periodic) {
+        // the box only serves the binning, it must enclose all atoms
+        m_lattice = Lattice::bounding_box(positions, natom, 1.0e-6 + 0.01 * cutoff);
+    }
+
+    double nbins[3];
+    for (int k = 0; k < 3; k++) {
+        nbins[k] = std::max(1.0, std::floor(m_lattice.width(k) / cutoff));
+    }
+    // sparse systems would get mostly empty bins, keep about two bins
+    // per atom at most by making the bins larger
+    const double max_bins = std::max(27.0, 2.0 * natom);
+    const double scale = std::cbrt(nbins[0] * nbins[1] * nbins[2] / max_bins);
+    for (int k = 0; k < 3; k++) {
+        m_nbins[k] = static_cast<int>(scale > 1.0 ? std::max(1.0, std::floor(nbins[k] / scale)) : nbins[k]);
+    }
+    const int nbins_total = m_nbins[0] * m_nbins[1] * m_nbins[2];
+    m_shifts_exact = false == m_lattice.periodic || (m_nbins[0] >= 3 && m_nbins[1] >= 3 && m_nbins[2] >= 3);
+
+    std::vector<int> atom_bin(natom);
+    // the cell translation taking each atom into the cell
+    std::vector<double> wrap(3 * natom, 0.0);
+    m_bin_start.assign(nbins_total + 1, 0);
+    for (int i = 0; i < natom; i++) {
+        double f[3];
+        m_lattice.to_fractional(&positions[3 * i], f);
+        int index[3];
+        for (int k = 0; k < 3; k++) {
+            const double image = std::floor(f[k]);
+            index[k] = std::min(static_cast<int>((f[k] - image) * m_nbins[k]), m_nbins[k] - 1);
+            if (true == m_lattice.periodic) {
+                for (int l = 0; l < 3; l++) {
+                    wrap[3 * i + l] -= image * m_lattice.a[k][l];
+                }
+            }
+        }
+        atom_bin[i] = (index[0] * m_nbins[1] + index[1]) * m_nbins[2] + index[2];
+        m_bin_start[atom_bin[i] + 1]++;
+    }
+    for (int b = 0; b < nbins_total; b++) {
+        m_bin_start[b + 1] += m_bin_start[b];
+    }
+    m_sorted.resize(natom);
+    m_binned_positions.resize(3 * natom);
+    std::vector<int> fill(m_bin_start.begin(), m_bin_start.end() - 1);
+    for (int i = 0; i < natom; i++) {
+        const int slot = fill[atom_bin[i]]++;
+        m_sorted[slot] = i;
+        for (int k = 0; k < 3; k++) {
+            m_binned_positions[3 * slot + k] = positions[3 * i + k] + wrap[3 * i + k];
+        }
+    }
+}
+
+int CellList::neighbour_bins(int bin, int* neighbours, double (*shifts)[3]) const {
+    const int x = bin / (m_nbins[1] * m_nbins[2]);
+    const int y = (bin / m_nbins[2]) % m_nbins[1];
+    const int z = bin % m_nbins[2];
+    int count = 0;
+    for (int dx = -1; dx <= 1; dx++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dz = -1; dz <= 1; dz++) {
+                int index[3] = {x + dx, y + dy, z + dz};
+                // the images crossed along each axis
+                int image[3] = {0, 0, 0};
+                bool inside = true;
+                for (int k = 0; k < 3; k++) {
+                    if (true == m_lattice.periodic) {
+                        image[k] = index[k] < 0 ? -1 : (index[k] >= m_nbins[k] ? 1 : 0);
+                        index[k] -= image[k] * m_nbins[k];
+                    } else if (index[k] < 0 || index[k] >= m_nbins[k]) {
+                        inside = false;
+                    }
+                }
+                if (false == inside) {
+                    continue;
+                }
+                const int other = (index[0] * m_nbins[1] + index[1]) * m_nbins[2] + index[2];
+                // with fewer than three bins per axis the periodic
+                // images of a bin coincide
+                if (std::find(neighbours, neighbours + count, other) == neighbours + count) {
+                    if (nullptr != shifts) {
+                        for (int l = 0; l < 3; l++) {
+                            shifts[count][l] = image[0] * m_lattice.a[0][l] + image[1] * m_lattice.a[1][l] + image[2] * m_lattice.a[2][l];
+                        }
+                    }
+                    neighbours[count++] = other;
+                }
+            }
+        }
+    }
+    return count;
+}
@@ -0,0 +1,152 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Linked-cell neighbour search with minimum-image convention, used by
+/// the bond detection and the pair analyses.
+
+#ifndef ANALYSIS_CELL_LIST_H
+#define ANALYSIS_CELL_LIST_H
+
+#include <cmath>
+#include <vector>
+
+/// Lattice vectors as rows of a, r = f * a for fractional coordinates f.
+class Lattice {
+public:
+    // returns a non-periodic lattice when the cell is empty or singular
+    static Lattice from_cell(const std::vector<std::vector<double>>& cell);
+    // an orthogonal non-periodic box enclosing all positions
+    static Lattice bounding_box(const double* positions, int natom, double padding);
+
+    void to_fractional(const double* r, double* f) const {
+        for (int k = 0; k < 3; k++) {
+            f[k] = (r[0] - origin[0]) * inverse[0][k]
+                + (r[1] - origin[1]) * inverse[1][k]
+                + (r[2] - origin[2]) * inverse[2][k];
+        }
+    }
+
+    // reduce a cartesian displacement to its nearest periodic image
+    void minimum_image(double* d) const {
+        if (false == periodic) {
+            return;
+        }
+        double f[3];
+        for (int k = 0; k < 3; k++) {
+            f[k] = d[0] * inverse[0][k] + d[1] * inverse[1][k] + d[2] * inverse[2][k];
+            f[k] -= std::round(f[k]);
+        }
+        for (int k = 0; k < 3; k++) {
+            d[k] = f[0] * a[0][k] + f[1] * a[1][k] + f[2] * a[2][k];
+        }
+    }
+
+    double volume() const;
+    // distance between opposite faces of the cell along axis k
+    double width(int k) const;
+
+    double a[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    double inverse[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    double origin[3] = {0, 0, 0};
+    bool periodic = false;
+};
+
+class CellList {
+public:
+    // the minimum image is only exact for cutoffs up to half the
+    // smallest cell width
+    void build(const double* positions, int natom, const Lattice& lattice, double cutoff);
+
+    int bin_count() const {
+        return static_cast<int>(m_bin_start.size()) - 1;
+    }
+
+    // calls f(i, j, dx, dy, dz, r2) once for every pair i != j closer
+    // than the cutoff where one atom is in the given bin, (dx, dy, dz)
+    // points from i to j. Bins can be processed in parallel.
+    template <typename F>
+    void for_each_pair_of_bin(int bin, F&& f) const {
+        int neighbours[27];
+        double shifts[27][3];
+        const int count = this->neighbour_bins(bin, neighbours, shifts);
+        for (int n = 0; n < count; n++) {
+            const int other = neighbours[n];
+            if (other < bin) {
+                continue;
+            }
+            const double* shift = shifts[n];
+            // locals, the callback could otherwise force reloads of the members
+            const double* positions = m_binned_positions.data();
+            const double cutoff2 = m_cutoff2;
+            const bool exact = m_shifts_exact;
+            const int a_end = m_bin_start[bin + 1];
+            const int b_end = m_bin_start[other + 1];
+            for (int a = m_bin_start[bin]; a < a_end; a++) {
+                const int i = m_sorted[a];
+                const double* ri = &positions[3 * a];
+                const double s[3] = {shift[0] - ri[0], shift[1] - ri[1], shift[2] - ri[2]};
+                const int b_begin = other == bin ? a + 1 : m_bin_start[other];
+                for (int b = b_begin; b < b_end; b++) {
+                    const double* rj = &positions[3 * b];
+                    double d[3] = {rj[0] + s[0], rj[1] + s[1], rj[2] + s[2]};
+                    if (false == exact) {
+                        m_lattice.minimum_image(d);
+                    }
+                    const double r2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+                    if (r2 <= cutoff2) {
+                        f(i, m_sorted[b], d[0], d[1], d[2], r2);
+                    }
+                }
+            }
+        }
+    }
+
+    template <typename F>
+    void for_each_pair(F&& f) const {
+        for (int bin = 0; bin < this->bin_count(); bin++) {
+            this->for_each_pair_of_bin(bin, f);
+        }
+    }
+
+    const Lattice& lattice() const {
+        return m_lattice;
+    }
+
+    // the distinct bins around and including bin, returns their count;
+    // shifts, when given, gets the lattice translation that brings each
+    // neighbour next to bin
+    int neighbour_bins(int bin, int* neighbours, double (*shifts)[3] = nullptr) const;
+
+private:
+    Lattice m_lattice;
+    double m_cutoff2 = 0.0;
+    int m_nbins[3] = {1, 1, 1};
+    // with at least three bins along every periodic axis a neighbour bin
+    // has a single image next to a bin and the shifts give the nearest
+    // image directly, otherwise every pair goes through minimum_image
+    bool m_shifts_exact = true;
+    // atoms sorted by bin, the atoms of bin b are m_sorted[m_bin_start[b]..m_bin_start[b + 1])
+    std::vector<int> m_sorted;
+    // the positions in m_sorted order, wrapped into the cell
+    std::vector<double> m_binned_positions;
+    std::vector<int> m_bin_start;
+};
+
+#endif // ANALYSIS_CELL_LIST_H
@@ -0,0 +1,51 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "analysis/frame.h"
+
+int SpeciesTable::index_of(const std::string& name) {
+    auto it = m_indices.find(name);
+    if (it != m_indices.end()) {
+        return it->second;
+    }
+    const int index = static_cast<int>(names.size());
+    names.push_back(name);
+    m_indices.emplace(name, index);
+    return index;
+}
+
+int SpeciesTable::find(const std::string& name) const {
+    auto it = m_indices.find(name);
+    return it == m_indices.end() ? -1 : it->second;
+}
+
+Frame frame_from_crystal(const atomsciflow::Crystal& crystal, SpeciesTable& species_table) {
+    Frame frame;
+    frame.positions.reserve(3 * crystal.atoms.size());
+    frame.species.reserve(crystal.atoms.size());
+    for (const auto& atom : crystal.atoms) {
+        frame.positions.push_back(atom.x);
+        frame.positions.push_back(atom.y);
+        frame.positions.push_back(atom.z);
+        frame.species.push_back(species_table.index_of(atom.name));
+    }
+    frame.cell = crystal.cell;
+    return frame;
+}
@@ -0,0 +1,73 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Flat per-frame atom arrays shared by the analyses and the trajectory
+/// readers. Positions are stored as x0 y0 z0 x1 y1 z1 ...
+
+#ifndef ANALYSIS_FRAME_H
+#define ANALYSIS_FRAME_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <atomsciflow/base/crystal.h>
+
+/// Maps element or type names to dense species indices.
+class SpeciesTable {
+public:
+    int index_of(const std::string& name);
+    // -1 if the name has not been seen
+    int find(const std::string& name) const;
+
+    int size() const {
+        return static_cast<int>(names.size());
+    }
+
+    std::vector<std::string> names;
+
+private:
+    std::unordered_map<std::string, int> m_indices;
+};
+
+struct Frame {
+    long step = 0;
+    double time = 0.0;
+    double energy = 0.0;
+    std::vector<double> positions;
+    // empty when the source has no velocities
+    std::vector<double> velocities;
+    // empty when the source has no forces
+    std::vector<double> forces;
+    // e, empty when the source has no charges
+    std::vector<double> charges;
+    std::vector<int> species;
+    // lattice vectors as rows, empty for non-periodic structures
+    std::vector<std::vector<double>> cell;
+
+    int natom() const {
+        return static_cast<int>(species.size());
+    }
+};
+
+// the charges stay empty, the crystal has none
+Frame frame_from_crystal(const atomsciflow::Crystal& crystal, SpeciesTable& species_table);
+
+#endif // ANALYSIS_FRAME_H
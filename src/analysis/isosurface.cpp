@@ -0,0 +1,820 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "analysis/isosurface.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "utils/trace.h"
+
+namespace {
+
+// three vertices per triangle, at most 10 triangles in a cell
+const int kMaxCaseEdges = 30;
+
+// corner c of a cell is at (c & 1, (c >> 1) & 1, (c >> 2) & 1), edge e
+// runs from corners[e] along axis[e]
+struct MarchingCase {
+    int nedge = 0;
+    std::uint8_t edges[kMaxCaseEdges];
+};
+
+struct MarchingTable {
+    int corners[12];
+    int axes[12];
+    // indexed by the mask of the corners above the isovalue
+    MarchingCase cases[256];
+};
+
+MarchingTable build_marching_table() {
+    MarchingTable table;
+    int edge_of[8][3];
+    int nedge = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        for (int c = 0; c < 8; c++) {
+            if (0 == ((c >> axis) & 1)) {
+                table.corners[nedge] = c;
+                table.axes[nedge] = axis;
+                edge_of[c][axis] = nedge;
+                nedge++;
+            }
+        }
+    }
+    const auto edge_between = [&](int c0, int c1) {
+        const int axis = 1 == (c0 ^ c1) ? 0 : (2 == (c0 ^ c1) ? 1 : 2);
+        return edge_of[std::min(c0, c1)][axis];
+    };
+
+    // two edges lie in a common face when their start corners agree on
+    // a coordinate other than their axes
+    const auto share_face = [&](int e0, int e1) {
+        const int c0 = table.corners[e0];
+        const int c1 = table.corners[e1];
+        for (int axis = 0; axis < 3; axis++) {
+            if (axis != table.axes[e0] && axis != table.axes[e1] && ((c0 >> axis) & 1) == ((c1 >> axis) & 1)) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    for (int mask = 0; mask < 256; mask++) {
+        // on every face the surface runs from the edge where a run of
+        // corners above the isovalue ends to the edge where it starts;
+        // next joins these segments into the loops around the cell
+        int next[12];
+        std::fill(next, next + 12, -1);
+        for (int axis = 0; axis < 3; axis++) {
+            const int u = (axis + 1) % 3;
+            const int v = (axis + 2) % 3;
+            for (int side = 0; side < 2; side++) {
+                // counter-clockwise seen from outside the cell
+                int corners[4] = {
+                    side << axis, (side << axis) | (1 << u), (side << axis) | (1 << u) | (1 << v), (side << axis) | (1 << v)
+                };
+                if (0 == side) {
+                    std::swap(corners[1], corners[3]);
+                }
+                bool above[4];
+                for (int i = 0; i < 4; i++) {
+                    above[i] = 0 != ((mask >> corners[i]) & 1);
+                }
+                for (int i = 0; i < 4; i++) {
+                    if (true == above[i] || false == above[(i + 1) % 4]) {
+                        continue;
+                    }
+                    int last = (i + 1) % 4;
+                    while (true == above[(last + 1) % 4]) {
+                        last = (last + 1) % 4;
+                    }
+                    next[edge_between(corners[last], corners[(last + 1) % 4])] = edge_between(corners[i], corners[(i + 1) % 4]);
+                }
+            }
+        }
+        // a fan per loop, wound counter-clockwise seen from below
+        auto& marching_case = table.cases[mask];
+        bool visited[12] = {};
+        for (int start = 0; start < 12; start++) {
+            if (next[start] < 0 || true == visited[start]) {
+                continue;
+            }
+            int loop[12];
+            int length = 0;
+            for (int edge = start; false == visited[edge]; edge = next[edge]) {
+                visited[edge] = true;
+                loop[length++] = edge;
+            }
+            // the apex of the fan is chosen so that no diagonal lies in a
+            // face of the cell, where it would overlap the neighbour cell
+            int apex = 0;
+            for (int a = 0; a < length; a++) {
+                bool on_face = false;
+                for (int i = 2; i + 1 < length; i++) {
+                    on_face = on_face || true == share_face(loop[a], loop[(a + i) % length]);
+                }
+                if (false == on_face) {
+                    apex = a;
+                    break;
+                }
+            }
+            for (int i = 1; i + 1 < length; i++) {
+                marching_case.edges[marching_case.nedge++] = loop[apex];
+                marching_case.edges[marching_case.nedge++] = loop[(apex + i + 1) % length];
+                marching_case.edges[marching_case.nedge++] = loop[(apex + i) % length];
+            }
+        }
+        assert(marching_case.nedge <= kMaxCaseEdges);
+    }
+    return table;
+}
+
+const MarchingTable& marching_table() {
+    static const MarchingTable table = build_marching_table();
+    return table;
+}
+
+// index maps of the cells, periodic grids get one more cell per axis
+// that reaches to the image of point 0
+struct Grid {
+    int ncell[3];
+    // the stored point of point i, i in [0, ncell]
+    std::vector<int> wrap[3];
+    // the points of the central difference at point i and its inverse span
+    std::vector<int> below[3];
+    std::vector<int> above[3];
+    std::vector<float> inverse_span[3];
+    // of the steps, turns index gradients into Cartesian ones
+    double inverse[3][3];
+
+    explicit Grid(const VolumetricData& data) {
+        for (int a = 0; a < 3; a++) {
+            const int n = data.n[a];
+            ncell[a] = true == data.periodic ? n : n - 1;
+            for (int i = 0; i <= std::max(0, ncell[a]); i++) {
+                wrap[a].push_back(i % std::max(1, n));
+                if (true == data.periodic) {
+                    below[a].push_back((i - 1 + n) % n);
+                    above[a].push_back((i + 1) % n);
+                    inverse_span[a].push_back(0.5f);
+                } else {
+                    below[a].push_back(std::max(0, i - 1));
+                    above[a].push_back(std::min(n - 1, i + 1));
+                    inverse_span[a].push_back(above[a].back() > below[a].back() ? 1.0f / (above[a].back() - below[a].back()) : 0.0f);
+                }
+            }
+        }
+        const auto& s = data.steps;
+        const double det = s[0][0] * (s[1][1] * s[2][2] - s[1][2] * s[2][1])
+            - s[0][1] * (s[1][0] * s[2][2] - s[1][2] * s[2][0])
+            + s[0][2] * (s[1][0] * s[2][1] - s[1][1] * s[2][0]);
+        const double inverse_det = 0.0 == det ? 0.0 : 1.0 / det;
+        inverse[0][0] = (s[1][1] * s[2][2] - s[1][2] * s[2][1]) * inverse_det;
+        inverse[0][1] = (s[0][2] * s[2][1] - s[0][1] * s[2][2]) * inverse_det;
+        inverse[0][2] = (s[0][1] * s[1][2] - s[0][2] * s[1][1]) * inverse_det;
+        inverse[1][0] = (s[1][2] * s[2][0] - s[1][0] * s[2][2]) * inverse_det;
+        inverse[1][1] = (s[0][0] * s[2][2] - s[0][2] * s[2][0]) * inverse_det;
+        inverse[1][2] = (s[0][2] * s[1][0] - s[0][0] * s[1][2]) * inverse_det;
+        inverse[2][0] = (s[1][0] * s[2][1] - s[1][1] * s[2][0]) * inverse_det;
+        inverse[2][1] = (s[0][1] * s[2][0] - s[0][0] * s[2][1]) * inverse_det;
+        inverse[2][2] = (s[0][0] * s[1][1] - s[0][1] * s[1][0]) * inverse_det;
+    }
+
+    // the gradient in points of point (i, j, k)
+    void gradient(const VolumetricData& data, int i, int j, int k, float g[3]) const {
+        const int wi = wrap[0][i];
+        const int wj = wrap[1][j];
+        const int wk = wrap[2][k];
+        g[0] = (data.value(above[0][i], wj, wk) - data.value(below[0][i], wj, wk)) * inverse_span[0][i];
+        g[1] = (data.value(wi, above[1][j], wk) - data.value(wi, below[1][j], wk)) * inverse_span[1][j];
+        g[2] = (data.value(wi, wj, above[2][k]) - data.value(wi, wj, below[2][k])) * inverse_span[2][k];
+    }
+};
+
+// the vertex on the edge from point (i, j, k) along axis, its normal
+// points towards the lower values
+void interpolate_vertex(const VolumetricData& data, const Grid& grid, float isovalue, int i, int j, int k, int axis, float* position, float* normal) {
+    int p1[3] = {i, j, k};
+    p1[axis]++;
+    const float v0 = data.value(grid.wrap[0][i], grid.wrap[1][j], grid.wrap[2][k]);
+    const float v1 = data.value(grid.wrap[0][p1[0]], grid.wrap[1][p1[1]], grid.wrap[2][p1[2]]);
+    const float t = (isovalue - v0) / (v1 - v0);
+    double point[3] = {static_cast<double>(i), static_cast<double>(j), static_cast<double>(k)};
+    point[axis] += t;
+    for (int c = 0; c < 3; c++) {
+        position[c] = static_cast<float>(
+            data.origin[c] + point[0] * data.steps[0][c] + point[1] * data.steps[1][c] + point[2] * data.steps[2][c]
+        );
+    }
+    float g0[3];
+    float g1[3];
+    grid.gradient(data, i, j, k, g0);
+    grid.gradient(data, p1[0], p1[1], p1[2], g1);
+    double direction[3];
+    double length = 0.0;
+    for (int c = 0; c < 3; c++) {
+        direction[c] = 0.0;
+        for (int a = 0; a < 3; a++) {
+            direction[c] -= grid.inverse[c][a] * (g0[a] + t * (g1[a] - g0[a]));
+        }
+        length += direction[c] * direction[c];
+    }
+    length = length > 0.0 ? 1.0 / std::sqrt(length) : 0.0;
+    for (int c = 0; c < 3; c++) {
+        normal[c] = static_cast<float>(direction[c] * length);
+    }
+}
+
+// the cells of the layers [z0, z1) and their vertices
+struct Slab {
+    int z0 = 0;
+    int z1 = 0;
+    std::vector<float> positions;
+    std::vector<float> normals;
+    // vertices of the slab, or -2 - key for the vertices of plane z1 that
+    // belong to the next slab
+    std::vector<std::int32_t> triangles;
+    // key and vertex of the x and y edges of plane z0, ascending keys
+    std::vector<std::pair<std::int32_t, std::int32_t>> bottom;
+};
+
+void polygonise_slab(const VolumetricData& data, const Grid& grid, float isovalue, Slab& slab) {
+    const auto& table = marching_table();
+    const int nx = grid.ncell[0] + 1;
+    const int ny = grid.ncell[1] + 1;
+    const std::size_t nplane = static_cast<std::size_t>(nx) * ny;
+    // 1 for the points above the isovalue, of the planes below and above
+    // the current layer
+    std::vector<std::uint8_t> above[2] = {std::vector<std::uint8_t>(nplane), std::vector<std::uint8_t>(nplane)};
+    // the vertices on the x and y edges, key 2 * point + axis, of the two
+    // planes and on the z edges between them, -1 when not created yet
+    std::vector<std::int32_t> xy_ids[2] = {std::vector<std::int32_t>(2 * nplane), std::vector<std::int32_t>(2 * nplane)};
+    std::vector<std::int32_t> z_ids(nplane);
+
+    const auto fill_plane = [&](int k, std::vector<std::uint8_t>& plane) {
+        const int wk = grid.wrap[2][k];
+        for (int j = 0; j < ny; j++) {
+            const float* row = &data.values[data.index(0, grid.wrap[1][j], wk)];
+            std::uint8_t* out = &plane[static_cast<std::size_t>(j) * nx];
+            for (int i = 0; i < nx; i++) {
+                out[i] = row[grid.wrap[0][i]] > isovalue ? 1 : 0;
+            }
+        }
+    };
+
+    const auto create_vertex = [&](int i, int j, int k, int axis) {
+        const std::size_t v = slab.positions.size();
+        slab.positions.resize(v + 3);
+        slab.normals.resize(v + 3);
+        interpolate_vertex(data, grid, isovalue, i, j, k, axis, &slab.positions[v], &slab.normals[v]);
+        return static_cast<std::int32_t>(v / 3);
+    };
+
+    fill_plane(slab.z0, above[0]);
+    std::fill(xy_ids[0].begin(), xy_ids[0].end(), -1);
+    const bool shared_top = slab.z1 < grid.ncell[2];
+    for (int k = slab.z0; k < slab.z1; k++) {
+        fill_plane(k + 1, above[1]);
+        std::fill(xy_ids[1].begin(), xy_ids[1].end(), -1);
+        std::fill(z_ids.begin(), z_ids.end(), -1);
+        const bool top_layer = k + 1 == slab.z1;
+        const std::uint8_t* b0 = above[0].data();
+        const std::uint8_t* b1 = above[1].data();
+        for (int j = 0; j < grid.ncell[1]; j++) {
+            for (int i = 0; i < grid.ncell[0]; i++) {
+                const std::size_t p = static_cast<std::size_t>(j) * nx + i;
+                const int mask = b0[p] | (b0[p + 1] << 1) | (b0[p + nx] << 2) | (b0[p + nx + 1] << 3)
+                    | (b1[p] << 4) | (b1[p + 1] << 5) | (b1[p + nx] << 6) | (b1[p + nx + 1] << 7);
+                if (0 == mask || 255 == mask) {
+                    continue;
+                }
+                const auto& marching_case = table.cases[mask];
+                for (int n = 0; n < marching_case.nedge; n++) {
+                    const int edge = marching_case.edges[n];
+                    const int corner = table.corners[edge];
+                    const int axis = table.axes[edge];
+                    const int dz = (corner >> 2) & 1;
+                    const std::size_t q = p + (corner & 1) + ((corner >> 1) & 1) * nx;
+                    std::int32_t& id = 2 == axis ? z_ids[q] : xy_ids[dz][2 * q + axis];
+                    if (-1 == id) {
+                        if (2 != axis && 1 == dz && true == top_layer && true == shared_top) {
+                            id = -2 - static_cast<std::int32_t>(2 * q + axis);
+                        } else {
+                            id = create_vertex(i + (corner & 1), j + ((corner >> 1) & 1), k + dz, axis);
+                        }
+                    }
+                    slab.triangles.push_back(id);
+                }
+            }
+        }
+        if (slab.z0 == k) {
+            for (std::size_t key = 0; key < xy_ids[0].size(); key++) {
+                if (xy_ids[0][key] >= 0) {
+                    slab.bottom.emplace_back(static_cast<std::int32_t>(key), xy_ids[0][key]);
+                }
+            }
+        }
+        std::swap(above[0], above[1]);
+        std::swap(xy_ids[0], xy_ids[1]);
+    }
+}
+
+} // namespace
+
+struct IsosurfaceBlock {
+    float isovalue = 0.0f;
+    // the triangles hold while the isovalue stays in [low, high): low is
+    // the largest value of the block at or below the isovalue they were
+    // made for, high the smallest above it
+    float low = 0.0f;
+    float high = 0.0f;
+    // edge keys (3 * point + axis) of the vertices of the block, ascending
+    std::vector<std::uint64_t> keys;
+    std::vector<float> positions;
+    std::vector<float> normals;
+    // vertices of the block, or -2 - f for the vertex of foreign_keys[f]
+    // that belongs to a neighbour block
+    std::vector<std::int32_t> triangles;
+    std::vector<std::uint64_t> foreign_keys;
+};
+
+namespace {
+
+// the point and the axis of an edge key
+void decode_edge_key(std::uint64_t key, const Grid& grid, int point[3], int& axis) {
+    const std::uint64_t nx = grid.ncell[0] + 1;
+    const std::uint64_t ny = grid.ncell[1] + 1;
+    const std::uint64_t index = key / 3;
+    axis = static_cast<int>(key % 3);
+    point[0] = static_cast<int>(index % nx);
+    point[1] = static_cast<int>(index / nx % ny);
+    point[2] = static_cast<int>(index / nx / ny);
+}
+
+// the vertices of the block are created for the edges that start in it;
+// the edges starting on its upper faces belong to the neighbours
+void polygonise_block(
+    const VolumetricData& data,
+    const Grid& grid,
+    const IsosurfaceIndex& index,
+    int block,
+    float isovalue,
+    IsosurfaceBlock& mesh,
+    std::vector<std::uint8_t>& above,
+    std::vector<std::int32_t>& ids) {
+
+    const auto& table = marching_table();
+    int c0[3];
+    int c1[3];
+    index.block_cells(block, c0, c1);
+    const int px = c1[0] - c0[0] + 1;
+    const int py = c1[1] - c0[1] + 1;
+    const int pz = c1[2] - c0[2] + 1;
+    const std::size_t npoint = static_cast<std::size_t>(px) * py * pz;
+    above.resize(npoint);
+    ids.assign(3 * npoint, -1);
+    mesh.isovalue = isovalue;
+    mesh.keys.clear();
+    mesh.positions.clear();
+    mesh.normals.clear();
+    mesh.triangles.clear();
+    mesh.foreign_keys.clear();
+
+    float low = std::numeric_limits<float>::lowest();
+    float high = std::numeric_limits<float>::max();
+    for (int lk = 0; lk < pz; lk++) {
+        const int wk = grid.wrap[2][c0[2] + lk];
+        for (int lj = 0; lj < py; lj++) {
+            const float* row = &data.values[data.index(0, grid.wrap[1][c0[1] + lj], wk)];
+            std::uint8_t* out = &above[(static_cast<std::size_t>(lk) * py + lj) * px];
+            for (int li = 0; li < px; li++) {
+                const float value = row[grid.wrap[0][c0[0] + li]];
+                if (value > isovalue) {
+                    out[li] = 1;
+                    high = std::min(high, value);
+                } else {
+                    out[li] = 0;
+                    low = std::max(low, value);
+                }
+            }
+        }
+    }
+    mesh.low = low;
+    mesh.high = high;
+
+    const std::uint64_t nx = grid.ncell[0] + 1;
+    const std::uint64_t ny = grid.ncell[1] + 1;
+    const std::size_t sy = px;
+    const std::size_t sz = static_cast<std::size_t>(px) * py;
+    for (int lk = 0; lk + 1 < pz; lk++) {
+        for (int lj = 0; lj + 1 < py; lj++) {
+            for (int li = 0; li + 1 < px; li++) {
+                const std::size_t p = lk * sz + lj * sy + li;
+                const std::uint8_t* b = above.data();
+                const int mask = b[p] | (b[p + 1] << 1) | (b[p + sy] << 2) | (b[p + sy + 1] << 3)
+                    | (b[p + sz] << 4) | (b[p + sz + 1] << 5) | (b[p + sz + sy] << 6) | (b[p + sz + sy + 1] << 7);
+                if (0 == mask || 255 == mask) {
+                    continue;
+                }
+                const auto& marching_case = table.cases[mask];
+                for (int n = 0; n < marching_case.nedge; n++) {
+                    const int edge = marching_case.edges[n];
+                    const int corner = table.corners[edge];
+                    const int axis = table.axes[edge];
+                    const int d[3] = {corner & 1, (corner >> 1) & 1, (corner >> 2) & 1};
+                    std::int32_t& id = ids[3 * (p + d[0] + d[1] * sy + d[2] * sz) + axis];
+                    if (-1 != id) {
+                        mesh.triangles.push_back(id);
+                        continue;
+                    }
+                    const int g[3] = {c0[0] + li + d[0], c0[1] + lj + d[1], c0[2] + lk + d[2]};
+                    const std::uint64_t key = ((static_cast<std::uint64_t>(g[2]) * ny + g[1]) * nx + g[0]) * 3 + axis;
+                    bool owned = true;
+                    for (int a = 0; a < 3; a++) {
+                        owned = owned && (a == axis || g[a] < c1[a] || c1[a] == grid.ncell[a]);
+                    }
+                    if (true == owned) {
+                        const std::size_t v = mesh.positions.size();
+                        mesh.positions.resize(v + 3);
+                        mesh.normals.resize(v + 3);
+                        interpolate_vertex(data, grid, isovalue, g[0], g[1], g[2], axis, &mesh.positions[v], &mesh.normals[v]);
+                        mesh.keys.push_back(key);
+                        id = static_cast<std::int32_t>(v / 3);
+                    } else {
+                        id = -2 - static_cast<std::int32_t>(mesh.foreign_keys.size());
+                        mesh.foreign_keys.push_back(key);
+                    }
+                    mesh.triangles.push_back(id);
+                }
+            }
+        }
+    }
+
+    // the vertices by key, for the lookups of the neighbours
+    const std::size_t nvertex = mesh.keys.size();
+    if (true == std::is_sorted(mesh.keys.begin(), mesh.keys.end())) {
+        return;
+    }
+    std::vector<std::int32_t> order(nvertex);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::int32_t a, std::int32_t b) {
+        return mesh.keys[a] < mesh.keys[b];
+    });
+    std::vector<std::int32_t> rank(nvertex);
+    std::vector<std::uint64_t> keys(nvertex);
+    std::vector<float> positions(3 * nvertex);
+    std::vector<float> normals(3 * nvertex);
+    for (std::size_t r = 0; r < nvertex; r++) {
+        const std::int32_t v = order[r];
+        rank[v] = static_cast<std::int32_t>(r);
+        keys[r] = mesh.keys[v];
+        std::copy(&mesh.positions[3 * v], &mesh.positions[3 * v] + 3, &positions[3 * r]);
+        std::copy(&mesh.normals[3 * v], &mesh.normals[3 * v] + 3, &normals[3 * r]);
+    }
+    for (auto& id : mesh.triangles) {
+        id = id >= 0 ? rank[id] : id;
+    }
+    mesh.keys.swap(keys);
+    mesh.positions.swap(positions);
+    mesh.normals.swap(normals);
+}
+
+// the vertices of a block whose triangles still hold, at the isovalue
+void move_vertices(const VolumetricData& data, const Grid& grid, float isovalue, IsosurfaceBlock& mesh) {
+    for (std::size_t v = 0; v < mesh.keys.size(); v++) {
+        int point[3];
+        int axis = 0;
+        decode_edge_key(mesh.keys[v], grid, point, axis);
+        interpolate_vertex(data, grid, isovalue, point[0], point[1], point[2], axis, &mesh.positions[3 * v], &mesh.normals[3 * v]);
+    }
+    mesh.isovalue = isovalue;
+}
+
+} // namespace
+
+Isosurface extract_isosurface(const VolumetricData& data, float isovalue) {
+    TRACE_SCOPE_CAT("extract_isosurface", "analysis");
+    Isosurface surface;
+    const Grid grid(data);
+    if (grid.ncell[0] <= 0 || grid.ncell[1] <= 0 || grid.ncell[2] <= 0 || true == data.values.empty()) {
+        return surface;
+    }
+    int nthread = 1;
+#ifdef _OPENMP
+    nthread = omp_get_max_threads();
+#endif
+    // several slabs per thread balance the parts without surface
+    const int nslab = std::min(grid.ncell[2], 4 * nthread);
+    std::vector<Slab> slabs(nslab);
+    for (int s = 0; s < nslab; s++) {
+        slabs[s].z0 = static_cast<int>(static_cast<long>(grid.ncell[2]) * s / nslab);
+        slabs[s].z1 = static_cast<int>(static_cast<long>(grid.ncell[2]) * (s + 1) / nslab);
+    }
+    marching_table();
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int s = 0; s < nslab; s++) {
+        polygonise_slab(data, grid, isovalue, slabs[s]);
+    }
+
+    // join the slabs, the vertices of plane z1 are taken from the next slab
+    std::vector<std::size_t> vertex_offsets(nslab + 1, 0);
+    std::vector<std::size_t> triangle_offsets(nslab + 1, 0);
+    for (int s = 0; s < nslab; s++) {
+        vertex_offsets[s + 1] = vertex_offsets[s] + slabs[s].positions.size() / 3;
+        triangle_offsets[s + 1] = triangle_offsets[s] + slabs[s].triangles.size();
+    }
+    surface.positions.resize(3 * vertex_offsets[nslab]);
+    surface.normals.resize(3 * vertex_offsets[nslab]);
+    surface.triangles.resize(triangle_offsets[nslab]);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int s = 0; s < nslab; s++) {
+        const auto& slab = slabs[s];
+        std::copy(slab.positions.begin(), slab.positions.end(), surface.positions.begin() + 3 * vertex_offsets[s]);
+        std::copy(slab.normals.begin(), slab.normals.end(), surface.normals.begin() + 3 * vertex_offsets[s]);
+        std::uint32_t* out = surface.triangles.data() + triangle_offsets[s];
+        for (const std::int32_t id : slab.triangles) {
+            if (id >= 0) {
+                *out++ = static_cast<std::uint32_t>(vertex_offsets[s] + id);
+                continue;
+            }
+            const auto& bottom = slabs[s + 1].bottom;
+            const std::int32_t key = -2 - id;
+            const auto found = std::lower_bound(bottom.begin(), bottom.end(), std::make_pair(key, std::int32_t{-1}));
+            assert(found != bottom.end() && found->first == key);
+            *out++ = static_cast<std::uint32_t>(vertex_offsets[s + 1] + found->second);
+        }
+    }
+    return surface;
+}
+
+void flip_isosurface(Isosurface& surface) {
+    const long nnormal = static_cast<long>(surface.normals.size());
+#pragma omp parallel for schedule(static)
+    for (long i = 0; i < nnormal; i++) {
+        surface.normals[i] = -surface.normals[i];
+    }
+    const long ntriangle = static_cast<long>(surface.ntriangle());
+#pragma omp parallel for schedule(static)
+    for (long t = 0; t < ntriangle; t++) {
+        std::swap(surface.triangles[3 * t + 1], surface.triangles[3 * t + 2]);
+    }
+}
+
+IsosurfaceIndex::IsosurfaceIndex(const std::shared_ptr<const VolumetricData>& data) : m_data{data} {
+    TRACE_SCOPE_CAT("IsosurfaceIndex::IsosurfaceIndex", "analysis");
+    const Grid grid(*data);
+    for (int a = 0; a < 3; a++) {
+        m_ncell[a] = std::max(0, grid.ncell[a]);
+        m_nblock[a] = (m_ncell[a] + kBlockCells - 1) / kBlockCells;
+    }
+    const int nblock = this->get_nblock();
+    if (0 == nblock || true == data->values.empty()) {
+        return;
+    }
+
+    // the range of the points of every block, its upper faces included
+    Level blocks;
+    std::copy(m_nblock, m_nblock + 3, blocks.n);
+    blocks.ranges.resize(nblock);
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int b = 0; b < nblock; b++) {
+        int c0[3];
+        int c1[3];
+        this->block_cells(b, c0, c1);
+        Range range{std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()};
+        for (int k = c0[2]; k <= c1[2]; k++) {
+            for (int j = c0[1]; j <= c1[1]; j++) {
+                const float* row = &data->values[data->index(0, grid.wrap[1][j], grid.wrap[2][k])];
+                for (int i = c0[0]; i <= c1[0]; i++) {
+                    const float value = row[grid.wrap[0][i]];
+                    range.min = std::min(range.min, value);
+                    range.max = std::max(range.max, value);
+                }
+            }
+        }
+        blocks.ranges[b] = range;
+    }
+    m_levels.push_back(std::move(blocks));
+
+    while (m_levels.back().ranges.size() > 1) {
+        const Level& children = m_levels.back();
+        Level parents;
+        for (int a = 0; a < 3; a++) {
+            parents.n[a] = (children.n[a] + 1) / 2;
+        }
+        const int nparent = parents.n[0] * parents.n[1] * parents.n[2];
+        parents.ranges.resize(nparent);
+#pragma omp parallel for schedule(static)
+        for (int node = 0; node < nparent; node++) {
+            const int x = node % parents.n[0];
+            const int y = node / parents.n[0] % parents.n[1];
+            const int z = node / parents.n[0] / parents.n[1];
+            Range range{std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest()};
+            for (int cz = 2 * z; cz < std::min(2 * z + 2, children.n[2]); cz++) {
+                for (int cy = 2 * y; cy < std::min(2 * y + 2, children.n[1]); cy++) {
+                    for (int cx = 2 * x; cx < std::min(2 * x + 2, children.n[0]); cx++) {
+                        const Range& child = children.ranges[(cz * children.n[1] + cy) * children.n[0] + cx];
+                        range.min = std::min(range.min, child.min);
+                        range.max = std::max(range.max, child.max);
+                    }
+                }
+            }
+            parents.ranges[node] = range;
+        }
+        m_levels.push_back(std::move(parents));
+    }
+}
+
+void IsosurfaceIndex::active_blocks(float isovalue, std::vector<int>& blocks) const {
+    blocks.clear();
+    if (true == m_levels.empty()) {
+        return;
+    }
+    // a cell crosses the isovalue when one corner is above it and one is not
+    std::vector<std::pair<int, int>> stack{{static_cast<int>(m_levels.size()) - 1, 0}};
+    while (false == stack.empty()) {
+        const auto [level, node] = stack.back();
+        stack.pop_back();
+        const Level& nodes = m_levels[level];
+        const Range& range = nodes.ranges[node];
+        if (false == (range.min <= isovalue && isovalue < range.max)) {
+            continue;
+        }
+        if (0 == level) {
+            blocks.push_back(node);
+            continue;
+        }
+        const Level& children = m_levels[level - 1];
+        const int x = node % nodes.n[0];
+        const int y = node / nodes.n[0] % nodes.n[1];
+        const int z = node / nodes.n[0] / nodes.n[1];
+        for (int cz = 2 * z; cz < std::min(2 * z + 2, children.n[2]); cz++) {
+            for (int cy = 2 * y; cy < std::min(2 * y + 2, children.n[1]); cy++) {
+                for (int cx = 2 * x; cx < std::min(2 * x + 2, children.n[0]); cx++) {
+                    stack.emplace_back(level - 1, (cz * children.n[1] + cy) * children.n[0] + cx);
+                }
+            }
+        }
+    }
+    std::sort(blocks.begin(), blocks.end());
+}
+
+void IsosurfaceIndex::block_cells(int block, int c0[3], int c1[3]) const {
+    const int b[3] = {block % m_nblock[0], block / m_nblock[0] % m_nblock[1], block / m_nblock[0] / m_nblock[1]};
+    for (int a = 0; a < 3; a++) {
+        c0[a] = b[a] * kBlockCells;
+        c1[a] = std::min(c0[a] + kBlockCells, m_ncell[a]);
+    }
+}
+
+int IsosurfaceIndex::block_of_point(int i, int j, int k) const {
+    const int bx = std::min(i / kBlockCells, m_nblock[0] - 1);
+    const int by = std::min(j / kBlockCells, m_nblock[1] - 1);
+    const int bz = std::min(k / kBlockCells, m_nblock[2] - 1);
+    return (bz * m_nblock[1] + by) * m_nblock[0] + bx;
+}
+
+IsosurfaceExtractor::IsosurfaceExtractor(const std::shared_ptr<const IsosurfaceIndex>& index, bool flipped)
+    : m_index{index}, m_flipped{flipped} {
+    m_meshes.resize(index->get_nblock());
+    m_slots.assign(index->get_nblock(), -1);
+}
+
+IsosurfaceExtractor::~IsosurfaceExtractor() = default;
+
+const Isosurface& IsosurfaceExtractor::extract(float isovalue) {
+    TRACE_SCOPE_CAT("IsosurfaceExtractor::extract", "analysis");
+    const auto start = std::chrono::steady_clock::now();
+    if (true == m_extracted && isovalue == m_isovalue) {
+        m_statistics = Statistics{};
+        m_statistics.nactive = m_active.size();
+        m_statistics.nreused = m_active.size();
+        return m_surface;
+    }
+    const VolumetricData& data = m_index->get_data();
+    const Grid grid(data);
+
+    // the meshes of the blocks left behind are dropped
+    std::vector<int> active;
+    m_index->active_blocks(isovalue, active);
+    for (const int block : m_active) {
+        m_slots[block] = -1;
+    }
+    for (std::size_t s = 0; s < active.size(); s++) {
+        m_slots[active[s]] = static_cast<int>(s);
+    }
+    for (const int block : m_active) {
+        if (m_slots[block] < 0) {
+            m_meshes[block].reset();
+        }
+    }
+    m_active.swap(active);
+
+    const long nactive = static_cast<long>(m_active.size());
+    // 0 polygonised, 1 moved, 2 reused
+    std::vector<std::uint8_t> work(nactive, 0);
+#pragma omp parallel
+    {
+        std::vector<std::uint8_t> above;
+        std::vector<std::int32_t> ids;
+#pragma omp for schedule(dynamic, 8)
+        for (long s = 0; s < nactive; s++) {
+            const int block = m_active[s];
+            auto& mesh = m_meshes[block];
+            if (nullptr != mesh && mesh->isovalue == isovalue) {
+                work[s] = 2;
+            } else if (nullptr != mesh && mesh->low <= isovalue && isovalue < mesh->high) {
+                move_vertices(data, grid, isovalue, *mesh);
+                work[s] = 1;
+            } else {
+                if (nullptr == mesh) {
+                    mesh = std::make_unique<IsosurfaceBlock>();
+                }
+                polygonise_block(data, grid, *m_index, block, isovalue, *mesh, above, ids);
+            }
+        }
+    }
+
+    // join the blocks, the foreign vertices are looked up in their blocks
+    std::vector<std::size_t> vertex_offsets(nactive + 1, 0);
+    std::vector<std::size_t> triangle_offsets(nactive + 1, 0);
+    for (long s = 0; s < nactive; s++) {
+        const auto& mesh = *m_meshes[m_active[s]];
+        vertex_offsets[s + 1] = vertex_offsets[s] + mesh.keys.size();
+        triangle_offsets[s + 1] = triangle_offsets[s] + mesh.triangles.size();
+    }
+    m_surface.positions.resize(3 * vertex_offsets[nactive]);
+    m_surface.normals.resize(3 * vertex_offsets[nactive]);
+    m_surface.triangles.resize(triangle_offsets[nactive]);
+    const float sign = true == m_flipped ? -1.0f : 1.0f;
+#pragma omp parallel for schedule(dynamic, 8)
+    for (long s = 0; s < nactive; s++) {
+        const auto& mesh = *m_meshes[m_active[s]];
+        std::copy(mesh.positions.begin(), mesh.positions.end(), m_surface.positions.begin() + 3 * vertex_offsets[s]);
+        float* normals = m_surface.normals.data() + 3 * vertex_offsets[s];
+        for (std::size_t i = 0; i < mesh.normals.size(); i++) {
+            normals[i] = sign * mesh.normals[i];
+        }
+        std::uint32_t* out = m_surface.triangles.data() + triangle_offsets[s];
+        for (std::size_t t = 0; t < mesh.triangles.size(); t++) {
+            const std::int32_t id = mesh.triangles[t];
+            if (id >= 0) {
+                out[t] = static_cast<std::uint32_t>(vertex_offsets[s] + id);
+                continue;
+            }
+            const std::uint64_t key = mesh.foreign_keys[-2 - id];
+            int point[3];
+            int axis = 0;
+            decode_edge_key(key, grid, point, axis);
+            const int slot = m_slots[m_index->block_of_point(point[0], point[1], point[2])];
+            assert(slot >= 0);
+            const auto& owner = *m_meshes[m_active[slot]];
+            const auto found = std::lower_bound(owner.keys.begin(), owner.keys.end(), key);
+            assert(found != owner.keys.end() && *found == key);
+            out[t] = static_cast<std::uint32_t>(vertex_offsets[slot] + (found - owner.keys.begin()));
+        }
+        if (true == m_flipped) {
+            for (std::size_t t = 0; t + 2 < mesh.triangles.size(); t += 3) {
+                std::swap(out[t + 1], out[t + 2]);
+            }
+        }
+    }
+
+    m_isovalue = isovalue;
+    m_extracted = true;
+    m_statistics = Statistics{};
+    m_statistics.nactive = m_active.size();
+    for (const auto w : work) {
+        m_statistics.npolygonised += 0 == w ? 1 : 0;
+        m_statistics.nmoved += 1 == w ? 1 : 0;
+        m_statistics.nreused += 2 == w ? 1 : 0;
+    }
+    m_statistics.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return m_surface;
+}
@@ -0,0 +1,155 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Isosurfaces of volumetric data by marching cubes.
+///
+/// The cells are cut into slabs along z that are polygonised in parallel.
+/// Within a slab every vertex is created once per grid edge and shared by
+/// the cells around it; the vertices on the plane between two slabs
+/// belong to the upper slab and are looked up from it when the slabs are
+/// joined, so the mesh has no duplicated vertices. Normals are the
+/// interpolated gradients of the data.
+///
+/// The triangulation of each of the 256 corner cases is built from the
+/// loops the surface cuts on the cell faces, separating the corners above
+/// the isovalue on ambiguous faces; neighbouring cells agree on every
+/// face and the surface has no cracks.
+///
+/// For isovalues that change interactively, IsosurfaceIndex keeps the
+/// value range of every block of 8^3 cells in an octree (a span-space
+/// index), so only the blocks whose range contains the isovalue are
+/// visited. IsosurfaceExtractor polygonises those blocks in parallel and
+/// keeps their meshes: a block is reused as it is for the same isovalue,
+/// and only its vertices are moved while no point of the block crosses
+/// the isovalue, which keeps the triangles valid.
+
+#ifndef ANALYSIS_ISOSURFACE_H
+#define ANALYSIS_ISOSURFACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "analysis/volumetric.h"
+
+struct Isosurface {
+    // A, x y z of every vertex
+    std::vector<float> positions;
+    // unit normals towards the lower values
+    std::vector<float> normals;
+    // three vertices per triangle, counter-clockwise seen from the lower
+    // values
+    std::vector<std::uint32_t> triangles;
+
+    std::size_t nvertex() const {
+        return positions.size() / 3;
+    }
+    std::size_t ntriangle() const {
+        return triangles.size() / 3;
+    }
+};
+
+// the surface where the data crosses isovalue; for periodic data the
+// cells between the last points and the images of the first are added,
+// so the surface reaches the faces of the cell
+Isosurface extract_isosurface(const VolumetricData& data, float isovalue);
+// turns the normals and the winding around, e.g. to face away from the
+// lobes below a negative isovalue
+void flip_isosurface(Isosurface& surface);
+
+class IsosurfaceIndex {
+public:
+    // cells along each edge of a block
+    static const int kBlockCells = 8;
+
+    explicit IsosurfaceIndex(const std::shared_ptr<const VolumetricData>& data);
+
+    // the blocks with cells crossing isovalue, ascending
+    void active_blocks(float isovalue, std::vector<int>& blocks) const;
+
+    const VolumetricData& get_data() const {
+        return *m_data;
+    }
+    int get_nblock() const {
+        return m_nblock[0] * m_nblock[1] * m_nblock[2];
+    }
+    // the cells [c0, c1) of a block
+    void block_cells(int block, int c0[3], int c1[3]) const;
+    // the block whose cells start at or contain point (i, j, k)
+    int block_of_point(int i, int j, int k) const;
+
+private:
+    struct Range {
+        float min;
+        float max;
+    };
+    struct Level {
+        int n[3];
+        std::vector<Range> ranges;
+    };
+
+    std::shared_ptr<const VolumetricData> m_data;
+    int m_ncell[3] = {0, 0, 0};
+    int m_nblock[3] = {0, 0, 0};
+    // the blocks first, then 2^3 blocks per node up to a single root
+    std::vector<Level> m_levels;
+};
+
+// the mesh of one block, see isosurface.cpp
+struct IsosurfaceBlock;
+
+class IsosurfaceExtractor {
+public:
+    // flipped turns the normals and the winding around, see
+    // flip_isosurface
+    explicit IsosurfaceExtractor(const std::shared_ptr<const IsosurfaceIndex>& index, bool flipped = false);
+    ~IsosurfaceExtractor();
+
+    // the same surface as extract_isosurface, valid until the next call
+    const Isosurface& extract(float isovalue);
+
+    struct Statistics {
+        std::size_t nactive = 0;
+        // blocks polygonised, with moved vertices and taken as they were
+        std::size_t npolygonised = 0;
+        std::size_t nmoved = 0;
+        std::size_t nreused = 0;
+        double milliseconds = 0.0;
+    };
+    const Statistics& get_statistics() const {
+        return m_statistics;
+    }
+
+private:
+    std::shared_ptr<const IsosurfaceIndex> m_index;
+    bool m_flipped = false;
+    // the meshes of the blocks of the last isovalue, by block
+    std::vector<std::unique_ptr<IsosurfaceBlock>> m_meshes;
+    std::vector<int> m_active;
+    // position of a block in m_active, -1 when it is not active
+    std::vector<int> m_slots;
+    bool m_extracted = false;
+    float m_isovalue = 0.0f;
+    Isosurface m_surface;
+    Statistics m_statistics;
+};
+
+#endif // ANALYSIS_ISOSURFACE_H
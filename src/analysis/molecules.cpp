@@ -0,0 +1,455 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "analysis/molecules.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iterator>
+#include <map>
+#include <unordered_map>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "analysis/cell_list.h"
+#include "utils/trace.h"
+
+namespace {
+
+bool bond_less(const Bond& lhs, const Bond& rhs) {
+    return lhs.i != rhs.i ? lhs.i < rhs.i : lhs.j < rhs.j;
+}
+
+// the root of i, halving the path on the way; safe to run concurrently
+// with unite since parents only ever move towards the root
+int find_root(std::vector<std::atomic<int>>& parent, int i) {
+    while (true) {
+        int p = parent[i].load(std::memory_order_relaxed);
+        if (p == i) {
+            return i;
+        }
+        const int grandparent = parent[p].load(std::memory_order_relaxed);
+        if (grandparent != p) {
+            parent[i].compare_exchange_weak(p, grandparent, std::memory_order_relaxed);
+        }
+        i = grandparent;
+    }
+}
+
+// links the root with the larger index below the other, so that a
+// successful compare-exchange can not create a cycle
+void unite(std::vector<std::atomic<int>>& parent, int i, int j) {
+    while (true) {
+        i = find_root(parent, i);
+        j = find_root(parent, j);
+        if (i == j) {
+            return;
+        }
+        if (i < j) {
+            std::swap(i, j);
+        }
+        int expected = i;
+        if (parent[i].compare_exchange_strong(expected, j, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+// standard atomic weights of H to Pu
+const char* const kElements[] = {
+    "H", "He", "Li", "Be", "B", "C", "N", "O", "F", "Ne",
+    "Na", "Mg", "Al", "Si", "P", "S", "Cl", "Ar", "K", "Ca",
+    "Sc", "Ti", "V", "Cr", "Mn", "Fe", "Co", "Ni", "Cu", "Zn",
+    "Ga", "Ge", "As", "Se", "Br", "Kr", "Rb", "Sr", "Y", "Zr",
+    "Nb", "Mo", "Tc", "Ru", "Rh", "Pd", "Ag", "Cd", "In", "Sn",
+    "Sb", "Te", "I", "Xe", "Cs", "Ba", "La", "Ce", "Pr", "Nd",
+    "Pm", "Sm", "Eu", "Gd", "Tb", "Dy", "Ho", "Er", "Tm", "Yb",
+    "Lu", "Hf", "Ta", "W", "Re", "Os", "Ir", "Pt", "Au", "Hg",
+    "Tl", "Pb", "Bi", "Po", "At", "Rn", "Fr", "Ra", "Ac", "Th",
+    "Pa", "U", "Np", "Pu",
+};
+const double kMasses[] = {
+    1.008, 4.0026, 6.94, 9.0122, 10.81, 12.011, 14.007, 15.999, 18.998, 20.180,
+    22.990, 24.305, 26.982, 28.085, 30.974, 32.06, 35.45, 39.948, 39.098, 40.078,
+    44.956, 47.867, 50.942, 51.996, 54.938, 55.845, 58.933, 58.693, 63.546, 65.38,
+    69.723, 72.630, 74.922, 78.971, 79.904, 83.798, 85.468, 87.62, 88.906, 91.224,
+    92.906, 95.95, 97.0, 101.07, 102.91, 106.42, 107.87, 112.41, 114.82, 118.71,
+    121.76, 127.60, 126.90, 131.29, 132.91, 137.33, 138.91, 140.12, 140.91, 144.24,
+    145.0, 150.36, 151.96, 157.25, 158.93, 162.50, 164.93, 167.26, 168.93, 173.05,
+    174.97, 178.49, 180.95, 183.84, 186.21, 190.23, 192.22, 195.08, 196.97, 200.59,
+    204.38, 207.2, 208.98, 209.0, 210.0, 222.0, 223.0, 226.0, 227.0, 232.04,
+    231.04, 238.03, 237.0, 244.0,
+};
+
+// Hill order: C, H, then the others alphabetically; without carbon all
+// alphabetically
+std::string hill_formula(const std::map<std::string, int>& counts) {
+    std::string formula;
+    auto append = [&formula](const std::string& name, int count) {
+        formula += name;
+        if (count > 1) {
+            formula += std::to_string(count);
+        }
+    };
+    const bool carbon = counts.count("C") > 0;
+    if (true == carbon) {
+        append("C", counts.at("C"));
+        if (counts.count("H") > 0) {
+            append("H", counts.at("H"));
+        }
+    }
+    for (const auto& item : counts) {
+        if (true == carbon && ("C" == item.first || "H" == item.first)) {
+            continue;
+        }
+        append(item.first, item.second);
+    }
+    return formula;
+}
+
+// neighbours in compressed rows, the neighbours of i are
+// neighbours[start[i]..start[i + 1])
+void bond_graph(int natom, const std::vector<Bond>& bonds, std::vector<int>& start, std::vector<int>& neighbours) {
+    start.assign(natom + 1, 0);
+    for (const auto& bond : bonds) {
+        start[bond.i + 1]++;
+        start[bond.j + 1]++;
+    }
+    for (int i = 0; i < natom; i++) {
+        start[i + 1] += start[i];
+    }
+    neighbours.resize(start[natom]);
+    std::vector<int> fill(start.begin(), start.end() - 1);
+    for (const auto& bond : bonds) {
+        neighbours[fill[bond.i]++] = bond.j;
+        neighbours[fill[bond.j]++] = bond.i;
+    }
+}
+
+// dense molecules from any labelling of the atoms
+Molecules molecules_from_labels(const std::vector<int>& labels, int nlabel) {
+    const int natom = static_cast<int>(labels.size());
+    Molecules molecules;
+    molecules.molecule_of.resize(natom);
+    std::vector<int> dense(nlabel, -1);
+    int count = 0;
+    for (int i = 0; i < natom; i++) {
+        int& molecule = dense[labels[i]];
+        if (molecule < 0) {
+            molecule = count++;
+        }
+        molecules.molecule_of[i] = molecule;
+    }
+    molecules.start.assign(count + 1, 0);
+    for (int i = 0; i < natom; i++) {
+        molecules.start[molecules.molecule_of[i] + 1]++;
+    }
+    for (int m = 0; m < count; m++) {
+        molecules.start[m + 1] += molecules.start[m];
+    }
+    molecules.atoms.resize(natom);
+    std::vector<int> fill(molecules.start.begin(), molecules.start.end() - 1);
+    for (int i = 0; i < natom; i++) {
+        molecules.atoms[fill[molecules.molecule_of[i]]++] = i;
+    }
+    return molecules;
+}
+
+} // namespace
+
+Molecules find_molecules(int natom, const std::vector<Bond>& bonds) {
+    TRACE_SCOPE_CAT("find_molecules", "analysis");
+    std::vector<std::atomic<int>> parent(natom);
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < natom; i++) {
+        parent[i].store(i, std::memory_order_relaxed);
+    }
+    const long nbond = static_cast<long>(bonds.size());
+#pragma omp parallel for schedule(static)
+    for (long b = 0; b < nbond; b++) {
+        unite(parent, bonds[b].i, bonds[b].j);
+    }
+    std::vector<int> roots(natom);
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < natom; i++) {
+        roots[i] = find_root(parent, i);
+    }
+    return molecules_from_labels(roots, natom);
+}
+
+std::vector<double> unwrap_molecules(const Frame& frame, const Molecules& molecules, const std::vector<Bond>& bonds) {
+    TRACE_SCOPE_CAT("unwrap_molecules", "analysis");
+    std::vector<double> positions = frame.positions;
+    const Lattice lattice = Lattice::from_cell(frame.cell);
+    if (false == lattice.periodic) {
+        return positions;
+    }
+    const int natom = frame.natom();
+    std::vector<int> start;
+    std::vector<int> neighbours;
+    bond_graph(natom, bonds, start, neighbours);
+    std::vector<char> placed(natom, 0);
+    const int count = molecules.count();
+#pragma omp parallel
+    {
+        std::vector<int> queue;
+#pragma omp for schedule(dynamic, 64)
+        for (int m = 0; m < count; m++) {
+            // breadth first from the first atom, every atom of the
+            // molecule is placed by exactly one thread
+            queue.assign(1, molecules.atoms[molecules.start[m]]);
+            placed[queue[0]] = 1;
+            for (std::size_t q = 0; q < queue.size(); q++) {
+                const int i = queue[q];
+                for (int n = start[i]; n < start[i + 1]; n++) {
+                    const int j = neighbours[n];
+                    if (0 != placed[j]) {
+                        continue;
+                    }
+                    placed[j] = 1;
+                    double d[3];
+                    for (int k = 0; k < 3; k++) {
+                        d[k] = frame.positions[3 * j + k] - frame.positions[3 * i + k];
+                    }
+                    lattice.minimum_image(d);
+                    for (int k = 0; k < 3; k++) {
+                        positions[3 * j + k] = positions[3 * i + k] + d[k];
+                    }
+                    queue.push_back(j);
+                }
+            }
+        }
+    }
+    return positions;
+}
+
+double atomic_mass(const std::string& name) {
+    static const std::unordered_map<std::string, double> masses = []() {
+        std::unordered_map<std::string, double> table;
+        for (std::size_t z = 0; z < sizeof(kMasses) / sizeof(kMasses[0]); z++) {
+            table[kElements[z]] = kMasses[z];
+        }
+        return table;
+    }();
+    const auto found = masses.find(name);
+    return found == masses.end() ? 1.0 : found->second;
+}
+
+std::string element_symbol(int z) {
+    const int nelement = sizeof(kElements) / sizeof(kElements[0]);
+    return z >= 1 && z <= nelement ? kElements[z - 1] : "X";
+}
+
+std::vector<MoleculeProperties> molecule_properties(
+    const Frame& frame,
+    const SpeciesTable& species_table,
+    const Molecules& molecules,
+    const std::vector<Bond>& bonds
+) {
+    TRACE_SCOPE_CAT("molecule_properties", "analysis");
+    const std::vector<double> positions = unwrap_molecules(frame, molecules, bonds);
+    std::vector<double> species_masses(species_table.size());
+    for (int s = 0; s < species_table.size(); s++) {
+        species_masses[s] = atomic_mass(species_table.names[s]);
+    }
+    const bool charged = frame.charges.size() == static_cast<std::size_t>(frame.natom());
+    const int count = molecules.count();
+    std::vector<MoleculeProperties> properties(count);
+
+    // the atoms of a molecule are contiguous in molecules.atoms, each
+    // pass runs over one molecule's slice
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int m = 0; m < count; m++) {
+        auto& property = properties[m];
+        const int* atoms = &molecules.atoms[molecules.start[m]];
+        const int natom = molecules.start[m + 1] - molecules.start[m];
+        property.natom = natom;
+
+        // formula and mass
+        std::map<std::string, int> counts;
+        double mass = 0.0;
+        double sum[3] = {0.0, 0.0, 0.0};
+        for (int a = 0; a < natom; a++) {
+            const int i = atoms[a];
+            const int s = frame.species[i];
+            counts[s < species_table.size() ? species_table.names[s] : std::to_string(s)]++;
+            const double w = s < species_table.size() ? species_masses[s] : 1.0;
+            mass += w;
+            for (int k = 0; k < 3; k++) {
+                sum[k] += w * positions[3 * i + k];
+            }
+        }
+        property.formula = hill_formula(counts);
+        property.mass = mass;
+        for (int k = 0; k < 3; k++) {
+            property.centre[k] = sum[k] / mass;
+        }
+
+        // dipole and radius of gyration about the centre of mass
+        double r2 = 0.0;
+        for (int a = 0; a < natom; a++) {
+            const int i = atoms[a];
+            const int s = frame.species[i];
+            const double w = s < species_table.size() ? species_masses[s] : 1.0;
+            const double q = true == charged ? frame.charges[i] : 0.0;
+            for (int k = 0; k < 3; k++) {
+                const double d = positions[3 * i + k] - property.centre[k];
+                r2 += w * d * d;
+                property.dipole[k] += q * d;
+            }
+        }
+        property.radius_of_gyration = std::sqrt(r2 / mass);
+    }
+    return properties;
+}
+
+void MoleculeTracker::reset(int natom, const std::vector<Bond>& bonds) {
+    TRACE_SCOPE_CAT("MoleculeTracker::reset", "analysis");
+    m_bonds = bonds;
+    const Molecules molecules = find_molecules(natom, bonds);
+    m_label = molecules.molecule_of;
+    m_count = molecules.count();
+    m_members.assign(m_count, std::vector<int>());
+    for (int m = 0; m < m_count; m++) {
+        m_members[m].assign(molecules.atoms.begin() + molecules.start[m], molecules.atoms.begin() + molecules.start[m + 1]);
+    }
+    m_free_labels.clear();
+    m_neighbours.assign(natom, std::vector<int>());
+    for (const auto& bond : bonds) {
+        m_neighbours[bond.i].push_back(bond.j);
+        m_neighbours[bond.j].push_back(bond.i);
+    }
+    m_visited.assign(natom, 0);
+    m_generation = 0;
+    m_touched = natom;
+}
+
+void MoleculeTracker::update(const std::vector<Bond>& bonds) {
+    // both lists are sorted, one merge gives the differences
+    std::vector<Bond> added;
+    std::vector<Bond> removed;
+    std::set_difference(bonds.begin(), bonds.end(), m_bonds.begin(), m_bonds.end(), std::back_inserter(added), bond_less);
+    std::set_difference(m_bonds.begin(), m_bonds.end(), bonds.begin(), bonds.end(), std::back_inserter(removed), bond_less);
+    this->apply(added, removed);
+    m_bonds = bonds;
+}
+
+void MoleculeTracker::update(const std::vector<Bond>& added, const std::vector<Bond>& removed) {
+    this->apply(added, removed);
+    std::vector<Bond> sorted_added = added;
+    std::vector<Bond> sorted_removed = removed;
+    std::sort(sorted_added.begin(), sorted_added.end(), bond_less);
+    std::sort(sorted_removed.begin(), sorted_removed.end(), bond_less);
+    std::vector<Bond> kept;
+    std::set_difference(m_bonds.begin(), m_bonds.end(), sorted_removed.begin(), sorted_removed.end(), std::back_inserter(kept), bond_less);
+    m_bonds.clear();
+    std::merge(kept.begin(), kept.end(), sorted_added.begin(), sorted_added.end(), std::back_inserter(m_bonds), bond_less);
+}
+
+void MoleculeTracker::apply(const std::vector<Bond>& added, const std::vector<Bond>& removed) {
+    TRACE_SCOPE_CAT("MoleculeTracker::apply", "analysis");
+    m_touched = 0;
+    std::vector<int> touched_labels;
+    for (const auto& bond : removed) {
+        auto& ni = m_neighbours[bond.i];
+        auto& nj = m_neighbours[bond.j];
+        ni.erase(std::find(ni.begin(), ni.end(), bond.j));
+        nj.erase(std::find(nj.begin(), nj.end(), bond.i));
+        touched_labels.push_back(m_label[bond.i]);
+    }
+    std::sort(touched_labels.begin(), touched_labels.end());
+    touched_labels.erase(std::unique(touched_labels.begin(), touched_labels.end()), touched_labels.end());
+    for (const int label : touched_labels) {
+        this->recluster(label);
+    }
+
+    // new bonds merge the smaller component into the larger
+    for (const auto& bond : added) {
+        m_neighbours[bond.i].push_back(bond.j);
+        m_neighbours[bond.j].push_back(bond.i);
+        int keep = m_label[bond.i];
+        int drop = m_label[bond.j];
+        if (keep == drop) {
+            continue;
+        }
+        if (m_members[keep].size() < m_members[drop].size()) {
+            std::swap(keep, drop);
+        }
+        for (const int i : m_members[drop]) {
+            m_label[i] = keep;
+        }
+        m_touched += m_members[drop].size();
+        m_members[keep].insert(m_members[keep].end(), m_members[drop].begin(), m_members[drop].end());
+        std::vector<int>().swap(m_members[drop]);
+        m_free_labels.push_back(drop);
+        m_count--;
+    }
+}
+
+void MoleculeTracker::recluster(int label) {
+    std::vector<int> members;
+    members.swap(m_members[label]);
+    m_touched += members.size();
+    if (0 == ++m_generation) {
+        std::fill(m_visited.begin(), m_visited.end(), 0);
+        m_generation = 1;
+    }
+    // breadth first over the members only, the first piece keeps the label
+    bool first = true;
+    m_count--;
+    for (const int seed : members) {
+        if (m_generation == m_visited[seed]) {
+            continue;
+        }
+        const int piece = true == first ? label : this->new_label();
+        first = false;
+        m_count++;
+        auto& piece_members = m_members[piece];
+        piece_members.push_back(seed);
+        m_visited[seed] = m_generation;
+        for (std::size_t q = 0; q < piece_members.size(); q++) {
+            const int i = piece_members[q];
+            m_label[i] = piece;
+            for (const int j : m_neighbours[i]) {
+                if (m_generation != m_visited[j]) {
+                    m_visited[j] = m_generation;
+                    piece_members.push_back(j);
+                }
+            }
+        }
+    }
+}
+
+int MoleculeTracker::new_label() {
+    if (false == m_free_labels.empty()) {
+        const int label = m_free_labels.back();
+        m_free_labels.pop_back();
+        return label;
+    }
+    m_members.emplace_back();
+    return static_cast<int>(m_members.size()) - 1;
+}
+
+Molecules MoleculeTracker::molecules() const {
+    return molecules_from_labels(m_label, static_cast<int>(m_members.size()));
+}
@@ -0,0 +1,127 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Molecules as the connected components of the bond graph, and their
+/// properties.
+///
+/// The components are found by a lock-free union-find over the bonds in
+/// parallel. MoleculeTracker keeps them up to date while the bonds change
+/// from frame to frame: new bonds merge two components, and removed bonds
+/// only re-cluster the components they were part of.
+
+#ifndef ANALYSIS_MOLECULES_H
+#define ANALYSIS_MOLECULES_H
+
+#include <string>
+#include <vector>
+
+#include "analysis/bonds.h"
+#include "analysis/frame.h"
+
+struct Molecules {
+    // molecule of every atom, molecules ordered by their first atom
+    std::vector<int> molecule_of;
+    // the atoms of molecule m are atoms[start[m]..start[m + 1]), ascending
+    std::vector<int> start;
+    std::vector<int> atoms;
+
+    int count() const {
+        return static_cast<int>(start.size()) - 1;
+    }
+};
+
+Molecules find_molecules(int natom, const std::vector<Bond>& bonds);
+
+// the positions with every molecule whole: walking the bonds outwards
+// from the first atom of a molecule, each atom is put at the minimum
+// image of the atom it was reached from
+std::vector<double> unwrap_molecules(const Frame& frame, const Molecules& molecules, const std::vector<Bond>& bonds);
+
+// standard atomic weight of an element, 1 for unknown names such as
+// LAMMPS types
+double atomic_mass(const std::string& name);
+// the symbol of atomic number z, "X" outside H to Pu
+std::string element_symbol(int z);
+
+struct MoleculeProperties {
+    // Hill order, e.g. CH4O
+    std::string formula;
+    int natom = 0;
+    // amu
+    double mass = 0.0;
+    // A, of the unwrapped molecule, may lie outside the cell
+    double centre[3] = {0.0, 0.0, 0.0};
+    // e A about the centre of mass, zero without charges
+    double dipole[3] = {0.0, 0.0, 0.0};
+    // A, mass weighted
+    double radius_of_gyration = 0.0;
+};
+
+std::vector<MoleculeProperties> molecule_properties(
+    const Frame& frame,
+    const SpeciesTable& species_table,
+    const Molecules& molecules,
+    const std::vector<Bond>& bonds
+);
+
+class MoleculeTracker {
+public:
+    void reset(int natom, const std::vector<Bond>& bonds);
+
+    // the bonds of the next frame, sorted as from detect_bonds
+    void update(const std::vector<Bond>& bonds);
+    // the bonds with i < j that appeared and disappeared
+    void update(const std::vector<Bond>& added, const std::vector<Bond>& removed);
+
+    int count() const {
+        return m_count;
+    }
+    int get_natom() const {
+        return static_cast<int>(m_label.size());
+    }
+    // renumbered as by find_molecules
+    Molecules molecules() const;
+    const std::vector<Bond>& get_bonds() const {
+        return m_bonds;
+    }
+    // the atoms the last update relabelled
+    std::size_t get_touched() const {
+        return m_touched;
+    }
+
+private:
+    void apply(const std::vector<Bond>& added, const std::vector<Bond>& removed);
+    void recluster(int label);
+    int new_label();
+
+    std::vector<Bond> m_bonds;
+    std::vector<std::vector<int>> m_neighbours;
+    // component label of every atom, labels are reused
+    std::vector<int> m_label;
+    std::vector<std::vector<int>> m_members;
+    std::vector<int> m_free_labels;
+    // visit marks of recluster, compared against m_generation
+    std::vector<unsigned> m_visited;
+    unsigned m_generation = 0;
+    int m_count = 0;
+    std::size_t m_touched = 0;
+};
+
+#endif // ANALYSIS_MOLECULES_H
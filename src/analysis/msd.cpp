@@ -0,0 +1,208 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "analysis/msd.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <armadillo>
+
+#include "analysis/cell_list.h"
+#include "utils/trace.h"
+
+namespace {
+
+std::size_t fft_size(std::size_t nframe) {
+    std::size_t n = 1;
+    while (n < 2 * nframe) {
+        n <<= 1;
+    }
+    return n;
+}
+
+} // namespace
+
+std::vector<double> atom_msd(const double* x, const double* y, const double* z, std::size_t nframe) {
+    std::vector<double> msd(nframe, 0.0);
+    if (0 == nframe) {
+        return msd;
+    }
+    const std::size_t n = fft_size(nframe);
+    // squares of r(t) and the autocorrelation, summed over x y z
+    std::vector<double> squares(nframe, 0.0);
+    std::vector<double> correlation(nframe, 0.0);
+    for (const double* series : {x, y, z}) {
+        // centred, the MSD does not depend on the origin and smaller
+        // values lose less to the cancellation in S1 - 2 * S2
+        double mean = 0.0;
+        for (std::size_t t = 0; t < nframe; t++) {
+            mean += series[t];
+        }
+        mean /= nframe;
+        arma::vec values(nframe);
+        for (std::size_t t = 0; t < nframe; t++) {
+            values[t] = series[t] - mean;
+            squares[t] += values[t] * values[t];
+        }
+        const arma::cx_vec spectrum = arma::fft(values, n);
+        const arma::vec autocorrelation = arma::real(arma::ifft(arma::cx_vec(spectrum % arma::conj(spectrum))));
+        for (std::size_t m = 0; m < nframe; m++) {
+            correlation[m] += autocorrelation[m];
+        }
+    }
+
+    double q = 0.0;
+    for (std::size_t t = 0; t < nframe; t++) {
+        q += 2.0 * squares[t];
+    }
+    for (std::size_t m = 0; m < nframe; m++) {
+        if (m > 0) {
+            q -= squares[m - 1] + squares[nframe - m];
+        }
+        const double count = static_cast<double>(nframe - m);
+        msd[m] = std::max(0.0, q / count - 2.0 * correlation[m] / count);
+    }
+    return msd;
+}
+
+DiffusionFit fit_diffusion(const std::vector<double>& msd, double time_step, double begin_fraction, double end_fraction) {
+    DiffusionFit fit;
+    const std::size_t nframe = msd.size();
+    std::size_t begin = static_cast<std::size_t>(begin_fraction * nframe);
+    std::size_t end = std::min(nframe, static_cast<std::size_t>(end_fraction * nframe));
+    if (end < begin + 2) {
+        begin = 0;
+        end = nframe;
+    }
+    if (end < 2) {
+        return fit;
+    }
+    double sum_t = 0.0, sum_m = 0.0, sum_tt = 0.0, sum_tm = 0.0;
+    for (std::size_t k = begin; k < end; k++) {
+        const double t = k * time_step;
+        sum_t += t;
+        sum_m += msd[k];
+        sum_tt += t * t;
+        sum_tm += t * msd[k];
+    }
+    const double count = static_cast<double>(end - begin);
+    const double denominator = count * sum_tt - sum_t * sum_t;
+    if (std::fabs(denominator) < 1.0e-300) {
+        return fit;
+    }
+    fit.slope = (count * sum_tm - sum_t * sum_m) / denominator;
+    fit.intercept = (sum_m - fit.slope * sum_t) / count;
+    fit.diffusion = fit.slope / 6.0;
+    return fit;
+}
+
+void MsdAnalysis::add_frame(const Frame& frame) {
+    const int natom = frame.natom();
+    if (0 == m_nframe) {
+        m_species = frame.species;
+        m_previous = frame.positions;
+        m_current = frame.positions;
+        m_unwrapped.assign(3 * natom, std::vector<double>());
+    } else if (static_cast<std::size_t>(natom) != m_species.size()) {
+        m_nskipped++;
+        return;
+    } else {
+        const Lattice lattice = Lattice::from_cell(frame.cell);
+        for (int i = 0; i < natom; i++) {
+            double d[3];
+            for (int k = 0; k < 3; k++) {
+                d[k] = frame.positions[3 * i + k] - m_previous[3 * i + k];
+            }
+            lattice.minimum_image(d);
+            for (int k = 0; k < 3; k++) {
+                m_current[3 * i + k] += d[k];
+            }
+        }
+        m_previous = frame.positions;
+    }
+    for (std::size_t c = 0; c < m_unwrapped.size(); c++) {
+        m_unwrapped[c].push_back(m_current[c]);
+    }
+    m_nframe++;
+}
+
+MsdResult MsdAnalysis::result(const SpeciesTable& species_table) const {
+    TRACE_SCOPE_CAT("MsdAnalysis::result", "analysis");
+    MsdResult result;
+    result.nframe = m_nframe;
+    result.nskipped = m_nskipped;
+    const int natom = static_cast<int>(m_species.size());
+    if (0 == m_nframe || 0 == natom) {
+        return result;
+    }
+
+    int nspecies = 0;
+    for (const int s : m_species) {
+        nspecies = std::max(nspecies, s + 1);
+    }
+    std::vector<int> counts(nspecies, 0);
+    for (const int s : m_species) {
+        counts[s]++;
+    }
+    // species sums, reduced over the threads at the end
+    std::vector<std::vector<double>> sums(nspecies, std::vector<double>(m_nframe, 0.0));
+#pragma omp parallel
+    {
+        std::vector<std::vector<double>> local_sums(nspecies);
+#pragma omp for schedule(dynamic, 1) nowait
+        for (int i = 0; i < natom; i++) {
+            const std::vector<double> msd = atom_msd(
+                m_unwrapped[3 * i].data(), m_unwrapped[3 * i + 1].data(), m_unwrapped[3 * i + 2].data(), m_nframe
+            );
+            auto& local = local_sums[m_species[i]];
+            if (local.empty()) {
+                local.assign(m_nframe, 0.0);
+            }
+            for (std::size_t m = 0; m < m_nframe; m++) {
+                local[m] += msd[m];
+            }
+        }
+#pragma omp critical
+        for (int s = 0; s < nspecies; s++) {
+            for (std::size_t m = 0; m < local_sums[s].size(); m++) {
+                sums[s][m] += local_sums[s][m];
+            }
+        }
+    }
+
+    result.msd.assign(m_nframe, 0.0);
+    for (int s = 0; s < nspecies; s++) {
+        if (0 == counts[s]) {
+            continue;
+        }
+        for (std::size_t m = 0; m < m_nframe; m++) {
+            result.msd[m] += sums[s][m] / natom;
+            sums[s][m] /= counts[s];
+        }
+        const std::string name = s < species_table.size() ? species_table.names[s] : std::to_string(s);
+        result.species_msd.emplace_back(name, std::move(sums[s]));
+    }
+    return result;
+}
@@ -0,0 +1,96 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Mean-squared displacement over whole trajectories.
+///
+/// The positions of every frame are unwrapped and kept per atom. The
+/// MSD of an atom for all lags m < T of a T frame trajectory,
+///
+///     MSD(m) = 1 / (T - m) * sum over t < T - m of |r(t + m) - r(t)|^2
+///            = S1(m) - 2 * S2(m),
+///
+/// takes O(T log T) instead of O(T^2): S2(m) is the autocorrelation of
+/// the positions, done by FFT on zero padding to at least 2T, and S1(m)
+/// the mean of r(t)^2 + r(t + m)^2, which follows from S1(m - 1) by
+/// dropping one term at each end.
+
+#ifndef ANALYSIS_MSD_H
+#define ANALYSIS_MSD_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "analysis/frame.h"
+
+// the MSD of one atom for lags 0 to nframe - 1, the coordinates are
+// series of nframe values
+std::vector<double> atom_msd(const double* x, const double* y, const double* z, std::size_t nframe);
+
+struct MsdResult {
+    // A^2 by lag in frames, averaged over all atoms
+    std::vector<double> msd;
+    // averaged over the atoms of each species
+    std::vector<std::pair<std::string, std::vector<double>>> species_msd;
+    std::size_t nframe = 0;
+    // the frames with another number of atoms than the first
+    std::size_t nskipped = 0;
+};
+
+struct DiffusionFit {
+    // A^2 per time unit of the time step
+    double slope = 0.0;
+    double intercept = 0.0;
+    // slope / 6, A^2 per time unit
+    double diffusion = 0.0;
+};
+
+// least squares line through the MSD between the lags begin_fraction and
+// end_fraction of the trajectory length, the long lags are averaged over
+// few time origins and left out by default
+DiffusionFit fit_diffusion(const std::vector<double>& msd, double time_step, double begin_fraction = 0.1, double end_fraction = 0.5);
+
+class MsdAnalysis {
+public:
+    // frames in trajectory order; periodic frames are unwrapped by the
+    // minimum image of the step from the previous frame, so atoms must
+    // move less than half a cell width between frames
+    void add_frame(const Frame& frame);
+
+    // the atoms are done in parallel
+    MsdResult result(const SpeciesTable& species_table) const;
+
+    std::size_t get_nframe() const {
+        return m_nframe;
+    }
+
+private:
+    std::vector<int> m_species;
+    // the positions of the last frame as read
+    std::vector<double> m_previous;
+    // the last unwrapped positions
+    std::vector<double> m_current;
+    // 3 * natom series, x y z of atom i are 3 * i, 3 * i + 1, 3 * i + 2
+    std::vector<std::vector<double>> m_unwrapped;
+    std::size_t m_nframe = 0;
+    std::size_t m_nskipped = 0;
+};
+
+#endif // ANALYSIS_MSD_H
@@ -0,0 +1,194 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "analysis/rdf.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "analysis/cell_list.h"
+#include "utils/trace.h"
+
+namespace {
+
+int pair_index(int a, int b) {
+    if (a > b) {
+        std::swap(a, b);
+    }
+    return b * (b + 1) / 2 + a;
+}
+
+double min_width(const Lattice& lattice) {
+    return std::min(lattice.width(0), std::min(lattice.width(1), lattice.width(2)));
+}
+
+} // namespace
+
+RdfAnalysis::RdfAnalysis(double r_max, int nbins) : m_r_max{r_max}, m_nbins{std::max(1, nbins)} {
+}
+
+void RdfAnalysis::add_frames(const std::vector<Frame>& frames) {
+    TRACE_SCOPE_CAT("RdfAnalysis::add_frames", "analysis");
+    if (false == m_r_max_fixed) {
+        for (const auto& frame : frames) {
+            const Lattice lattice = Lattice::from_cell(frame.cell);
+            if (true == lattice.periodic) {
+                m_r_max = std::min(m_r_max, 0.5 * min_width(lattice));
+                m_r_max_fixed = true;
+                break;
+            }
+        }
+    }
+    int nthread = 1;
+#ifdef _OPENMP
+    nthread = omp_get_max_threads();
+#endif
+    if (m_histograms.size() < static_cast<std::size_t>(nthread)) {
+        m_histograms.resize(nthread);
+    }
+    const int nframe = static_cast<int>(frames.size());
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int f = 0; f < nframe; f++) {
+        int thread = 0;
+#ifdef _OPENMP
+        thread = omp_get_thread_num();
+#endif
+        this->add_frame(frames[f], m_histograms[thread]);
+    }
+}
+
+void RdfAnalysis::add_frame(const Frame& frame, Histogram& histogram) const {
+    const Lattice lattice = Lattice::from_cell(frame.cell);
+    const int natom = frame.natom();
+    if (false == lattice.periodic || natom < 2 || 0.5 * min_width(lattice) < m_r_max * (1.0 - 1.0e-9)) {
+        histogram.nskipped++;
+        return;
+    }
+
+    int nspecies = 0;
+    for (const int s : frame.species) {
+        nspecies = std::max(nspecies, s + 1);
+    }
+    const int npair = nspecies * (nspecies + 1) / 2;
+    if (histogram.total.empty()) {
+        histogram.total.assign(m_nbins, 0);
+    }
+    if (histogram.partial_norms.size() < static_cast<std::size_t>(npair)) {
+        // new pairs get the higher indices, the existing counts stay put
+        histogram.partials.resize(static_cast<std::size_t>(npair) * m_nbins, 0);
+        histogram.partial_norms.resize(npair, 0.0);
+    }
+
+    const double volume = std::fabs(lattice.volume());
+    std::vector<double> counts(nspecies, 0.0);
+    for (const int s : frame.species) {
+        counts[s] += 1.0;
+    }
+    histogram.total_norm += 0.5 * natom * (natom - 1.0) / volume;
+    for (int b = 0; b < nspecies; b++) {
+        for (int a = 0; a <= b; a++) {
+            const double pairs = a == b ? 0.5 * counts[a] * (counts[a] - 1.0) : counts[a] * counts[b];
+            histogram.partial_norms[pair_index(a, b)] += pairs / volume;
+        }
+    }
+
+    CellList cell_list;
+    cell_list.build(frame.positions.data(), natom, lattice, m_r_max);
+    const double inverse_dr = m_nbins / m_r_max;
+    const int last_bin = m_nbins - 1;
+    std::uint64_t* total = histogram.total.data();
+    std::uint64_t* partials = histogram.partials.data();
+    const int* species = frame.species.data();
+    const int nbins = m_nbins;
+    cell_list.for_each_pair([&](int i, int j, double, double, double, double r2) {
+        const int bin = std::min(static_cast<int>(std::sqrt(r2) * inverse_dr), last_bin);
+        total[bin]++;
+        partials[static_cast<std::size_t>(pair_index(species[i], species[j])) * nbins + bin]++;
+    });
+    histogram.nframe++;
+}
+
+RdfResult RdfAnalysis::result(const SpeciesTable& species_table) const {
+    RdfResult result;
+    std::vector<std::uint64_t> total(m_nbins, 0);
+    std::vector<std::uint64_t> partials;
+    std::vector<double> partial_norms;
+    double total_norm = 0.0;
+    for (const auto& histogram : m_histograms) {
+        result.nframe += histogram.nframe;
+        result.nskipped += histogram.nskipped;
+        total_norm += histogram.total_norm;
+        for (std::size_t k = 0; k < histogram.total.size(); k++) {
+            total[k] += histogram.total[k];
+        }
+        if (partials.size() < histogram.partials.size()) {
+            partials.resize(histogram.partials.size(), 0);
+            partial_norms.resize(histogram.partial_norms.size(), 0.0);
+        }
+        for (std::size_t k = 0; k < histogram.partials.size(); k++) {
+            partials[k] += histogram.partials[k];
+        }
+        for (std::size_t k = 0; k < histogram.partial_norms.size(); k++) {
+            partial_norms[k] += histogram.partial_norms[k];
+        }
+    }
+
+    const double dr = m_r_max / m_nbins;
+    std::vector<double> shells(m_nbins);
+    result.r.resize(m_nbins);
+    for (int k = 0; k < m_nbins; k++) {
+        const double r0 = k * dr;
+        const double r1 = r0 + dr;
+        result.r[k] = r0 + 0.5 * dr;
+        shells[k] = 4.0 / 3.0 * M_PI * (r1 * r1 * r1 - r0 * r0 * r0);
+    }
+    auto normalize = [&](const std::uint64_t* counts, double norm) {
+        std::vector<double> g(m_nbins, 0.0);
+        if (norm > 0.0) {
+            for (int k = 0; k < m_nbins; k++) {
+                g[k] = counts[k] / (shells[k] * norm);
+            }
+        }
+        return g;
+    };
+    result.g = normalize(total.data(), total_norm);
+
+    const int npair = static_cast<int>(partial_norms.size());
+    for (int b = 0; b * (b + 1) / 2 < npair; b++) {
+        for (int a = 0; a <= b; a++) {
+            const int pair = pair_index(a, b);
+            if (pair >= npair || partial_norms[pair] <= 0.0) {
+                continue;
+            }
+            auto name_of = [&species_table](int s) {
+                return s < species_table.size() ? species_table.names[s] : std::to_string(s);
+            };
+            result.partials.emplace_back(
+                name_of(a) + "-" + name_of(b),
+                normalize(partials.data() + static_cast<std::size_t>(pair) * m_nbins, partial_norms[pair])
+            );
+        }
+    }
+    return result;
+}
@@ -0,0 +1,89 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Radial distribution functions accumulated over whole trajectories.
+///
+/// The frames of a batch are binned in parallel, one frame per thread,
+/// into histograms owned by the threads and only summed when the result
+/// is asked for, so a trajectory can be streamed batch by batch. For
+/// species a and b
+///
+///     g_ab(r) = H_ab(r) / (V_shell(r) * sum over frames of P_ab / V)
+///
+/// with H_ab the pair counts, P_ab = N_a * N_b for a != b and
+/// N_a * (N_a - 1) / 2 for a == b, and V the cell volume of the frame.
+
+#ifndef ANALYSIS_RDF_H
+#define ANALYSIS_RDF_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "analysis/frame.h"
+
+struct RdfResult {
+    // bin centres, A
+    std::vector<double> r;
+    std::vector<double> g;
+    // g_ab for every species pair a <= b seen, named "a-b"
+    std::vector<std::pair<std::string, std::vector<double>>> partials;
+    std::size_t nframe = 0;
+    // the non-periodic frames and those too small for r_max
+    std::size_t nskipped = 0;
+};
+
+class RdfAnalysis {
+public:
+    // r_max is cut to half the smallest cell width of the first
+    // periodic frame, the minimum image is not exact beyond it
+    RdfAnalysis(double r_max, int nbins);
+
+    // the frames are processed in parallel, call it with batches of
+    // about twice the number of threads
+    void add_frames(const std::vector<Frame>& frames);
+
+    RdfResult result(const SpeciesTable& species_table) const;
+
+    double get_r_max() const {
+        return m_r_max;
+    }
+
+private:
+    struct Histogram {
+        std::vector<std::uint64_t> total;
+        // pair-major, the pair index of a <= b is b * (b + 1) / 2 + a
+        std::vector<std::uint64_t> partials;
+        double total_norm = 0.0;
+        std::vector<double> partial_norms;
+        std::size_t nframe = 0;
+        std::size_t nskipped = 0;
+    };
+
+    void add_frame(const Frame& frame, Histogram& histogram) const;
+
+    double m_r_max;
+    int m_nbins;
+    bool m_r_max_fixed = false;
+    std::vector<Histogram> m_histograms;
+};
+
+#endif // ANALYSIS_RDF_H
@@ -0,0 +1,703 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "analysis/trajectory.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <string.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "utils/trace.h"
+
+namespace bip = boost::interprocess;
+
+namespace {
+
+const double kHartreeToEv = 27.211386245988;
+
+const char kOutcarMarker[] = "TOTAL-FORCE (eV/Angst)";
+const std::string kUnknownName = "X";
+const char kLammpsMarker[] = "ITEM: TIMESTEP";
+
+// memchr for the first byte and memcmp for the rest, memmem is not
+// available on every platform
+const char* find(const char* begin, const char* end, const char* needle) {
+    const std::size_t length = std::strlen(needle);
+    if (0 == length || begin >= end || static_cast<std::size_t>(end - begin) < length) {
+        return nullptr;
+    }
+    const char* last = end - length;
+    for (const char* pos = begin; pos <= last; pos++) {
+        pos = static_cast<const char*>(std::memchr(pos, needle[0], last - pos + 1));
+        if (nullptr == pos) {
+            return nullptr;
+        }
+        if (0 == std::memcmp(pos + 1, needle + 1, length - 1)) {
+            return pos;
+        }
+    }
+    return nullptr;
+}
+
+const char* line_start(const char* begin, const char* pos) {
+    while (pos > begin && '\n' != pos[-1]) {
+        pos--;
+    }
+    return pos;
+}
+
+// the start of the next line, end if there is none
+const char* next_line(const char* pos, const char* end) {
+    const char* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+    return nullptr == newline ? end : newline + 1;
+}
+
+const char* skip_blanks(const char* pos, const char* end) {
+    while (pos < end && (' ' == *pos || '\t' == *pos || '\r' == *pos)) {
+        pos++;
+    }
+    return pos;
+}
+
+// parses a number after optional blanks, nullptr when there is none;
+// the mapped text is not zero terminated
+const char* parse_number(const char* pos, const char* end, double& value) {
+    pos = skip_blanks(pos, end);
+    if (pos < end && '+' == *pos) {
+        pos++;
+    }
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    const auto result = std::from_chars(pos, end, value);
+    return std::errc() == result.ec ? result.ptr : nullptr;
+#else
+    char buffer[64];
+    std::size_t length = 0;
+    while (pos + length < end && length + 1 < sizeof(buffer) && ' ' != pos[length] && '\t' != pos[length] && '\n' != pos[length]) {
+        buffer[length] = pos[length];
+        length++;
+    }
+    buffer[length] = '\0';
+    char* number_end = nullptr;
+    value = std::strtod(buffer, &number_end);
+    return number_end == buffer ? nullptr : pos + (number_end - buffer);
+#endif
+}
+
+// the next whitespace separated word of the line
+const char* parse_word(const char* pos, const char* end, const char*& word, std::size_t& length) {
+    pos = skip_blanks(pos, end);
+    word = pos;
+    while (pos < end && ' ' != *pos && '\t' != *pos && '\r' != *pos && '\n' != *pos) {
+        pos++;
+    }
+    length = pos - word;
+    return pos;
+}
+
+// the number after "key" and the following '=', false if not on the line
+bool value_after(const char* begin, const char* end, const char* key, double& value) {
+    const char* pos = find(begin, end, key);
+    if (nullptr == pos) {
+        return false;
+    }
+    pos = static_cast<const char*>(std::memchr(pos, '=', end - pos));
+    return nullptr != pos && nullptr != parse_number(pos + 1, end, value);
+}
+
+// three lines, the first three numbers of each
+bool parse_cell(const char* pos, const char* end, std::vector<std::vector<double>>& cell) {
+    cell.assign(3, std::vector<double>(3, 0.0));
+    for (int i = 0; i < 3; i++) {
+        const char* line_end = next_line(pos, end);
+        for (int k = 0; k < 3; k++) {
+            pos = parse_number(pos, line_end, cell[i][k]);
+            if (nullptr == pos) {
+                cell.clear();
+                return false;
+            }
+        }
+        pos = line_end;
+    }
+    return true;
+}
+
+std::string lower_case(std::string str) {
+    std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+    return str;
+}
+
+} // namespace
+
+const char* OutcarFormat::find_frame(const char* pos, const char* end) const {
+    const char* marker = find(pos, end, kOutcarMarker);
+    return nullptr == marker ? nullptr : line_start(pos, marker);
+}
+
+const char* OutcarFormat::frame_end(const char* begin, const char* end, bool at_eof) const {
+    const char* next = this->find_frame(next_line(begin, end), end);
+    if (nullptr != next) {
+        return next;
+    }
+    return true == at_eof ? end : nullptr;
+}
+
+void OutcarFormat::parse_header(const char* begin, const char* end) {
+    //    TITEL  = PAW_PBE Si 05Jan2001
+    //    ions per type =               2   4
+    std::vector<std::string> species;
+    for (const char* pos = find(begin, end, "TITEL"); nullptr != pos; pos = find(pos + 1, end, "TITEL")) {
+        const char* line_end = next_line(pos, end);
+        const char* word = nullptr;
+        std::size_t length = 0;
+        const char* equal = static_cast<const char*>(std::memchr(pos, '=', line_end - pos));
+        if (nullptr == equal) {
+            continue;
+        }
+        // the potential, then the element with an optional suffix, Ti_sv
+        const char* after = parse_word(equal + 1, line_end, word, length);
+        parse_word(after, line_end, word, length);
+        std::size_t element_length = 0;
+        while (element_length < length && std::isalpha(static_cast<unsigned char>(word[element_length]))) {
+            element_length++;
+        }
+        species.emplace_back(word, element_length);
+    }
+    const char* ions = find(begin, end, "ions per type");
+    if (nullptr != ions) {
+        const char* line_end = next_line(ions, end);
+        const char* pos = static_cast<const char*>(std::memchr(ions, '=', line_end - ions));
+        if (nullptr != pos) {
+            pos++;
+        }
+        for (std::size_t s = 0; nullptr != pos && s < species.size(); s++) {
+            double count = 0;
+            pos = parse_number(pos, line_end, count);
+            if (nullptr != pos) {
+                m_atom_names.insert(m_atom_names.end(), static_cast<std::size_t>(count), species[s]);
+            }
+        }
+    }
+    // the last lattice before the first positions
+    const char* lattice = nullptr;
+    for (const char* pos = find(begin, end, "direct lattice vectors"); nullptr != pos; pos = find(pos + 1, end, "direct lattice vectors")) {
+        lattice = pos;
+    }
+    if (nullptr != lattice) {
+        parse_cell(next_line(lattice, end), end, m_cell);
+    }
+}
+
+bool OutcarFormat::parse_frame(const char* begin, const char* end, Frame& frame, SpeciesTable& species_table) const {
+    //  POSITION                                       TOTAL-FORCE (eV/Angst)
+    //  -----------------------------------------------------------------------------------
+    //       0.00000      0.00000      0.00000         0.000000      0.000000      0.000000
+    //  -----------------------------------------------------------------------------------
+    const char* pos = next_line(next_line(begin, end), end);
+    const std::size_t natom = m_atom_names.size();
+    frame.positions.reserve(3 * natom);
+    frame.forces.reserve(3 * natom);
+    frame.species.reserve(natom);
+    const std::string* previous_name = nullptr;
+    int previous_species = -1;
+    while (pos < end) {
+        const char* line_end = next_line(pos, end);
+        double values[6];
+        const char* cursor = pos;
+        int nvalue = 0;
+        while (nvalue < 6 && nullptr != (cursor = parse_number(cursor, line_end, values[nvalue]))) {
+            nvalue++;
+        }
+        if (6 != nvalue) {
+            break;
+        }
+        const std::size_t i = frame.species.size();
+        if (natom > 0 && i >= natom) {
+            break;
+        }
+        frame.positions.insert(frame.positions.end(), values, values + 3);
+        frame.forces.insert(frame.forces.end(), values + 3, values + 6);
+        const std::string& name = natom > 0 ? m_atom_names[i] : kUnknownName;
+        if (&name != previous_name && (nullptr == previous_name || name != *previous_name)) {
+            previous_species = species_table.index_of(name);
+        }
+        previous_name = &name;
+        frame.species.push_back(previous_species);
+        pos = line_end;
+    }
+    if (frame.species.empty()) {
+        return false;
+    }
+    value_after(pos, end, "free  energy   TOTEN", frame.energy);
+    // the lattice of the next ionic step, see finish_frame
+    const char* lattice = find(pos, end, "direct lattice vectors");
+    if (nullptr != lattice) {
+        parse_cell(next_line(lattice, end), end, frame.cell);
+    }
+    return true;
+}
+
+void OutcarFormat::finish_frame(Frame& frame) {
+    if (true == frame.cell.empty()) {
+        frame.cell = m_cell;
+    } else {
+        std::swap(frame.cell, m_cell);
+    }
+}
+
+const char* LammpsDumpFormat::find_frame(const char* pos, const char* end) const {
+    return find(pos, end, kLammpsMarker);
+}
+
+const char* LammpsDumpFormat::frame_end(const char* begin, const char* end, bool at_eof) const {
+    const char* next = find(begin + 1, end, kLammpsMarker);
+    if (nullptr != next) {
+        return next;
+    }
+    return true == at_eof ? end : nullptr;
+}
+
+bool LammpsDumpFormat::parse_frame(const char* begin, const char* end, Frame& frame, SpeciesTable& species_table) const {
+    std::size_t natom = 0;
+    double bounds[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+    bool triclinic = false;
+    const char* pos = begin;
+    while (pos < end) {
+        const char* line_end = next_line(pos, end);
+        double value = 0;
+        if (0 == std::strncmp(pos, "ITEM: TIMESTEP", 14)) {
+            pos = line_end;
+            if (nullptr != parse_number(pos, end, value)) {
+                frame.step = static_cast<long>(value);
+            }
+        } else if (0 == std::strncmp(pos, "ITEM: NUMBER OF ATOMS", 21)) {
+            pos = line_end;
+            if (nullptr != parse_number(pos, end, value)) {
+                natom = static_cast<std::size_t>(value);
+            }
+        } else if (0 == std::strncmp(pos, "ITEM: BOX BOUNDS", 16)) {
+            // lo hi, with the tilt xy xz yz of triclinic boxes
+            triclinic = nullptr != find(pos, line_end, "xy");
+            pos = line_end;
+            for (int i = 0; i < 3 && pos < end; i++) {
+                const char* bounds_end = next_line(pos, end);
+                const char* cursor = pos;
+                for (int k = 0; k < (triclinic ? 3 : 2) && nullptr != cursor; k++) {
+                    cursor = parse_number(cursor, bounds_end, bounds[i][k]);
+                }
+                pos = bounds_end;
+            }
+            continue;
+        } else if (0 == std::strncmp(pos, "ITEM: ATOMS", 11)) {
+            break;
+        }
+        pos = next_line(pos, end);
+    }
+    if (pos >= end || 0 == natom) {
+        return false;
+    }
+
+    // the box, see the LAMMPS documentation of triclinic boxes
+    const double xy = bounds[0][2], xz = bounds[1][2], yz = bounds[2][2];
+    const double xlo = bounds[0][0] - std::min({0.0, xy, xz, xy + xz});
+    const double xhi = bounds[0][1] - std::max({0.0, xy, xz, xy + xz});
+    const double ylo = bounds[1][0] - std::min(0.0, yz);
+    const double yhi = bounds[1][1] - std::max(0.0, yz);
+    const double zlo = bounds[2][0];
+    const double zhi = bounds[2][1];
+    frame.cell = {{xhi - xlo, 0.0, 0.0}, {xy, yhi - ylo, 0.0}, {xz, yz, zhi - zlo}};
+
+    // the columns of "ITEM: ATOMS id type xs ys zs ..."
+    int id_column = -1;
+    int name_column = -1;
+    int position_column[3] = {-1, -1, -1};
+    int velocity_column[3] = {-1, -1, -1};
+    int charge_column = -1;
+    bool scaled = false;
+    const char* line_end = next_line(pos, end);
+    const char* cursor = pos + 11;
+    for (int column = 0; ; column++) {
+        const char* word = nullptr;
+        std::size_t length = 0;
+        cursor = parse_word(cursor, line_end, word, length);
+        if (0 == length) {
+            break;
+        }
+        const std::string name(word, length);
+        if ("id" == name) {
+            id_column = column;
+        } else if ("element" == name || ("type" == name && name_column < 0)) {
+            name_column = column;
+        } else if ("q" == name) {
+            charge_column = column;
+        }
+        for (int k = 0; k < 3; k++) {
+            const std::string axis(1, "xyz"[k]);
+            if (axis == name || axis + "u" == name) {
+                position_column[k] = column;
+            } else if (axis + "s" == name || axis + "su" == name) {
+                position_column[k] = column;
+                scaled = true;
+            } else if ("v" + axis == name) {
+                velocity_column[k] = column;
+            }
+        }
+    }
+    if (position_column[0] < 0 || position_column[1] < 0 || position_column[2] < 0) {
+        return false;
+    }
+    const bool has_velocities = velocity_column[0] >= 0 && velocity_column[1] >= 0 && velocity_column[2] >= 0;
+
+    frame.positions.assign(3 * natom, 0.0);
+    frame.species.assign(natom, 0);
+    if (true == has_velocities) {
+        frame.velocities.assign(3 * natom, 0.0);
+    }
+    if (charge_column >= 0) {
+        frame.charges.assign(natom, 0.0);
+    }
+    std::vector<long> ids(natom, 0);
+    bool ordered_ids = id_column >= 0;
+    pos = line_end;
+    std::string previous_name;
+    int previous_species = name_column < 0 ? species_table.index_of(kUnknownName) : -1;
+    for (std::size_t i = 0; i < natom; i++) {
+        if (pos >= end) {
+            return false;
+        }
+        line_end = next_line(pos, end);
+        cursor = pos;
+        double position[3] = {0, 0, 0};
+        for (int column = 0; ; column++) {
+            const char* word = nullptr;
+            std::size_t length = 0;
+            const char* word_end = parse_word(cursor, line_end, word, length);
+            if (0 == length) {
+                break;
+            }
+            if (column == name_column) {
+                if (previous_species < 0 || previous_name.size() != length || 0 != previous_name.compare(0, length, word, length)) {
+                    previous_name.assign(word, length);
+                    previous_species = species_table.index_of(previous_name);
+                }
+            } else {
+                double value = 0;
+                parse_number(word, word_end, value);
+                if (column == id_column) {
+                    ids[i] = static_cast<long>(value);
+                } else if (column == charge_column) {
+                    frame.charges[i] = value;
+                }
+                for (int k = 0; k < 3; k++) {
+                    if (column == position_column[k]) {
+                        position[k] = value;
+                    } else if (column == velocity_column[k]) {
+                        frame.velocities[3 * i + k] = value;
+                    }
+                }
+            }
+            cursor = word_end;
+        }
+        if (true == scaled) {
+            const double sx = position[0], sy = position[1], sz = position[2];
+            position[0] = xlo + sx * (xhi - xlo) + sy * xy + sz * xz;
+            position[1] = ylo + sy * (yhi - ylo) + sz * yz;
+            position[2] = zlo + sz * (zhi - zlo);
+        }
+        std::copy(position, position + 3, frame.positions.begin() + 3 * i);
+        frame.species[i] = previous_species;
+        ordered_ids = ordered_ids && ids[i] >= 1 && ids[i] <= static_cast<long>(natom);
+        pos = line_end;
+    }
+
+    // dumps are not sorted unless asked for, the atoms are put in the
+    // order of their ids so that frames can be compared
+    if (true == ordered_ids) {
+        Frame sorted;
+        sorted.positions.resize(frame.positions.size());
+        sorted.velocities.resize(frame.velocities.size());
+        sorted.charges.resize(frame.charges.size());
+        sorted.species.resize(natom);
+        for (std::size_t i = 0; i < natom; i++) {
+            const std::size_t j = ids[i] - 1;
+            std::copy_n(frame.positions.begin() + 3 * i, 3, sorted.positions.begin() + 3 * j);
+            if (true == has_velocities) {
+                std::copy_n(frame.velocities.begin() + 3 * i, 3, sorted.velocities.begin() + 3 * j);
+            }
+            if (charge_column >= 0) {
+                sorted.charges[j] = frame.charges[i];
+            }
+            sorted.species[j] = frame.species[i];
+        }
+        frame.positions.swap(sorted.positions);
+        frame.velocities.swap(sorted.velocities);
+        frame.charges.swap(sorted.charges);
+        frame.species.swap(sorted.species);
+    }
+    return true;
+}
+
+const char* XyzFormat::find_frame(const char* pos, const char* end) const {
+    return pos < end ? pos : nullptr;
+}
+
+const char* XyzFormat::frame_end(const char* begin, const char* end, bool at_eof) const {
+    const char* pos = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+    if (nullptr == pos) {
+        return true == at_eof ? end : nullptr;
+    }
+    double natom = 0;
+    if (nullptr == parse_number(begin, pos, natom)) {
+        // a blank or broken line, skipped
+        return pos + 1;
+    }
+    // the comment line and the atoms
+    pos++;
+    for (long i = 0; i < static_cast<long>(natom) + 1; i++) {
+        const char* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        if (nullptr == newline) {
+            return true == at_eof ? end : nullptr;
+        }
+        pos = newline + 1;
+    }
+    return pos;
+}
+
+bool XyzFormat::parse_frame(const char* begin, const char* end, Frame& frame, SpeciesTable& species_table) const {
+    double natom = 0;
+    if (nullptr == parse_number(begin, end, natom) || natom < 1) {
+        return false;
+    }
+    const char* comment = next_line(begin, end);
+    const char* pos = next_line(comment, end);
+    double value = 0;
+    if (value_after(comment, pos, " E ", value)) {
+        //  i =        5, time =        2.500, E =       -34.1234567890
+        frame.energy = value * kHartreeToEv;
+        if (value_after(comment, pos, "i ", value)) {
+            frame.step = static_cast<long>(value);
+        }
+        if (value_after(comment, pos, "time", value)) {
+            frame.time = value;
+        }
+    } else if (value_after(comment, pos, "energy", value)) {
+        // extended XYZ, Lattice="ax ay az bx by bz cx cy cz" energy=-10.2
+        frame.energy = value;
+    }
+    const char* lattice = find(comment, pos, "Lattice=\"");
+    if (nullptr != lattice) {
+        const char* cursor = lattice + 9;
+        frame.cell.assign(3, std::vector<double>(3, 0.0));
+        for (int i = 0; i < 9 && nullptr != cursor; i++) {
+            cursor = parse_number(cursor, pos, frame.cell[i / 3][i % 3]);
+        }
+        if (nullptr == cursor) {
+            frame.cell.clear();
+        }
+    }
+
+    const std::size_t n = static_cast<std::size_t>(natom);
+    frame.positions.reserve(3 * n);
+    frame.species.reserve(n);
+    std::string previous_name;
+    int previous_species = -1;
+    for (std::size_t i = 0; i < n && pos < end; i++) {
+        const char* line_end = next_line(pos, end);
+        const char* word = nullptr;
+        std::size_t length = 0;
+        const char* cursor = parse_word(pos, line_end, word, length);
+        if (previous_species < 0 || previous_name.size() != length || 0 != previous_name.compare(0, length, word, length)) {
+            previous_name.assign(word, length);
+            previous_species = species_table.index_of(previous_name);
+        }
+        double position[3];
+        for (int k = 0; k < 3 && nullptr != cursor; k++) {
+            cursor = parse_number(cursor, line_end, position[k]);
+        }
+        if (nullptr == cursor) {
+            return false;
+        }
+        frame.positions.insert(frame.positions.end(), position, position + 3);
+        frame.species.push_back(previous_species);
+        pos = line_end;
+    }
+    return frame.species.size() == n;
+}
+
+std::unique_ptr<TrajectoryFormat> make_trajectory_format(const std::string& path) {
+    const boost::filesystem::path file_path(path);
+    const auto name = lower_case(file_path.filename().string());
+    const auto extension = lower_case(file_path.extension().string());
+    if (std::string::npos != name.find("outcar")) {
+        return std::make_unique<OutcarFormat>();
+    } else if (".lammpstrj" == extension || ".dump" == extension || 0 == name.compare(0, 5, "dump.")) {
+        return std::make_unique<LammpsDumpFormat>();
+    } else if (".xyz" == extension) {
+        return std::make_unique<XyzFormat>();
+    }
+    throw std::runtime_error("unknown trajectory format: " + path);
+}
+
+TrajectoryReader::TrajectoryReader(const std::string& path)
+    : TrajectoryReader(path, make_trajectory_format(path)) {
+}
+
+TrajectoryReader::TrajectoryReader(const std::string& path, std::unique_ptr<TrajectoryFormat> format)
+    : m_path{path}, m_format{std::move(format)} {
+}
+
+std::size_t TrajectoryReader::read(const std::function<bool(Frame& frame)>& on_frame) {
+    TRACE_SCOPE_CAT("TrajectoryReader::read", "parse");
+    m_file_size = boost::filesystem::file_size(m_path);
+    m_bytes_read = 0;
+    if (0 == m_file_size) {
+        return 0;
+    }
+    bip::file_mapping file;
+    try {
+        file = bip::file_mapping(m_path.c_str(), bip::read_only);
+    } catch (const bip::interprocess_exception& e) {
+        throw std::runtime_error("can not map " + m_path + ": " + e.what());
+    }
+
+    int nthread = m_nthread;
+#ifdef _OPENMP
+    if (nthread <= 0) {
+        nthread = omp_get_max_threads();
+    }
+#else
+    nthread = 1;
+#endif
+    // every thread maps the names it meets to its own indices, they are
+    // translated to the shared table in file order
+    std::vector<SpeciesTable> thread_tables(nthread);
+    std::vector<std::vector<int>> thread_to_shared(nthread);
+
+    std::uint64_t window_bytes = m_window_bytes;
+    bool header_done = false;
+    std::size_t nframe = 0;
+    std::vector<std::pair<const char*, const char*>> ranges;
+    std::vector<Frame> frames;
+    std::vector<int> frame_thread;
+    std::vector<char> frame_ok;
+
+    while (m_bytes_read < m_file_size) {
+        const std::uint64_t length = std::min(window_bytes, m_file_size - m_bytes_read);
+        const bool at_eof = m_bytes_read + length == m_file_size;
+        bip::mapped_region region(file, bip::read_only, m_bytes_read, length);
+        region.advise(bip::mapped_region::advice_sequential);
+        const char* begin = static_cast<const char*>(region.get_address());
+        const char* end = begin + length;
+        const char* pos = begin;
+
+        if (false == header_done) {
+            const char* first = m_format->find_frame(pos, end);
+            if (nullptr == first && false == at_eof) {
+                window_bytes *= 2;
+                continue;
+            }
+            m_format->parse_header(pos, nullptr == first ? end : first);
+            header_done = true;
+            if (nullptr == first) {
+                break;
+            }
+            pos = first;
+        }
+
+        // the frame boundaries, found serially and fast
+        ranges.clear();
+        while (pos < end) {
+            const char* frame_end = m_format->frame_end(pos, end, at_eof);
+            if (nullptr == frame_end) {
+                break;
+            }
+            ranges.emplace_back(pos, frame_end);
+            pos = frame_end;
+        }
+        if (true == ranges.empty()) {
+            if (true == at_eof) {
+                break;
+            }
+            // a frame larger than the window
+            window_bytes *= 2;
+            continue;
+        }
+
+        frames.assign(ranges.size(), Frame());
+        frame_thread.assign(ranges.size(), 0);
+        frame_ok.assign(ranges.size(), 0);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthread)
+        for (long i = 0; i < static_cast<long>(ranges.size()); i++) {
+#ifdef _OPENMP
+            const int thread = omp_get_thread_num();
+#else
+            const int thread = 0;
+#endif
+            frame_thread[i] = thread;
+            frame_ok[i] = m_format->parse_frame(ranges[i].first, ranges[i].second, frames[i], thread_tables[thread]) ? 1 : 0;
+        }
+
+        m_bytes_read += pos - begin;
+        for (std::size_t i = 0; i < frames.size(); i++) {
+            if (0 == frame_ok[i]) {
+                continue;
+            }
+            const int thread = frame_thread[i];
+            auto& to_shared = thread_to_shared[thread];
+            while (static_cast<int>(to_shared.size()) < thread_tables[thread].size()) {
+                to_shared.push_back(m_species_table.index_of(thread_tables[thread].names[to_shared.size()]));
+            }
+            for (auto& species : frames[i].species) {
+                species = to_shared[species];
+            }
+            m_format->finish_frame(frames[i]);
+            nframe++;
+            if (false == on_frame(frames[i])) {
+                return nframe;
+            }
+        }
+        // the window shrinks back after an oversized frame
+        window_bytes = m_window_bytes;
+    }
+    return nframe;
+}
+
+void FrameSpacing::add_frame(const Frame& frame) {
+    if (0 == m_nframe) {
+        m_first_time = frame.time;
+        m_first_step = frame.step;
+    } else if (1 == m_nframe) {
+        m_time_step = frame.time > m_first_time ? frame.time - m_first_time : 0.0;
+        m_steps = frame.step > m_first_step ? frame.step - m_first_step : 0;
+    }
+    m_nframe++;
+}
@@ -0,0 +1,171 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Streaming readers for large trajectory and output files.
+///
+/// The file is memory mapped one window at a time. Inside a window the
+/// frame boundaries are found with memchr and memcmp, the frames are
+/// parsed in parallel and handed to the caller in file order. A frame
+/// running past the end of the window starts the next window, so the
+/// memory in use is bounded by the window size whatever the file size.
+///
+/// Formats, chosen by the file name:
+///
+///     OUTCAR                      VASP, positions, forces and energy
+///     *.lammpstrj, *.dump, dump.* LAMMPS dump, positions, velocities
+///                                 and charges
+///     *.xyz                       XYZ trajectories, with the energy of
+///                                 CP2K or extended XYZ comment lines
+///
+/// Energies are converted to eV.
+
+#ifndef ANALYSIS_TRAJECTORY_H
+#define ANALYSIS_TRAJECTORY_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "analysis/frame.h"
+
+class TrajectoryFormat {
+public:
+    virtual ~TrajectoryFormat() = default;
+
+    // the start of the first frame at or after pos, nullptr when none
+    // starts before end
+    virtual const char* find_frame(const char* pos, const char* end) const = 0;
+    // the end of the frame starting at begin, nullptr when the frame may
+    // continue past end; at_eof tells that end is the end of the file
+    virtual const char* frame_end(const char* begin, const char* end, bool at_eof) const = 0;
+    // the bytes before the first frame
+    virtual void parse_header(const char* begin, const char* end) {
+    }
+    // called from several threads at once, the species indices refer to
+    // the species table of the calling thread
+    virtual bool parse_frame(const char* begin, const char* end, Frame& frame, SpeciesTable& species_table) const = 0;
+    // called in file order on the reading thread, e.g. for state that
+    // carries over from one frame to the next
+    virtual void finish_frame(Frame& frame) {
+    }
+};
+
+class OutcarFormat : public TrajectoryFormat {
+public:
+    const char* find_frame(const char* pos, const char* end) const override;
+    const char* frame_end(const char* begin, const char* end, bool at_eof) const override;
+    void parse_header(const char* begin, const char* end) override;
+    bool parse_frame(const char* begin, const char* end, Frame& frame, SpeciesTable& species_table) const override;
+    void finish_frame(Frame& frame) override;
+
+private:
+    // element of every atom, from TITEL and "ions per type"
+    std::vector<std::string> m_atom_names;
+    // the lattice of the next frame, printed before its positions
+    std::vector<std::vector<double>> m_cell;
+};
+
+class LammpsDumpFormat : public TrajectoryFormat {
+public:
+    const char* find_frame(const char* pos, const char* end) const override;
+    const char* frame_end(const char* begin, const char* end, bool at_eof) const override;
+    bool parse_frame(const char* begin, const char* end, Frame& frame, SpeciesTable& species_table) const override;
+};
+
+class XyzFormat : public TrajectoryFormat {
+public:
+    const char* find_frame(const char* pos, const char* end) const override;
+    const char* frame_end(const char* begin, const char* end, bool at_eof) const override;
+    bool parse_frame(const char* begin, const char* end, Frame& frame, SpeciesTable& species_table) const override;
+};
+
+// throws std::runtime_error for unknown file names
+std::unique_ptr<TrajectoryFormat> make_trajectory_format(const std::string& path);
+
+class TrajectoryReader {
+public:
+    // the format is chosen by the file name
+    explicit TrajectoryReader(const std::string& path);
+    TrajectoryReader(const std::string& path, std::unique_ptr<TrajectoryFormat> format);
+
+    void set_window_bytes(std::uint64_t window_bytes) {
+        m_window_bytes = window_bytes;
+    }
+    // 0 for all cores
+    void set_threads(int nthread) {
+        m_nthread = nthread;
+    }
+
+    // calls on_frame for every frame in file order on the calling thread,
+    // reading stops when it returns false; returns the number of frames
+    // passed to on_frame, throws std::runtime_error when the file can
+    // not be mapped
+    std::size_t read(const std::function<bool(Frame& frame)>& on_frame);
+
+    // the names of the species indices of the frames
+    const SpeciesTable& get_species_table() const {
+        return m_species_table;
+    }
+    std::uint64_t get_file_size() const {
+        return m_file_size;
+    }
+    // for progress reports from on_frame
+    std::uint64_t get_bytes_read() const {
+        return m_bytes_read;
+    }
+
+private:
+    std::string m_path;
+    std::unique_ptr<TrajectoryFormat> m_format;
+    std::uint64_t m_window_bytes = 64 << 20;
+    int m_nthread = 0;
+    std::uint64_t m_file_size = 0;
+    std::uint64_t m_bytes_read = 0;
+    SpeciesTable m_species_table;
+};
+
+/// The spacing of the frames, from the first two added. Only the CP2K
+/// XYZ comment lines carry times; for the other formats the time
+/// between frames is unknown and left to the user, the MD steps
+/// between frames are reported instead.
+class FrameSpacing {
+public:
+    void add_frame(const Frame& frame);
+
+    // fs, 0 when the frames carry no times
+    double get_time_step() const {
+        return m_time_step;
+    }
+    // 0 when the frames carry no step numbers
+    long get_steps() const {
+        return m_steps;
+    }
+
+private:
+    int m_nframe = 0;
+    double m_first_time = 0.0;
+    long m_first_step = 0;
+    double m_time_step = 0.0;
+    long m_steps = 0;
+};
+
+#endif // ANALYSIS_TRAJECTORY_H
@@ -0,0 +1,261 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "analysis/vacf.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "analysis/cell_list.h"
+#include "utils/trace.h"
+
+namespace {
+
+// atoms per batched FFT
+const int kBatchAtoms = 16;
+// cm/fs
+const double kSpeedOfLight = 2.99792458e-5;
+
+std::size_t fft_size(int length) {
+    std::size_t n = 1;
+    while (n < 2 * static_cast<std::size_t>(length)) {
+        n <<= 1;
+    }
+    return n;
+}
+
+// C(m) / C(0) from the summed power spectrum
+std::vector<double> normalized_correlation(const std::vector<double>& power, const std::vector<double>& counts) {
+    std::vector<double> correlation(counts.size(), 0.0);
+    arma::cx_vec spectrum(power.size());
+    for (std::size_t k = 0; k < power.size(); k++) {
+        spectrum[k] = power[k];
+    }
+    const arma::vec sums = arma::real(arma::ifft(spectrum));
+    for (std::size_t m = 0; m < counts.size(); m++) {
+        correlation[m] = counts[m] > 0.0 ? sums[m] / counts[m] : 0.0;
+    }
+    const double c0 = correlation.empty() ? 0.0 : correlation[0];
+    if (c0 > 0.0) {
+        for (auto& c : correlation) {
+            c /= c0;
+        }
+    }
+    return correlation;
+}
+
+// the Hann-windowed cosine transform of C(m) for the max_lag bins of
+// vdos_wavenumbers, unit area
+std::vector<double> density_of_states(const std::vector<double>& correlation) {
+    const std::size_t nlag = correlation.size();
+    std::vector<double> vdos(nlag, 0.0);
+    if (nlag < 2) {
+        return vdos;
+    }
+    // the even extension of length 2 * nlag has a real spectrum
+    arma::vec extended(2 * nlag);
+    extended.zeros();
+    for (std::size_t m = 0; m < nlag; m++) {
+        const double window = std::cos(0.5 * M_PI * m / nlag);
+        extended[m] = correlation[m] * window * window;
+        if (m > 0) {
+            extended[2 * nlag - m] = extended[m];
+        }
+    }
+    const arma::cx_vec spectrum = arma::fft(extended, 2 * nlag);
+    double area = 0.0;
+    for (std::size_t k = 0; k < nlag; k++) {
+        vdos[k] = std::max(0.0, spectrum[k].real());
+        area += vdos[k];
+    }
+    if (area > 0.0) {
+        for (auto& value : vdos) {
+            value /= area;
+        }
+    }
+    return vdos;
+}
+
+} // namespace
+
+std::vector<double> vdos_wavenumbers(std::size_t nbin, double time_step_fs) {
+    std::vector<double> wavenumbers(nbin);
+    for (std::size_t k = 0; k < nbin; k++) {
+        wavenumbers[k] = k / (2.0 * nbin * time_step_fs) / kSpeedOfLight;
+    }
+    return wavenumbers;
+}
+
+VacfAnalysis::VacfAnalysis(int max_lag) : m_max_lag{std::max(2, max_lag)} {
+}
+
+void VacfAnalysis::set_atoms(const std::vector<int>& atoms) {
+    m_atoms = atoms;
+}
+
+void VacfAnalysis::add_frame(const Frame& frame) {
+    const int natom = frame.natom();
+    if (m_natom < 0) {
+        m_natom = natom;
+        if (m_atoms.empty()) {
+            for (int i = 0; i < natom; i++) {
+                m_atoms.push_back(i);
+            }
+        }
+        m_atoms.erase(std::remove_if(m_atoms.begin(), m_atoms.end(), [natom](int i) {
+            return i < 0 || i >= natom;
+        }), m_atoms.end());
+        for (const int i : m_atoms) {
+            m_species.push_back(frame.species[i]);
+            m_nspecies = std::max(m_nspecies, frame.species[i] + 1);
+        }
+        m_segment.set_size(m_max_lag, 3 * m_atoms.size());
+        m_power.assign(m_nspecies, std::vector<double>(fft_size(m_max_lag), 0.0));
+        m_counts.assign(m_max_lag, 0.0);
+        m_from_positions = frame.velocities.empty();
+        if (true == m_from_positions) {
+            // the first velocity comes with the second frame
+            m_previous = frame.positions;
+            m_nframe++;
+            return;
+        }
+    } else if (natom != m_natom) {
+        m_nskipped++;
+        return;
+    }
+
+    const Lattice lattice = true == m_from_positions ? Lattice::from_cell(frame.cell) : Lattice{};
+    for (std::size_t a = 0; a < m_atoms.size(); a++) {
+        const int i = m_atoms[a];
+        double v[3];
+        if (true == m_from_positions) {
+            for (int k = 0; k < 3; k++) {
+                v[k] = frame.positions[3 * i + k] - m_previous[3 * i + k];
+            }
+            lattice.minimum_image(v);
+        } else {
+            for (int k = 0; k < 3; k++) {
+                v[k] = frame.velocities[3 * i + k];
+            }
+        }
+        for (int k = 0; k < 3; k++) {
+            m_segment(m_segment_length, 3 * a + k) = v[k];
+        }
+    }
+    if (true == m_from_positions) {
+        m_previous = frame.positions;
+    }
+    m_nframe++;
+    if (++m_segment_length == m_max_lag) {
+        this->process_segment();
+    }
+}
+
+void VacfAnalysis::process_segment() {
+    TRACE_SCOPE_CAT("VacfAnalysis::process_segment", "analysis");
+    const int length = m_segment_length;
+    if (0 == length) {
+        return;
+    }
+    if (length < m_max_lag) {
+        // rows past the end of a short last segment must not add to the
+        // power, the zero padding of the FFT then covers them
+        m_segment.rows(length, m_max_lag - 1).zeros();
+    }
+    const std::size_t n = m_power.empty() ? 0 : m_power[0].size();
+    const int natom = static_cast<int>(m_atoms.size());
+    const int nbatch = (natom + kBatchAtoms - 1) / kBatchAtoms;
+#pragma omp parallel
+    {
+        std::vector<std::vector<double>> local_power(m_nspecies);
+#pragma omp for schedule(dynamic, 1) nowait
+        for (int batch = 0; batch < nbatch; batch++) {
+            const int first = batch * kBatchAtoms;
+            const int last = std::min(natom, first + kBatchAtoms);
+            const arma::cx_mat spectrum = arma::fft(arma::mat(m_segment.cols(3 * first, 3 * last - 1)), n);
+            for (int a = first; a < last; a++) {
+                auto& power = local_power[m_species[a]];
+                if (power.empty()) {
+                    power.assign(n, 0.0);
+                }
+                for (int k = 0; k < 3; k++) {
+                    const std::size_t column = 3 * (a - first) + k;
+                    for (std::size_t f = 0; f < n; f++) {
+                        power[f] += std::norm(spectrum(f, column));
+                    }
+                }
+            }
+        }
+#pragma omp critical
+        for (int s = 0; s < m_nspecies; s++) {
+            for (std::size_t f = 0; f < local_power[s].size(); f++) {
+                m_power[s][f] += local_power[s][f];
+            }
+        }
+    }
+    for (int m = 0; m < length; m++) {
+        m_counts[m] += static_cast<double>(length - m) * natom;
+    }
+    m_segment_length = 0;
+}
+
+VacfResult VacfAnalysis::result(const SpeciesTable& species_table) {
+    this->process_segment();
+    VacfResult result;
+    result.nframe = m_nframe;
+    result.nskipped = m_nskipped;
+    result.from_positions = m_from_positions;
+    if (m_power.empty()) {
+        return result;
+    }
+
+    // lags past the longest segment of short trajectories have no data
+    int nlag = m_max_lag;
+    while (nlag > 0 && 0.0 == m_counts[nlag - 1]) {
+        nlag--;
+    }
+    std::vector<double> all_counts(m_counts.begin(), m_counts.begin() + nlag);
+    std::vector<double> counts(nlag, 0.0);
+    std::vector<double> total(m_power[0].size(), 0.0);
+    for (int s = 0; s < m_nspecies; s++) {
+        const double natom = static_cast<double>(std::count(m_species.begin(), m_species.end(), s));
+        if (0.0 == natom) {
+            continue;
+        }
+        // m_counts holds the products of all selected atoms
+        for (int m = 0; m < nlag; m++) {
+            counts[m] = m_counts[m] * natom / m_species.size();
+        }
+        for (std::size_t f = 0; f < total.size(); f++) {
+            total[f] += m_power[s][f];
+        }
+        const std::string name = s < species_table.size() ? species_table.names[s] : std::to_string(s);
+        std::vector<double> vacf = normalized_correlation(m_power[s], counts);
+        result.species_vdos.emplace_back(name, density_of_states(vacf));
+        result.species_vacf.emplace_back(name, std::move(vacf));
+    }
+    result.vacf = normalized_correlation(total, all_counts);
+    result.vdos = density_of_states(result.vacf);
+    return result;
+}
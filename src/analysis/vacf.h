@@ -0,0 +1,102 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Velocity autocorrelation and vibrational density of states.
+///
+/// Frames are streamed into segments of max_lag frames. When a segment is
+/// full its velocity series are Fourier transformed column by column in
+/// batches of atoms, in parallel, and the power spectra are summed per
+/// species, so the memory in use does not grow with the trajectory. On
+/// zero padding to at least twice the segment length the inverse
+/// transform of the summed power is the sum of the autocorrelations,
+///
+///     C(m) = sum over segments and t of v(t) . v(t + m) / count(m),
+///
+/// and the VDOS is the cosine transform of C(m) / C(0) under a Hann
+/// window.
+
+#ifndef ANALYSIS_VACF_H
+#define ANALYSIS_VACF_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <armadillo>
+
+#include "analysis/frame.h"
+
+struct VacfResult {
+    // C(m) / C(0) by lag in frames, over the selected atoms
+    std::vector<double> vacf;
+    std::vector<std::pair<std::string, std::vector<double>>> species_vacf;
+    // by frequency bin, see vdos_wavenumbers, unit area
+    std::vector<double> vdos;
+    std::vector<std::pair<std::string, std::vector<double>>> species_vdos;
+    std::size_t nframe = 0;
+    // the frames with another number of atoms than the first
+    std::size_t nskipped = 0;
+    // the trajectory had no velocities, the steps between frames were used
+    bool from_positions = false;
+};
+
+// the wavenumbers in cm^-1 of the VDOS bins for the time between frames
+std::vector<double> vdos_wavenumbers(std::size_t nbin, double time_step_fs);
+
+class VacfAnalysis {
+public:
+    // the longest correlation lag in frames, which also sets the VDOS
+    // resolution to 1 / (2 * max_lag * time step)
+    explicit VacfAnalysis(int max_lag = 2048);
+
+    // restricts the analysis to these atoms, all when empty; call
+    // before the first frame
+    void set_atoms(const std::vector<int>& atoms);
+
+    // frames in trajectory order; frames without velocities use the
+    // minimum-image step from the previous frame, in A per frame
+    void add_frame(const Frame& frame);
+
+    VacfResult result(const SpeciesTable& species_table);
+
+private:
+    void process_segment();
+
+    int m_max_lag;
+    std::vector<int> m_atoms;
+    // species of the selected atoms
+    std::vector<int> m_species;
+    int m_nspecies = 0;
+    // the velocities of the current segment, column 3 * a + k is
+    // component k of selected atom a
+    arma::mat m_segment;
+    int m_segment_length = 0;
+    // sum of |F|^2 over the segments, per species
+    std::vector<std::vector<double>> m_power;
+    // the number of products summed into each lag
+    std::vector<double> m_counts;
+    std::vector<double> m_previous;
+    bool m_from_positions = false;
+    int m_natom = -1;
+    std::size_t m_nframe = 0;
+    std::size_t m_nskipped = 0;
+};
+
+#endif // ANALYSIS_VACF_H
@@ -0,0 +1,439 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "analysis/volumetric.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "analysis/molecules.h"
+#include "utils/trace.h"
+
+namespace bip = boost::interprocess;
+
+namespace {
+
+const double kBohrToAngstrom = 0.529177210903;
+// points sampled by suggest_isovalue
+const std::size_t kIsovalueSamples = 1 << 20;
+// returned by the destinations of parse_values for numbers to drop
+const std::size_t kSkip = static_cast<std::size_t>(-1);
+
+bool is_space(char c) {
+    return ' ' == c || '\t' == c || '\n' == c || '\r' == c;
+}
+
+// the next line, pos is moved past it
+std::string next_line(const char*& pos, const char* end, const std::string& path) {
+    if (pos >= end) {
+        throw std::runtime_error("unexpected end of " + path);
+    }
+    const char* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+    const char* line_end = nullptr == newline ? end : newline;
+    std::string line(pos, line_end);
+    pos = nullptr == newline ? end : newline + 1;
+    return line;
+}
+
+// parses the number of [pos, end), nullptr when it is not one
+const char* parse_value(const char* pos, const char* end, float& value) {
+    if (pos < end && '+' == *pos) {
+        pos++;
+    }
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    const auto result = std::from_chars(pos, end, value);
+    return std::errc() == result.ec ? result.ptr : nullptr;
+#else
+    char buffer[64];
+    const std::size_t length = std::min<std::size_t>(end - pos, sizeof(buffer) - 1);
+    std::memcpy(buffer, pos, length);
+    buffer[length] = '\0';
+    char* number_end = nullptr;
+    value = std::strtof(buffer, &number_end);
+    return number_end == buffer ? nullptr : pos + (number_end - buffer);
+#endif
+}
+
+// parses the first count whitespace separated numbers of [begin, end),
+// number t going to values[destination(t)] unless that is kSkip. The text is cut into chunks
+// at whitespace, the numbers of every chunk are counted in parallel and
+// then parsed in parallel from the offsets of the counts.
+template <typename Destination>
+void parse_values(const char* begin, const char* end, std::size_t count, std::vector<float>& values, Destination destination, const std::string& path) {
+    TRACE_SCOPE_CAT("parse_values", "parse");
+    int nthread = 1;
+#ifdef _OPENMP
+    nthread = omp_get_max_threads();
+#endif
+    const std::size_t length = end - begin;
+    const int nchunk = static_cast<int>(std::max<std::size_t>(1, std::min<std::size_t>(16 * nthread, length >> 16)));
+    std::vector<const char*> bounds(nchunk + 1, end);
+    bounds[0] = begin;
+    for (int c = 1; c < nchunk; c++) {
+        const char* pos = std::max(bounds[c - 1], begin + length / nchunk * c);
+        while (pos < end && false == is_space(*pos)) {
+            pos++;
+        }
+        bounds[c] = pos;
+    }
+
+    std::vector<std::size_t> offsets(nchunk + 1, 0);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < nchunk; c++) {
+        std::size_t ntoken = 0;
+        bool in_token = false;
+        for (const char* pos = bounds[c]; pos < bounds[c + 1]; pos++) {
+            const bool space = is_space(*pos);
+            ntoken += (false == space && false == in_token) ? 1 : 0;
+            in_token = false == space;
+        }
+        offsets[c + 1] = ntoken;
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    if (offsets[nchunk] < count) {
+        throw std::runtime_error(path + " holds " + std::to_string(offsets[nchunk]) + " values, " + std::to_string(count) + " expected");
+    }
+
+    std::atomic<bool> ok{true};
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < nchunk; c++) {
+        const char* pos = bounds[c];
+        const char* chunk_end = bounds[c + 1];
+        const std::size_t last = std::min(count, offsets[c + 1]);
+        for (std::size_t t = offsets[c]; t < last; t++) {
+            while (true == is_space(*pos)) {
+                pos++;
+            }
+            const char* token_end = pos;
+            while (token_end < chunk_end && false == is_space(*token_end)) {
+                token_end++;
+            }
+            float value = 0.0f;
+            if (token_end != parse_value(pos, token_end, value)) {
+                ok.store(false);
+                break;
+            }
+            const std::size_t index = destination(t);
+            if (kSkip != index) {
+                values[index] = value;
+            }
+            pos = token_end;
+        }
+    }
+    if (false == ok.load()) {
+        throw std::runtime_error("non-numeric value in the data of " + path);
+    }
+}
+
+void update_range(VolumetricData& data) {
+    float lo = data.values.empty() ? 0.0f : data.values[0];
+    float hi = lo;
+    const long nvalue = static_cast<long>(data.values.size());
+#pragma omp parallel
+    {
+        float thread_lo = lo;
+        float thread_hi = hi;
+#pragma omp for schedule(static) nowait
+        for (long i = 0; i < nvalue; i++) {
+            thread_lo = std::min(thread_lo, data.values[i]);
+            thread_hi = std::max(thread_hi, data.values[i]);
+        }
+#pragma omp critical
+        {
+            lo = std::min(lo, thread_lo);
+            hi = std::max(hi, thread_hi);
+        }
+    }
+    data.min_value = lo;
+    data.max_value = hi;
+}
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        if (0 == boost::filesystem::file_size(path)) {
+            throw std::runtime_error(path + " is empty");
+        }
+        try {
+            m_file = bip::file_mapping(path.c_str(), bip::read_only);
+            m_region = bip::mapped_region(m_file, bip::read_only);
+        } catch (const bip::interprocess_exception& e) {
+            throw std::runtime_error("can not map " + path + ": " + e.what());
+        }
+        m_region.advise(bip::mapped_region::advice_sequential);
+    }
+
+    const char* begin() const {
+        return static_cast<const char*>(m_region.get_address());
+    }
+    const char* end() const {
+        return begin() + m_region.get_size();
+    }
+
+private:
+    bip::file_mapping m_file;
+    bip::mapped_region m_region;
+};
+
+} // namespace
+
+VolumetricData read_volumetric(const std::string& path) {
+    const std::string name = boost::filesystem::path(path).filename().string();
+    const std::string extension = boost::filesystem::path(path).extension().string();
+    if (".cube" == extension || ".cub" == extension) {
+        return read_cube(path);
+    }
+    for (const char* prefix : {"CHGCAR", "CHG", "PARCHG", "AECCAR", "LOCPOT", "ELFCAR"}) {
+        if (0 == name.compare(0, std::strlen(prefix), prefix)) {
+            return read_chgcar(path);
+        }
+    }
+    throw std::runtime_error("unknown volumetric format: " + path);
+}
+
+VolumetricData read_cube(const std::string& path) {
+    TRACE_SCOPE_CAT("read_cube", "io");
+    MappedFile file(path);
+    const char* pos = file.begin();
+    const char* end = file.end();
+    VolumetricData data;
+    next_line(pos, end, path);
+    next_line(pos, end, path);
+
+    int natom = 0;
+    {
+        std::istringstream line(next_line(pos, end, path));
+        line >> natom >> data.origin[0] >> data.origin[1] >> data.origin[2];
+        if (true == line.fail()) {
+            throw std::runtime_error("malformed atom count and origin in " + path);
+        }
+    }
+    // a negative number of points means Angstrom instead of Bohr
+    double unit = kBohrToAngstrom;
+    for (int a = 0; a < 3; a++) {
+        std::istringstream line(next_line(pos, end, path));
+        line >> data.n[a] >> data.steps[a][0] >> data.steps[a][1] >> data.steps[a][2];
+        if (true == line.fail() || 0 == data.n[a]) {
+            throw std::runtime_error("malformed grid axis in " + path);
+        }
+        if (data.n[a] < 0) {
+            data.n[a] = -data.n[a];
+            unit = 1.0;
+        }
+    }
+    for (int a = 0; a < 3; a++) {
+        data.origin[a] *= unit;
+        for (int b = 0; b < 3; b++) {
+            data.steps[a][b] *= unit;
+        }
+    }
+
+    for (int i = 0; i < std::abs(natom); i++) {
+        std::istringstream line(next_line(pos, end, path));
+        int z = 0;
+        double charge = 0.0;
+        double xyz[3];
+        line >> z >> charge >> xyz[0] >> xyz[1] >> xyz[2];
+        if (true == line.fail()) {
+            throw std::runtime_error("malformed atom line in " + path);
+        }
+        data.frame.species.push_back(data.species_table.index_of(element_symbol(z)));
+        for (int k = 0; k < 3; k++) {
+            data.frame.positions.push_back(xyz[k] * unit);
+        }
+    }
+    // orbital files list the orbitals after the atoms, their values are
+    // interleaved point by point
+    int norbital = 1;
+    if (natom < 0) {
+        std::istringstream line(next_line(pos, end, path));
+        line >> norbital;
+        norbital = std::max(1, norbital);
+    }
+
+    const int nx = data.n[0];
+    const int ny = data.n[1];
+    const int nz = data.n[2];
+    data.values.resize(static_cast<std::size_t>(nx) * ny * nz);
+    // z runs fastest in the file
+    const std::size_t nyz = static_cast<std::size_t>(ny) * nz;
+    parse_values(pos, end, data.values.size() * norbital, data.values, [&](std::size_t t) {
+        if (0 != t % norbital) {
+            return kSkip;
+        }
+        const std::size_t point = t / norbital;
+        const int i = static_cast<int>(point / nyz);
+        const int j = static_cast<int>(point / nz % ny);
+        const int k = static_cast<int>(point % nz);
+        return data.index(i, j, k);
+    }, path);
+    update_range(data);
+    return data;
+}
+
+VolumetricData read_chgcar(const std::string& path) {
+    TRACE_SCOPE_CAT("read_chgcar", "io");
+    MappedFile file(path);
+    const char* pos = file.begin();
+    const char* end = file.end();
+    VolumetricData data;
+    data.periodic = true;
+    next_line(pos, end, path);
+    double scale = 1.0;
+    {
+        std::istringstream line(next_line(pos, end, path));
+        line >> scale;
+    }
+    std::vector<std::vector<double>> cell(3, std::vector<double>(3, 0.0));
+    for (int a = 0; a < 3; a++) {
+        std::istringstream line(next_line(pos, end, path));
+        line >> cell[a][0] >> cell[a][1] >> cell[a][2];
+        if (true == line.fail()) {
+            throw std::runtime_error("malformed lattice in " + path);
+        }
+    }
+    const double volume = std::fabs(
+        cell[0][0] * (cell[1][1] * cell[2][2] - cell[1][2] * cell[2][1])
+        - cell[0][1] * (cell[1][0] * cell[2][2] - cell[1][2] * cell[2][0])
+        + cell[0][2] * (cell[1][0] * cell[2][1] - cell[1][1] * cell[2][0])
+    );
+    // a negative scale is the volume
+    if (scale < 0.0) {
+        scale = std::cbrt(-scale / volume);
+    }
+    for (auto& row : cell) {
+        for (auto& x : row) {
+            x *= scale;
+        }
+    }
+
+    // species names since VASP 5, then the atom counts
+    std::vector<std::string> names;
+    std::string line_text = next_line(pos, end, path);
+    {
+        std::istringstream line(line_text);
+        std::string word;
+        while (line >> word) {
+            names.push_back(word);
+        }
+    }
+    std::vector<int> counts;
+    if (false == names.empty() && 0 != std::isalpha(static_cast<unsigned char>(names[0][0]))) {
+        line_text = next_line(pos, end, path);
+    } else {
+        names.clear();
+    }
+    {
+        std::istringstream line(line_text);
+        int count = 0;
+        while (line >> count) {
+            counts.push_back(count);
+        }
+    }
+    line_text = next_line(pos, end, path);
+    if ('S' == line_text[line_text.find_first_not_of(" \t")] || 's' == line_text[line_text.find_first_not_of(" \t")]) {
+        line_text = next_line(pos, end, path);
+    }
+    const char mode = line_text[line_text.find_first_not_of(" \t")];
+    const bool direct = 'D' == mode || 'd' == mode;
+    for (std::size_t s = 0; s < counts.size(); s++) {
+        const int species = data.species_table.index_of(s < names.size() ? names[s] : "X");
+        for (int i = 0; i < counts[s]; i++) {
+            std::istringstream line(next_line(pos, end, path));
+            double xyz[3];
+            line >> xyz[0] >> xyz[1] >> xyz[2];
+            if (true == line.fail()) {
+                throw std::runtime_error("malformed position in " + path);
+            }
+            for (int k = 0; k < 3; k++) {
+                data.frame.positions.push_back(true == direct
+                    ? xyz[0] * cell[0][k] + xyz[1] * cell[1][k] + xyz[2] * cell[2][k]
+                    : xyz[k] * scale);
+            }
+            data.frame.species.push_back(species);
+        }
+    }
+    data.frame.cell = cell;
+
+    // the grid size after a blank line
+    for (;;) {
+        std::istringstream line(next_line(pos, end, path));
+        if (line >> data.n[0] >> data.n[1] >> data.n[2]) {
+            break;
+        }
+    }
+    for (int a = 0; a < 3; a++) {
+        if (data.n[a] <= 0) {
+            throw std::runtime_error("malformed grid size in " + path);
+        }
+        for (int b = 0; b < 3; b++) {
+            data.steps[a][b] = cell[a][b] / data.n[a];
+        }
+    }
+    data.values.resize(static_cast<std::size_t>(data.n[0]) * data.n[1] * data.n[2]);
+    // x runs fastest in the file as in memory
+    parse_values(pos, end, data.values.size(), data.values, [](std::size_t t) {
+        return t;
+    }, path);
+
+    // the charge files hold the density times the cell volume
+    const std::string name = boost::filesystem::path(path).filename().string();
+    if (0 == name.compare(0, 3, "CHG") || 0 == name.compare(0, 6, "PARCHG") || 0 == name.compare(0, 6, "AECCAR")) {
+        const float inverse_volume = static_cast<float>(1.0 / volume);
+        const long nvalue = static_cast<long>(data.values.size());
+#pragma omp parallel for schedule(static)
+        for (long i = 0; i < nvalue; i++) {
+            data.values[i] *= inverse_volume;
+        }
+    }
+    update_range(data);
+    return data;
+}
+
+float suggest_isovalue(const VolumetricData& data, double fraction) {
+    if (true == data.values.empty()) {
+        return 0.0f;
+    }
+    const std::size_t stride = std::max<std::size_t>(1, data.values.size() / kIsovalueSamples);
+    std::vector<float> sample;
+    sample.reserve(data.values.size() / stride + 1);
+    for (std::size_t i = 0; i < data.values.size(); i += stride) {
+        sample.push_back(std::fabs(data.values[i]));
+    }
+    const std::size_t nth = std::min(sample.size() - 1, static_cast<std::size_t>((1.0 - fraction) * sample.size()));
+    std::nth_element(sample.begin(), sample.begin() + nth, sample.end());
+    return sample[nth];
+}
@@ -0,0 +1,83 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Scalar fields on regular grids, such as charge densities, potentials
+/// and orbitals, with the atoms of the file.
+///
+/// Formats, chosen by the file name:
+///
+///     *.cube, *.cub                        Gaussian cube, the first
+///                                          orbital of multi-orbital files
+///     CHGCAR*, CHG*, PARCHG*, AECCAR*,     VASP, the first data set; the
+///     LOCPOT*, ELFCAR*                     charge files are divided by
+///                                          the cell volume
+///
+/// The values are parsed in parallel on the memory mapped file. Lengths
+/// are converted to Angstrom, the values are kept in the units of the
+/// file.
+
+#ifndef ANALYSIS_VOLUMETRIC_H
+#define ANALYSIS_VOLUMETRIC_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "analysis/frame.h"
+
+struct VolumetricData {
+    // points along each axis
+    int n[3] = {0, 0, 0};
+    // A, the position of point (0, 0, 0)
+    double origin[3] = {0.0, 0.0, 0.0};
+    // A, the step from one point to the next along each axis, as rows
+    double steps[3][3] = {{0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}};
+    // the grid repeats along every axis, point n[a] is point 0 again
+    bool periodic = false;
+    // x fastest, see index()
+    std::vector<float> values;
+    float min_value = 0.0f;
+    float max_value = 0.0f;
+
+    Frame frame;
+    SpeciesTable species_table;
+
+    std::size_t index(int i, int j, int k) const {
+        return (static_cast<std::size_t>(k) * n[1] + j) * n[0] + i;
+    }
+    float value(int i, int j, int k) const {
+        return values[index(i, j, k)];
+    }
+    std::size_t size() const {
+        return values.size();
+    }
+};
+
+// throws std::runtime_error for unknown names and malformed files
+VolumetricData read_volumetric(const std::string& path);
+VolumetricData read_cube(const std::string& path);
+VolumetricData read_chgcar(const std::string& path);
+
+// the value whose absolute value is exceeded by the given fraction of
+// the points, estimated from a sample; a starting isovalue that works
+// whatever the units
+float suggest_isovalue(const VolumetricData& data, double fraction = 0.05);
+
+#endif // ANALYSIS_VOLUMETRIC_H
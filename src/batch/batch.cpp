@@ -0,0 +1,358 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "batch/batch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <atomsciflow/base/atomic_radius.h>
+
+#include "analysis/bonds.h"
+#include "analysis/frame.h"
+#include "batch/offscreen_renderer.h"
+#include "calc/input_generator.h"
+#include "utils/logger.h"
+#include "utils/trace.h"
+
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+namespace {
+
+std::string lower_extension(const fs::path& path) {
+    auto extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension;
+}
+
+bool is_structure_file(const fs::path& path) {
+    auto extension = lower_extension(path);
+    return ".xyz" == extension || ".cif" == extension;
+}
+
+std::string json_escape(const std::string& str) {
+    std::string escaped;
+    for (const auto c : str) {
+        if ('"' == c || '\\' == c) {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+std::string analysis_composition(atomsciflow::Crystal& crystal) {
+    std::map<std::string, int> counts;
+    for (const auto& atom : crystal.atoms) {
+        counts[atom.name]++;
+    }
+    std::string formula;
+    for (const auto& item : counts) {
+        formula += item.first;
+        if (item.second > 1) {
+            formula += std::to_string(item.second);
+        }
+    }
+    double volume = 0.0;
+    if (3 == crystal.cell.size()) {
+        const auto& a = crystal.cell[0];
+        const auto& b = crystal.cell[1];
+        const auto& c = crystal.cell[2];
+        volume = std::abs(
+            a[0] * (b[1] * c[2] - b[2] * c[1])
+            - a[1] * (b[0] * c[2] - b[2] * c[0])
+            + a[2] * (b[0] * c[1] - b[1] * c[0])
+        );
+    }
+    std::ostringstream out;
+    out << "\"natom\":" << crystal.atoms.size()
+        << ",\"formula\":\"" << json_escape(formula) << "\""
+        << ",\"volume\":" << volume;
+    return out.str();
+}
+
+std::string analysis_bonds(atomsciflow::Crystal& crystal) {
+    thread_local atomsciflow::AtomicRadius atomic_radius;
+    SpeciesTable species_table;
+    auto frame = frame_from_crystal(crystal, species_table);
+    auto bonds = detect_bonds(frame, species_radii(species_table, atomic_radius));
+    return "\"nbond\":" + std::to_string(bonds.size());
+}
+
+} // namespace
+
+std::map<std::string, BatchAnalysis>& batch_analyses() {
+    static std::map<std::string, BatchAnalysis> analyses{
+        {"composition", analysis_composition},
+        {"bonds", analysis_bonds},
+    };
+    return analyses;
+}
+
+std::vector<std::string> collect_structure_files(const std::vector<std::string>& inputs) {
+    std::vector<std::string> files;
+    for (const auto& input : inputs) {
+        if (true == fs::is_directory(input)) {
+            for (const auto& entry : fs::recursive_directory_iterator(input)) {
+                if (true == fs::is_regular_file(entry.path()) && true == is_structure_file(entry.path())) {
+                    files.push_back(entry.path().string());
+                }
+            }
+        } else {
+            files.push_back(input);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+std::vector<std::string> unique_output_names(const std::vector<std::string>& files) {
+    std::vector<std::string> names(files.size());
+    std::set<std::string> taken;
+    std::vector<std::size_t> duplicates;
+    for (std::size_t i = 0; i < files.size(); i++) {
+        names[i] = fs::path(files[i]).stem().string();
+        if (false == taken.insert(names[i]).second) {
+            duplicates.push_back(i);
+        }
+    }
+    // after all plain stems are taken, so that a file named a-2 keeps
+    // its name next to two files named a
+    for (const std::size_t i : duplicates) {
+        const auto stem = names[i];
+        for (int counter = 2; ; counter++) {
+            names[i] = stem + "-" + std::to_string(counter);
+            if (true == taken.insert(names[i]).second) {
+                break;
+            }
+        }
+    }
+    return names;
+}
+
+void read_structure_file(atomsciflow::Crystal& crystal, const std::string& path) {
+    TRACE_SCOPE_CAT("read_structure_file", "parse");
+    auto extension = lower_extension(path);
+    if (".xyz" == extension) {
+        crystal.read_xyz_file(path);
+    } else if (".cif" == extension) {
+        crystal.read_cif_file(path);
+    } else {
+        throw std::runtime_error("unsupported structure format: " + path);
+    }
+}
+
+void write_structure_file(atomsciflow::Crystal& crystal, const std::string& path) {
+    auto extension = lower_extension(path);
+    if (".xyz" == extension) {
+        crystal.write_xyz_file(path);
+    } else if (".cif" == extension) {
+        crystal.write_cif_file(path);
+    } else {
+        throw std::runtime_error("unsupported structure format: " + path);
+    }
+}
+
+bool is_batch_mode(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (0 == std::strcmp(argv[i], "--batch")) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int run_batch(int argc, char* argv[]) {
+    po::options_description options("atomscistudio --batch [options] inputs...");
+    options.add_options()
+        ("help,h", "print this help message")
+        ("batch", "run without GUI")
+        ("convert", po::value<std::string>(), "write each structure in this format (xyz, cif)")
+        ("render", "render each structure into a PNG image")
+        ("inputs", po::value<std::string>(), "write calculator inputs from this template directory")
+        ("set", po::value<std::vector<std::string>>()->composing(), "template parameter key=value, can be repeated")
+        ("analysis", po::value<std::vector<std::string>>()->composing(), "run an analysis, can be repeated")
+        ("output-dir,o", po::value<std::string>()->default_value("."), "directory for the outputs")
+        ("jobs,j", po::value<int>()->default_value(0), "number of parallel jobs, 0 for all cores")
+        ("width", po::value<int>()->default_value(800), "image width")
+        ("height", po::value<int>()->default_value(600), "image height")
+        ("input", po::value<std::vector<std::string>>(), "structure files or directories");
+    po::positional_options_description positional;
+    positional.add("input", -1);
+
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv).options(options).positional(positional).run(), vm);
+        po::notify(vm);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+    if (vm.count("help") || 0 == vm.count("input")) {
+        std::cout << options << std::endl;
+        std::cout << "Available analyses:";
+        for (const auto& item : batch_analyses()) {
+            std::cout << " " << item.first;
+        }
+        std::cout << std::endl;
+        return 0 == vm.count("help") ? 2 : 0;
+    }
+
+    std::vector<std::string> analysis_names;
+    if (vm.count("analysis")) {
+        analysis_names = vm["analysis"].as<std::vector<std::string>>();
+        for (const auto& name : analysis_names) {
+            if (0 == batch_analyses().count(name)) {
+                std::cerr << "Unknown analysis: " << name << std::endl;
+                return 2;
+            }
+        }
+    }
+    const std::string convert_format = vm.count("convert") ? vm["convert"].as<std::string>() : "";
+    const bool render = vm.count("render") > 0;
+    const fs::path output_dir = vm["output-dir"].as<std::string>();
+    const int width = vm["width"].as<int>();
+    const int height = vm["height"].as<int>();
+    fs::create_directories(output_dir);
+
+    const auto files = collect_structure_files(vm["input"].as<std::vector<std::string>>());
+
+    if (vm.count("inputs")) {
+        std::map<std::string, std::string> parameters;
+        if (vm.count("set")) {
+            for (const auto& item : vm["set"].as<std::vector<std::string>>()) {
+                const auto equal = item.find('=');
+                if (std::string::npos == equal) {
+                    std::cerr << "Expected key=value: " << item << std::endl;
+                    return 2;
+                }
+                parameters[item.substr(0, equal)] = item.substr(equal + 1);
+            }
+        }
+        try {
+            const InputTemplate input_template(vm["inputs"].as<std::string>(), parameters);
+            const auto result = generate_inputs(input_template, files, output_dir.string(), vm["jobs"].as<int>());
+            for (const auto& error : result.errors) {
+                std::cerr << error.first << ": " << error.second << std::endl;
+            }
+            std::cout << result.ngenerated << " of " << files.size() << " inputs written in " << result.seconds << " s" << std::endl;
+            if (false == result.errors.empty()) {
+                return 1;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 2;
+        }
+        if (convert_format.empty() && false == render && analysis_names.empty()) {
+            return 0;
+        }
+    }
+    std::vector<std::string> analysis_lines(files.size());
+    std::vector<std::string> errors(files.size());
+
+    // decided up front, a recursive collection may find the same stem in
+    // several directories
+    const auto names = unique_output_names(files);
+
+    int jobs = vm["jobs"].as<int>();
+#ifdef _OPENMP
+    if (jobs <= 0) {
+        jobs = omp_get_max_threads();
+    }
+    std::vector<std::unique_ptr<OffscreenRenderer>> renderers(jobs);
+#else
+    jobs = 1;
+    std::vector<std::unique_ptr<OffscreenRenderer>> renderers(1);
+#endif
+
+    // dynamic scheduling, the structures differ a lot in size
+#pragma omp parallel for schedule(dynamic, 1) num_threads(jobs)
+    for (long i = 0; i < static_cast<long>(files.size()); i++) {
+#ifdef _OPENMP
+        const int thread = omp_get_thread_num();
+#else
+        const int thread = 0;
+#endif
+        const fs::path path = files[i];
+        try {
+            atomsciflow::Crystal crystal;
+            read_structure_file(crystal, path.string());
+
+            if (false == convert_format.empty()) {
+                auto output = output_dir / (names[i] + "." + convert_format);
+                write_structure_file(crystal, output.string());
+            }
+            if (true == render) {
+                // every thread keeps its own viewer and OpenGL context
+                if (nullptr == renderers[thread]) {
+                    renderers[thread] = std::make_unique<OffscreenRenderer>(width, height);
+                }
+                auto image = output_dir / (names[i] + ".png");
+                if (false == renderers[thread]->render(crystal, image.string())) {
+                    throw std::runtime_error("can not render " + image.string());
+                }
+            }
+            if (false == analysis_names.empty()) {
+                std::string line = "{\"file\":\"" + json_escape(path.string()) + "\"";
+                for (const auto& name : analysis_names) {
+                    line += ",\"" + name + "\":{" + batch_analyses()[name](crystal) + "}";
+                }
+                analysis_lines[i] = line + "}";
+            }
+        } catch (const std::exception& e) {
+            errors[i] = e.what();
+        }
+    }
+
+    if (false == analysis_names.empty()) {
+        std::ofstream out((output_dir / "analysis.jsonl").string());
+        for (const auto& line : analysis_lines) {
+            if (false == line.empty()) {
+                out << line << "\n";
+            }
+        }
+    }
+
+    int nfailed = 0;
+    for (std::size_t i = 0; i < files.size(); i++) {
+        if (false == errors[i].empty()) {
+            std::cerr << files[i] << ": " << errors[i] << std::endl;
+            nfailed++;
+        }
+    }
+    std::cout << files.size() - nfailed << " of " << files.size() << " structures processed" << std::endl;
+    return 0 == nfailed ? 0 : 1;
+}
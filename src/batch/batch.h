@@ -0,0 +1,54 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Headless batch mode: `atomscistudio --batch [options] inputs...`
+///
+/// Converts structures, renders images and runs analyses over many
+/// files in parallel, without creating a QApplication or a window.
+
+#ifndef BATCH_BATCH_H
+#define BATCH_BATCH_H
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <atomsciflow/base/crystal.h>
+
+// an analysis returns the members of a JSON object, e.g. "\"natom\":3"
+using BatchAnalysis = std::function<std::string(atomsciflow::Crystal& crystal)>;
+
+std::map<std::string, BatchAnalysis>& batch_analyses();
+
+// the structure files below the directories, sorted
+std::vector<std::string> collect_structure_files(const std::vector<std::string>& inputs);
+
+// output names for the files, their stems made unique: the first file
+// with a stem keeps it, the others get the lowest free "-2", "-3", ...
+std::vector<std::string> unique_output_names(const std::vector<std::string>& files);
+
+void read_structure_file(atomsciflow::Crystal& crystal, const std::string& path);
+void write_structure_file(atomsciflow::Crystal& crystal, const std::string& path);
+
+bool is_batch_mode(int argc, char* argv[]);
+int run_batch(int argc, char* argv[]);
+
+#endif // BATCH_BATCH_H
@@ -0,0 +1,80 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "batch/offscreen_renderer.h"
+
+#include <Aspect_DisplayConnection.hxx>
+#include <Aspect_NeutralWindow.hxx>
+#include <Image_AlienPixMap.hxx>
+#include <OpenGl_GraphicDriver.hxx>
+
+#include "modeling_occ/atoms_presentation.h"
+#include "utils/trace.h"
+
+OffscreenRenderer::OffscreenRenderer(int width, int height)
+    : m_width{width}, m_height{height} {
+
+    this->m_atomic_radius = std::make_shared<atomsciflow::AtomicRadius>();
+    this->m_atomic_color = std::make_shared<AtomicColor>();
+
+    Handle(Aspect_DisplayConnection) display_connection = new Aspect_DisplayConnection{};
+    Handle(OpenGl_GraphicDriver) graphic_driver = new OpenGl_GraphicDriver{display_connection, Standard_False};
+    graphic_driver->ChangeOptions().buffersNoSwap = Standard_True;
+    graphic_driver->InitContext();
+
+    m_v3d_viewer = new V3d_Viewer{graphic_driver};
+    m_v3d_viewer->SetLightOn();
+    m_v3d_viewer->SetDefaultLights();
+    m_v3d_view = m_v3d_viewer->CreateView();
+
+    Handle(Aspect_NeutralWindow) window = new Aspect_NeutralWindow();
+    window->SetSize(m_width, m_height);
+    window->SetVirtual(Standard_True);
+    m_v3d_view->SetWindow(window);
+
+    m_v3d_view->SetBackgroundColor(Quantity_Color(
+        0., 0., 0.,
+        Quantity_TOC_sRGB
+    ));
+    m_v3d_view->Camera()->SetProjectionType(Graphic3d_Camera::Projection_Orthographic);
+    m_v3d_view->SetProj(V3d_XposYposZpos);
+
+    m_ais_context = new AIS_InteractiveContext{m_v3d_viewer};
+    m_ais_context->SetDisplayMode(AIS_Shaded, Standard_False);
+}
+
+bool OffscreenRenderer::render(const atomsciflow::Crystal& crystal, const std::string& image_path) {
+    TRACE_SCOPE_CAT("OffscreenRenderer::render", "draw");
+    m_ais_context->RemoveAll(Standard_False);
+    for (const auto& atom_sphere : build_atom_spheres(crystal, *m_atomic_radius, *m_atomic_color)) {
+        m_ais_context->Display(atom_sphere, Standard_False);
+    }
+    m_v3d_view->FitAll(0.01, Standard_False);
+
+    Image_AlienPixMap image;
+    V3d_ImageDumpOptions options;
+    options.Width = m_width;
+    options.Height = m_height;
+    options.BufferType = Graphic3d_BT_RGB;
+    if (false == m_v3d_view->ToPixMap(image, options)) {
+        return false;
+    }
+    return image.Save(TCollection_AsciiString(image_path.c_str()));
+}
@@ -0,0 +1,69 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Renders structures into image files without a window, with its own
+/// OCCT viewer on a virtual Aspect_NeutralWindow.
+///
+/// On Linux OCCT still needs a display connection: either an OCCT build
+/// with EGL, or an X server such as Xvfb (xvfb-run atomscistudio --batch).
+
+#ifndef BATCH_OFFSCREEN_RENDERER_H
+#define BATCH_OFFSCREEN_RENDERER_H
+
+#include <memory>
+#include <string>
+
+#include <AIS_InteractiveContext.hxx>
+#include <V3d_View.hxx>
+#include <V3d_Viewer.hxx>
+
+#include <atomsciflow/base/crystal.h>
+#include <atomsciflow/base/atomic_radius.h>
+
+#include "modeling/atomic_color.h"
+
+class OffscreenRenderer {
+public:
+    OffscreenRenderer(int width, int height);
+    ~OffscreenRenderer() = default;
+
+    // the image format is deduced from the extension of image_path
+    bool render(const atomsciflow::Crystal& crystal, const std::string& image_path);
+
+    const Handle(V3d_View)& get_view() const {
+        return m_v3d_view;
+    }
+    const Handle(AIS_InteractiveContext)& get_context() const {
+        return m_ais_context;
+    }
+
+private:
+    int m_width;
+    int m_height;
+
+    Handle(V3d_Viewer) m_v3d_viewer;
+    Handle(V3d_View) m_v3d_view;
+    Handle(AIS_InteractiveContext) m_ais_context;
+
+    std::shared_ptr<atomsciflow::AtomicRadius> m_atomic_radius;
+    std::shared_ptr<AtomicColor> m_atomic_color;
+};
+
+#endif // BATCH_OFFSCREEN_RENDERER_H
@@ -0,0 +1,276 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// atomscistudio_bench: timings of the core hot paths on synthetic
+/// structures, written as JSON so that releases can be compared.
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <Standard_Failure.hxx>
+
+#include <atomsciflow/base/crystal.h>
+#include <atomsciflow/base/atomic_radius.h>
+
+#include "analysis/bonds.h"
+#include "analysis/frame.h"
+#include "batch/offscreen_renderer.h"
+#include "bench/synthetic.h"
+#include "modeling/atomic_color.h"
+#include "modeling_occ/atoms_presentation.h"
+
+namespace po = boost::program_options;
+
+namespace {
+
+struct BenchResult {
+    std::string name;
+    long natom;
+    int iterations;
+    double min_ms;
+    double mean_ms;
+    double max_ms;
+    std::string note;
+};
+
+class BenchRunner {
+public:
+    BenchRunner(double min_time_ms, int max_iterations)
+        : m_min_time_ms{min_time_ms}, m_max_iterations{max_iterations} {
+    }
+
+    // repeats f until min_time_ms has passed or max_iterations are done
+    void run(const std::string& name, long natom, const std::function<void()>& f) {
+        BenchResult result{name, natom, 0, std::numeric_limits<double>::max(), 0.0, 0.0, ""};
+        double total_ms = 0.0;
+        while (result.iterations < m_max_iterations && (0 == result.iterations || total_ms < m_min_time_ms)) {
+            auto begin = std::chrono::steady_clock::now();
+            f();
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            result.min_ms = std::min(result.min_ms, ms);
+            result.max_ms = std::max(result.max_ms, ms);
+            total_ms += ms;
+            result.iterations++;
+        }
+        result.mean_ms = total_ms / result.iterations;
+        std::cout << name << " natom=" << natom
+                  << " mean=" << result.mean_ms << " ms"
+                  << " min=" << result.min_ms << " ms"
+                  << " iterations=" << result.iterations << std::endl;
+        m_results.push_back(result);
+    }
+
+    void skip(const std::string& name, long natom, const std::string& note) {
+        std::cout << name << " natom=" << natom << " skipped: " << note << std::endl;
+        m_results.push_back(BenchResult{name, natom, 0, 0.0, 0.0, 0.0, note});
+    }
+
+    void write_json(const std::string& path, const std::vector<long>& sizes, int threads) const {
+        std::ofstream out(path);
+        out << "{\n  \"threads\": " << threads << ",\n  \"sizes\": [";
+        for (std::size_t i = 0; i < sizes.size(); i++) {
+            out << (i > 0 ? ", " : "") << sizes[i];
+        }
+        out << "],\n  \"results\": [";
+        for (std::size_t i = 0; i < m_results.size(); i++) {
+            const auto& result = m_results[i];
+            out << (i > 0 ? "," : "") << "\n    {"
+                << "\"name\": \"" << result.name << "\", "
+                << "\"natom\": " << result.natom << ", "
+                << "\"iterations\": " << result.iterations << ", "
+                << "\"min_ms\": " << result.min_ms << ", "
+                << "\"mean_ms\": " << result.mean_ms << ", "
+                << "\"max_ms\": " << result.max_ms;
+            if (false == result.note.empty()) {
+                out << ", \"skipped\": \"" << result.note << "\"";
+            }
+            out << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+private:
+    double m_min_time_ms;
+    int m_max_iterations;
+    std::vector<BenchResult> m_results;
+};
+
+std::vector<long> parse_sizes(const std::string& text) {
+    std::vector<long> sizes;
+    std::istringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        sizes.push_back(std::stol(item));
+    }
+    return sizes;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    po::options_description options("atomscistudio_bench [options]");
+    options.add_options()
+        ("help,h", "print this help message")
+        ("sizes", po::value<std::string>()->default_value("1000,100000,1000000,10000000"), "comma separated atom counts")
+        ("output,o", po::value<std::string>()->default_value("atomscistudio_bench.json"), "JSON result file")
+        ("min-time", po::value<double>()->default_value(500.0), "minimal time per benchmark in ms")
+        ("max-iterations", po::value<int>()->default_value(20), "maximal repetitions per benchmark")
+        ("max-sphere-atoms", po::value<long>()->default_value(100000), "largest structure drawn with BRep spheres")
+        ("no-render", "skip the benchmarks which need an OpenGL context");
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, options), vm);
+        po::notify(vm);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+    if (vm.count("help")) {
+        std::cout << options << std::endl;
+        return 0;
+    }
+
+    const auto sizes = parse_sizes(vm["sizes"].as<std::string>());
+    const long max_sphere_atoms = vm["max-sphere-atoms"].as<long>();
+    const bool render = 0 == vm.count("no-render");
+    BenchRunner runner(vm["min-time"].as<double>(), vm["max-iterations"].as<int>());
+
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+
+    atomsciflow::AtomicRadius atomic_radius;
+    AtomicColor atomic_color;
+    std::unique_ptr<OffscreenRenderer> renderer;
+    std::string render_error;
+    if (true == render) {
+        try {
+            renderer = std::make_unique<OffscreenRenderer>(1280, 720);
+        } catch (const Standard_Failure& e) {
+            render_error = e.GetMessageString();
+        }
+    } else {
+        render_error = "--no-render";
+    }
+
+    for (const long natom : sizes) {
+        const std::string xyz = make_synthetic_xyz(natom);
+
+        atomsciflow::Crystal crystal;
+        runner.run("parse_xyz_str", natom, [&]() {
+            atomsciflow::Crystal parsed;
+            parsed.read_xyz_str(xyz);
+        });
+        crystal.read_xyz_str(xyz);
+
+        runner.run("element_lookup_map", natom, [&]() {
+            double sum = 0.0;
+            for (const auto& atom : crystal.atoms) {
+                sum += atomic_radius.calculated[atom.name];
+                sum += atomic_color.jmol[atom.name][0];
+            }
+            volatile double sink = sum;
+            (void)sink;
+        });
+
+        SpeciesTable species_table;
+        Frame frame;
+        runner.run("frame_from_crystal", natom, [&]() {
+            SpeciesTable table;
+            frame = frame_from_crystal(crystal, table);
+            species_table = table;
+        });
+
+        const auto radii = species_radii(species_table, atomic_radius);
+        runner.run("element_lookup_species", natom, [&]() {
+            double sum = 0.0;
+            for (const int species : frame.species) {
+                sum += radii[species];
+            }
+            volatile double sink = sum;
+            (void)sink;
+        });
+
+        std::size_t nbond = 0;
+        runner.run("detect_bonds", natom, [&]() {
+            nbond = detect_bonds(frame, radii).size();
+        });
+        std::cout << "  " << nbond << " bonds" << std::endl;
+
+        if (natom <= max_sphere_atoms) {
+            runner.run("scene_spheres", natom, [&]() {
+                build_atom_spheres(crystal, atomic_radius, atomic_color);
+            });
+        } else {
+            runner.skip("scene_spheres", natom, "above --max-sphere-atoms");
+        }
+        runner.run("scene_points", natom, [&]() {
+            build_atom_points(crystal, atomic_color);
+        });
+
+        if (nullptr == renderer) {
+            runner.skip("offscreen_frame", natom, render_error);
+            runner.skip("picking", natom, render_error);
+            continue;
+        }
+        auto context = renderer->get_context();
+        auto view = renderer->get_view();
+        context->RemoveAll(Standard_False);
+        if (natom <= max_sphere_atoms) {
+            for (const auto& atom_sphere : build_atom_spheres(crystal, atomic_radius, atomic_color)) {
+                context->Display(atom_sphere, Standard_False);
+            }
+        } else {
+            context->Display(build_atom_points(crystal, atomic_color), Standard_False);
+        }
+        view->FitAll(0.01, Standard_False);
+        view->Redraw();
+
+        runner.run("offscreen_frame", natom, [&]() {
+            view->Turn(0.0, 0.01, 0.0, Standard_False);
+            view->Redraw();
+        });
+        Standard_Integer width = 0;
+        Standard_Integer height = 0;
+        view->Window()->Size(width, height);
+        runner.run("picking", natom, [&]() {
+            context->MoveTo(width / 2, height / 2, view, Standard_False);
+        });
+        context->RemoveAll(Standard_False);
+    }
+
+    runner.write_json(vm["output"].as<std::string>(), sizes, threads);
+    return 0;
+}
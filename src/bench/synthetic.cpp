@@ -0,0 +1,56 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "bench/synthetic.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+std::string make_synthetic_xyz(long natom, unsigned int seed, double spacing) {
+    static const char* elements[] = {"C", "H", "O", "N", "Si", "H"};
+    const long side = static_cast<long>(std::ceil(std::cbrt(static_cast<double>(natom))));
+    const double length = side * spacing;
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> jitter(-0.1 * spacing, 0.1 * spacing);
+
+    std::string xyz;
+    xyz.reserve(static_cast<std::size_t>(natom) * 40 + 128);
+    char line[128];
+    std::snprintf(line, sizeof(line), "%ld\n", natom);
+    xyz += line;
+    std::snprintf(line, sizeof(line),
+        "cell: %f 0.000000 0.000000 | 0.000000 %f 0.000000 | 0.000000 0.000000 %f\n",
+        length, length, length);
+    xyz += line;
+    for (long i = 0; i < natom; i++) {
+        const long x = i / (side * side);
+        const long y = (i / side) % side;
+        const long z = i % side;
+        std::snprintf(line, sizeof(line), "%s\t%f\t%f\t%f\n",
+            elements[i % 6],
+            (x + 0.5) * spacing + jitter(generator),
+            (y + 0.5) * spacing + jitter(generator),
+            (z + 0.5) * spacing + jitter(generator));
+        xyz += line;
+    }
+    return xyz;
+}
@@ -0,0 +1,32 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Synthetic structures for the benchmarks: atoms on a jittered simple
+/// cubic grid in a periodic box, with a mix of elements.
+
+#ifndef BENCH_SYNTHETIC_H
+#define BENCH_SYNTHETIC_H
+
+#include <string>
+
+// xyz text in the format read by atomsciflow::Crystal::read_xyz_str
+std::string make_synthetic_xyz(long natom, unsigned int seed = 42, double spacing = 1.5);
+
+#endif // BENCH_SYNTHETIC_H
@@ -0,0 +1,289 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "cache/structure_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+#include "utils/hash.h"
+#include "utils/logger.h"
+#include "utils/trace.h"
+
+namespace fs = boost::filesystem;
+namespace bip = boost::interprocess;
+
+// bump on any change of the layout of atoms.bin or bonds.bin, or of
+// the way structures are parsed
+const std::uint32_t StructureCache::kFormatVersion = 1;
+
+namespace {
+
+const char kAtomsMagic[8] = {'A', 'S', 'S', 'A', 'T', 'O', 'M', 'S'};
+const char* kParserVersion = "atomsciflow-crystal";
+
+struct AtomsHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::int32_t natom;
+    std::int32_t nspecies;
+    std::int32_t periodic;
+    double cell[3][3];
+    // followed by nspecies zero terminated names, padded to 8 bytes,
+    // int32 species[natom] padded to 8 bytes and double positions[3 * natom]
+};
+
+std::size_t align8(std::size_t offset) {
+    return (offset + 7) & ~static_cast<std::size_t>(7);
+}
+
+void touch(const fs::path& path) {
+    boost::system::error_code ec;
+    fs::last_write_time(path, std::time(nullptr), ec);
+}
+
+} // namespace
+
+StructureCache::StructureCache(const std::string& cache_dir, std::uint64_t max_bytes)
+    : m_cache_dir{cache_dir}, m_max_bytes{max_bytes} {
+    if (false == fs::exists(m_cache_dir)) {
+        fs::create_directories(m_cache_dir);
+    }
+}
+
+std::string StructureCache::key_of(const std::string& file_path) const {
+    TRACE_SCOPE_CAT("StructureCache::key_of", "cache");
+    Sha256 sha256;
+    sha256.update(std::string(kParserVersion) + "/" + std::to_string(kFormatVersion) + "/");
+    return sha256.update_file(file_path).hex_digest();
+}
+
+bool StructureCache::contains(const std::string& key) const {
+    return fs::exists(fs::path(m_cache_dir) / key / "atoms.bin");
+}
+
+std::string StructureCache::thumbnail_path(const std::string& key) const {
+    return (fs::path(m_cache_dir) / key / "thumbnail.png").string();
+}
+
+bool StructureCache::load(const std::string& key, CachedStructure& cached) {
+    TRACE_SCOPE_CAT("StructureCache::load", "cache");
+    const fs::path entry = fs::path(m_cache_dir) / key;
+    if (false == this->contains(key)) {
+        return false;
+    }
+    // counts, offsets and indices are checked against the mapped sizes,
+    // a truncated or corrupt entry is a miss and is overwritten by the
+    // next store
+    const auto corrupt = [&key, &cached](const char* what) {
+        LOG_WARNING("Corrupt cache entry %s: %s", key.c_str(), what);
+        cached.natom = 0;
+        cached.nbond = 0;
+        cached.species = nullptr;
+        cached.positions = nullptr;
+        cached.bonds = nullptr;
+        return false;
+    };
+    try {
+        cached.m_atoms_file = bip::file_mapping((entry / "atoms.bin").string().c_str(), bip::read_only);
+        cached.m_atoms_region = bip::mapped_region(cached.m_atoms_file, bip::read_only);
+        const char* data = static_cast<const char*>(cached.m_atoms_region.get_address());
+        const std::size_t size = cached.m_atoms_region.get_size();
+        if (size < sizeof(AtomsHeader)) {
+            return corrupt("truncated header");
+        }
+        AtomsHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (0 != std::memcmp(header.magic, kAtomsMagic, 8) || header.version != kFormatVersion) {
+            return false;
+        }
+        if (header.natom < 0 || header.nspecies < 0) {
+            return corrupt("negative count");
+        }
+        cached.natom = header.natom;
+        cached.periodic = 0 != header.periodic;
+        std::memcpy(cached.cell, header.cell, sizeof(header.cell));
+
+        std::size_t offset = sizeof(AtomsHeader);
+        cached.species_names.clear();
+        for (int s = 0; s < header.nspecies; s++) {
+            if (offset >= size) {
+                return corrupt("truncated species names");
+            }
+            const char* name = data + offset;
+            const std::size_t length = strnlen(name, size - offset);
+            if (length == size - offset) {
+                return corrupt("unterminated species name");
+            }
+            cached.species_names.emplace_back(name, length);
+            offset += length + 1;
+        }
+        // natom is at most 2^31, none of this overflows 64 bits
+        const std::uint64_t species_offset = align8(offset);
+        const std::uint64_t positions_offset = align8(species_offset + sizeof(std::int32_t) * static_cast<std::uint64_t>(cached.natom));
+        if (positions_offset + sizeof(double) * 3 * static_cast<std::uint64_t>(cached.natom) > size) {
+            return corrupt("truncated atoms");
+        }
+        cached.species = reinterpret_cast<const std::int32_t*>(data + species_offset);
+        cached.positions = reinterpret_cast<const double*>(data + positions_offset);
+        for (int i = 0; i < cached.natom; i++) {
+            if (cached.species[i] < 0 || cached.species[i] >= header.nspecies) {
+                return corrupt("species index out of range");
+            }
+        }
+
+        cached.nbond = 0;
+        cached.bonds = nullptr;
+        const fs::path bonds_path = entry / "bonds.bin";
+        if (fs::exists(bonds_path) && fs::file_size(bonds_path) > 0) {
+            cached.m_bonds_file = bip::file_mapping(bonds_path.string().c_str(), bip::read_only);
+            cached.m_bonds_region = bip::mapped_region(cached.m_bonds_file, bip::read_only);
+            if (0 != cached.m_bonds_region.get_size() % (2 * sizeof(std::int32_t))) {
+                return corrupt("truncated bonds");
+            }
+            const std::uint64_t nbond = cached.m_bonds_region.get_size() / (2 * sizeof(std::int32_t));
+            const auto bonds = static_cast<const std::int32_t*>(cached.m_bonds_region.get_address());
+            for (std::uint64_t b = 0; b < 2 * nbond; b++) {
+                if (bonds[b] < 0 || bonds[b] >= cached.natom) {
+                    return corrupt("bond atom out of range");
+                }
+            }
+            cached.nbond = static_cast<int>(nbond);
+            cached.bonds = bonds;
+        }
+    } catch (const bip::interprocess_exception& e) {
+        LOG_WARNING("Can not map cache entry %s: %s", key.c_str(), e.what());
+        return false;
+    } catch (const fs::filesystem_error& e) {
+        LOG_WARNING("Can not read cache entry %s: %s", key.c_str(), e.what());
+        return false;
+    }
+    touch(entry);
+    return true;
+}
+
+bool StructureCache::store(const std::string& key, const Frame& frame, const SpeciesTable& species_table, const std::vector<Bond>& bonds) {
+    TRACE_SCOPE_CAT("StructureCache::store", "cache");
+    const fs::path entry = fs::path(m_cache_dir) / key;
+    // written next to the final place and renamed, so that readers
+    // never see a half written entry
+    const fs::path staging = fs::path(m_cache_dir) / (key + ".tmp");
+    boost::system::error_code ec;
+    fs::remove_all(staging, ec);
+    fs::create_directories(staging, ec);
+    if (ec) {
+        LOG_WARNING("Can not create cache entry %s: %s", key.c_str(), ec.message().c_str());
+        return false;
+    }
+
+    AtomsHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kAtomsMagic, 8);
+    header.version = kFormatVersion;
+    header.natom = frame.natom();
+    header.nspecies = species_table.size();
+    header.periodic = 3 == frame.cell.size() ? 1 : 0;
+    for (int i = 0; i < 3 && 1 == header.periodic; i++) {
+        for (int k = 0; k < 3; k++) {
+            header.cell[i][k] = frame.cell[i][k];
+        }
+    }
+
+    const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    std::ofstream atoms_out((staging / "atoms.bin").string(), std::ios::binary);
+    atoms_out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::size_t offset = sizeof(header);
+    for (const auto& name : species_table.names) {
+        atoms_out.write(name.c_str(), name.size() + 1);
+        offset += name.size() + 1;
+    }
+    atoms_out.write(padding, align8(offset) - offset);
+    offset = align8(offset);
+    std::vector<std::int32_t> species(frame.species.begin(), frame.species.end());
+    atoms_out.write(reinterpret_cast<const char*>(species.data()), sizeof(std::int32_t) * species.size());
+    offset += sizeof(std::int32_t) * species.size();
+    atoms_out.write(padding, align8(offset) - offset);
+    atoms_out.write(reinterpret_cast<const char*>(frame.positions.data()), sizeof(double) * frame.positions.size());
+    atoms_out.close();
+
+    std::vector<std::int32_t> pairs;
+    pairs.reserve(2 * bonds.size());
+    for (const auto& bond : bonds) {
+        pairs.push_back(bond.i);
+        pairs.push_back(bond.j);
+    }
+    std::ofstream bonds_out((staging / "bonds.bin").string(), std::ios::binary);
+    bonds_out.write(reinterpret_cast<const char*>(pairs.data()), sizeof(std::int32_t) * pairs.size());
+    bonds_out.close();
+
+    if (false == atoms_out.good() || false == bonds_out.good()) {
+        LOG_WARNING("Can not write cache entry %s", key.c_str());
+        fs::remove_all(staging, ec);
+        return false;
+    }
+    fs::remove_all(entry, ec);
+    fs::rename(staging, entry, ec);
+    if (ec) {
+        LOG_WARNING("Can not write cache entry %s: %s", key.c_str(), ec.message().c_str());
+        fs::remove_all(staging, ec);
+        return false;
+    }
+    this->evict();
+    return true;
+}
+
+void StructureCache::evict() {
+    struct Entry {
+        fs::path path;
+        std::time_t last_used;
+        std::uint64_t bytes;
+    };
+    std::vector<Entry> entries;
+    std::uint64_t total_bytes = 0;
+    boost::system::error_code ec;
+    for (const auto& dir : fs::directory_iterator(m_cache_dir, ec)) {
+        if (false == fs::is_directory(dir.path(), ec)) {
+            continue;
+        }
+        Entry entry{dir.path(), fs::last_write_time(dir.path(), ec), 0};
+        for (const auto& file : fs::directory_iterator(dir.path(), ec)) {
+            entry.bytes += fs::file_size(file.path(), ec);
+        }
+        total_bytes += entry.bytes;
+        entries.push_back(entry);
+    }
+    if (total_bytes <= m_max_bytes) {
+        return;
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) {
+        return lhs.last_used < rhs.last_used;
+    });
+    for (const auto& entry : entries) {
+        if (total_bytes <= m_max_bytes) {
+            break;
+        }
+        fs::remove_all(entry.path, ec);
+        total_bytes -= entry.bytes;
+    }
+}
@@ -0,0 +1,94 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Disk cache of parsed structures under the config dir.
+///
+/// Entries are keyed by the SHA-256 of the file content together with
+/// the cache format and parser version, so a changed file or a parser
+/// update never hits a stale entry. Every entry is a directory with
+///
+///     atoms.bin      header, cell, species names, species, positions
+///     bonds.bin      the detected bonds as int32 pairs
+///     thumbnail.png  the view after the first draw, previewed when opening
+///
+/// atoms.bin and bonds.bin are memory mapped and checked when loaded, an
+/// entry that does not fit its counts is a miss. The cache is bounded in size, the
+/// least recently used entries are evicted first.
+
+#ifndef CACHE_STRUCTURE_CACHE_H
+#define CACHE_STRUCTURE_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "analysis/bonds.h"
+#include "analysis/frame.h"
+
+/// A loaded entry, the arrays point into the mapped files.
+class CachedStructure {
+public:
+    int natom = 0;
+    int nbond = 0;
+    double cell[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+    bool periodic = false;
+    std::vector<std::string> species_names;
+    const std::int32_t* species = nullptr;
+    const double* positions = nullptr;
+    // pairs i0 j0 i1 j1 ...
+    const std::int32_t* bonds = nullptr;
+
+private:
+    friend class StructureCache;
+    boost::interprocess::file_mapping m_atoms_file;
+    boost::interprocess::mapped_region m_atoms_region;
+    boost::interprocess::file_mapping m_bonds_file;
+    boost::interprocess::mapped_region m_bonds_region;
+};
+
+class StructureCache {
+public:
+    StructureCache(const std::string& cache_dir, std::uint64_t max_bytes);
+
+    // hash of the file content and of the parser version
+    std::string key_of(const std::string& file_path) const;
+
+    bool load(const std::string& key, CachedStructure& cached);
+    // false when the entry could not be written, nothing is thrown
+    bool store(const std::string& key, const Frame& frame, const SpeciesTable& species_table, const std::vector<Bond>& bonds);
+
+    std::string thumbnail_path(const std::string& key) const;
+    bool contains(const std::string& key) const;
+
+    // remove least recently used entries until the cache fits max_bytes
+    void evict();
+
+    static const std::uint32_t kFormatVersion;
+
+private:
+    std::string m_cache_dir;
+    std::uint64_t m_max_bytes;
+};
+
+#endif // CACHE_STRUCTURE_CACHE_H
@@ -20,18 +20,53 @@
 
 #include "calccontrol.h"
 
-#include <iostream>
-#include <yaml-cpp/yaml.h>
+#include <fstream>
+
+#include <boost/filesystem.hpp>
 
 #include <QTabWidget>
 #include <QCheckBox>
+#include <QApplication>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QInputDialog>
+#include <QPointer>
 #include <QSplitter>
+#include <QtConcurrent/QtConcurrent>
 
+#include "batch/batch.h"
+#include "calc/input_generator.h"
 #include "calc/leftzone.h"
 #include "calc/rightzone.h"
-#include "atomsciflow/remote/ssh.h"
+#include "utils/logger.h"
+#include "utils/trace.h"
+
+namespace {
+
+bool ingest_into(const std::shared_ptr<ResultsStore>& results_store, const std::string& output_path, const std::string& job) {
+    if (nullptr == results_store) {
+        return false;
+    }
+    ResultRecord record;
+    if (false == read_result_record(output_path, record)) {
+        return false;
+    }
+    record.job = job;
+    // called from the completions of jobs and workflow steps, which have
+    // to go on when the store can not be written
+    try {
+        results_store->append({record});
+    } catch (const std::exception& e) {
+        LOG_WARNING("can not add %s to the results: %s", output_path.c_str(), e.what());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
 
 CalcControl::CalcControl(QWidget *parent) : QWidget{parent} {
+    TRACE_SCOPE_CAT("CalcControl::CalcControl", "calc");
 
     this->m_hlayout = new QHBoxLayout(this);
     this->setLayout(this->m_hlayout);
@@ -39,10 +74,10 @@ CalcControl::CalcControl(QWidget *parent) : QWidget{parent} {
     auto h_splitter = new QSplitter(this);
     this->m_hlayout->addWidget(h_splitter);
 
-    auto left_zone = new LeftZone(this);
-    auto right_zone = new RightZone(this);
-    h_splitter->addWidget(left_zone);
-    h_splitter->addWidget(right_zone);
+    this->m_left_zone = new LeftZone(this);
+    this->m_right_zone = new RightZone(this);
+    h_splitter->addWidget(this->m_left_zone);
+    h_splitter->addWidget(this->m_right_zone);
 
     h_splitter->setVisible(true);
     h_splitter->setHandleWidth(10);
@@ -50,11 +85,430 @@ CalcControl::CalcControl(QWidget *parent) : QWidget{parent} {
     h_splitter->setFrameShadow(QFrame::Plain);
     h_splitter->setStyleSheet("QSplitter::handle {background-color: gray}");
 
-    atomsciflow::Ssh ssh;
+    this->m_job_monitor = new JobMonitor(this);
+    this->m_workflow_pool = new QThreadPool(this);
+    this->m_remote_step_pool = new QThreadPool(this);
+    QObject::connect(this->m_job_monitor, &JobMonitor::jobs_changed, this->m_left_zone->m_job_table, &JobTable::update_jobs);
+    QObject::connect(this->m_job_monitor, &JobMonitor::jobs_changed, this, &CalcControl::on_jobs_changed);
+
+    QObject::connect(this->m_left_zone->m_run_workflow_button, &QPushButton::clicked, this, [this]() {
+        auto file_path = QFileDialog::getOpenFileName(this, tr("Run Workflow"), "", tr("Workflow (*.yaml *.yml)"));
+        if (false == file_path.isEmpty()) {
+            this->run_workflow(file_path.toStdString(), this->m_left_zone->m_workflow_remote_check_box->isChecked());
+        }
+    });
+    QObject::connect(this->m_left_zone->m_submit_job_button, &QPushButton::clicked, this, [this]() {
+        bool ok = false;
+        auto remote_dir = QInputDialog::getText(this, tr("Submit Job"), tr("Remote directory:"), QLineEdit::Normal, "", &ok);
+        if (false == ok || true == remote_dir.isEmpty()) {
+            return;
+        }
+        auto script = QInputDialog::getText(this, tr("Submit Job"), tr("Job script:"), QLineEdit::Normal, "job.sh", &ok);
+        if (false == ok || true == script.isEmpty()) {
+            return;
+        }
+        this->submit_job(remote_dir.toStdString(), script.toStdString());
+    });
+    for (const bool upload : {true, false}) {
+        auto button = true == upload ? this->m_left_zone->m_stage_in_button : this->m_left_zone->m_stage_out_button;
+        QObject::connect(button, &QPushButton::clicked, this, [this, upload]() {
+            auto local_dir = QFileDialog::getExistingDirectory(this, tr("Local Directory"));
+            if (true == local_dir.isEmpty()) {
+                return;
+            }
+            bool ok = false;
+            auto remote_dir = QInputDialog::getText(this, tr("Remote Directory"), tr("Remote directory:"), QLineEdit::Normal, "", &ok);
+            if (false == ok || true == remote_dir.isEmpty()) {
+                return;
+            }
+            this->stage_async(local_dir.toStdString(), remote_dir.toStdString(), upload);
+        });
+    }
+    QObject::connect(this->m_left_zone->m_watch_output_button, &QPushButton::clicked, this, [this]() {
+        bool ok = false;
+        auto remote_path = QInputDialog::getText(this, tr("Watch Output"), tr("Remote file:"), QLineEdit::Normal, "", &ok);
+        if (true == ok && false == remote_path.isEmpty()) {
+            this->watch_output(remote_path.toStdString());
+        }
+    });
+    QObject::connect(this->m_left_zone->m_fetch_output_button, &QPushButton::clicked, this, [this]() {
+        bool ok = false;
+        auto remote_path = QInputDialog::getText(this, tr("Fetch Output"), tr("Remote file:"), QLineEdit::Normal, "", &ok);
+        if (false == ok || true == remote_path.isEmpty()) {
+            return;
+        }
+        auto local_path = QFileDialog::getSaveFileName(this, tr("Save Output As"), QFileInfo(remote_path).fileName());
+        if (true == local_path.isEmpty()) {
+            return;
+        }
+        this->fetch_output(remote_path.toStdString(), local_path.toStdString());
+    });
+    QObject::connect(this->m_left_zone->m_generate_inputs_button, &QPushButton::clicked, this, [this]() {
+        auto structure_dir = QFileDialog::getExistingDirectory(this, tr("Structure Library"));
+        if (true == structure_dir.isEmpty()) {
+            return;
+        }
+        auto template_dir = QFileDialog::getExistingDirectory(this, tr("Input Template"));
+        if (true == template_dir.isEmpty()) {
+            return;
+        }
+        auto output_dir = QFileDialog::getExistingDirectory(this, tr("Output Directory"));
+        if (true == output_dir.isEmpty()) {
+            return;
+        }
+        this->generate_inputs(structure_dir.toStdString(), template_dir.toStdString(), output_dir.toStdString());
+    });
+}
+
+SshExecResult CalcControl::run_remote(const std::string& command) {
+    TRACE_SCOPE_CAT("CalcControl::run_remote", "calc");
+    return SshSessionPool::instance().exec(this->m_endpoint, command);
+}
+
+void CalcControl::track_job(const std::string& job_id) {
+    this->m_job_monitor->track(this->m_endpoint, this->m_scheduler, job_id);
+    this->m_job_monitor->start();
+}
+
+void CalcControl::wait_for_job(const SshEndpoint& endpoint, Scheduler scheduler, const std::string& job_id, const std::function<void()>& on_finished) {
+    this->m_job_waiters[endpoint.host + "/" + job_id] = on_finished;
+    this->m_job_monitor->track(endpoint, scheduler, job_id);
+    this->m_job_monitor->start();
+}
+
+void CalcControl::on_jobs_changed(const std::vector<JobStatus>& changed) {
+    for (const auto& status : changed) {
+        if (false == is_finished(status.state)) {
+            continue;
+        }
+        auto found = this->m_job_waiters.find(status.host + "/" + status.id);
+        if (this->m_job_waiters.end() == found) {
+            continue;
+        }
+        const auto on_finished = found->second;
+        this->m_job_waiters.erase(found);
+        on_finished();
+    }
+}
+
+void CalcControl::submit_job(const std::string& remote_dir, const std::string& script) {
+    TRACE_SCOPE_CAT("CalcControl::submit_job", "calc");
+    const auto endpoint = this->m_endpoint;
+    const auto scheduler = this->m_scheduler;
+    QPointer<CalcControl> control(this);
+    QtConcurrent::run([control, endpoint, scheduler, remote_dir, script]() {
+        // a failure after the submission started is not retried, the job
+        // may be queued already
+        SshExecResult result;
+        try {
+            result = SshSessionPool::instance().exec(endpoint, "cd " + shell_quote(remote_dir) + " && " + job_submit_command(scheduler, script));
+        } catch (const SshError& e) {
+            LOG_ERROR("can not submit %s: %s", script.c_str(), e.what());
+            return;
+        }
+        const auto job_id = parse_submitted_job_id(scheduler, result.out);
+        if (0 != result.exit_status || job_id.empty()) {
+            LOG_ERROR("can not submit %s: %s%s", script.c_str(), result.out.c_str(), result.err.c_str());
+            return;
+        }
+        LOG_INFO("submitted %s in %s as job %s", script.c_str(), remote_dir.c_str(), job_id.c_str());
+        QMetaObject::invokeMethod(qApp, [control, job_id]() {
+            if (nullptr != control) {
+                control->track_job(job_id);
+            }
+        });
+    });
+}
+
+void CalcControl::set_manifest_dir(const std::string& manifest_dir) {
+    this->m_delta_sync = std::make_shared<DeltaSync>(manifest_dir);
+}
 
-    YAML::Node yaml_node = YAML::Load("[1, 2, 3, 4, 5]");
-    for (int i = 0; i < yaml_node.size(); i++) {
-        std::cout << yaml_node[i].as<int>() << std::endl;
+void CalcControl::stage_async(const std::string& local_dir, const std::string& remote_dir, bool upload) {
+    if (nullptr == this->m_delta_sync) {
+        LOG_ERROR("no manifest directory for the transfers");
+        return;
     }
+    const auto endpoint = this->m_endpoint;
+    const auto delta_sync = this->m_delta_sync;
+    QtConcurrent::run([endpoint, delta_sync, local_dir, remote_dir, upload]() {
+        TRACE_SCOPE_CAT("CalcControl::stage_async", "calc");
+        try {
+            auto lease = SshSessionPool::instance().acquire(endpoint);
+            const auto stats = true == upload
+                ? delta_sync->upload_dir(*lease, local_dir, remote_dir)
+                : delta_sync->download_dir(*lease, remote_dir, local_dir);
+            LOG_INFO("%s %s: %.1f MB of files, %.1f MB sent", true == upload ? "uploaded" : "downloaded",
+                local_dir.c_str(), stats.file_bytes / 1.0e6, stats.wire_bytes / 1.0e6);
+        } catch (const std::exception& e) {
+            LOG_ERROR("can not transfer %s: %s", local_dir.c_str(), e.what());
+        }
+    });
+}
+
+void CalcControl::fetch_output(const std::string& remote_path, const std::string& local_path) {
+    const auto endpoint = this->m_endpoint;
+    const auto download_streams = this->m_download_streams;
+    const auto results_store = this->m_results_store;
+    // the widgets may be gone when the download finishes
+    QPointer<QPushButton> button(this->m_left_zone->m_fetch_output_button);
+    QPointer<QProgressBar> progress_bar(this->m_left_zone->m_fetch_progress_bar);
+    button->setEnabled(false);
+    progress_bar->setValue(0);
+    QtConcurrent::run([endpoint, download_streams, results_store, remote_path, local_path, button, progress_bar]() {
+        TRACE_SCOPE_CAT("CalcControl::fetch_output", "calc");
+        SftpDownloader downloader(endpoint);
+        downloader.set_max_streams(download_streams);
+        downloader.set_progress_callback([remote_path, progress_bar](const DownloadProgress& progress) {
+            LOG_DEBUG("%s: %.1f of %.1f MB, %.1f MB/s", remote_path.c_str(),
+                progress.bytes_done / 1.0e6, progress.bytes_total / 1.0e6, progress.bytes_per_second / 1.0e6);
+            const int percent = progress.bytes_total > 0 ? static_cast<int>(100 * progress.bytes_done / progress.bytes_total) : 0;
+            QMetaObject::invokeMethod(qApp, [progress_bar, percent]() {
+                if (nullptr != progress_bar) {
+                    progress_bar->setValue(percent);
+                }
+            });
+        });
+        try {
+            downloader.download(remote_path, local_path);
+            ingest_into(results_store, local_path, remote_path);
+        } catch (const std::exception& e) {
+            // the partial file stays, the next fetch resumes it
+            LOG_ERROR("can not fetch %s: %s", remote_path.c_str(), e.what());
+        }
+        QMetaObject::invokeMethod(qApp, [button, progress_bar]() {
+            if (nullptr != button) {
+                button->setEnabled(true);
+            }
+            if (nullptr != progress_bar) {
+                progress_bar->setValue(100);
+            }
+        });
+    });
+}
+
+bool CalcControl::ingest_result(const std::string& output_path, const std::string& job) {
+    TRACE_SCOPE_CAT("CalcControl::ingest_result", "calc");
+    return ingest_into(this->m_results_store, output_path, job);
+}
+
+void CalcControl::watch_output(const std::string& remote_path) {
+    if (nullptr != this->m_output_watcher) {
+        this->m_output_watcher->deleteLater();
+    }
+    this->m_output_watcher = new OutputWatcher(this->m_endpoint, remote_path, this);
+    QObject::connect(this->m_output_watcher, &OutputWatcher::text_appended, this->m_right_zone, &RightZone::append_output);
+    QObject::connect(this->m_output_watcher, &OutputWatcher::data_changed, this->m_right_zone->m_convergence_plot, &ConvergencePlot::set_data);
+}
+
+void CalcControl::set_local_cores(int max_cores) {
+    this->m_local_executor = std::make_unique<LocalExecutor>(max_cores);
+    auto job_table = this->m_left_zone->m_job_table;
+    this->m_local_executor->set_state_callback([job_table](int job_id, LocalJobState state, int exit_code) {
+        JobStatus status;
+        status.host = "localhost";
+        status.id = std::to_string(job_id);
+        status.state = local_job_state_name(state);
+        if (LocalJobState::Failed == state) {
+            status.state += " (" + std::to_string(exit_code) + ")";
+        }
+        // the callback runs on a worker thread
+        QMetaObject::invokeMethod(job_table, [job_table, status]() {
+            job_table->update_jobs({status});
+        });
+    });
+}
+
+int CalcControl::run_local(const LocalJob& job) {
+    if (nullptr == this->m_local_executor) {
+        this->set_local_cores(0);
+    }
+    auto results_job = job;
+    const auto results_store = this->m_results_store;
+    results_job.on_finished = [job, results_store](int exit_code) {
+        if (0 == exit_code) {
+            ingest_into(results_store, (boost::filesystem::path(job.working_dir) / job.output_file).string(), job.working_dir);
+        }
+        if (job.on_finished) {
+            job.on_finished(exit_code);
+        }
+    };
+    return this->m_local_executor->submit(results_job);
+}
+
+void CalcControl::cancel_local(int job_id) {
+    if (nullptr != this->m_local_executor) {
+        this->m_local_executor->cancel(job_id);
+    }
+}
+
+void CalcControl::run_workflow(const std::string& path, bool remote) {
+    TRACE_SCOPE_CAT("CalcControl::run_workflow", "calc");
+    Workflow workflow;
+    try {
+        workflow = load_workflow(path);
+    } catch (const std::exception& e) {
+        LOG_ERROR("%s", e.what());
+        return;
+    }
+    if (nullptr == this->m_local_executor) {
+        this->set_local_cores(0);
+    }
+
+    WorkflowScheduler::Launcher launcher;
+    if (false == remote) {
+        auto executor = this->m_local_executor.get();
+        launcher = [executor](const WorkflowStep& step, std::function<void(int)> done) {
+            LocalJob job;
+            job.command = step.command;
+            job.working_dir = step.workdir;
+            job.cores = step.cores;
+            job.output_file = "workflow.log";
+            job.on_finished = done;
+            executor->submit(job);
+        };
+    } else {
+        // the working directories are mirrored below the remote root,
+        // relative to the directory of the workflow file
+        const auto endpoint = this->m_endpoint;
+        const auto local_root = boost::filesystem::absolute(path).parent_path();
+        const auto remote_root = this->m_remote_workflow_root + "/" + workflow.name;
+        const auto delta_sync = this->m_delta_sync;
+        if (nullptr == delta_sync) {
+            LOG_ERROR("no manifest directory for the transfers");
+            return;
+        }
+        auto step_pool = this->m_remote_step_pool;
+        const auto scheduler = this->m_scheduler;
+        QPointer<CalcControl> control(this);
+        launcher = [endpoint, local_root, remote_root, delta_sync, step_pool, scheduler, control](const WorkflowStep& step, std::function<void(int)> done) {
+            // the step runs as a batch job, a session is only held to
+            // upload and submit it and, once the job monitor sees it
+            // finished, to fetch the outputs; done is called exactly once,
+            // whatever fails
+            QtConcurrent::run(step_pool, [=]() {
+                const auto relative = boost::filesystem::path(step.workdir).lexically_relative(local_root);
+                const auto remote_dir = remote_root + "/" + relative.generic_string();
+                const auto script = step.name + ".job.sh";
+                // the scheduler does not keep the exit code of the command
+                const auto exit_file = step.name + ".exit";
+                std::string job_id;
+                try {
+                    boost::system::error_code ec;
+                    boost::filesystem::remove(boost::filesystem::path(step.workdir) / exit_file, ec);
+                    auto lease = SshSessionPool::instance().acquire(endpoint);
+                    delta_sync->upload_dir(*lease, step.workdir, remote_dir);
+                    const auto text = job_script(scheduler, step.name, step.cores, step.command) + "echo $? > " + shell_quote(exit_file) + "\n";
+                    const auto result = lease->exec("cd " + shell_quote(remote_dir) + " && rm -f " + shell_quote(exit_file)
+                        + " && printf '%s' " + shell_quote(text) + " > " + shell_quote(script) + " && " + job_submit_command(scheduler, script));
+                    job_id = parse_submitted_job_id(scheduler, result.out);
+                    if (0 != result.exit_status || job_id.empty()) {
+                        LOG_ERROR("can not submit %s: %s%s", step.name.c_str(), result.out.c_str(), result.err.c_str());
+                        job_id.clear();
+                    }
+                } catch (const std::exception& e) {
+                    LOG_ERROR("%s: %s", step.name.c_str(), e.what());
+                    job_id.clear();
+                }
+                if (true == job_id.empty()) {
+                    done(-1);
+                    return;
+                }
+                LOG_INFO("workflow step %s submitted as job %s", step.name.c_str(), job_id.c_str());
+                auto fetch = [=]() {
+                    QtConcurrent::run(step_pool, [=]() {
+                        int exit_status = -1;
+                        try {
+                            auto lease = SshSessionPool::instance().acquire(endpoint);
+                            delta_sync->download_dir(*lease, remote_dir, step.workdir);
+                            int code = 0;
+                            std::ifstream in((boost::filesystem::path(step.workdir) / exit_file).string());
+                            if (in >> code) {
+                                exit_status = code;
+                            } else {
+                                LOG_ERROR("%s: job %s left no exit code", step.name.c_str(), job_id.c_str());
+                            }
+                        } catch (const std::exception& e) {
+                            LOG_ERROR("%s: %s", step.name.c_str(), e.what());
+                        }
+                        done(exit_status);
+                    });
+                };
+                QMetaObject::invokeMethod(qApp, [control, endpoint, scheduler, job_id, fetch, done]() {
+                    if (nullptr == control) {
+                        done(-1);
+                        return;
+                    }
+                    control->wait_for_job(endpoint, scheduler, job_id, fetch);
+                });
+            });
+        };
+    }
+
+    auto job_table = this->m_left_zone->m_job_table;
+    const auto memo_dir = this->m_workflow_memo_dir;
+    const auto results_store = this->m_results_store;
+    QtConcurrent::run(this->m_workflow_pool, [workflow, memo_dir, launcher, job_table, results_store]() {
+        // the memo directory is created here
+        std::unique_ptr<WorkflowScheduler> scheduler;
+        try {
+            scheduler = std::make_unique<WorkflowScheduler>(memo_dir, launcher);
+        } catch (const std::exception& e) {
+            LOG_ERROR("workflow %s: %s", workflow.name.c_str(), e.what());
+            return;
+        }
+        scheduler->set_state_callback([job_table, results_store, &workflow](const WorkflowStep& step, StepState state) {
+            // restored steps were ingested when they ran
+            if (StepState::Done == state) {
+                for (const auto& output : step.outputs) {
+                    ingest_into(results_store, (boost::filesystem::path(step.workdir) / output).string(), workflow.name + "/" + step.name);
+                }
+            }
+            // step names repeat across workflows
+            JobStatus status;
+            status.host = "workflow";
+            status.id = workflow.name + "/" + step.name;
+            status.name = workflow.name;
+            status.state = step_state_name(state);
+            QMetaObject::invokeMethod(job_table, [job_table, status]() {
+                job_table->update_jobs({status});
+            });
+        });
+        if (false == scheduler->run(workflow)) {
+            LOG_ERROR("workflow %s failed", workflow.name.c_str());
+        }
+    });
+}
 
+void CalcControl::generate_inputs(const std::string& structure_dir, const std::string& template_dir, const std::string& output_dir) {
+    TRACE_SCOPE_CAT("CalcControl::generate_inputs", "calc");
+    QPointer<QPushButton> button(this->m_left_zone->m_generate_inputs_button);
+    QPointer<QProgressBar> progress_bar(this->m_left_zone->m_inputs_progress_bar);
+    button->setEnabled(false);
+    progress_bar->setValue(0);
+    QtConcurrent::run([structure_dir, template_dir, output_dir, button, progress_bar]() {
+        try {
+            const InputTemplate input_template(template_dir);
+            const auto files = collect_structure_files({structure_dir});
+            const auto result = ::generate_inputs(input_template, files, output_dir, 0, [progress_bar](std::size_t done, std::size_t total) {
+                const int percent = static_cast<int>(100 * done / total);
+                QMetaObject::invokeMethod(qApp, [progress_bar, percent]() {
+                    if (nullptr != progress_bar) {
+                        progress_bar->setValue(percent);
+                    }
+                });
+            });
+            for (const auto& error : result.errors) {
+                LOG_ERROR("%s: %s", error.first.c_str(), error.second.c_str());
+            }
+            LOG_INFO("%zu of %zu inputs written to %s in %.2f s", result.ngenerated, files.size(), output_dir.c_str(), result.seconds);
+        } catch (const std::exception& e) {
+            LOG_ERROR("%s", e.what());
+        }
+        QMetaObject::invokeMethod(qApp, [button]() {
+            if (nullptr != button) {
+                button->setEnabled(true);
+            }
+        });
+    });
 }
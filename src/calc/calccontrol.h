@@ -21,17 +21,132 @@
 #ifndef CALCCONTROL_H
 #define CALCCONTROL_H
 
+#include <QThreadPool>
 #include <QWidget>
 #include <QtWidgets/QHBoxLayout>
 
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "calc/job_monitor.h"
+#include "calc/leftzone.h"
+#include "calc/local_executor.h"
+#include "calc/output_watcher.h"
+#include "calc/workflow.h"
+#include "calc/rightzone.h"
+#include "remote/delta_sync.h"
+#include "remote/sftp_download.h"
+#include "remote/ssh_pool.h"
+#include "results/results_store.h"
+
 class CalcControl : public QWidget {
     Q_OBJECT
 public:
     explicit CalcControl(QWidget *parent = nullptr);
 
+    void set_endpoint(const SshEndpoint& endpoint) {
+        m_endpoint = endpoint;
+    }
+    const SshEndpoint& get_endpoint() const {
+        return m_endpoint;
+    }
+    void set_scheduler(Scheduler scheduler) {
+        m_scheduler = scheduler;
+    }
+
+    // manifests of the remote file signatures for the delta transfers
+    void set_manifest_dir(const std::string& manifest_dir);
+
+    // copies the files below the local directory to the remote one or
+    // back in the background, only their changed blocks are sent; the
+    // result is reported in the log
+    void stage_async(const std::string& local_dir, const std::string& remote_dir, bool upload);
+
+    // large outputs in the background, split over several sessions and
+    // resumable, with progress in the Remote tab; the output is added to
+    // the results store
+    void fetch_output(const std::string& remote_path, const std::string& local_path);
+    void set_download_streams(int download_streams) {
+        m_download_streams = download_streams;
+    }
+
+    // follows the output file on the current endpoint in the output view
+    // and the convergence plot
+    void watch_output(const std::string& remote_path);
+
+    // runs on this machine, listed in the job table as localhost
+    int run_local(const LocalJob& job);
+    void cancel_local(int job_id);
+    void set_local_cores(int max_cores);
+
+    // runs the steps of a YAML workflow in the background, locally or as
+    // batch jobs on the current endpoint below the remote workflow root,
+    // step states are listed in the job table
+    void run_workflow(const std::string& path, bool remote);
+    void set_workflow_memo_dir(const std::string& memo_dir) {
+        m_workflow_memo_dir = memo_dir;
+    }
+    void set_remote_workflow_root(const std::string& remote_root) {
+        m_remote_workflow_root = remote_root;
+    }
+
+    // writes inputs from the template directory for every structure below
+    // the structure directory in the background, with progress in the
+    // Inputs tab
+    void generate_inputs(const std::string& structure_dir, const std::string& template_dir, const std::string& output_dir);
+
+    // finished local jobs, workflow steps and fetched outputs are added
+    // to the results store
+    void set_results_store(const std::shared_ptr<ResultsStore>& results_store) {
+        m_results_store = results_store;
+    }
+    // thread safe, false when the file is no recognized output
+    bool ingest_result(const std::string& output_path, const std::string& job);
+
+    // the job on the current endpoint shows up in the job table
+    void track_job(const std::string& job_id);
+    // submits the job script of the remote directory in the background
+    // with the scheduler of the endpoint and tracks the job
+    void submit_job(const std::string& remote_dir, const std::string& script);
+    // tracks the job and calls on_finished on the GUI thread once the
+    // monitor sees it leave the queue
+    void wait_for_job(const SshEndpoint& endpoint, Scheduler scheduler, const std::string& job_id, const std::function<void()>& on_finished);
+
+    JobMonitor* get_job_monitor() {
+        return m_job_monitor;
+    }
+
+    // runs on a pooled session to the current endpoint
+    SshExecResult run_remote(const std::string& command);
+
     QHBoxLayout* m_hlayout;
 signals:
 
+private:
+    void on_jobs_changed(const std::vector<JobStatus>& changed);
+
+    SshEndpoint m_endpoint;
+    Scheduler m_scheduler = Scheduler::Slurm;
+    JobMonitor* m_job_monitor;
+    OutputWatcher* m_output_watcher = nullptr;
+    RightZone* m_right_zone;
+    LeftZone* m_left_zone;
+    std::unique_ptr<LocalExecutor> m_local_executor;
+    std::shared_ptr<DeltaSync> m_delta_sync;
+    int m_download_streams = 4;
+    std::shared_ptr<ResultsStore> m_results_store;
+    std::string m_workflow_memo_dir;
+    std::string m_remote_workflow_root = "workflows";
+    // host/job id -> called when the job finished
+    std::map<std::string, std::function<void()>> m_job_waiters;
+    // the schedulers block until their workflows are done and the remote
+    // steps while they transfer and submit, kept apart from each other and
+    // from the global pool so that neither can starve the other
+    QThreadPool* m_workflow_pool;
+    QThreadPool* m_remote_step_pool;
 };
 
 #endif // CALCCONTROL_H
@@ -0,0 +1,91 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "calc/convergence_plot.h"
+
+#include <QPainter>
+#include <QPainterPath>
+
+#include <algorithm>
+#include <cmath>
+
+ConvergencePlot::ConvergencePlot(QWidget* parent) : QWidget{parent} {
+    this->setMinimumSize(400, 300);
+    this->setAutoFillBackground(true);
+    this->setBackgroundRole(QPalette::Base);
+    this->m_upper_title = tr("SCF change (log10)");
+    this->m_lower_title = tr("Ionic step energy");
+}
+
+void ConvergencePlot::set_titles(const QString& upper_title, const QString& lower_title) {
+    this->m_upper_title = upper_title;
+    this->m_lower_title = lower_title;
+    this->update();
+}
+
+void ConvergencePlot::set_data(const ConvergenceData& data) {
+    this->m_data = data;
+    this->update();
+}
+
+void ConvergencePlot::paintEvent(QPaintEvent* event) {
+    Q_UNUSED(event);
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+    const QRectF area = QRectF(this->rect()).adjusted(60, 10, -10, -10);
+    const double half = area.height() / 2;
+    this->draw_series(painter, QRectF(area.left(), area.top(), area.width(), half - 20), m_data.scf_change, true, this->m_upper_title);
+    this->draw_series(painter, QRectF(area.left(), area.top() + half + 10, area.width(), half - 20), m_data.ionic_energy, false, this->m_lower_title);
+}
+
+void ConvergencePlot::draw_series(QPainter& painter, const QRectF& rect, const std::vector<double>& values, bool log_scale, const QString& title) {
+    painter.setPen(this->palette().color(QPalette::Text));
+    painter.drawRect(rect);
+    painter.drawText(rect.adjusted(4, 2, 0, 0), Qt::AlignLeft | Qt::AlignTop, title);
+    if (values.empty()) {
+        return;
+    }
+    std::vector<double> y(values.size());
+    std::transform(values.begin(), values.end(), y.begin(), [log_scale](double value) {
+        return true == log_scale ? std::log10(std::max(std::fabs(value), 1.0e-16)) : value;
+    });
+    const auto range = std::minmax_element(y.begin(), y.end());
+    double y_min = *range.first;
+    double y_max = *range.second;
+    if (y_max - y_min < 1.0e-12) {
+        y_min -= 0.5;
+        y_max += 0.5;
+    }
+    painter.drawText(QRectF(rect.left() - 58, rect.top(), 54, 16), Qt::AlignRight, QString::number(y_max, 'g', 6));
+    painter.drawText(QRectF(rect.left() - 58, rect.bottom() - 16, 54, 16), Qt::AlignRight, QString::number(y_min, 'g', 6));
+
+    const double dx = y.size() > 1 ? rect.width() / (y.size() - 1) : 0;
+    QPainterPath path;
+    for (std::size_t i = 0; i < y.size(); i++) {
+        const QPointF point(rect.left() + i * dx, rect.bottom() - (y[i] - y_min) / (y_max - y_min) * rect.height());
+        if (0 == i) {
+            path.moveTo(point);
+        } else {
+            path.lineTo(point);
+        }
+    }
+    painter.setPen(QPen(this->palette().color(QPalette::Highlight), 1.5));
+    painter.drawPath(path);
+}
@@ -0,0 +1,51 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef CALC_CONVERGENCE_PLOT_H
+#define CALC_CONVERGENCE_PLOT_H
+
+#include <QWidget>
+
+#include "calc/output_parsers.h"
+
+/// The SCF change on a log scale above the energy of the ionic steps.
+class ConvergencePlot : public QWidget {
+    Q_OBJECT
+public:
+    explicit ConvergencePlot(QWidget* parent = nullptr);
+
+    // the upper series is drawn on a log scale
+    void set_titles(const QString& upper_title, const QString& lower_title);
+
+public slots:
+    void set_data(const ConvergenceData& data);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    void draw_series(QPainter& painter, const QRectF& rect, const std::vector<double>& values, bool log_scale, const QString& title);
+
+    ConvergenceData m_data;
+    QString m_upper_title;
+    QString m_lower_title;
+};
+
+#endif // CALC_CONVERGENCE_PLOT_H
@@ -0,0 +1,301 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "calc/input_generator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "batch/batch.h"
+#include "utils/trace.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+const std::map<std::string, int> field_of{
+    {"name", 0},
+    {"index", 1},
+    {"natom", 2},
+    {"ntyp", 3},
+    {"species", 4},
+    {"species_counts", 5},
+    {"cell", 6},
+    {"positions", 7},
+    {"coordinates", 8},
+};
+
+void append_xyz(std::string& out, double x, double y, double z) {
+    char buffer[64];
+    const int length = std::snprintf(buffer, sizeof(buffer), " %15.10f %15.10f %15.10f", x, y, z);
+    out.append(buffer, length);
+}
+
+void write_file(const fs::path& path, const std::string& content) {
+    std::FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (nullptr == file) {
+        throw std::runtime_error("can not write " + path.string());
+    }
+    const auto nwritten = std::fwrite(content.data(), 1, content.size(), file);
+    if (0 != std::fclose(file) || nwritten != content.size()) {
+        throw std::runtime_error("can not write " + path.string());
+    }
+}
+
+} // namespace
+
+InputTemplate::InputTemplate(const std::string& template_dir, const std::map<std::string, std::string>& parameters) {
+    TRACE_SCOPE_CAT("InputTemplate::InputTemplate", "calc");
+    if (false == fs::is_directory(template_dir)) {
+        throw std::runtime_error("no template directory: " + template_dir);
+    }
+    std::vector<fs::path> paths;
+    for (const auto& entry : fs::recursive_directory_iterator(template_dir)) {
+        if (true == fs::is_regular_file(entry.path())) {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    if (true == paths.empty()) {
+        throw std::runtime_error("empty template directory: " + template_dir);
+    }
+    for (const auto& path : paths) {
+        std::ifstream in(path.string(), std::ios::binary);
+        const std::string content{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        m_files.push_back(this->parse(path.lexically_relative(template_dir).generic_string(), content, parameters));
+    }
+}
+
+InputTemplate::File InputTemplate::parse(const std::string& relative_path, const std::string& content, const std::map<std::string, std::string>& parameters) {
+    File file;
+    file.relative_path = relative_path;
+    std::string literal;
+    std::size_t pos = 0;
+    while (pos < content.size()) {
+        const auto open = content.find("{{", pos);
+        if (std::string::npos == open) {
+            literal.append(content, pos, std::string::npos);
+            break;
+        }
+        literal.append(content, pos, open - pos);
+        const auto close = content.find("}}", open + 2);
+        if (std::string::npos == close) {
+            throw std::runtime_error(relative_path + ": unterminated placeholder");
+        }
+        auto key = content.substr(open + 2, close - open - 2);
+        key.erase(0, key.find_first_not_of(" \t"));
+        key.erase(key.find_last_not_of(" \t") + 1);
+        pos = close + 2;
+
+        // parameters are constant, they become part of the literal text
+        const auto parameter = parameters.find(key);
+        if (parameters.end() != parameter) {
+            literal += parameter->second;
+            continue;
+        }
+        const auto field = field_of.find(key);
+        if (field_of.end() == field) {
+            throw std::runtime_error(relative_path + ": no value for {{" + key + "}}");
+        }
+        if (false == literal.empty()) {
+            file.literal_size += literal.size();
+            file.segments.push_back({Literal, std::move(literal)});
+            literal.clear();
+        }
+        file.segments.push_back({static_cast<Field>(field->second), ""});
+        m_used[field->second] = true;
+    }
+    if (false == literal.empty()) {
+        file.literal_size += literal.size();
+        file.segments.push_back({Literal, std::move(literal)});
+    }
+    return file;
+}
+
+void InputTemplate::fill_fields(const atomsciflow::Crystal& crystal, const std::string& name, std::size_t index, Fields& fields) const {
+    for (auto& field : fields) {
+        field.clear();
+    }
+    fields[Name] = name;
+    fields[Index] = std::to_string(index);
+    fields[Natom] = std::to_string(crystal.atoms.size());
+
+    // species in order of appearance, atoms grouped by species as VASP
+    // expects them
+    std::vector<std::string> species;
+    std::vector<int> species_of(crystal.atoms.size());
+    for (std::size_t i = 0; i < crystal.atoms.size(); i++) {
+        const auto& atom_name = crystal.atoms[i].name;
+        std::size_t s = 0;
+        while (s < species.size() && species[s] != atom_name) {
+            s++;
+        }
+        if (species.size() == s) {
+            species.push_back(atom_name);
+        }
+        species_of[i] = s;
+    }
+    std::vector<int> counts(species.size(), 0);
+    for (const int s : species_of) {
+        counts[s]++;
+    }
+    fields[Ntyp] = std::to_string(species.size());
+    for (std::size_t s = 0; s < species.size(); s++) {
+        fields[Species] += (0 == s ? "" : " ") + species[s];
+        fields[SpeciesCounts] += (0 == s ? "" : " ") + std::to_string(counts[s]);
+    }
+
+    if (true == m_used[Cell]) {
+        for (const auto& vector : crystal.cell) {
+            if (3 == vector.size()) {
+                append_xyz(fields[Cell], vector[0], vector[1], vector[2]);
+                fields[Cell] += '\n';
+            }
+        }
+    }
+    if (true == m_used[Positions] || true == m_used[Coordinates]) {
+        fields[Positions].reserve(crystal.atoms.size() * 56);
+        fields[Coordinates].reserve(crystal.atoms.size() * 52);
+        for (std::size_t s = 0; s < species.size(); s++) {
+            for (std::size_t i = 0; i < crystal.atoms.size(); i++) {
+                if (static_cast<int>(s) != species_of[i]) {
+                    continue;
+                }
+                const auto& atom = crystal.atoms[i];
+                if (true == m_used[Positions]) {
+                    fields[Positions] += atom.name;
+                    append_xyz(fields[Positions], atom.x, atom.y, atom.z);
+                    fields[Positions] += '\n';
+                }
+                if (true == m_used[Coordinates]) {
+                    append_xyz(fields[Coordinates], atom.x, atom.y, atom.z);
+                    fields[Coordinates] += '\n';
+                }
+            }
+        }
+    }
+}
+
+void InputTemplate::render(std::size_t file, const Fields& fields, std::string& out) const {
+    const auto& template_file = m_files[file];
+    std::size_t size = out.size() + template_file.literal_size;
+    for (const auto& segment : template_file.segments) {
+        if (Literal != segment.field) {
+            size += fields[segment.field].size();
+        }
+    }
+    out.reserve(size);
+    for (const auto& segment : template_file.segments) {
+        out += Literal == segment.field ? segment.text : fields[segment.field];
+    }
+}
+
+InputGenerationResult generate_inputs(
+    const InputTemplate& input_template,
+    const std::vector<std::string>& structure_files,
+    const std::string& output_dir,
+    int jobs,
+    const std::function<void(std::size_t done, std::size_t total)>& progress
+) {
+    TRACE_SCOPE_CAT("generate_inputs", "calc");
+    const auto start = std::chrono::steady_clock::now();
+    InputGenerationResult result;
+
+    // names are decided up front, the same as for the batch outputs
+    const auto names = unique_output_names(structure_files);
+
+    // the directories of the template below each output directory
+    std::set<std::string> subdirs;
+    for (std::size_t file = 0; file < input_template.get_nfiles(); file++) {
+        const auto parent = fs::path(input_template.get_relative_path(file)).parent_path();
+        if (false == parent.empty()) {
+            subdirs.insert(parent.string());
+        }
+    }
+
+#ifdef _OPENMP
+    if (jobs <= 0) {
+        jobs = omp_get_max_threads();
+    }
+#else
+    jobs = 1;
+#endif
+    std::vector<std::string> errors(structure_files.size());
+    std::atomic<std::size_t> ndone{0};
+    const fs::path root = output_dir;
+
+#pragma omp parallel num_threads(jobs)
+    {
+        // buffers are reused, their capacity stays with the thread
+        atomsciflow::Crystal crystal;
+        InputTemplate::Fields fields;
+        std::string buffer;
+
+#pragma omp for schedule(dynamic, 16)
+        for (long i = 0; i < static_cast<long>(structure_files.size()); i++) {
+            try {
+                crystal.atoms.clear();
+                crystal.cell.clear();
+                read_structure_file(crystal, structure_files[i]);
+                input_template.fill_fields(crystal, names[i], i, fields);
+
+                const auto dir = root / names[i];
+                fs::create_directories(dir);
+                for (const auto& subdir : subdirs) {
+                    fs::create_directories(dir / subdir);
+                }
+                for (std::size_t file = 0; file < input_template.get_nfiles(); file++) {
+                    buffer.clear();
+                    input_template.render(file, fields, buffer);
+                    write_file(dir / input_template.get_relative_path(file), buffer);
+                }
+            } catch (const std::exception& e) {
+                errors[i] = e.what();
+            }
+            const auto done = ++ndone;
+            if (nullptr != progress && (0 == done % 256 || structure_files.size() == done)) {
+                progress(done, structure_files.size());
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < structure_files.size(); i++) {
+        if (true == errors[i].empty()) {
+            result.ngenerated++;
+        } else {
+            result.errors.emplace_back(structure_files[i], errors[i]);
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
@@ -0,0 +1,122 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Bulk generation of calculator inputs from a template directory.
+///
+/// Every file below the template directory, e.g. INCAR, POSCAR and KPOINTS
+/// for VASP or a single pw.in for Quantum ESPRESSO, is copied into one
+/// directory per structure with the placeholders replaced:
+///
+///     {{name}}            stem of the structure file
+///     {{index}}           position of the structure in the library
+///     {{natom}}, {{ntyp}} number of atoms and of species
+///     {{species}}         species in order of appearance, "Si O"
+///     {{species_counts}}  atoms per species, "3 6"
+///     {{cell}}            three lines with the cell vectors
+///     {{positions}}       "Si x y z" lines, grouped by species
+///     {{coordinates}}     "x y z" lines in the same order
+///
+/// Any other {{key}} is taken from the parameters. The templates are
+/// parsed once and shared by all threads, every output file is rendered
+/// into a memory buffer and written with a single call.
+
+#ifndef CALC_INPUT_GENERATOR_H
+#define CALC_INPUT_GENERATOR_H
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <atomsciflow/base/crystal.h>
+
+class InputTemplate {
+public:
+    // throws std::runtime_error for an empty template directory, an
+    // unterminated placeholder or a key without a parameter
+    explicit InputTemplate(const std::string& template_dir, const std::map<std::string, std::string>& parameters = {});
+
+    std::size_t get_nfiles() const {
+        return m_files.size();
+    }
+    const std::string& get_relative_path(std::size_t file) const {
+        return m_files[file].relative_path;
+    }
+
+    // values of the structure placeholders, only the ones used by the
+    // templates are filled
+    using Fields = std::array<std::string, 9>;
+    void fill_fields(const atomsciflow::Crystal& crystal, const std::string& name, std::size_t index, Fields& fields) const;
+
+    // appends the rendered file to out
+    void render(std::size_t file, const Fields& fields, std::string& out) const;
+
+private:
+    enum Field {
+        Literal = -1,
+        Name = 0,
+        Index,
+        Natom,
+        Ntyp,
+        Species,
+        SpeciesCounts,
+        Cell,
+        Positions,
+        Coordinates,
+    };
+
+    struct Segment {
+        Field field;
+        std::string text;
+    };
+
+    struct File {
+        std::string relative_path;
+        std::vector<Segment> segments;
+        std::size_t literal_size = 0;
+    };
+
+    File parse(const std::string& relative_path, const std::string& content, const std::map<std::string, std::string>& parameters);
+
+    std::vector<File> m_files;
+    std::array<bool, 9> m_used{};
+};
+
+struct InputGenerationResult {
+    std::size_t ngenerated = 0;
+    // structure file and error message
+    std::vector<std::pair<std::string, std::string>> errors;
+    double seconds = 0.0;
+};
+
+// writes output_dir/<name>/<template files> for every structure file,
+// jobs <= 0 uses all cores, progress is called from the worker threads
+InputGenerationResult generate_inputs(
+    const InputTemplate& input_template,
+    const std::vector<std::string>& structure_files,
+    const std::string& output_dir,
+    int jobs = 0,
+    const std::function<void(std::size_t done, std::size_t total)>& progress = nullptr
+);
+
+#endif // CALC_INPUT_GENERATOR_H
@@ -0,0 +1,268 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "calc/job_monitor.h"
+
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrent>
+
+#include <algorithm>
+#include <sstream>
+
+#include <boost/algorithm/string.hpp>
+
+#include "utils/logger.h"
+#include "utils/trace.h"
+
+namespace {
+
+const char* kFinished = "FINISHED";
+
+} // namespace
+
+bool is_finished(const std::string& state) {
+    return kFinished == state || "DONE" == state || "EXIT" == state;
+}
+
+Scheduler scheduler_from_name(const std::string& name) {
+    const auto lower = boost::algorithm::to_lower_copy(name);
+    if ("pbs" == lower || "torque" == lower) {
+        return Scheduler::Pbs;
+    } else if ("lsf" == lower) {
+        return Scheduler::Lsf;
+    }
+    return Scheduler::Slurm;
+}
+
+std::string job_query_command(Scheduler scheduler, const std::string& user) {
+    // asking for job ids fails once they all left the queue, the jobs of
+    // the user are listed instead
+    const auto quoted_user = shell_quote(user);
+    switch (scheduler) {
+    case Scheduler::Pbs:
+        return "qstat -u " + quoted_user;
+    case Scheduler::Lsf:
+        // -a keeps the jobs finished within the clean period as DONE or EXIT
+        return "bjobs -a -noheader -u " + quoted_user + " -o 'jobid stat job_name run_time delimiter=\"|\"'";
+    case Scheduler::Slurm:
+    default:
+        return "squeue -h -u " + quoted_user + " -o '%i|%T|%j|%M'";
+    }
+}
+
+std::map<std::string, JobStatus> parse_job_query(Scheduler scheduler, const std::string& output) {
+    std::map<std::string, JobStatus> jobs;
+    std::istringstream stream(output);
+    std::string line;
+    while (std::getline(stream, line)) {
+        boost::algorithm::trim(line);
+        if (line.empty()) {
+            continue;
+        }
+        JobStatus status;
+        std::vector<std::string> fields;
+        if (Scheduler::Pbs == scheduler) {
+            // Job ID  Username  Queue  Jobname  SessID  NDS  TSK  Memory
+            // Time  S  Time, after the server name and three header lines
+            boost::algorithm::split(fields, line, boost::algorithm::is_space(), boost::algorithm::token_compress_on);
+            if (fields.size() < 11 || "Job" == fields[0] || '-' == fields[0][0]) {
+                continue;
+            }
+            status.id = fields[0].substr(0, fields[0].find('.'));
+            status.name = fields[3];
+            status.state = fields[9];
+            status.elapsed = fields[10];
+        } else {
+            boost::algorithm::split(fields, line, boost::algorithm::is_any_of("|"));
+            if (fields.size() < 4) {
+                continue;
+            }
+            // squeue and bjobs are both asked for id|state|name|elapsed
+            status.id = fields[0];
+            status.state = fields[1];
+            status.name = fields[2];
+            status.elapsed = fields[3];
+        }
+        jobs[status.id] = status;
+    }
+    return jobs;
+}
+
+std::string job_script(Scheduler scheduler, const std::string& name, int cores, const std::string& command) {
+    const auto ncore = std::to_string(std::max(1, cores));
+    std::string script = "#!/bin/sh\n";
+    switch (scheduler) {
+    case Scheduler::Pbs:
+        // PBS starts the job in the home directory
+        script += "#PBS -N " + name + "\n#PBS -l nodes=1:ppn=" + ncore + "\ncd \"$PBS_O_WORKDIR\"\n";
+        break;
+    case Scheduler::Lsf:
+        script += "#BSUB -J " + name + "\n#BSUB -n " + ncore + "\n";
+        break;
+    case Scheduler::Slurm:
+    default:
+        script += "#SBATCH -J " + name + "\n#SBATCH -n " + ncore + "\n";
+        break;
+    }
+    return script + command + "\n";
+}
+
+std::string job_submit_command(Scheduler scheduler, const std::string& script) {
+    switch (scheduler) {
+    case Scheduler::Pbs:
+        return "qsub " + shell_quote(script);
+    case Scheduler::Lsf:
+        return "bsub < " + shell_quote(script);
+    case Scheduler::Slurm:
+    default:
+        return "sbatch " + shell_quote(script);
+    }
+}
+
+std::string parse_submitted_job_id(Scheduler scheduler, const std::string& output) {
+    // Submitted batch job 123, 123.server or Job <123> is submitted
+    std::string text = boost::algorithm::trim_copy(output);
+    if (Scheduler::Lsf == scheduler) {
+        const auto begin = text.find('<');
+        const auto end = text.find('>');
+        if (std::string::npos == begin || std::string::npos == end || end < begin) {
+            return std::string();
+        }
+        text = text.substr(begin + 1, end - begin - 1);
+    } else if (Scheduler::Slurm == scheduler) {
+        const auto space = text.find_last_of(" \t\n");
+        text = std::string::npos == space ? text : text.substr(space + 1);
+    } else {
+        text = text.substr(0, text.find('.'));
+    }
+    if (text.empty() || false == std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        return std::string();
+    }
+    return text;
+}
+
+JobMonitor::JobMonitor(QObject* parent) : QObject{parent} {
+    m_timer = new QTimer(this);
+    m_timer->setInterval(30 * 1000);
+    QObject::connect(m_timer, &QTimer::timeout, this, &JobMonitor::poll);
+}
+
+void JobMonitor::track(const SshEndpoint& endpoint, Scheduler scheduler, const std::string& job_id) {
+    auto& host = m_hosts[endpoint.key()];
+    host.endpoint = endpoint;
+    host.scheduler = scheduler;
+    auto& status = host.jobs[job_id];
+    status.host = endpoint.host;
+    status.id = job_id;
+}
+
+void JobMonitor::untrack(const SshEndpoint& endpoint, const std::string& job_id) {
+    auto host = m_hosts.find(endpoint.key());
+    if (m_hosts.end() != host) {
+        host->second.jobs.erase(job_id);
+    }
+}
+
+void JobMonitor::set_interval(int seconds) {
+    m_timer->setInterval(std::max(1, seconds) * 1000);
+}
+
+void JobMonitor::start() {
+    if (false == m_timer->isActive()) {
+        m_timer->start();
+    }
+}
+
+void JobMonitor::stop() {
+    m_timer->stop();
+}
+
+void JobMonitor::poll() {
+    TRACE_SCOPE_CAT("JobMonitor::poll", "calc");
+    for (auto& item : m_hosts) {
+        auto& host = item.second;
+        const bool unfinished = std::any_of(host.jobs.begin(), host.jobs.end(), [](const std::pair<const std::string, JobStatus>& job) {
+            return false == is_finished(job.second.state);
+        });
+        // a host still answering the previous poll is skipped
+        if (false == unfinished || true == host.polling) {
+            continue;
+        }
+        host.polling = true;
+        const auto host_key = item.first;
+        const auto endpoint = host.endpoint;
+        const auto command = job_query_command(host.scheduler, endpoint.user);
+        auto watcher = new QFutureWatcher<SshExecResult>(this);
+        QObject::connect(watcher, &QFutureWatcher<SshExecResult>::finished, this, [this, watcher, host_key]() {
+            this->on_query_finished(host_key, watcher->result());
+            watcher->deleteLater();
+        });
+        watcher->setFuture(QtConcurrent::run([endpoint, command]() {
+            SshExecResult result;
+            try {
+                result = SshSessionPool::instance().exec(endpoint, command);
+            } catch (const SshError& e) {
+                LOG_WARNING("job query on %s failed: %s", endpoint.key().c_str(), e.what());
+                result.exit_status = -1;
+                result.err = e.what();
+            }
+            return result;
+        }));
+    }
+}
+
+void JobMonitor::on_query_finished(const std::string& host_key, const SshExecResult& result) {
+    auto item = m_hosts.find(host_key);
+    if (m_hosts.end() == item) {
+        return;
+    }
+    auto& host = item->second;
+    host.polling = false;
+    if (0 != result.exit_status) {
+        // the connection or the scheduler failed, an empty list would
+        // finish every job, keep the last known states
+        LOG_WARNING("job query on %s exited with %d: %s", host_key.c_str(), result.exit_status, result.err.c_str());
+        return;
+    }
+    const auto queried = parse_job_query(host.scheduler, result.out);
+    std::vector<JobStatus> changed;
+    for (auto& job : host.jobs) {
+        if (true == is_finished(job.second.state)) {
+            continue;
+        }
+        auto found = queried.find(job.first);
+        JobStatus status;
+        if (queried.end() == found) {
+            status = job.second;
+            status.state = kFinished;
+        } else {
+            status = found->second;
+        }
+        status.host = host.endpoint.host;
+        status.id = job.first;
+        if (false == (status == job.second)) {
+            job.second = status;
+            changed.push_back(status);
+        }
+    }
+    if (false == changed.empty()) {
+        emit this->jobs_changed(changed);
+    }
+}
@@ -0,0 +1,116 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Scheduler state of the tracked jobs.
+///
+/// Jobs are grouped by host, and every poll sends one squeue, qstat or
+/// bjobs command per host listing the jobs of the login user. The result
+/// is compared with the last known state, only jobs whose state changed
+/// are reported, so the cost of a poll grows with the number of hosts
+/// rather than with the number of jobs. A tracked job missing from the
+/// list has finished; a query exiting with an error keeps the last known
+/// states.
+
+#ifndef CALC_JOB_MONITOR_H
+#define CALC_JOB_MONITOR_H
+
+#include <QObject>
+#include <QTimer>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "remote/ssh_pool.h"
+
+enum class Scheduler {
+    Slurm,
+    Pbs,
+    Lsf,
+};
+
+Scheduler scheduler_from_name(const std::string& name);
+
+struct JobStatus {
+    std::string host;
+    std::string id;
+    std::string name;
+    // as reported by the scheduler, or "FINISHED" once the job left the queue
+    std::string state;
+    std::string elapsed;
+
+    // the elapsed time changes on every poll of a running job and does
+    // not count as a change
+    bool operator==(const JobStatus& other) const {
+        return state == other.state && name == other.name;
+    }
+};
+
+// the single command listing the jobs of user, it exits with 0 also
+// when the user has no jobs
+std::string job_query_command(Scheduler scheduler, const std::string& user);
+// parses the output of job_query_command() into id -> status
+std::map<std::string, JobStatus> parse_job_query(Scheduler scheduler, const std::string& output);
+
+// FINISHED, or the DONE and EXIT that LSF keeps listed for a while
+bool is_finished(const std::string& state);
+
+// a job script running command with the cores in the directory it was
+// submitted from, the name is shown by the scheduler
+std::string job_script(Scheduler scheduler, const std::string& name, int cores, const std::string& command);
+// submits the job script in the current directory
+std::string job_submit_command(Scheduler scheduler, const std::string& script);
+// the job id printed by job_submit_command(), empty when there is none
+std::string parse_submitted_job_id(Scheduler scheduler, const std::string& output);
+
+class JobMonitor : public QObject {
+    Q_OBJECT
+public:
+    explicit JobMonitor(QObject* parent = nullptr);
+
+    void track(const SshEndpoint& endpoint, Scheduler scheduler, const std::string& job_id);
+    void untrack(const SshEndpoint& endpoint, const std::string& job_id);
+
+    void set_interval(int seconds);
+    void start();
+    void stop();
+
+public slots:
+    void poll();
+
+signals:
+    // only the jobs whose status differs from the previous poll
+    void jobs_changed(const std::vector<JobStatus>& changed);
+
+private:
+    struct Host {
+        SshEndpoint endpoint;
+        Scheduler scheduler;
+        std::map<std::string, JobStatus> jobs;
+        bool polling = false;
+    };
+
+    void on_query_finished(const std::string& host_key, const SshExecResult& result);
+
+    std::map<std::string, Host> m_hosts;
+    QTimer* m_timer;
+};
+
+#endif // CALC_JOB_MONITOR_H
@@ -0,0 +1,57 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "calc/job_table.h"
+
+#include <QHeaderView>
+
+JobTable::JobTable(QWidget* parent) : QTableWidget{parent} {
+    this->setColumnCount(5);
+    this->setHorizontalHeaderLabels({tr("Host"), tr("Job"), tr("Name"), tr("State"), tr("Elapsed")});
+    this->horizontalHeader()->setStretchLastSection(true);
+    this->verticalHeader()->setVisible(false);
+    this->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    this->setSelectionBehavior(QAbstractItemView::SelectRows);
+}
+
+void JobTable::update_jobs(const std::vector<JobStatus>& changed) {
+    this->setUpdatesEnabled(false);
+    for (const auto& job : changed) {
+        const auto key = job.host + "/" + job.id;
+        auto found = m_rows.find(key);
+        int row = 0;
+        if (m_rows.end() == found) {
+            row = this->rowCount();
+            this->insertRow(row);
+            m_rows[key] = row;
+            this->setItem(row, 0, new QTableWidgetItem(QString::fromStdString(job.host)));
+            this->setItem(row, 1, new QTableWidgetItem(QString::fromStdString(job.id)));
+            this->setItem(row, 2, new QTableWidgetItem());
+            this->setItem(row, 3, new QTableWidgetItem());
+            this->setItem(row, 4, new QTableWidgetItem());
+        } else {
+            row = found->second;
+        }
+        this->item(row, 2)->setText(QString::fromStdString(job.name));
+        this->item(row, 3)->setText(QString::fromStdString(job.state));
+        this->item(row, 4)->setText(QString::fromStdString(job.elapsed));
+    }
+    this->setUpdatesEnabled(true);
+}
@@ -0,0 +1,46 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef CALC_JOB_TABLE_H
+#define CALC_JOB_TABLE_H
+
+#include <QTableWidget>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "calc/job_monitor.h"
+
+/// One row per job, only the rows of changed jobs are touched.
+class JobTable : public QTableWidget {
+    Q_OBJECT
+public:
+    explicit JobTable(QWidget* parent = nullptr);
+
+public slots:
+    void update_jobs(const std::vector<JobStatus>& changed);
+
+private:
+    // host/id -> row
+    std::map<std::string, int> m_rows;
+};
+
+#endif // CALC_JOB_TABLE_H
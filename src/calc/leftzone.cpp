@@ -61,6 +61,65 @@ LeftZone::LeftZone(QWidget *parent) : QWidget{parent} {
     auto tab_2 = new QWidget();
     tab_widget->addTab(tab_2, QString());
     tab_2->setObjectName(QString::fromUtf8("tab_2"));
+
+    auto workflow_tab = new QWidget();
+    tab_widget->addTab(workflow_tab, QObject::tr("Workflow"));
+    workflow_tab->setObjectName(QString::fromUtf8("workflow_tab"));
+    auto workflow_layout = new QVBoxLayout(workflow_tab);
+    this->m_workflow_remote_check_box = new QCheckBox(workflow_tab);
+    workflow_layout->addWidget(this->m_workflow_remote_check_box);
+    this->m_workflow_remote_check_box->setText(QObject::tr("Run on the remote host"));
+    this->m_run_workflow_button = new QPushButton(workflow_tab);
+    workflow_layout->addWidget(this->m_run_workflow_button);
+    this->m_run_workflow_button->setText(QObject::tr("Run workflow..."));
+    workflow_layout->addStretch();
+
+    auto remote_tab = new QWidget();
+    tab_widget->addTab(remote_tab, QObject::tr("Remote"));
+    remote_tab->setObjectName(QString::fromUtf8("remote_tab"));
+    auto remote_layout = new QVBoxLayout(remote_tab);
+    this->m_submit_job_button = new QPushButton(remote_tab);
+    remote_layout->addWidget(this->m_submit_job_button);
+    this->m_submit_job_button->setText(QObject::tr("Submit job..."));
+    this->m_submit_job_button->setToolTip(QObject::tr("Submit a job script of a remote directory and follow it in the Jobs tab"));
+    this->m_stage_in_button = new QPushButton(remote_tab);
+    remote_layout->addWidget(this->m_stage_in_button);
+    this->m_stage_in_button->setText(QObject::tr("Upload directory..."));
+    this->m_stage_in_button->setToolTip(QObject::tr("Send the changed blocks of the files of a local directory"));
+    this->m_stage_out_button = new QPushButton(remote_tab);
+    remote_layout->addWidget(this->m_stage_out_button);
+    this->m_stage_out_button->setText(QObject::tr("Download directory..."));
+    this->m_stage_out_button->setToolTip(QObject::tr("Fetch the changed blocks of the files of a remote directory"));
+    this->m_watch_output_button = new QPushButton(remote_tab);
+    remote_layout->addWidget(this->m_watch_output_button);
+    this->m_watch_output_button->setText(QObject::tr("Watch output..."));
+    this->m_watch_output_button->setToolTip(QObject::tr("Follow a growing remote output in the output view and the convergence plot"));
+    this->m_fetch_output_button = new QPushButton(remote_tab);
+    remote_layout->addWidget(this->m_fetch_output_button);
+    this->m_fetch_output_button->setText(QObject::tr("Fetch output..."));
+    this->m_fetch_output_button->setToolTip(QObject::tr("Download a large remote file over several streams, resuming an interrupted download"));
+    this->m_fetch_progress_bar = new QProgressBar(remote_tab);
+    remote_layout->addWidget(this->m_fetch_progress_bar);
+    this->m_fetch_progress_bar->setValue(0);
+    remote_layout->addStretch();
+
+    auto inputs_tab = new QWidget();
+    tab_widget->addTab(inputs_tab, QObject::tr("Inputs"));
+    inputs_tab->setObjectName(QString::fromUtf8("inputs_tab"));
+    auto inputs_layout = new QVBoxLayout(inputs_tab);
+    this->m_generate_inputs_button = new QPushButton(inputs_tab);
+    inputs_layout->addWidget(this->m_generate_inputs_button);
+    this->m_generate_inputs_button->setText(QObject::tr("Generate inputs..."));
+    this->m_generate_inputs_button->setToolTip(QObject::tr("Write inputs for every structure of a directory from a template directory"));
+    this->m_inputs_progress_bar = new QProgressBar(inputs_tab);
+    inputs_layout->addWidget(this->m_inputs_progress_bar);
+    this->m_inputs_progress_bar->setValue(0);
+    inputs_layout->addStretch();
+
+    this->m_job_table = new JobTable(tab_widget);
+    tab_widget->addTab(this->m_job_table, QObject::tr("Jobs"));
+    this->m_job_table->setObjectName(QString::fromUtf8("job_table"));
+
     tab_widget->setTabText(tab_widget->indexOf(tab_1), QCoreApplication::translate("Atoms3DTools", "Tab 1", nullptr));
     tab_widget->setTabText(tab_widget->indexOf(tab_2), QCoreApplication::translate("Atoms3DTools", "Tab 2", nullptr));
 
@@ -27,17 +27,33 @@
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QCheckBox>
 #include <QtWidgets/QGridLayout>
+#include <QtWidgets/QProgressBar>
+#include <QtWidgets/QPushButton>
 #include <QtWidgets/QSlider>
 #include <QtWidgets/QTabWidget>
 #include <QtWidgets/QTextBrowser>
 #include <QtWidgets/QVBoxLayout>
 #include <QtWidgets/QWidget>
 
+#include "calc/job_table.h"
+
 class LeftZone : public QWidget {
     Q_OBJECT
 public:
     explicit LeftZone(QWidget *parent = nullptr);
 
+    JobTable* m_job_table;
+    QPushButton* m_run_workflow_button;
+    QCheckBox* m_workflow_remote_check_box;
+    QPushButton* m_submit_job_button;
+    QPushButton* m_stage_in_button;
+    QPushButton* m_stage_out_button;
+    QPushButton* m_watch_output_button;
+    QPushButton* m_fetch_output_button;
+    QProgressBar* m_fetch_progress_bar;
+    QPushButton* m_generate_inputs_button;
+    QProgressBar* m_inputs_progress_bar;
+
 signals:
 
 };
@@ -0,0 +1,509 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "calc/local_executor.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+#include <boost/filesystem.hpp>
+
+#include "utils/logger.h"
+#include "utils/trace.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// "0-3,8-11" -> 0 1 2 3 8 9 10 11
+std::vector<int> parse_cpu_list(const std::string& text) {
+    std::vector<int> cpus;
+    std::stringstream stream(text);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        const auto dash = range.find('-');
+        try {
+            if (std::string::npos == dash) {
+                cpus.push_back(std::stoi(range));
+            } else {
+                for (int cpu = std::stoi(range.substr(0, dash)); cpu <= std::stoi(range.substr(dash + 1)); cpu++) {
+                    cpus.push_back(cpu);
+                }
+            }
+        } catch (const std::exception&) {
+        }
+    }
+    return cpus;
+}
+
+std::vector<std::vector<int>> numa_nodes() {
+    std::vector<int> allowed;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (0 == sched_getaffinity(0, sizeof(set), &set)) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                allowed.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (allowed.empty()) {
+        for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++) {
+            allowed.push_back(static_cast<int>(cpu));
+        }
+    }
+    std::vector<std::vector<int>> nodes;
+    for (int node = 0; ; node++) {
+        std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (false == cpulist.good()) {
+            break;
+        }
+        std::string text;
+        std::getline(cpulist, text);
+        std::vector<int> cpus;
+        for (const int cpu : parse_cpu_list(text)) {
+            if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) {
+                cpus.push_back(cpu);
+            }
+        }
+        if (false == cpus.empty()) {
+            nodes.push_back(cpus);
+        }
+    }
+    if (nodes.empty()) {
+        nodes.push_back(allowed);
+    }
+    return nodes;
+}
+
+} // namespace
+
+const char* local_job_state_name(LocalJobState state) {
+    switch (state) {
+    case LocalJobState::Queued:
+        return "QUEUED";
+    case LocalJobState::Running:
+        return "RUNNING";
+    case LocalJobState::Done:
+        return "DONE";
+    case LocalJobState::Failed:
+        return "FAILED";
+    case LocalJobState::Cancelled:
+    default:
+        return "CANCELLED";
+    }
+}
+
+CoreAllocator::CoreAllocator(int max_cores) {
+    m_free = numa_nodes();
+    int ncpu = 0;
+    for (int node = 0; node < static_cast<int>(m_free.size()); node++) {
+        for (const int cpu : m_free[node]) {
+            m_node_of[cpu] = node;
+        }
+        ncpu += static_cast<int>(m_free[node].size());
+    }
+    m_max_cores = max_cores > 0 ? std::min(max_cores, ncpu) : ncpu;
+    m_nfree = m_max_cores;
+}
+
+std::vector<int> CoreAllocator::take(int ncore) {
+    std::vector<int> cpus;
+    // the fullest node that still fits the request keeps the large free
+    // nodes for large jobs
+    int best = -1;
+    for (int node = 0; node < static_cast<int>(m_free.size()); node++) {
+        const int nfree = static_cast<int>(m_free[node].size());
+        if (nfree >= ncore && (best < 0 || nfree < static_cast<int>(m_free[best].size()))) {
+            best = node;
+        }
+    }
+    std::vector<int> order;
+    if (best >= 0) {
+        order.push_back(best);
+    } else {
+        for (int node = 0; node < static_cast<int>(m_free.size()); node++) {
+            order.push_back(node);
+        }
+        std::sort(order.begin(), order.end(), [this](int lhs, int rhs) {
+            return m_free[lhs].size() > m_free[rhs].size();
+        });
+    }
+    for (const int node : order) {
+        while (static_cast<int>(cpus.size()) < ncore && false == m_free[node].empty()) {
+            cpus.push_back(m_free[node].back());
+            m_free[node].pop_back();
+        }
+    }
+    m_nfree -= static_cast<int>(cpus.size());
+    return cpus;
+}
+
+std::vector<int> CoreAllocator::acquire(int ncore) {
+    ncore = std::max(1, std::min(ncore, m_max_cores));
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const auto ticket = m_next_ticket++;
+    m_released.wait(lock, [&]() {
+        return ticket == m_serving && m_nfree >= ncore;
+    });
+    m_serving++;
+    auto cpus = this->take(ncore);
+    lock.unlock();
+    m_released.notify_all();
+    return cpus;
+}
+
+void CoreAllocator::release(const std::vector<int>& cpus) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const int cpu : cpus) {
+            m_free[m_node_of[cpu]].push_back(cpu);
+        }
+        m_nfree += static_cast<int>(cpus.size());
+    }
+    m_released.notify_all();
+}
+
+LocalExecutor::LocalExecutor(int max_cores) : m_allocator{max_cores} {
+    // a job holds at least one core, more workers than cores would only wait
+    m_pool = std::make_unique<WorkStealingPool>(m_allocator.get_max_cores());
+}
+
+LocalExecutor::~LocalExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& item : m_jobs) {
+            if (LocalJobState::Queued == item.second.state || LocalJobState::Running == item.second.state) {
+                terminate(item.second);
+                item.second.state = LocalJobState::Cancelled;
+            }
+        }
+    }
+    m_pool.reset();
+}
+
+int LocalExecutor::submit(const LocalJob& job) {
+    int job_id = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        job_id = m_next_id++;
+        m_jobs[job_id].job = job;
+    }
+    m_pool->submit([this, job_id]() {
+        this->run_job(job_id);
+    }, [this, job_id](std::exception_ptr error) {
+        this->fail_job(job_id, error);
+    });
+    return job_id;
+}
+
+void LocalExecutor::cancel(int job_id) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_jobs.find(job_id);
+        if (m_jobs.end() == found) {
+            return;
+        }
+        auto& entry = found->second;
+        if (LocalJobState::Queued != entry.state && LocalJobState::Running != entry.state) {
+            return;
+        }
+        // a job is started and marked running in two steps, whatever was
+        // started is stopped here and a job not started yet is skipped
+        // when a worker gets to it
+        terminate(entry);
+        entry.state = LocalJobState::Cancelled;
+    }
+    if (m_state_callback) {
+        m_state_callback(job_id, LocalJobState::Cancelled, -1);
+    }
+}
+
+void LocalExecutor::wait_all() {
+    m_pool->wait_idle();
+}
+
+LocalJobState LocalExecutor::get_state(int job_id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_jobs[job_id].state;
+}
+
+int LocalExecutor::get_exit_code(int job_id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_jobs[job_id].exit_code;
+}
+
+void LocalExecutor::set_state(int job_id, LocalJobState state) {
+    int exit_code = -1;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& entry = m_jobs[job_id];
+        // a cancellation is kept even when the process exits normally
+        if (LocalJobState::Cancelled != entry.state) {
+            entry.state = state;
+        }
+        state = entry.state;
+        exit_code = entry.exit_code;
+    }
+    if (m_state_callback) {
+        m_state_callback(job_id, state, exit_code);
+    }
+}
+
+void LocalExecutor::terminate(Entry& entry) {
+#if defined(_WIN32)
+    if (nullptr != entry.job_object) {
+        TerminateJobObject(static_cast<HANDLE>(entry.job_object), 1);
+    }
+#else
+    if (entry.pid > 0) {
+        // the job runs in its own process group, children of the shell
+        // are stopped as well
+        kill(-entry.pid, SIGTERM);
+    }
+#endif
+}
+
+void LocalExecutor::fail_job(int job_id, std::exception_ptr error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::exception& e) {
+        LOG_ERROR("local job %d failed: %s", job_id, e.what());
+    } catch (...) {
+        LOG_ERROR("local job %d failed", job_id);
+    }
+    std::function<void(int)> on_finished;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& entry = m_jobs[job_id];
+        // a final state means on_finished was reached already
+        if (LocalJobState::Queued != entry.state && LocalJobState::Running != entry.state) {
+            return;
+        }
+        on_finished = entry.job.on_finished;
+    }
+    this->set_state(job_id, LocalJobState::Failed);
+    if (on_finished) {
+        on_finished(-1);
+    }
+}
+
+void LocalExecutor::run_job(int job_id) {
+    TRACE_SCOPE_CAT("LocalExecutor::run_job", "calc");
+    LocalJob job;
+    bool cancelled = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        job = m_jobs[job_id].job;
+        cancelled = LocalJobState::Cancelled == m_jobs[job_id].state;
+    }
+    if (cancelled) {
+        if (job.on_finished) {
+            job.on_finished(-1);
+        }
+        return;
+    }
+    const auto cpus = m_allocator.acquire(job.cores);
+    const auto output_path = (fs::path(job.working_dir) / job.output_file).string();
+    const auto omp_num_threads = "OMP_NUM_THREADS=" + std::to_string(cpus.size());
+
+#if defined(_WIN32)
+    // a run of "name=value\0" closed by one more "\0"
+    std::string environment;
+    if (char* block = GetEnvironmentStringsA()) {
+        for (const char* variable = block; '\0' != *variable; variable += std::strlen(variable) + 1) {
+            if (0 != _strnicmp(variable, "OMP_NUM_THREADS=", 16)) {
+                environment.append(variable).push_back('\0');
+            }
+        }
+        FreeEnvironmentStringsA(block);
+    }
+    environment.append(omp_num_threads).push_back('\0');
+    environment.push_back('\0');
+    std::string command_line = "cmd.exe /c " + job.command;
+    DWORD_PTR affinity = 0;
+    for (const int cpu : cpus) {
+        if (cpu < static_cast<int>(8 * sizeof(DWORD_PTR))) {
+            affinity |= static_cast<DWORD_PTR>(1) << cpu;
+        }
+    }
+    HANDLE process = nullptr;
+#else
+    // everything the child needs is prepared here, between fork and exec
+    // only async-signal-safe calls are allowed
+    std::vector<char*> envp;
+    for (char** variable = environ; nullptr != *variable; variable++) {
+        if (0 != std::strncmp(*variable, "OMP_NUM_THREADS=", 16)) {
+            envp.push_back(*variable);
+        }
+    }
+    envp.push_back(const_cast<char*>(omp_num_threads.c_str()));
+    envp.push_back(nullptr);
+    const char* argv[] = {"sh", "-c", job.command.c_str(), nullptr};
+#if defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (const int cpu : cpus) {
+        CPU_SET(cpu, &cpu_set);
+    }
+#endif
+    pid_t pid = -1;
+#endif
+
+    bool skipped = false;
+    bool started = false;
+    {
+        // a cancel takes the same lock, it either sees the started
+        // process or keeps the job from starting
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& entry = m_jobs[job_id];
+        if (LocalJobState::Cancelled == entry.state) {
+            skipped = true;
+        } else {
+#if defined(_WIN32)
+            // the output handle is inheritable, creating it under the
+            // lock keeps it out of the other jobs' processes
+            SECURITY_ATTRIBUTES inherit{sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE};
+            HANDLE output = CreateFileA(output_path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &inherit, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            HANDLE job_object = CreateJobObjectA(nullptr, nullptr);
+            STARTUPINFOA startup{};
+            startup.cb = sizeof(startup);
+            startup.dwFlags = STARTF_USESTDHANDLES;
+            startup.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+            startup.hStdOutput = output;
+            startup.hStdError = output;
+            PROCESS_INFORMATION info{};
+            // suspended until it is in the job object, so that nothing it
+            // starts escapes a cancel
+            if (INVALID_HANDLE_VALUE != output && nullptr != job_object
+                && FALSE != CreateProcessA(nullptr, &command_line[0], nullptr, nullptr, TRUE, CREATE_SUSPENDED | CREATE_NO_WINDOW,
+                    &environment[0], job.working_dir.c_str(), &startup, &info)) {
+                AssignProcessToJobObject(job_object, info.hProcess);
+                if (0 != affinity) {
+                    SetProcessAffinityMask(info.hProcess, affinity);
+                }
+                ResumeThread(info.hThread);
+                CloseHandle(info.hThread);
+                entry.job_object = job_object;
+                entry.process = info.hProcess;
+                process = info.hProcess;
+                started = true;
+            } else if (nullptr != job_object) {
+                CloseHandle(job_object);
+            }
+            if (INVALID_HANDLE_VALUE != output) {
+                CloseHandle(output);
+            }
+#else
+            pid = fork();
+            if (0 == pid) {
+                setpgid(0, 0);
+#if defined(__linux__)
+                sched_setaffinity(0, sizeof(cpu_set), &cpu_set);
+#endif
+                if (0 != chdir(job.working_dir.c_str())) {
+                    _exit(127);
+                }
+                const int fd = open(output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                if (fd >= 0) {
+                    dup2(fd, STDOUT_FILENO);
+                    dup2(fd, STDERR_FILENO);
+                    close(fd);
+                }
+                execve("/bin/sh", const_cast<char* const*>(argv), envp.data());
+                _exit(127);
+            }
+            if (pid > 0) {
+                // the parent sets the group as well, a cancel right after
+                // the fork must not find it missing; fails harmlessly once
+                // the child has exec'd
+                setpgid(pid, pid);
+                entry.pid = pid;
+                started = true;
+            }
+#endif
+        }
+    }
+    if (true == skipped) {
+        m_allocator.release(cpus);
+        if (job.on_finished) {
+            job.on_finished(-1);
+        }
+        return;
+    }
+    if (false == started) {
+        m_allocator.release(cpus);
+        LOG_ERROR("can not start local job %d", job_id);
+        this->set_state(job_id, LocalJobState::Failed);
+        if (job.on_finished) {
+            job.on_finished(-1);
+        }
+        return;
+    }
+    this->set_state(job_id, LocalJobState::Running);
+
+#if defined(_WIN32)
+    WaitForSingleObject(process, INFINITE);
+    DWORD code = 1;
+    GetExitCodeProcess(process, &code);
+    const int exit_code = static_cast<int>(code);
+#else
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && EINTR == errno) {
+    }
+    const int exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+#endif
+    m_allocator.release(cpus);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& entry = m_jobs[job_id];
+        entry.exit_code = exit_code;
+#if defined(_WIN32)
+        CloseHandle(static_cast<HANDLE>(entry.process));
+        CloseHandle(static_cast<HANDLE>(entry.job_object));
+        entry.process = nullptr;
+        entry.job_object = nullptr;
+#else
+        entry.pid = -1;
+#endif
+    }
+    this->set_state(job_id, 0 == exit_code ? LocalJobState::Done : LocalJobState::Failed);
+    if (job.on_finished) {
+        job.on_finished(exit_code);
+    }
+}
@@ -0,0 +1,149 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Runs calculations as processes on the local machine.
+///
+/// Jobs are dispatched through a WorkStealingPool and every job declares
+/// the cores it needs. A core allocator hands out concrete CPUs, within
+/// one NUMA node when one has enough free cores. The job's process is
+/// pinned to them and gets OMP_NUM_THREADS set accordingly. Cores are
+/// granted in submission order, and never more than max_cores at once,
+/// so the machine is kept busy without oversubscription.
+
+#ifndef CALC_LOCAL_EXECUTOR_H
+#define CALC_LOCAL_EXECUTOR_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/types.h>
+#endif
+
+#include "utils/work_stealing_pool.h"
+
+struct LocalJob {
+    // run by /bin/sh -c, cmd.exe /c on Windows, in working_dir
+    std::string command;
+    std::string working_dir = ".";
+    int cores = 1;
+    // stdout and stderr, relative to working_dir
+    std::string output_file = "job.out";
+    // called from a worker thread with the exit code, -1 when cancelled
+    // or when the job could not be run
+    std::function<void(int)> on_finished;
+};
+
+enum class LocalJobState {
+    Queued,
+    Running,
+    Done,
+    Failed,
+    Cancelled,
+};
+
+const char* local_job_state_name(LocalJobState state);
+
+/// Free CPUs grouped by NUMA node.
+class CoreAllocator {
+public:
+    // max_cores 0: every CPU this process may run on
+    explicit CoreAllocator(int max_cores = 0);
+
+    // blocks until the cores are free and all earlier requests are served
+    std::vector<int> acquire(int ncore);
+    void release(const std::vector<int>& cpus);
+
+    int get_max_cores() const {
+        return m_max_cores;
+    }
+
+private:
+    std::vector<int> take(int ncore);
+
+    std::mutex m_mutex;
+    std::condition_variable m_released;
+    // node -> free CPUs
+    std::vector<std::vector<int>> m_free;
+    std::map<int, int> m_node_of;
+    int m_nfree = 0;
+    int m_max_cores = 0;
+    unsigned long m_next_ticket = 0;
+    unsigned long m_serving = 0;
+};
+
+class LocalExecutor {
+public:
+    explicit LocalExecutor(int max_cores = 0);
+    // cancels whatever still runs
+    ~LocalExecutor();
+
+    int submit(const LocalJob& job);
+    void cancel(int job_id);
+    void wait_all();
+
+    LocalJobState get_state(int job_id);
+    int get_exit_code(int job_id);
+    int get_max_cores() const {
+        return m_allocator.get_max_cores();
+    }
+
+    // called from the worker threads
+    void set_state_callback(const std::function<void(int, LocalJobState, int)>& callback) {
+        m_state_callback = callback;
+    }
+
+private:
+    struct Entry {
+        LocalJob job;
+        LocalJobState state = LocalJobState::Queued;
+#if defined(_WIN32)
+        // the job object holds the process and everything it starts
+        void* job_object = nullptr;
+        void* process = nullptr;
+#else
+        // also the process group of the job
+        pid_t pid = -1;
+#endif
+        int exit_code = -1;
+    };
+
+    // stops the process of a started job, nothing otherwise
+    static void terminate(Entry& entry);
+    void run_job(int job_id);
+    void fail_job(int job_id, std::exception_ptr error);
+    void set_state(int job_id, LocalJobState state);
+
+    CoreAllocator m_allocator;
+    std::mutex m_mutex;
+    std::map<int, Entry> m_jobs;
+    int m_next_id = 0;
+    std::function<void(int, LocalJobState, int)> m_state_callback;
+    // declared last, its workers are joined before the rest goes away
+    std::unique_ptr<WorkStealingPool> m_pool;
+};
+
+#endif // CALC_LOCAL_EXECUTOR_H
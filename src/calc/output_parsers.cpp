@@ -0,0 +1,163 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "calc/output_parsers.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+
+namespace {
+
+bool starts_with(const std::string& line, const char* prefix) {
+    return 0 == line.compare(0, std::strlen(prefix), prefix);
+}
+
+// the first number after the first '=' or '<' past the key
+bool value_after(const std::string& line, const char* key, char separator, double& value) {
+    const auto key_pos = line.find(key);
+    if (std::string::npos == key_pos) {
+        return false;
+    }
+    const auto separator_pos = line.find(separator, key_pos + std::strlen(key));
+    if (std::string::npos == separator_pos) {
+        return false;
+    }
+    const char* begin = line.c_str() + separator_pos + 1;
+    char* end = nullptr;
+    value = std::strtod(begin, &end);
+    return end != begin;
+}
+
+} // namespace
+
+void IncrementalParser::feed(const char* data, std::size_t length) {
+    const char* end = data + length;
+    while (data < end) {
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', end - data));
+        if (nullptr == newline) {
+            m_partial_line.append(data, end);
+            return;
+        }
+        if (m_partial_line.empty()) {
+            this->parse_line(std::string(data, newline));
+        } else {
+            m_partial_line.append(data, newline);
+            this->parse_line(m_partial_line);
+            m_partial_line.clear();
+        }
+        data = newline + 1;
+    }
+}
+
+void IncrementalParser::reset() {
+    m_data = ConvergenceData();
+    m_partial_line.clear();
+}
+
+void QeOutputParser::parse_line(const std::string& line) {
+    double value = 0;
+    if (starts_with(line, "!")) {
+        if (value_after(line, "total energy", '=', value)) {
+            m_data.ionic_energy.push_back(value);
+        }
+    } else if (std::string::npos != line.find("total energy") && value_after(line, "total energy", '=', value)) {
+        // the intermediate "total energy" lines of the scf cycle
+        if (std::string::npos == line.find("The total energy")) {
+            m_data.scf_energy.push_back(value);
+        }
+    } else if (value_after(line, "estimated scf accuracy", '<', value)) {
+        m_data.scf_change.push_back(value);
+    } else if (value_after(line, "Total force", '=', value)) {
+        m_data.force.push_back(value);
+    } else if (std::string::npos != line.find("total   stress") && value_after(line, "P", '=', value)) {
+        m_data.pressure.push_back(value);
+    } else if (std::string::npos != line.find("highest occupied, lowest unoccupied level")) {
+        // "     highest occupied, lowest unoccupied level (ev):     6.2455    6.8533"
+        const char* begin = line.c_str() + line.find(':') + 1;
+        char* end = nullptr;
+        const double homo = std::strtod(begin, &end);
+        begin = end;
+        const double lumo = std::strtod(begin, &end);
+        if (end != begin) {
+            m_data.band_gap.push_back(lumo - homo);
+        }
+    }
+}
+
+void VaspOszicarParser::parse_line(const std::string& line) {
+    // DAV:   3    -0.427E+02   -0.158E+00   -0.153E+01  5016   0.137E+01
+    if (starts_with(line, "DAV:") || starts_with(line, "RMM:") || starts_with(line, "CG :") || starts_with(line, "DIA:")) {
+        const char* cursor = line.c_str() + 4;
+        char* end = nullptr;
+        std::strtol(cursor, &end, 10);
+        cursor = end;
+        const double energy = std::strtod(cursor, &end);
+        if (end == cursor) {
+            return;
+        }
+        cursor = end;
+        const double change = std::strtod(cursor, &end);
+        m_data.scf_energy.push_back(energy);
+        m_data.scf_change.push_back(std::fabs(change));
+        return;
+    }
+    //    1 F= -.42741697E+02 E0= -.42741697E+02  d E =-.427417E+02
+    double value = 0;
+    if (std::string::npos != line.find(" F=") && value_after(line, " F", '=', value)) {
+        m_data.ionic_energy.push_back(value);
+    }
+}
+
+void VaspOutcarParser::parse_line(const std::string& line) {
+    double value = 0;
+    // every electronic step: "  free energy    TOTEN  =" and the change
+    // in "  total energy-change (2. order) :"; the ionic step ends with
+    // "  free  energy   TOTEN  =" (two spaces between free and energy)
+    if (std::string::npos != line.find("free energy    TOTEN") && value_after(line, "TOTEN", '=', value)) {
+        m_data.scf_energy.push_back(value);
+    } else if (std::string::npos != line.find("free  energy   TOTEN") && value_after(line, "TOTEN", '=', value)) {
+        m_data.ionic_energy.push_back(value);
+    } else if (value_after(line, "total energy-change (2. order)", ':', value)) {
+        m_data.scf_change.push_back(std::fabs(value));
+    } else if (value_after(line, "external pressure", '=', value)) {
+        m_data.pressure.push_back(value);
+    } else if (std::string::npos != line.find("FORCES: max atom, RMS")) {
+        // "  FORCES: max atom, RMS     0.123456    0.045678"
+        const char* begin = line.c_str() + line.find("RMS") + 3;
+        char* end = nullptr;
+        value = std::strtod(begin, &end);
+        if (end != begin) {
+            m_data.force.push_back(value);
+        }
+    }
+}
+
+std::unique_ptr<IncrementalParser> make_output_parser(const std::string& file_path) {
+    const auto name = boost::filesystem::path(file_path).filename().string();
+    if (std::string::npos != name.find("OSZICAR")) {
+        return std::make_unique<VaspOszicarParser>();
+    } else if (std::string::npos != name.find("OUTCAR")) {
+        return std::make_unique<VaspOutcarParser>();
+    }
+    return std::make_unique<QeOutputParser>();
+}
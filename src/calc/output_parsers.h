@@ -0,0 +1,88 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Parsers for the output of running calculations, fed chunk by chunk.
+///
+/// A chunk may end in the middle of a line; the incomplete line is kept
+/// until the next chunk arrives. The parser state carries over between
+/// chunks, so every byte of the output is parsed exactly once.
+
+#ifndef CALC_OUTPUT_PARSERS_H
+#define CALC_OUTPUT_PARSERS_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ConvergenceData {
+    // one entry per electronic step
+    std::vector<double> scf_energy;
+    // |dE| or the estimated accuracy of the step
+    std::vector<double> scf_change;
+    // one entry per finished ionic step
+    std::vector<double> ionic_energy;
+    // the force the code reports for the ionic step: max atom or total
+    std::vector<double> force;
+    // kbar, whenever the stress is printed
+    std::vector<double> pressure;
+    // eV, HOMO-LUMO gap of insulators as printed by pw.x
+    std::vector<double> band_gap;
+};
+
+class IncrementalParser {
+public:
+    virtual ~IncrementalParser() = default;
+
+    void feed(const char* data, std::size_t length);
+    virtual void reset();
+
+    const ConvergenceData& get_data() const {
+        return m_data;
+    }
+
+protected:
+    virtual void parse_line(const std::string& line) = 0;
+
+    ConvergenceData m_data;
+
+private:
+    std::string m_partial_line;
+};
+
+/// pw.x of Quantum ESPRESSO
+class QeOutputParser : public IncrementalParser {
+protected:
+    void parse_line(const std::string& line) override;
+};
+
+class VaspOszicarParser : public IncrementalParser {
+protected:
+    void parse_line(const std::string& line) override;
+};
+
+class VaspOutcarParser : public IncrementalParser {
+protected:
+    void parse_line(const std::string& line) override;
+};
+
+// chosen by the file name: OSZICAR, OUTCAR, else pw.x output
+std::unique_ptr<IncrementalParser> make_output_parser(const std::string& file_path);
+
+#endif // CALC_OUTPUT_PARSERS_H
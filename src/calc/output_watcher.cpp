@@ -0,0 +1,74 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "calc/output_watcher.h"
+
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrent>
+
+#include "utils/logger.h"
+
+OutputWatcher::OutputWatcher(const SshEndpoint& endpoint, const std::string& remote_path, QObject* parent)
+    : QObject{parent} {
+    m_tail = std::make_shared<RemoteTail>(endpoint, remote_path);
+    m_parser = make_output_parser(remote_path);
+    m_timer = new QTimer(this);
+    m_timer->setInterval(2000);
+    QObject::connect(m_timer, &QTimer::timeout, this, &OutputWatcher::poll);
+    m_timer->start();
+    this->poll();
+}
+
+void OutputWatcher::poll() {
+    // the tail is used by one thread at a time, a slow read delays the
+    // next poll instead of stacking up
+    if (true == m_polling) {
+        return;
+    }
+    m_polling = true;
+    auto tail = m_tail;
+    auto watcher = new QFutureWatcher<Chunk>(this);
+    QObject::connect(watcher, &QFutureWatcher<Chunk>::finished, this, [this, watcher]() {
+        m_polling = false;
+        this->on_chunk(watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run([tail]() {
+        Chunk chunk;
+        try {
+            chunk.data = tail->read_new(chunk.reset);
+        } catch (const SshError& e) {
+            LOG_WARNING("%s", e.what());
+        }
+        return chunk;
+    }));
+}
+
+void OutputWatcher::on_chunk(const Chunk& chunk) {
+    if (true == chunk.reset) {
+        m_parser->reset();
+    }
+    if (chunk.data.empty() && false == chunk.reset) {
+        return;
+    }
+    m_parser->feed(chunk.data.data(), chunk.data.size());
+    emit this->text_appended(QString::fromStdString(chunk.data), chunk.reset);
+    emit this->data_changed(m_parser->get_data());
+}
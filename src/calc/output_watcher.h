@@ -0,0 +1,71 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Live view of the output of a running calculation.
+///
+/// Polls a RemoteTail on a worker thread and feeds only the new bytes to
+/// an incremental parser, so a refresh costs the size of the appended
+/// output rather than of the whole file.
+
+#ifndef CALC_OUTPUT_WATCHER_H
+#define CALC_OUTPUT_WATCHER_H
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include <memory>
+#include <string>
+
+#include "calc/output_parsers.h"
+#include "remote/remote_tail.h"
+
+class OutputWatcher : public QObject {
+    Q_OBJECT
+public:
+    OutputWatcher(const SshEndpoint& endpoint, const std::string& remote_path, QObject* parent = nullptr);
+
+    void set_interval(int milliseconds) {
+        m_timer->setInterval(milliseconds);
+    }
+
+public slots:
+    void poll();
+
+signals:
+    // reset: the file was restarted, the text starts from the beginning
+    void text_appended(const QString& text, bool reset);
+    void data_changed(const ConvergenceData& data);
+
+private:
+    struct Chunk {
+        std::string data;
+        bool reset = false;
+    };
+
+    void on_chunk(const Chunk& chunk);
+
+    std::shared_ptr<RemoteTail> m_tail;
+    std::unique_ptr<IncrementalParser> m_parser;
+    QTimer* m_timer;
+    bool m_polling = false;
+};
+
+#endif // CALC_OUTPUT_WATCHER_H
@@ -60,15 +60,30 @@ RightZone::RightZone(QWidget *parent) : QWidget{parent} {
     tab_2->setObjectName(QString::fromUtf8("tab_2"));
     tab_widget->addTab(tab_2, QString());
 
+    this->m_convergence_plot = new ConvergencePlot(tab_widget);
+    tab_widget->addTab(this->m_convergence_plot, QObject::tr("Convergence"));
+    this->m_convergence_plot->setObjectName(QString::fromUtf8("convergence_plot"));
+
     tab_widget->setTabText(tab_widget->indexOf(tab_1), QCoreApplication::translate("Atoms3DTools", "Tab 1", nullptr));
     tab_widget->setTabText(tab_widget->indexOf(tab_2), QCoreApplication::translate("Atoms3DTools", "Tab 2", nullptr));
     tab_widget->setCurrentIndex(0);
 
-    auto text_browser = new QTextBrowser(this);
-    vertical_layout->addWidget(text_browser);
-    text_browser->setObjectName(QString::fromUtf8("text_browser"));
-    text_browser->setMinimumSize(800, 600);
-    text_browser->setText(QObject::tr(
+    this->m_text_browser = new QTextBrowser(this);
+    vertical_layout->addWidget(this->m_text_browser);
+    this->m_text_browser->setObjectName(QString::fromUtf8("text_browser"));
+    this->m_text_browser->setMinimumSize(800, 600);
+    // the live output keeps the last lines only
+    this->m_text_browser->document()->setMaximumBlockCount(5000);
+    this->m_text_browser->setText(QObject::tr(
 "provide really powerful controlling of the calculation workflow"
     ));
 }
+
+void RightZone::append_output(const QString& text, bool reset) {
+    if (true == reset) {
+        this->m_text_browser->clear();
+    }
+    this->m_text_browser->moveCursor(QTextCursor::End);
+    this->m_text_browser->insertPlainText(text);
+    this->m_text_browser->moveCursor(QTextCursor::End);
+}
@@ -33,11 +33,19 @@
 #include <QtWidgets/QVBoxLayout>
 #include <QtWidgets/QWidget>
 
+#include "calc/convergence_plot.h"
+
 class RightZone : public QWidget {
     Q_OBJECT
 public:
     explicit RightZone(QWidget *parent = nullptr);
 
+    QTextBrowser* m_text_browser;
+    ConvergencePlot* m_convergence_plot;
+
+public slots:
+    void append_output(const QString& text, bool reset);
+
 signals:
 
 };
@@ -0,0 +1,454 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "calc/workflow.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/algorithm/string/replace.hpp>
+#include <boost/filesystem.hpp>
+#include <yaml-cpp/yaml.h>
+
+#include "utils/hash.h"
+#include "utils/logger.h"
+#include "utils/trace.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+struct StepTemplate {
+    WorkflowStep step;
+    std::vector<std::pair<std::string, std::vector<std::string>>> sweep;
+};
+
+std::vector<std::string> string_list(const YAML::Node& node) {
+    std::vector<std::string> values;
+    if (!node) {
+        return values;
+    } else if (node.IsScalar()) {
+        values.push_back(node.as<std::string>());
+    } else if (node.IsSequence()) {
+        for (const auto& item : node) {
+            values.push_back(item.as<std::string>());
+        }
+    }
+    return values;
+}
+
+std::string substitute(std::string text, const std::map<std::string, std::string>& assignment) {
+    for (const auto& item : assignment) {
+        boost::algorithm::replace_all(text, "${" + item.first + "}", item.second);
+    }
+    return text;
+}
+
+// every combination of the sweep values
+std::vector<std::map<std::string, std::string>> sweep_points(const StepTemplate& step_template) {
+    std::vector<std::map<std::string, std::string>> points(1);
+    for (const auto& axis : step_template.sweep) {
+        std::vector<std::map<std::string, std::string>> expanded;
+        for (const auto& point : points) {
+            for (const auto& value : axis.second) {
+                auto next = point;
+                next[axis.first] = value;
+                expanded.push_back(next);
+            }
+        }
+        points.swap(expanded);
+    }
+    return points;
+}
+
+bool consistent(const std::map<std::string, std::string>& lhs, const std::map<std::string, std::string>& rhs) {
+    for (const auto& item : lhs) {
+        auto found = rhs.find(item.first);
+        if (rhs.end() != found && found->second != item.second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+Workflow load_workflow(const std::string& path) {
+    TRACE_SCOPE_CAT("load_workflow", "calc");
+    const auto base_dir = fs::absolute(fs::path(path)).parent_path();
+    YAML::Node root;
+    try {
+        root = YAML::LoadFile(path);
+    } catch (const YAML::Exception& e) {
+        throw std::runtime_error("can not read workflow " + path + ": " + e.what());
+    }
+    Workflow workflow;
+    workflow.name = root["name"] ? root["name"].as<std::string>() : fs::path(path).stem().string();
+
+    std::vector<StepTemplate> templates;
+    for (const auto& node : root["steps"]) {
+        StepTemplate step_template;
+        auto& step = step_template.step;
+        if (!node["name"] || !node["command"]) {
+            throw std::runtime_error("every workflow step needs a name and a command");
+        }
+        step.name = node["name"].as<std::string>();
+        step.command = node["command"].as<std::string>();
+        step.workdir = node["workdir"] ? node["workdir"].as<std::string>() : step.name;
+        step.inputs = string_list(node["inputs"]);
+        step.outputs = string_list(node["outputs"]);
+        step.depends = string_list(node["depends"]);
+        step.cores = node["cores"] ? node["cores"].as<int>() : 1;
+        if (node["sweep"]) {
+            for (const auto& axis : node["sweep"]) {
+                step_template.sweep.emplace_back(axis.first.as<std::string>(), string_list(axis.second));
+            }
+        }
+        templates.push_back(step_template);
+    }
+
+    // name of the template -> its expansions with their sweep points
+    std::map<std::string, std::vector<std::pair<std::string, std::map<std::string, std::string>>>> expansions;
+    for (const auto& step_template : templates) {
+        if (expansions.count(step_template.step.name)) {
+            throw std::runtime_error("duplicate workflow step " + step_template.step.name);
+        }
+        auto& names = expansions[step_template.step.name];
+        for (const auto& point : sweep_points(step_template)) {
+            std::string name = step_template.step.name;
+            if (false == point.empty()) {
+                std::string suffix;
+                for (const auto& item : point) {
+                    suffix += (suffix.empty() ? "" : ",") + item.first + "=" + item.second;
+                }
+                name += "[" + suffix + "]";
+            }
+            names.emplace_back(name, point);
+        }
+    }
+
+    for (const auto& step_template : templates) {
+        for (const auto& expansion : expansions[step_template.step.name]) {
+            const auto& point = expansion.second;
+            WorkflowStep step = step_template.step;
+            step.name = expansion.first;
+            step.command = substitute(step.command, point);
+            step.workdir = (base_dir / substitute(step.workdir, point)).lexically_normal().string();
+            for (auto& input : step.inputs) {
+                input = substitute(input, point);
+            }
+            for (auto& output : step.outputs) {
+                output = substitute(output, point);
+            }
+            // a swept dependency is matched on the sweep keys both share
+            step.depends.clear();
+            for (const auto& dependency : step_template.step.depends) {
+                auto found = expansions.find(dependency);
+                if (expansions.end() == found) {
+                    throw std::runtime_error("step " + step_template.step.name + " depends on unknown step " + dependency);
+                }
+                for (const auto& dependency_expansion : found->second) {
+                    if (consistent(point, dependency_expansion.second)) {
+                        step.depends.push_back(dependency_expansion.first);
+                    }
+                }
+            }
+            workflow.steps.push_back(step);
+        }
+    }
+
+    // Kahn's algorithm, only to reject cycles before anything runs
+    std::map<std::string, int> nwaiting;
+    std::map<std::string, std::vector<std::string>> dependents;
+    for (const auto& step : workflow.steps) {
+        nwaiting[step.name] = static_cast<int>(step.depends.size());
+        for (const auto& dependency : step.depends) {
+            dependents[dependency].push_back(step.name);
+        }
+    }
+    std::vector<std::string> ready;
+    for (const auto& item : nwaiting) {
+        if (0 == item.second) {
+            ready.push_back(item.first);
+        }
+    }
+    std::size_t nvisited = 0;
+    while (false == ready.empty()) {
+        const auto name = ready.back();
+        ready.pop_back();
+        nvisited++;
+        for (const auto& dependent : dependents[name]) {
+            if (0 == --nwaiting[dependent]) {
+                ready.push_back(dependent);
+            }
+        }
+    }
+    if (nvisited != workflow.steps.size()) {
+        throw std::runtime_error("workflow " + workflow.name + " has a dependency cycle");
+    }
+    return workflow;
+}
+
+const char* step_state_name(StepState state) {
+    switch (state) {
+    case StepState::Waiting:
+        return "WAITING";
+    case StepState::Running:
+        return "RUNNING";
+    case StepState::Done:
+        return "DONE";
+    case StepState::Cached:
+        return "CACHED";
+    case StepState::Failed:
+        return "FAILED";
+    case StepState::Skipped:
+    default:
+        return "SKIPPED";
+    }
+}
+
+WorkflowScheduler::WorkflowScheduler(const std::string& memo_dir, const Launcher& launcher)
+    : m_memo_dir{memo_dir}, m_launcher{launcher} {
+    fs::create_directories(fs::path(m_memo_dir) / "objects");
+    fs::create_directories(fs::path(m_memo_dir) / "steps");
+}
+
+std::string WorkflowScheduler::step_key(const WorkflowStep& step) {
+    Sha256 sha256;
+    sha256.update(step.command).update("\n", 1);
+    auto inputs = step.inputs;
+    std::sort(inputs.begin(), inputs.end());
+    for (const auto& input : inputs) {
+        // normalized first, the workdir may not exist yet
+        const auto input_path = (fs::path(step.workdir) / input).lexically_normal();
+        sha256.update(input).update(" ", 1);
+        sha256.update(fs::exists(input_path) ? Sha256::of_file(input_path.string()) : std::string("missing"));
+        sha256.update("\n", 1);
+    }
+    // the same command declaring other outputs stores other files
+    for (const auto& output : step.outputs) {
+        sha256.update("> ", 2).update(output).update("\n", 1);
+    }
+    std::vector<std::string> dependency_keys;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& dependency : step.depends) {
+            dependency_keys.push_back(m_keys[m_index_of[dependency]]);
+        }
+    }
+    std::sort(dependency_keys.begin(), dependency_keys.end());
+    for (const auto& key : dependency_keys) {
+        sha256.update(key).update("\n", 1);
+    }
+    return sha256.hex_digest();
+}
+
+bool WorkflowScheduler::restore_outputs(const WorkflowStep& step, const std::string& key) {
+    if (step.outputs.empty()) {
+        return false;
+    }
+    std::ifstream record((fs::path(m_memo_dir) / "steps" / key).string());
+    if (false == record.good()) {
+        return false;
+    }
+    std::string output;
+    std::string digest;
+    std::vector<std::pair<std::string, std::string>> outputs;
+    while (record >> std::quoted(output) >> digest) {
+        outputs.emplace_back(output, digest);
+    }
+    try {
+        for (const auto& item : outputs) {
+            if (false == fs::exists(fs::path(m_memo_dir) / "objects" / item.second)) {
+                return false;
+            }
+        }
+        for (const auto& item : outputs) {
+            const auto target = fs::path(step.workdir) / item.first;
+            if (fs::exists(target) && Sha256::of_file(target.string()) == item.second) {
+                continue;
+            }
+            fs::create_directories(target.parent_path());
+            fs::copy_file(fs::path(m_memo_dir) / "objects" / item.second, target, fs::copy_options::overwrite_existing);
+        }
+    } catch (const std::exception& e) {
+        // the step runs again and overwrites what was restored
+        LOG_WARNING("can not restore the outputs of %s: %s", step.name.c_str(), e.what());
+        return false;
+    }
+    return true;
+}
+
+void WorkflowScheduler::store_outputs(const WorkflowStep& step, const std::string& key) {
+    if (step.outputs.empty()) {
+        return;
+    }
+    // a step that is not memoized only runs again next time, a failure
+    // here does not fail it
+    try {
+        std::ostringstream record;
+        for (const auto& output : step.outputs) {
+            const auto source = fs::path(step.workdir) / output;
+            if (false == fs::exists(source)) {
+                LOG_WARNING("step %s did not produce %s", step.name.c_str(), output.c_str());
+                return;
+            }
+            const auto digest = Sha256::of_file(source.string());
+            const auto object = fs::path(m_memo_dir) / "objects" / digest;
+            // copied, not linked: a rerun truncating the output in place
+            // would change the stored object as well
+            if (false == fs::exists(object)) {
+                fs::copy_file(source, object, fs::copy_options::overwrite_existing);
+            }
+            record << std::quoted(output) << " " << digest << "\n";
+        }
+        const auto record_path = fs::path(m_memo_dir) / "steps" / key;
+        const auto tmp = record_path.string() + ".tmp";
+        std::ofstream(tmp) << record.str();
+        fs::rename(tmp, record_path);
+    } catch (const std::exception& e) {
+        LOG_WARNING("can not memoize the outputs of %s: %s", step.name.c_str(), e.what());
+    }
+}
+
+bool WorkflowScheduler::run(const Workflow& workflow) {
+    TRACE_SCOPE_CAT("WorkflowScheduler::run", "calc");
+    const int nstep = static_cast<int>(workflow.steps.size());
+    std::vector<int> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_workflow = &workflow;
+        m_index_of.clear();
+        for (int i = 0; i < nstep; i++) {
+            m_index_of[workflow.steps[i].name] = i;
+        }
+        m_dependents.assign(nstep, {});
+        m_nwaiting.assign(nstep, 0);
+        m_states.assign(nstep, StepState::Waiting);
+        m_keys.assign(nstep, std::string());
+        m_nfinished = 0;
+        for (int i = 0; i < nstep; i++) {
+            for (const auto& dependency : workflow.steps[i].depends) {
+                m_dependents[m_index_of[dependency]].push_back(i);
+                m_nwaiting[i]++;
+            }
+            if (0 == m_nwaiting[i]) {
+                ready.push_back(i);
+            }
+        }
+    }
+    for (const int index : ready) {
+        this->start_step(index);
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished.wait(lock, [this, nstep]() {
+        return m_nfinished == nstep;
+    });
+    m_workflow = nullptr;
+    return std::none_of(m_states.begin(), m_states.end(), [](StepState state) {
+        return StepState::Failed == state || StepState::Skipped == state;
+    });
+}
+
+void WorkflowScheduler::start_step(int index) {
+    const auto& step = m_workflow->steps[index];
+    // called from the threads finishing other steps as well, anything
+    // thrown here fails the step instead of leaving run() waiting
+    std::string key;
+    try {
+        key = this->step_key(step);
+        fs::create_directories(step.workdir);
+    } catch (const std::exception& e) {
+        LOG_ERROR("can not start %s: %s", step.name.c_str(), e.what());
+        this->finish_step(index, StepState::Failed);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_keys[index] = key;
+        m_states[index] = StepState::Running;
+    }
+    if (true == this->restore_outputs(step, key)) {
+        this->finish_step(index, StepState::Cached);
+        return;
+    }
+    if (m_state_callback) {
+        m_state_callback(step, StepState::Running);
+    }
+    try {
+        m_launcher(step, [this, index, key](int exit_code) {
+            const auto& step = m_workflow->steps[index];
+            if (0 == exit_code) {
+                this->store_outputs(step, key);
+            }
+            this->finish_step(index, 0 == exit_code ? StepState::Done : StepState::Failed);
+        });
+    } catch (const std::exception& e) {
+        LOG_ERROR("can not launch %s: %s", step.name.c_str(), e.what());
+        this->finish_step(index, StepState::Failed);
+    }
+}
+
+void WorkflowScheduler::finish_step(int index, StepState state) {
+    std::vector<int> ready;
+    std::vector<int> skipped;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_states[index] = state;
+        if (StepState::Failed == state) {
+            // everything downstream of a failed step is skipped
+            std::vector<int> stack = m_dependents[index];
+            while (false == stack.empty()) {
+                const int dependent = stack.back();
+                stack.pop_back();
+                if (StepState::Waiting != m_states[dependent]) {
+                    continue;
+                }
+                m_states[dependent] = StepState::Skipped;
+                skipped.push_back(dependent);
+                stack.insert(stack.end(), m_dependents[dependent].begin(), m_dependents[dependent].end());
+            }
+        } else {
+            for (const int dependent : m_dependents[index]) {
+                if (0 == --m_nwaiting[dependent] && StepState::Waiting == m_states[dependent]) {
+                    ready.push_back(dependent);
+                }
+            }
+        }
+    }
+    if (m_state_callback) {
+        m_state_callback(m_workflow->steps[index], state);
+        for (const int dependent : skipped) {
+            m_state_callback(m_workflow->steps[dependent], StepState::Skipped);
+        }
+    }
+    for (const int dependent : ready) {
+        this->start_step(dependent);
+    }
+    // counted last, run() may return as soon as the count is complete
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_nfinished += 1 + static_cast<int>(skipped.size());
+    }
+    m_finished.notify_all();
+}
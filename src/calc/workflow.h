@@ -0,0 +1,132 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Workflows of dependent calculation steps, described in YAML:
+///
+///     name: si-bands
+///     steps:
+///       - name: relax
+///         workdir: relax
+///         command: pw.x -in relax.in > relax.out
+///         inputs: [relax.in, Si.pbe-n-kjpaw_psl.1.0.0.UPF]
+///         outputs: [relax.out]
+///         cores: 4
+///       - name: scf
+///         depends: [relax]
+///         workdir: scf-${ecut}
+///         sweep: {ecut: [30, 40, 50]}
+///         command: ...
+///
+/// A step with a sweep is expanded into one step per value, ${key} in
+/// workdir and command is replaced; steps depending on it depend on all
+/// expansions. Independent steps are dispatched in parallel.
+///
+/// Every step is keyed by the SHA-256 of its command, the content of its
+/// input files, its output names and the keys of the steps it depends on.
+/// After a step succeeded its outputs are stored by content in the memo
+/// directory, and a later run with the same key restores them instead of
+/// running the step again. Steps without outputs have nothing to restore
+/// and always run.
+
+#ifndef CALC_WORKFLOW_H
+#define CALC_WORKFLOW_H
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct WorkflowStep {
+    std::string name;
+    std::string command;
+    // absolute, resolved against the directory of the workflow file
+    std::string workdir;
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+    std::vector<std::string> depends;
+    int cores = 1;
+};
+
+struct Workflow {
+    std::string name;
+    std::vector<WorkflowStep> steps;
+};
+
+// throws std::runtime_error on malformed files, unknown dependencies
+// and cycles
+Workflow load_workflow(const std::string& path);
+
+enum class StepState {
+    Waiting,
+    Running,
+    Done,
+    // restored from the memo directory
+    Cached,
+    Failed,
+    // a dependency failed
+    Skipped,
+};
+
+const char* step_state_name(StepState state);
+
+class WorkflowScheduler {
+public:
+    // starts the step in its existing workdir and calls done with the
+    // exit code, from any thread
+    using Launcher = std::function<void(const WorkflowStep& step, std::function<void(int)> done)>;
+
+    WorkflowScheduler(const std::string& memo_dir, const Launcher& launcher);
+
+    void set_state_callback(const std::function<void(const WorkflowStep&, StepState)>& callback) {
+        m_state_callback = callback;
+    }
+
+    // blocks until every step is finished, true if none failed
+    bool run(const Workflow& workflow);
+
+    // the memo key of the step, valid once its dependencies are done
+    std::string step_key(const WorkflowStep& step);
+
+private:
+    void start_ready();
+    void start_step(int index);
+    void finish_step(int index, StepState state);
+    bool restore_outputs(const WorkflowStep& step, const std::string& key);
+    void store_outputs(const WorkflowStep& step, const std::string& key);
+
+    std::string m_memo_dir;
+    Launcher m_launcher;
+    std::function<void(const WorkflowStep&, StepState)> m_state_callback;
+
+    // state of the running workflow, guarded by m_mutex
+    std::mutex m_mutex;
+    std::condition_variable m_finished;
+    const Workflow* m_workflow = nullptr;
+    std::map<std::string, int> m_index_of;
+    std::vector<std::vector<int>> m_dependents;
+    std::vector<int> m_nwaiting;
+    std::vector<StepState> m_states;
+    std::vector<std::string> m_keys;
+    int m_nfinished = 0;
+};
+
+#endif // CALC_WORKFLOW_H
@@ -23,10 +23,13 @@
 #include <cstdlib>
 #include <boost/filesystem.hpp>
 
+#include "utils/trace.h"
+
 namespace fs = boost::filesystem;
 namespace pt = boost::property_tree;
 
 ConfigManager::ConfigManager() {
+    TRACE_SCOPE_CAT("ConfigManager::ConfigManager", "startup");
     this->home_dir = get_home_dir();
     this->config_dir = get_config_dir();
 
@@ -73,6 +76,7 @@ std::string ConfigManager::get_config_dir() {
 }
 
 void ConfigManager::init_json() {
+    TRACE_SCOPE_CAT("ConfigManager::init_json", "startup");
 
     if (false == fs::exists(fs::path(this->get_config_dir()) / "config.json")) {
         config_ptree.add("version", "0.0.0");
@@ -22,11 +22,26 @@
 #include <QShortcut>
 #include <QKeySequence>
 
+#include <cstring>
+
+#include "batch/batch.h"
 #include "main/mainwindow.h"
+#include "utils/startup_profiler.h"
 
 int main(int argc, char* argv[]) {
 
+    if (true == is_batch_mode(argc, argv)) {
+        return run_batch(argc, argv);
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (0 == std::strcmp(argv[i], "--startup-profile")) {
+            StartupProfiler::instance().enable();
+        }
+    }
+
     QApplication app(argc, argv);
+    StartupProfiler::instance().mark("QApplication");
 
     MainWindow main_win;
 
@@ -38,6 +53,7 @@ int main(int argc, char* argv[]) {
 
     main_win.show();
     main_win.resize(1920, 1080);
+    StartupProfiler::instance().mark("MainWindow shown");
 
     return app.exec();
 }
@@ -0,0 +1,113 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "main/curve_plot.h"
+
+#include <QPainter>
+#include <QPainterPath>
+
+#include <algorithm>
+#include <limits>
+
+#include "utils/decimation.h"
+
+CurvePlot::CurvePlot(QWidget* parent) : QWidget{parent} {
+    this->setMinimumSize(400, 300);
+    this->setAutoFillBackground(true);
+    this->setBackgroundRole(QPalette::Base);
+}
+
+void CurvePlot::set_titles(const QString& x_title, const QString& y_title) {
+    this->m_x_title = x_title;
+    this->m_y_title = y_title;
+    this->update();
+}
+
+void CurvePlot::set_curves(const std::vector<double>& x, const std::vector<std::pair<QString, std::vector<double>>>& curves) {
+    this->m_x = x;
+    this->m_curves = curves;
+    this->update();
+}
+
+void CurvePlot::paintEvent(QPaintEvent* event) {
+    Q_UNUSED(event);
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+    const QRectF rect = QRectF(this->rect()).adjusted(60, 24, -10, -30);
+    const QColor text_color = this->palette().color(QPalette::Text);
+    painter.setPen(text_color);
+    painter.drawRect(rect);
+    painter.drawText(QRectF(rect.left(), 4, rect.width(), 18), Qt::AlignLeft, this->m_y_title);
+    painter.drawText(QRectF(rect.left(), rect.bottom() + 12, rect.width(), 18), Qt::AlignHCenter, this->m_x_title);
+    if (this->m_x.size() < 2 || this->m_curves.empty()) {
+        return;
+    }
+
+    const double x_min = this->m_x.front();
+    const double x_max = this->m_x.back();
+    double y_min = std::numeric_limits<double>::max();
+    double y_max = std::numeric_limits<double>::lowest();
+    for (const auto& curve : this->m_curves) {
+        for (const double y : curve.second) {
+            y_min = std::min(y_min, y);
+            y_max = std::max(y_max, y);
+        }
+    }
+    if (y_max - y_min < 1.0e-12) {
+        y_min -= 0.5;
+        y_max += 0.5;
+    }
+    painter.drawText(QRectF(rect.left() - 58, rect.top(), 54, 16), Qt::AlignRight, QString::number(y_max, 'g', 4));
+    painter.drawText(QRectF(rect.left() - 58, rect.bottom() - 16, 54, 16), Qt::AlignRight, QString::number(y_min, 'g', 4));
+    painter.drawText(QRectF(rect.left(), rect.bottom() + 2, 80, 16), Qt::AlignLeft, QString::number(x_min, 'g', 4));
+    painter.drawText(QRectF(rect.right() - 80, rect.bottom() + 2, 80, 16), Qt::AlignRight, QString::number(x_max, 'g', 4));
+
+    static const Qt::GlobalColor colors[] = {
+        Qt::darkBlue, Qt::red, Qt::darkGreen, Qt::magenta, Qt::darkCyan, Qt::darkYellow, Qt::gray, Qt::darkRed
+    };
+    const int ncolor = sizeof(colors) / sizeof(colors[0]);
+    for (std::size_t c = 0; c < this->m_curves.size(); c++) {
+        const auto& values = this->m_curves[c].second;
+        const std::size_t npoint = std::min(values.size(), this->m_x.size());
+        // long curves are drawn from the extremes of each pixel column
+        std::vector<double> xs;
+        std::vector<double> ys;
+        decimate_min_max(this->m_x.data(), values.data(), npoint, std::max(1, static_cast<int>(rect.width())), xs, ys);
+        QPainterPath path;
+        for (std::size_t i = 0; i < xs.size(); i++) {
+            const QPointF point(
+                rect.left() + (xs[i] - x_min) / (x_max - x_min) * rect.width(),
+                rect.bottom() - (ys[i] - y_min) / (y_max - y_min) * rect.height()
+            );
+            if (0 == i) {
+                path.moveTo(point);
+            } else {
+                path.lineTo(point);
+            }
+        }
+        const QColor color(colors[c % ncolor]);
+        painter.setPen(QPen(color, 1.5));
+        painter.drawPath(path);
+        const QRectF legend(rect.right() - 110, rect.top() + 4 + 16 * c, 100, 16);
+        painter.drawLine(QPointF(legend.left(), legend.center().y()), QPointF(legend.left() + 20, legend.center().y()));
+        painter.setPen(text_color);
+        painter.drawText(legend.adjusted(24, 0, 0, 0), Qt::AlignLeft | Qt::AlignVCenter, this->m_curves[c].first);
+    }
+}
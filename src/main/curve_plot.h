@@ -0,0 +1,50 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef MAIN_CURVE_PLOT_H
+#define MAIN_CURVE_PLOT_H
+
+#include <QString>
+#include <QWidget>
+
+#include <utility>
+#include <vector>
+
+/// Several named curves over a common x axis, with a legend.
+class CurvePlot : public QWidget {
+    Q_OBJECT
+public:
+    explicit CurvePlot(QWidget* parent = nullptr);
+
+    void set_titles(const QString& x_title, const QString& y_title);
+    // every curve has one value per x
+    void set_curves(const std::vector<double>& x, const std::vector<std::pair<QString, std::vector<double>>>& curves);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    std::vector<double> m_x;
+    std::vector<std::pair<QString, std::vector<double>>> m_curves;
+    QString m_x_title;
+    QString m_y_title;
+};
+
+#endif // MAIN_CURVE_PLOT_H
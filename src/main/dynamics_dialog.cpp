@@ -0,0 +1,256 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "main/dynamics_dialog.h"
+
+#include <QApplication>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QPointer>
+#include <QVBoxLayout>
+#include <QtConcurrent/QtConcurrent>
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include <atomsciflow/base/atomic_radius.h>
+
+#include "analysis/bonds.h"
+#include "analysis/molecules.h"
+#include "analysis/rdf.h"
+#include "analysis/trajectory.h"
+#include "utils/logger.h"
+
+namespace {
+
+// A, cut to half the cell width of small cells
+const double kRdfMaxRadius = 10.0;
+const int kRdfBins = 200;
+// A^2/fs in 1e-5 cm^2/s
+const double kDiffusionUnit = 1.0e4;
+
+} // namespace
+
+DynamicsDialog::DynamicsDialog(const QString& path, QWidget* parent)
+    : QDialog{parent}, m_cancelled{std::make_shared<std::atomic<bool>>(false)} {
+    this->setWindowTitle(tr("Dynamics - %1").arg(QFileInfo(path).fileName()));
+    this->resize(900, 600);
+    auto layout = new QVBoxLayout(this);
+    this->m_label = new QLabel(this);
+    layout->addWidget(this->m_label);
+    this->m_label->setText(tr("Reading %1").arg(path));
+    this->m_progress_bar = new QProgressBar(this);
+    layout->addWidget(this->m_progress_bar);
+    this->m_tab_widget = new QTabWidget(this);
+    layout->addWidget(this->m_tab_widget);
+    auto energy_widget = new QWidget(this->m_tab_widget);
+    this->m_tab_widget->addTab(energy_widget, tr("Energy"));
+    auto energy_layout = new QVBoxLayout(energy_widget);
+    this->m_energy_plot = new PlotWidget(energy_widget);
+    energy_layout->addWidget(this->m_energy_plot);
+    this->m_energy_plot->set_titles(tr("Frame"), tr("Energy (eV)"));
+    this->m_energy_plot->add_series(tr("energy"));
+    this->m_force_plot = new PlotWidget(energy_widget);
+    energy_layout->addWidget(this->m_force_plot);
+    this->m_force_plot->set_titles(tr("Frame"), tr("Max force (eV/A)"));
+    this->m_force_plot->add_series(tr("max force"));
+    this->m_rdf_plot = new CurvePlot(this->m_tab_widget);
+    this->m_tab_widget->addTab(this->m_rdf_plot, tr("RDF"));
+    this->m_rdf_plot->set_titles(tr("r (A)"), tr("g(r)"));
+    this->m_molecules_plot = new CurvePlot(this->m_tab_widget);
+    this->m_tab_widget->addTab(this->m_molecules_plot, tr("Molecules"));
+    this->m_molecules_plot->set_titles(tr("Frame"), tr("Molecules"));
+
+    auto msd_widget = new QWidget(this->m_tab_widget);
+    this->m_tab_widget->addTab(msd_widget, tr("MSD"));
+    auto msd_layout = new QVBoxLayout(msd_widget);
+    auto time_step_layout = new QHBoxLayout();
+    msd_layout->addLayout(time_step_layout);
+    time_step_layout->addWidget(new QLabel(tr("Time between frames (fs)"), msd_widget));
+    this->m_time_step_spin_box = new QDoubleSpinBox(msd_widget);
+    time_step_layout->addWidget(this->m_time_step_spin_box);
+    this->m_time_step_spin_box->setDecimals(3);
+    this->m_time_step_spin_box->setRange(0.001, 1.0e6);
+    this->m_time_step_spin_box->setValue(1.0);
+    time_step_layout->addStretch();
+    this->m_diffusion_label = new QLabel(msd_widget);
+    msd_layout->addWidget(this->m_diffusion_label);
+    this->m_diffusion_label->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    this->m_msd_plot = new CurvePlot(msd_widget);
+    msd_layout->addWidget(this->m_msd_plot);
+    this->m_msd_plot->set_titles(tr("t (fs)"), tr("MSD (A^2)"));
+    connect(this->m_time_step_spin_box, &QDoubleSpinBox::valueChanged, this, &DynamicsDialog::update_msd);
+
+    this->read_trajectory(path);
+}
+
+DynamicsDialog::~DynamicsDialog() {
+    this->m_cancelled->store(true);
+}
+
+void DynamicsDialog::read_trajectory(const QString& path) {
+    auto cancelled = this->m_cancelled;
+    QPointer<DynamicsDialog> dialog(this);
+    QtConcurrent::run([path, cancelled, dialog]() {
+        const auto start = std::chrono::steady_clock::now();
+        // appended to the plots with the progress
+        std::vector<double> energies;
+        std::vector<double> max_forces;
+        RdfAnalysis rdf(kRdfMaxRadius, kRdfBins);
+        RdfResult rdf_result;
+        MsdAnalysis msd;
+        MsdResult msd_result;
+        // molecules by frame, only the molecules whose bonds changed are
+        // re-clustered from one frame to the next
+        atomsciflow::AtomicRadius atomic_radius;
+        std::vector<double> radii;
+        MoleculeTracker molecule_tracker;
+        std::vector<double> molecule_counts;
+        FrameSpacing spacing;
+        int natom = 0;
+        std::size_t nframe = 0;
+        std::uint64_t file_size = 0;
+        QString error;
+        try {
+            TrajectoryReader reader(path.toStdString());
+            int last_percent = -1;
+            // the frames of a batch are binned in parallel, one per thread
+            const std::size_t batch_size = 2 * std::max(1u, std::thread::hardware_concurrency());
+            std::vector<Frame> batch;
+            nframe = reader.read([&](Frame& frame) {
+                natom = frame.natom();
+                msd.add_frame(frame);
+                if (radii.size() != reader.get_species_table().names.size()) {
+                    radii = species_radii(reader.get_species_table(), atomic_radius);
+                }
+                const auto bonds = detect_bonds(frame, radii);
+                if (true == molecule_counts.empty() || natom != molecule_tracker.get_natom()) {
+                    molecule_tracker.reset(natom, bonds);
+                } else {
+                    molecule_tracker.update(bonds);
+                }
+                molecule_counts.push_back(molecule_tracker.count());
+                spacing.add_frame(frame);
+                energies.push_back(frame.energy);
+                if (false == frame.forces.empty()) {
+                    double max_force = 0.0;
+                    for (std::size_t i = 0; i + 2 < frame.forces.size(); i += 3) {
+                        max_force = std::max(max_force, std::sqrt(
+                            frame.forces[i] * frame.forces[i] + frame.forces[i + 1] * frame.forces[i + 1] + frame.forces[i + 2] * frame.forces[i + 2]
+                        ));
+                    }
+                    max_forces.push_back(max_force);
+                }
+                batch.push_back(std::move(frame));
+                if (batch.size() >= batch_size) {
+                    rdf.add_frames(batch);
+                    batch.clear();
+                }
+                const int percent = static_cast<int>(100 * reader.get_bytes_read() / std::max<std::uint64_t>(1, reader.get_file_size()));
+                if (percent != last_percent) {
+                    last_percent = percent;
+                    QMetaObject::invokeMethod(qApp, [dialog, percent, energies, max_forces]() {
+                        if (nullptr != dialog) {
+                            dialog->m_progress_bar->setValue(percent);
+                            dialog->m_energy_plot->append(0, {}, energies);
+                            dialog->m_force_plot->append(0, {}, max_forces);
+                        }
+                    });
+                    energies.clear();
+                    max_forces.clear();
+                }
+                return false == cancelled->load();
+            });
+            rdf.add_frames(batch);
+            rdf_result = rdf.result(reader.get_species_table());
+            msd_result = msd.result(reader.get_species_table());
+            file_size = reader.get_file_size();
+        } catch (const std::exception& e) {
+            error = QString::fromStdString(e.what());
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double r_max = rdf.get_r_max();
+        QMetaObject::invokeMethod(qApp, [dialog, energies, max_forces, rdf_result, r_max, msd_result, molecule_counts, spacing, natom, nframe, file_size, seconds, error]() {
+            if (nullptr == dialog) {
+                return;
+            }
+            dialog->m_progress_bar->setValue(100);
+            dialog->m_energy_plot->append(0, {}, energies);
+            dialog->m_force_plot->append(0, {}, max_forces);
+            if (false == error.isEmpty()) {
+                dialog->m_label->setText(error);
+                LOG_ERROR("%s", qPrintable(error));
+                return;
+            }
+            QString text = tr("%1 frames of %2 atoms, %3 MB read in %4 s").arg(nframe).arg(natom)
+                .arg(file_size / 1.0e6, 0, 'f', 1).arg(seconds, 0, 'f', 2);
+            if (0.0 == spacing.get_time_step() && spacing.get_steps() > 0) {
+                text += tr(", frames %1 MD steps apart, set the time between them").arg(spacing.get_steps());
+            }
+            dialog->m_label->setText(text);
+            std::vector<std::pair<QString, std::vector<double>>> curves;
+            curves.emplace_back(tr("total"), rdf_result.g);
+            for (const auto& partial : rdf_result.partials) {
+                curves.emplace_back(QString::fromStdString(partial.first), partial.second);
+            }
+            dialog->m_rdf_plot->set_curves(rdf_result.r, curves);
+            dialog->m_rdf_plot->set_titles(tr("r (A), up to %1").arg(r_max, 0, 'f', 2),
+                tr("g(r) over %1 frames, %2 skipped as non-periodic or too small").arg(rdf_result.nframe).arg(rdf_result.nskipped));
+            std::vector<double> frames(molecule_counts.size());
+            for (std::size_t f = 0; f < frames.size(); f++) {
+                frames[f] = f;
+            }
+            dialog->m_molecules_plot->set_curves(frames, {{tr("molecules"), molecule_counts}});
+            dialog->m_msd_result = msd_result;
+            // without frame times the value set by the user is kept
+            const double time_step = spacing.get_time_step();
+            if (time_step > 0.0 && time_step != dialog->m_time_step_spin_box->value()) {
+                // updates the MSD through valueChanged
+                dialog->m_time_step_spin_box->setValue(time_step);
+            } else {
+                dialog->update_msd();
+            }
+        });
+    });
+}
+
+void DynamicsDialog::update_msd() {
+    const double time_step = this->m_time_step_spin_box->value();
+    const auto& result = this->m_msd_result;
+    std::vector<double> times(result.msd.size());
+    for (std::size_t m = 0; m < times.size(); m++) {
+        times[m] = m * time_step;
+    }
+    std::vector<std::pair<QString, std::vector<double>>> curves;
+    curves.emplace_back(tr("all"), result.msd);
+    QString text = tr("D (1e-5 cm^2/s), fitted over 10% to 50% of the longest lag:");
+    text += tr(" all %1").arg(fit_diffusion(result.msd, time_step).diffusion * kDiffusionUnit, 0, 'g', 4);
+    for (const auto& species : result.species_msd) {
+        const QString name = QString::fromStdString(species.first);
+        curves.emplace_back(name, species.second);
+        text += tr(", %1 %2").arg(name).arg(fit_diffusion(species.second, time_step).diffusion * kDiffusionUnit, 0, 'g', 4);
+    }
+    if (result.nskipped > 0) {
+        text += tr("; %1 frames with another number of atoms skipped").arg(result.nskipped);
+    }
+    this->m_diffusion_label->setText(text);
+    this->m_msd_plot->set_curves(times, curves);
+}
@@ -0,0 +1,70 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Analysis > Dynamics: reads a trajectory in the background and shows
+/// the energy, the largest force and the number of molecules of every
+/// frame, the radial distribution functions and the mean-squared
+/// displacement.
+
+#ifndef MAIN_DYNAMICS_DIALOG_H
+#define MAIN_DYNAMICS_DIALOG_H
+
+#include <QDialog>
+#include <QDoubleSpinBox>
+#include <QLabel>
+#include <QProgressBar>
+#include <QTabWidget>
+
+#include <atomic>
+#include <memory>
+
+#include "analysis/msd.h"
+#include "main/curve_plot.h"
+#include "main/plot_widget.h"
+
+class DynamicsDialog : public QDialog {
+    Q_OBJECT
+public:
+    DynamicsDialog(const QString& path, QWidget* parent = nullptr);
+    ~DynamicsDialog();
+
+private:
+    void read_trajectory(const QString& path);
+    // plots the MSD and fits the diffusion coefficients for the time step
+    void update_msd();
+
+    QLabel* m_label;
+    QProgressBar* m_progress_bar;
+    QTabWidget* m_tab_widget;
+    // filled while the trajectory is read
+    PlotWidget* m_energy_plot;
+    PlotWidget* m_force_plot;
+    CurvePlot* m_rdf_plot;
+    CurvePlot* m_molecules_plot;
+    CurvePlot* m_msd_plot;
+    // fs between frames
+    QDoubleSpinBox* m_time_step_spin_box;
+    QLabel* m_diffusion_label;
+    MsdResult m_msd_result;
+    // the reading stops when the dialog is closed
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+#endif // MAIN_DYNAMICS_DIALOG_H
@@ -20,12 +20,26 @@
 
 #include "main/mainwindow.h"
 
-#include <iostream>
 #include <QDebug>
+#include <QDialog>
+#include <QGridLayout>
+#include <QHeaderView>
+#include <QImage>
+#include <QInputDialog>
+#include <QLabel>
+#include <QTableWidget>
 #include <QSplitter>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QMessageBox>
+#include <QPointer>
 #include <QScreen>
+#include <QTimer>
+#include <QApplication>
+#include <QtConcurrent/QtConcurrent>
+
+#include <chrono>
+#include <map>
 
 #include <atomsciflow/base/crystal.h>
 
@@ -34,10 +48,20 @@
 #include "modeling_occ/modeling.h"
 #include "modeling_occ/modeling_tools.h"
 
+#include "analysis/molecules.h"
 #include "calc/calccontrol.h"
 #include "config/config_manager.h"
+#include "main/dynamics_dialog.h"
+#include "main/plot_dialog.h"
+#include "main/vdos_dialog.h"
+#include "results/results_store.h"
+#include "utils/logger.h"
+#include "utils/startup_profiler.h"
+#include "utils/trace.h"
 
 MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
+    TRACE_SCOPE_CAT("MainWindow::MainWindow", "startup");
+    StartupProfiler::instance().mark("ConfigManager");
 
     m_root_menubar = new QMenuBar(this);
     setMenuBar(m_root_menubar);
@@ -58,8 +82,15 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
     menu_file->addAction(action_file_open);
     action_file_open->setObjectName("Open");
     action_file_open->setText(tr("Open"));
-    action_file_open->setStatusTip("Open a project");
+    action_file_open->setStatusTip("Open a structure");
     action_file_open->setShortcuts(QKeySequence::Open);
+    QObject::connect(action_file_open, &QAction::triggered, this, &MainWindow::open_structure);
+    auto action_file_open_volumetric = new QAction(this->m_root_menubar);
+    menu_file->addAction(action_file_open_volumetric);
+    action_file_open_volumetric->setObjectName("Open Volumetric Data");
+    action_file_open_volumetric->setText(tr("Open Volumetric Data"));
+    action_file_open_volumetric->setStatusTip(tr("Open a CUBE or CHGCAR file and show its isosurfaces"));
+    QObject::connect(action_file_open_volumetric, &QAction::triggered, this, &MainWindow::open_volumetric);
     auto action_file_close = new QAction(this->m_root_menubar);
     menu_file->addAction(action_file_close);
     action_file_close->setObjectName(tr("Close"));
@@ -73,6 +104,14 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
     action_file_export_image->setObjectName(QObject::tr("Export Image"));
     action_file_export_image->setText("Export Image");
     QObject::connect(action_file_export_image, &QAction::triggered, this, &MainWindow::export_to_image);
+    if (true == Tracer::enabled()) {
+        auto action_file_export_trace = new QAction(this->m_root_menubar);
+        menu_file_export->addAction(action_file_export_trace);
+        action_file_export_trace->setObjectName(QObject::tr("Export Trace"));
+        action_file_export_trace->setText(tr("Export Trace"));
+        action_file_export_trace->setStatusTip(tr("Save the recorded spans as a Chrome trace"));
+        QObject::connect(action_file_export_trace, &QAction::triggered, this, &MainWindow::export_trace);
+    }
 
     auto menu_edit = new QMenu(m_root_menubar);
     this->m_root_menubar->addMenu(menu_edit);
@@ -120,6 +159,32 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
     menu_view_plots->addAction(action_view_plots_polar);
     action_view_plots_polar->setObjectName(tr("Polar"));
     action_view_plots_polar->setText(tr("Polar"));
+    action_view_plots_polar->setStatusTip(tr("Polar plot of the columns of a data file, the first in degrees"));
+    QObject::connect(action_view_plots_polar, &QAction::triggered, this, [this]() {
+        this->open_plot(PlotWidget::Mode::Polar);
+    });
+    auto action_view_plots_line = new QAction(m_root_menubar);
+    menu_view_plots->addAction(action_view_plots_line);
+    action_view_plots_line->setObjectName(tr("Line"));
+    action_view_plots_line->setText(tr("Line"));
+    action_view_plots_line->setStatusTip(tr("Line plot of the columns of a data file"));
+    QObject::connect(action_view_plots_line, &QAction::triggered, this, [this]() {
+        this->open_plot(PlotWidget::Mode::Line);
+    });
+    auto action_view_plots_histogram = new QAction(m_root_menubar);
+    menu_view_plots->addAction(action_view_plots_histogram);
+    action_view_plots_histogram->setObjectName(tr("Histogram"));
+    action_view_plots_histogram->setText(tr("Histogram"));
+    action_view_plots_histogram->setStatusTip(tr("Histogram of the columns of a data file"));
+    QObject::connect(action_view_plots_histogram, &QAction::triggered, this, [this]() {
+        this->open_plot(PlotWidget::Mode::Histogram);
+    });
+    auto action_view_plots_vdos = new QAction(m_root_menubar);
+    menu_view_plots->addAction(action_view_plots_vdos);
+    action_view_plots_vdos->setObjectName(tr("Vibrational DOS"));
+    action_view_plots_vdos->setText(tr("Vibrational DOS"));
+    action_view_plots_vdos->setStatusTip(tr("Velocity autocorrelation and vibrational density of states of a trajectory"));
+    QObject::connect(action_view_plots_vdos, &QAction::triggered, this, &MainWindow::open_vibrational_dos);
 
     auto menu_modeling = new QMenu(m_root_menubar);
     this->m_root_menubar->addMenu(menu_modeling);
@@ -148,6 +213,8 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
     action_analysis_dynamics->setObjectName(tr("Dynamics"));
     menu_analysis->addAction(action_analysis_dynamics);
     action_analysis_dynamics->setText("Dynamics");
+    action_analysis_dynamics->setStatusTip(tr("Read a trajectory and analyse its frames"));
+    QObject::connect(action_analysis_dynamics, &QAction::triggered, this, &MainWindow::open_trajectory);
     auto menu_analysis_properties = new QMenu(this->m_root_menubar);
     menu_analysis->addMenu(menu_analysis_properties);
     menu_analysis_properties->setTitle(tr("&Properties"));
@@ -155,7 +222,16 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
     menu_analysis_properties->addAction(action_analysis_molecule);
     action_analysis_molecule->setObjectName(tr("Molecule"));
     action_analysis_molecule->setText(tr("Molecule"));
+    action_analysis_molecule->setStatusTip(tr("List the molecules of the structure with their properties"));
+    QObject::connect(action_analysis_molecule, &QAction::triggered, this, &MainWindow::show_molecules);
     menu_analysis_properties->addSeparator();
+    menu_analysis->addSeparator();
+    auto action_analysis_query_results = new QAction(this->m_root_menubar);
+    menu_analysis->addAction(action_analysis_query_results);
+    action_analysis_query_results->setObjectName(tr("Query Results"));
+    action_analysis_query_results->setText(tr("Query Results"));
+    action_analysis_query_results->setStatusTip(tr("Search the results of finished calculations"));
+    QObject::connect(action_analysis_query_results, &QAction::triggered, this, &MainWindow::query_results);
 
     auto menu_help = new QMenu(m_root_menubar);
     this->m_root_menubar->addMenu(menu_help);
@@ -214,11 +290,50 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
 //    win_container->setMinimumSize(QSize(200, 100));
 //    win_container->setMaximumSize(screenSize);
 
+    // The workspaces are built when their tab is activated for the first
+    // time. The OCCT graphic driver is created meanwhile on another thread.
+    this->m_graphic_driver_future = QtConcurrent::run([]() {
+        auto graphic_driver = OccView::create_graphic_driver();
+        StartupProfiler::instance().mark("OCCT graphic driver");
+        return graphic_driver;
+    });
+
     auto tab1 = new QWidget(this->m_central_widget);
     this->m_root_tabwidget->addTab(tab1, QObject::tr("Modeling"));
+    new QHBoxLayout(tab1);
+    this->m_tab_builders.push_back(&MainWindow::build_modeling_workspace);
+
+    auto tab2 = new QWidget(this->m_central_widget);
+    this->m_root_tabwidget->addTab(tab2, QObject::tr("Calculation"));
+    auto tab2_hlayout = new QHBoxLayout(tab2);
+    tab2_hlayout->setContentsMargins(0, 0, 0, 0);
+    this->m_tab_builders.push_back(&MainWindow::build_calc_workspace);
+
+    this->m_tab_built.resize(this->m_tab_builders.size(), false);
+    QObject::connect(this->m_root_tabwidget, &QTabWidget::currentChanged, this, &MainWindow::on_tab_activated);
+    // build the current tab once the event loop runs, so that the window
+    // shows up before the first workspace is ready
+    QTimer::singleShot(0, this, [this]() {
+        this->on_tab_activated(this->m_root_tabwidget->currentIndex());
+    });
+
+    StartupProfiler::instance().mark("MainWindow");
+}
+
+void MainWindow::on_tab_activated(int index) {
+    if (index < 0 || index >= static_cast<int>(this->m_tab_builders.size()) || true == this->m_tab_built[index]) {
+        return;
+    }
+    this->m_tab_built[index] = true;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    (this->*m_tab_builders[index])(this->m_root_tabwidget->widget(index));
+    QApplication::restoreOverrideCursor();
+}
+
+void MainWindow::build_modeling_workspace(QWidget* tab1) {
+    TRACE_SCOPE_CAT("MainWindow::build_modeling_workspace", "startup");
     auto tab1_hsplitter = new QSplitter(this->m_central_widget);
-    auto tab1_hlayout= new QHBoxLayout(tab1);
-    tab1->setLayout(tab1_hlayout);
+    auto tab1_hlayout = tab1->layout();
     tab1_hlayout->addWidget(tab1_hsplitter);
     tab1_hsplitter->setOrientation(Qt::Orientation::Horizontal);
     tab1_hsplitter->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
@@ -228,8 +343,8 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
     tab1_hsplitter->setFrameShadow(QFrame::Plain);
     tab1_hsplitter->setStyleSheet("QSplitter::handle {background-color: gray}");
 
-    auto tab1_vlayout = new QVBoxLayout(tab1);
-    auto modeling_widget = new ModelingControl(this->m_central_widget);
+    auto graphic_driver = this->m_graphic_driver_future.result();
+    auto modeling_widget = new ModelingControl(this->m_central_widget, graphic_driver);
     auto modeling_tools = new ModelingTools(this->m_central_widget, modeling_widget);
     tab1_hsplitter->addWidget(modeling_tools);
     tab1_hsplitter->addWidget(modeling_widget);
@@ -237,9 +352,118 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
     modeling_widget->setMinimumSize(1200, 800);
     modeling_widget->setMaximumSize(screen_size);
 
-    auto tab2 = new CalcControl(this->m_central_widget);
-    this->m_root_tabwidget->addTab(tab2, QObject::tr("Calculation"));
+    ProgressiveSettings progressive_settings;
+    auto& config_ptree = this->m_config_manager.config_ptree;
+    progressive_settings.enabled = config_ptree.get<bool>("rendering.progressive.enabled", progressive_settings.enabled);
+    progressive_settings.idle_interval_ms = config_ptree.get<int>("rendering.progressive.idle_interval_ms", progressive_settings.idle_interval_ms);
+    progressive_settings.interactive_frame_ms = config_ptree.get<double>("rendering.progressive.interactive_frame_ms", progressive_settings.interactive_frame_ms);
+    progressive_settings.min_atoms = config_ptree.get<int>("rendering.progressive.min_atoms", progressive_settings.min_atoms);
+    modeling_widget->get_occview()->set_progressive_settings(progressive_settings);
+
+    // parsed structures, bonds and thumbnails are kept under the config dir
+    const auto cache_megabytes = config_ptree.get<std::uint64_t>("cache.max_megabytes", 2048);
+    modeling_widget->set_structure_cache(std::make_shared<StructureCache>(
+        (fs::path(this->m_config_manager.get_config_dir()) / "cache").string(),
+        cache_megabytes * 1024 * 1024
+    ));
+    this->m_modeling_widget = modeling_widget;
+    StartupProfiler::instance().mark("Modeling workspace");
 
+    if (true == StartupProfiler::instance().is_enabled()) {
+        auto connection = std::make_shared<QMetaObject::Connection>();
+        *connection = QObject::connect(modeling_widget->get_occview(), &OccView::frame_rendered, this, [connection]() {
+            StartupProfiler::instance().mark("First frame");
+            StartupProfiler::instance().report();
+            QObject::disconnect(*connection);
+        });
+    }
+}
+
+void MainWindow::build_calc_workspace(QWidget* tab2) {
+    TRACE_SCOPE_CAT("MainWindow::build_calc_workspace", "startup");
+    auto calc_control = new CalcControl(tab2);
+    tab2->layout()->addWidget(calc_control);
+
+    auto& config_ptree = this->m_config_manager.config_ptree;
+    SshEndpoint endpoint;
+    endpoint.host = config_ptree.get<std::string>("remote.host", "localhost");
+    endpoint.port = config_ptree.get<int>("remote.port", endpoint.port);
+    endpoint.user = config_ptree.get<std::string>("remote.user", "");
+    endpoint.private_key = config_ptree.get<std::string>("remote.private_key", "");
+    endpoint.public_key = config_ptree.get<std::string>("remote.public_key", "");
+    endpoint.compress = config_ptree.get<bool>("remote.compress", endpoint.compress);
+    calc_control->set_endpoint(endpoint);
+    calc_control->set_download_streams(config_ptree.get<int>("remote.download_streams", 4));
+    calc_control->set_local_cores(config_ptree.get<int>("local.max_cores", 0));
+    calc_control->set_results_store(this->get_results_store());
+    calc_control->set_manifest_dir((fs::path(this->m_config_manager.get_config_dir()) / "manifests").string());
+    calc_control->set_workflow_memo_dir((fs::path(this->m_config_manager.get_config_dir()) / "workflow_memo").string());
+    calc_control->set_remote_workflow_root(config_ptree.get<std::string>("remote.workflow_root", "workflows"));
+    calc_control->set_scheduler(scheduler_from_name(config_ptree.get<std::string>("remote.scheduler", "slurm")));
+    calc_control->get_job_monitor()->set_interval(config_ptree.get<int>("remote.poll_interval", 30));
+    SshSessionPool::instance().set_max_sessions_per_host(config_ptree.get<int>("remote.max_sessions", SshSessionPool::instance().get_max_sessions_per_host()));
+    StartupProfiler::instance().mark("Calculation workspace");
+}
+
+void MainWindow::open_structure() {
+    // the modeling workspace is built on demand, its structure cache
+    // provides the previews in the dialog
+    this->m_root_tabwidget->setCurrentIndex(0);
+    this->on_tab_activated(0);
+    QFileDialog dialog(this, tr("Open Structure"), "", tr("Structure (*.xyz *.cif)"));
+    dialog.setFileMode(QFileDialog::ExistingFile);
+    // the native dialogs can not take the preview
+    dialog.setOption(QFileDialog::DontUseNativeDialog);
+    auto preview = new QLabel(&dialog);
+    preview->setFixedSize(256, 256);
+    preview->setAlignment(Qt::AlignCenter);
+    auto grid_layout = qobject_cast<QGridLayout*>(dialog.layout());
+    if (nullptr != grid_layout) {
+        grid_layout->addWidget(preview, 0, grid_layout->columnCount(), grid_layout->rowCount(), 1);
+    }
+    const auto structure_cache = this->m_modeling_widget->get_structure_cache();
+    QObject::connect(&dialog, &QFileDialog::currentChanged, preview, [preview, structure_cache](const QString& path) {
+        preview->clear();
+        preview->setProperty("path", path);
+        if (nullptr == structure_cache || false == QFileInfo(path).isFile()) {
+            return;
+        }
+        // the key hashes the whole file, so it is looked up in the
+        // background and a preview for a path no longer selected dropped
+        QPointer<QLabel> label(preview);
+        QtConcurrent::run([structure_cache, path, label]() {
+            QImage image;
+            try {
+                const auto thumbnail = structure_cache->thumbnail_path(structure_cache->key_of(path.toStdString()));
+                if (true == fs::exists(thumbnail)) {
+                    image.load(QString::fromStdString(thumbnail));
+                }
+            } catch (const std::exception& e) {
+                LOG_DEBUG("No preview for %s: %s", qPrintable(path), e.what());
+            }
+            QMetaObject::invokeMethod(qApp, [label, path, image]() {
+                if (nullptr == label || label->property("path").toString() != path) {
+                    return;
+                }
+                if (true == image.isNull()) {
+                    label->setText(tr("No preview"));
+                } else {
+                    label->setPixmap(QPixmap::fromImage(image).scaled(label->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+                }
+            });
+        });
+    });
+    if (QDialog::Accepted != dialog.exec() || true == dialog.selectedFiles().isEmpty()) {
+        return;
+    }
+    const auto file_path = dialog.selectedFiles().first();
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    try {
+        this->m_modeling_widget->open_structure(file_path.toStdString());
+    } catch (const std::exception& e) {
+        LOG_ERROR("Can not open %s: %s", qPrintable(file_path), e.what());
+    }
+    QApplication::restoreOverrideCursor();
 }
 
 void MainWindow::export_to_image() {
@@ -248,10 +472,20 @@ void MainWindow::export_to_image() {
     fd->setViewMode(QFileDialog::Detail);
     QString file_path;
     file_path = fd->getSaveFileName(this, tr("Save File"), "export.png");
-    std::cout << file_path.toStdString() << std::endl;
+    LOG_INFO("Export image to: %s", qPrintable(file_path));
     delete fd;
 }
 
+void MainWindow::export_trace() {
+    auto file_path = QFileDialog::getSaveFileName(this, tr("Save Trace"), "atomscistudio-trace.json", tr("JSON (*.json)"));
+    if (true == file_path.isEmpty()) {
+        return;
+    }
+    if (false == Tracer::instance().write_chrome_trace(file_path.toStdString())) {
+        QMessageBox::warning(this, tr("Export Trace"), tr("Can not write %1").arg(file_path));
+    }
+}
+
 void MainWindow::popup_about() {
     auto msg_box = new QMessageBox(this->m_central_widget);
     msg_box->setText("About Atomscistudio (version 0.0.0)");
@@ -284,3 +518,181 @@ void MainWindow::popup_config() {
     msg_box->exec();
     delete msg_box;
 }
+
+void MainWindow::open_volumetric() {
+    auto file_path = QFileDialog::getOpenFileName(this, tr("Open Volumetric Data"), "",
+        tr("Volumetric data (*.cube *.cub CHGCAR* CHG* PARCHG* AECCAR* LOCPOT* ELFCAR*);;All files (*)"));
+    if (true == file_path.isEmpty()) {
+        return;
+    }
+    // the modeling workspace is built on demand
+    this->m_root_tabwidget->setCurrentIndex(0);
+    this->on_tab_activated(0);
+    this->m_modeling_widget->open_volumetric(file_path.toStdString());
+}
+
+void MainWindow::open_trajectory() {
+    auto file_path = QFileDialog::getOpenFileName(this, tr("Open Trajectory"), "",
+        tr("Trajectory (OUTCAR* *.lammpstrj *.dump dump.* *.xyz);;All files (*)"));
+    if (true == file_path.isEmpty()) {
+        return;
+    }
+    auto dialog = new DynamicsDialog(file_path, this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->show();
+}
+
+void MainWindow::open_vibrational_dos() {
+    auto file_path = QFileDialog::getOpenFileName(this, tr("Open Trajectory"), "",
+        tr("Trajectory (OUTCAR* *.lammpstrj *.dump dump.* *.xyz);;All files (*)"));
+    if (true == file_path.isEmpty()) {
+        return;
+    }
+    auto dialog = new VdosDialog(file_path, this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->show();
+}
+
+void MainWindow::open_plot(PlotWidget::Mode mode) {
+    auto file_path = QFileDialog::getOpenFileName(this, tr("Open Data"), "",
+        tr("Data (*.dat *.txt *.csv *.ener *.out);;All files (*)"));
+    if (true == file_path.isEmpty()) {
+        return;
+    }
+    auto dialog = new PlotDialog(file_path, mode, this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->show();
+}
+
+std::shared_ptr<ResultsStore> MainWindow::get_results_store() {
+    if (nullptr == this->m_results_store) {
+        this->m_results_store = std::make_shared<ResultsStore>(
+            (fs::path(this->m_config_manager.get_config_dir()) / "results").string()
+        );
+    }
+    return this->m_results_store;
+}
+
+void MainWindow::query_results() {
+    bool ok = false;
+    auto query = QInputDialog::getText(this, tr("Query Results"),
+        tr("Conditions on energy, energy_per_atom, force, pressure, band_gap, natom, time, job, composition, code or path:"),
+        QLineEdit::Normal, "energy_per_atom < -5 and composition = O2Si", &ok);
+    if (false == ok) {
+        return;
+    }
+    auto results_store = this->get_results_store();
+    std::vector<std::uint64_t> rows;
+    double milliseconds = 0.0;
+    try {
+        const auto start = std::chrono::steady_clock::now();
+        rows = results_store->select(parse_result_query(query.toStdString()));
+        milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    } catch (const std::exception& e) {
+        QMessageBox::warning(this, tr("Query Results"), QString::fromStdString(e.what()));
+        return;
+    }
+
+    // the table shows the first rows only
+    const std::size_t max_rows = 1000;
+    const std::vector<QString> headers{"job", "composition", "energy", "energy_per_atom", "force", "pressure", "band_gap", "code", "path"};
+    auto dialog = new QDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->setWindowTitle(tr("Query Results"));
+    dialog->resize(1000, 600);
+    auto layout = new QVBoxLayout(dialog);
+    auto label = new QLabel(dialog);
+    layout->addWidget(label);
+    label->setText(tr("%1 of %2 results in %3 ms").arg(rows.size()).arg(results_store->size()).arg(milliseconds, 0, 'f', 2));
+    auto table = new QTableWidget(dialog);
+    layout->addWidget(table);
+    table->setColumnCount(headers.size());
+    for (std::size_t j = 0; j < headers.size(); j++) {
+        table->setHorizontalHeaderItem(j, new QTableWidgetItem(headers[j]));
+    }
+    table->setRowCount(std::min(rows.size(), max_rows));
+    for (std::size_t i = 0; i < rows.size() && i < max_rows; i++) {
+        const auto record = results_store->get_record(rows[i]);
+        const std::vector<QString> cells{
+            QString::fromStdString(record.job),
+            QString::fromStdString(record.composition),
+            QString::number(record.energy, 'f', 6),
+            QString::number(record.energy_per_atom, 'f', 6),
+            QString::number(record.force, 'g', 4),
+            QString::number(record.pressure, 'f', 2),
+            QString::number(record.band_gap, 'f', 3),
+            QString::fromStdString(record.code),
+            QString::fromStdString(record.path),
+        };
+        for (std::size_t j = 0; j < cells.size(); j++) {
+            table->setItem(i, j, new QTableWidgetItem(cells[j]));
+        }
+    }
+    table->horizontalHeader()->setStretchLastSection(true);
+    dialog->show();
+}
+
+void MainWindow::show_molecules() {
+    if (nullptr == this->m_modeling_widget || true == this->m_modeling_widget->m_crystal->atoms.empty()) {
+        QMessageBox::information(this, tr("Molecule"), tr("Open a structure first"));
+        return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    SpeciesTable species_table;
+    const Frame frame = frame_from_crystal(*this->m_modeling_widget->m_crystal, species_table);
+    const auto& bonds = this->m_modeling_widget->get_bonds();
+    const Molecules molecules = find_molecules(frame.natom(), bonds);
+    const auto properties = molecule_properties(frame, species_table, molecules, bonds);
+    const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::map<std::string, int> formula_counts;
+    for (const auto& property : properties) {
+        formula_counts[property.formula]++;
+    }
+    QStringList formulas;
+    for (const auto& item : formula_counts) {
+        formulas << QString("%1 x %2").arg(QString::fromStdString(item.first)).arg(item.second);
+    }
+
+    // the table shows the first molecules only; there is no dipole
+    // column, the crystal carries no charges
+    const std::size_t max_rows = 1000;
+    const std::vector<QString> headers{"formula", "atoms", "mass (amu)", "x (A)", "y (A)", "z (A)", "Rg (A)"};
+    auto dialog = new QDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->setWindowTitle(tr("Molecule"));
+    dialog->resize(900, 600);
+    auto layout = new QVBoxLayout(dialog);
+    auto label = new QLabel(dialog);
+    layout->addWidget(label);
+    label->setWordWrap(true);
+    auto text = tr("%1 molecules in %2 ms: %3").arg(molecules.count()).arg(milliseconds, 0, 'f', 2).arg(formulas.join(", "));
+    if (true == bonds.empty()) {
+        text += "\n" + tr("No bonds were detected, every atom is counted as a molecule.");
+    }
+    label->setText(text);
+    auto table = new QTableWidget(dialog);
+    layout->addWidget(table);
+    table->setColumnCount(headers.size());
+    for (std::size_t j = 0; j < headers.size(); j++) {
+        table->setHorizontalHeaderItem(j, new QTableWidgetItem(headers[j]));
+    }
+    table->setRowCount(std::min(properties.size(), max_rows));
+    for (std::size_t i = 0; i < properties.size() && i < max_rows; i++) {
+        const auto& property = properties[i];
+        const std::vector<QString> cells{
+            QString::fromStdString(property.formula),
+            QString::number(property.natom),
+            QString::number(property.mass, 'f', 3),
+            QString::number(property.centre[0], 'f', 4),
+            QString::number(property.centre[1], 'f', 4),
+            QString::number(property.centre[2], 'f', 4),
+            QString::number(property.radius_of_gyration, 'f', 4),
+        };
+        for (std::size_t j = 0; j < cells.size(); j++) {
+            table->setItem(i, j, new QTableWidgetItem(cells[j]));
+        }
+    }
+    table->horizontalHeader()->setStretchLastSection(true);
+    dialog->show();
+}
@@ -29,10 +29,19 @@
 #include <QMainWindow>
 #include <QtWidgets/QHBoxLayout>
 #include <QMenuBar>
+#include <QFuture>
+
+#include <memory>
+#include <vector>
 
 #include <boost/filesystem.hpp>
+#include <Graphic3d_GraphicDriver.hxx>
 
 #include "config/config_manager.h"
+#include "main/plot_widget.h"
+
+class ModelingControl;
+class ResultsStore;
 
 namespace fs = boost::filesystem;
 
@@ -43,9 +52,18 @@ public:
     ~MainWindow() {
     };
 
+    void open_structure();
+    void open_volumetric();
+    void open_trajectory();
+    void open_vibrational_dos();
+    // a data file in a PlotDialog
+    void open_plot(PlotWidget::Mode mode);
     void export_to_image();
+    void export_trace();
     void popup_about();
     void popup_config();
+    void query_results();
+    void show_molecules();
 
     QWidget* m_central_widget;
     QMenuBar* m_root_menubar;
@@ -54,9 +72,19 @@ public:
     QTabWidget* m_root_tabwidget;
     ConfigManager m_config_manager;
 private slots:
+    void on_tab_activated(int index);
 
 private:
+    void build_modeling_workspace(QWidget* tab);
+    void build_calc_workspace(QWidget* tab);
+    // opened on first use
+    std::shared_ptr<ResultsStore> get_results_store();
 
+    QFuture<Handle(Graphic3d_GraphicDriver)> m_graphic_driver_future;
+    std::vector<void (MainWindow::*)(QWidget*)> m_tab_builders;
+    std::vector<bool> m_tab_built;
+    ModelingControl* m_modeling_widget = nullptr;
+    std::shared_ptr<ResultsStore> m_results_store;
 };
 
 #endif // MAIN_MAINWINDOW_H
@@ -0,0 +1,194 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "main/plot_dialog.h"
+
+#include <QApplication>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QPointer>
+#include <QVBoxLayout>
+#include <QtConcurrent/QtConcurrent>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "utils/logger.h"
+
+namespace {
+
+// rows handed to the plot at once, and at least that often
+const std::size_t kChunkRows = 1 << 18;
+const double kChunkSeconds = 0.2;
+
+} // namespace
+
+PlotDialog::PlotDialog(const QString& path, PlotWidget::Mode mode, QWidget* parent)
+    : QDialog{parent}, m_cancelled{std::make_shared<std::atomic<bool>>(false)} {
+    this->setWindowTitle(tr("Plot - %1").arg(QFileInfo(path).fileName()));
+    this->resize(900, 600);
+    auto layout = new QVBoxLayout(this);
+    auto options_layout = new QHBoxLayout();
+    layout->addLayout(options_layout);
+    options_layout->addWidget(new QLabel(tr("Mode"), this));
+    this->m_mode_combo_box = new QComboBox(this);
+    options_layout->addWidget(this->m_mode_combo_box);
+    this->m_mode_combo_box->addItem(tr("Line"), static_cast<int>(PlotWidget::Mode::Line));
+    this->m_mode_combo_box->addItem(tr("Histogram"), static_cast<int>(PlotWidget::Mode::Histogram));
+    this->m_mode_combo_box->addItem(tr("Polar (x in degrees)"), static_cast<int>(PlotWidget::Mode::Polar));
+    this->m_mode_combo_box->setCurrentIndex(this->m_mode_combo_box->findData(static_cast<int>(mode)));
+    options_layout->addWidget(new QLabel(tr("Decimation"), this));
+    this->m_decimation_combo_box = new QComboBox(this);
+    options_layout->addWidget(this->m_decimation_combo_box);
+    this->m_decimation_combo_box->addItem(tr("Min/max"), static_cast<int>(PlotWidget::Decimation::MinMax));
+    this->m_decimation_combo_box->addItem(tr("LTTB"), static_cast<int>(PlotWidget::Decimation::Lttb));
+    options_layout->addStretch();
+    this->m_label = new QLabel(this);
+    layout->addWidget(this->m_label);
+    this->m_plot = new PlotWidget(this);
+    layout->addWidget(this->m_plot);
+    this->m_plot->set_mode(mode);
+    this->m_plot->set_titles(tr("x"), tr("y"));
+
+    connect(this->m_mode_combo_box, &QComboBox::currentIndexChanged, this, [this]() {
+        this->m_plot->set_mode(static_cast<PlotWidget::Mode>(this->m_mode_combo_box->currentData().toInt()));
+    });
+    connect(this->m_decimation_combo_box, &QComboBox::currentIndexChanged, this, [this]() {
+        this->m_plot->set_decimation(static_cast<PlotWidget::Decimation>(this->m_decimation_combo_box->currentData().toInt()));
+    });
+    connect(this->m_plot, &PlotWidget::painted, this, &PlotDialog::update_status);
+
+    this->m_read_status = tr("Reading %1").arg(path);
+    this->read_columns(path);
+}
+
+PlotDialog::~PlotDialog() {
+    this->m_cancelled->store(true);
+}
+
+void PlotDialog::update_status() {
+    this->m_label->setText(tr("%1; %2 of %3 points drawn in %4 ms")
+        .arg(this->m_read_status)
+        .arg(this->m_plot->get_drawn_points())
+        .arg(this->m_plot->get_total_points())
+        .arg(this->m_plot->get_paint_ms(), 0, 'f', 1));
+}
+
+void PlotDialog::read_columns(const QString& path) {
+    auto cancelled = this->m_cancelled;
+    QPointer<PlotDialog> dialog(this);
+    QtConcurrent::run([path, cancelled, dialog]() {
+        const auto start = std::chrono::steady_clock::now();
+        auto last_chunk = start;
+        std::ifstream file(path.toStdString());
+        if (false == file.is_open()) {
+            QMetaObject::invokeMethod(qApp, [dialog, path]() {
+                if (nullptr != dialog) {
+                    dialog->m_read_status = tr("Can not open %1").arg(path);
+                    dialog->update_status();
+                }
+            });
+            return;
+        }
+        // the number of columns is set by the first row of numbers
+        int ncolumn = 0;
+        std::vector<std::vector<double>> columns;
+        std::size_t nrow = 0;
+        std::size_t nskipped = 0;
+        double last_x = 0.0;
+        const auto flush = [&](bool last) {
+            // the first column is x, a single column is plotted over the index
+            std::vector<double> x;
+            std::vector<std::vector<double>> series;
+            if (1 == ncolumn) {
+                series.push_back(std::move(columns[0]));
+            } else if (ncolumn > 1) {
+                x = std::move(columns[0]);
+                series.assign(std::make_move_iterator(columns.begin() + 1), std::make_move_iterator(columns.end()));
+            }
+            columns.assign(ncolumn, {});
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            QMetaObject::invokeMethod(qApp, [dialog, x, series, nrow, nskipped, seconds, last]() {
+                if (nullptr == dialog) {
+                    return;
+                }
+                for (std::size_t s = 0; s < series.size(); s++) {
+                    if (s >= dialog->m_plot->get_series_count()) {
+                        dialog->m_plot->add_series(1 == series.size() ? tr("y") : tr("column %1").arg(s + 2));
+                    }
+                    dialog->m_plot->append(static_cast<int>(s), x, series[s]);
+                }
+                dialog->m_read_status = tr("%1 rows%2 in %3 s%4").arg(nrow)
+                    .arg(nskipped > 0 ? tr(", %1 skipped").arg(nskipped) : QString())
+                    .arg(seconds, 0, 'f', 2)
+                    .arg(true == last ? QString() : tr(", reading"));
+                dialog->update_status();
+            });
+        };
+        std::string line;
+        std::vector<double> row;
+        while (std::getline(file, line)) {
+            const char* pos = line.c_str();
+            while (' ' == *pos || '\t' == *pos) {
+                pos++;
+            }
+            if ('#' == *pos || '\0' == *pos) {
+                continue;
+            }
+            row.clear();
+            char* next = nullptr;
+            for (double value = std::strtod(pos, &next); next != pos; value = std::strtod(pos, &next)) {
+                row.push_back(value);
+                pos = next;
+            }
+            if (0 == ncolumn && false == row.empty()) {
+                ncolumn = static_cast<int>(row.size());
+                columns.assign(ncolumn, {});
+            }
+            if (static_cast<int>(row.size()) < ncolumn || 0 == ncolumn) {
+                nskipped++;
+                continue;
+            }
+            // the plot needs x in order
+            if (ncolumn > 1 && nrow > 0 && row[0] < last_x) {
+                nskipped++;
+                continue;
+            }
+            last_x = row[0];
+            for (int c = 0; c < ncolumn; c++) {
+                columns[c].push_back(row[c]);
+            }
+            nrow++;
+            if (0 == nrow % kChunkRows
+                || (0 == nrow % 1024 && std::chrono::duration<double>(std::chrono::steady_clock::now() - last_chunk).count() > kChunkSeconds)) {
+                if (true == cancelled->load()) {
+                    return;
+                }
+                flush(false);
+                last_chunk = std::chrono::steady_clock::now();
+            }
+        }
+        flush(true);
+        LOG_INFO("plotted %zu rows of %s", nrow, qPrintable(path));
+    });
+}
@@ -0,0 +1,61 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// View > Plots: columns of a text data file in a PlotWidget. The file is
+/// read in the background and the plot grows as the rows come in, so
+/// long energy or temperature traces show up at once.
+///
+/// One column is plotted over the row index; with more columns the first
+/// is x and each other column a series. Lines starting with '#' are
+/// skipped, as are rows that are not numbers and rows whose x is smaller
+/// than the one before.
+
+#ifndef MAIN_PLOT_DIALOG_H
+#define MAIN_PLOT_DIALOG_H
+
+#include <QComboBox>
+#include <QDialog>
+#include <QLabel>
+
+#include <atomic>
+#include <memory>
+
+#include "main/plot_widget.h"
+
+class PlotDialog : public QDialog {
+    Q_OBJECT
+public:
+    PlotDialog(const QString& path, PlotWidget::Mode mode, QWidget* parent = nullptr);
+    ~PlotDialog();
+
+private:
+    void read_columns(const QString& path);
+    void update_status();
+
+    QComboBox* m_mode_combo_box;
+    QComboBox* m_decimation_combo_box;
+    QLabel* m_label;
+    PlotWidget* m_plot;
+    QString m_read_status;
+    // the reading stops when the dialog is closed
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+#endif // MAIN_PLOT_DIALOG_H
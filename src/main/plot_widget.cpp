@@ -0,0 +1,375 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "main/plot_widget.h"
+
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPainterPath>
+#include <QWheelEvent>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const double kDegree = M_PI / 180.0;
+
+} // namespace
+
+PlotWidget::PlotWidget(QWidget* parent) : QWidget{parent} {
+    this->setMinimumSize(400, 300);
+    this->setAutoFillBackground(true);
+    this->setBackgroundRole(QPalette::Base);
+    this->setMouseTracking(false);
+}
+
+void PlotWidget::set_mode(Mode mode) {
+    this->m_mode = mode;
+    this->update();
+}
+
+void PlotWidget::set_decimation(Decimation decimation) {
+    this->m_decimation = decimation;
+    this->update();
+}
+
+void PlotWidget::set_titles(const QString& x_title, const QString& y_title) {
+    this->m_x_title = x_title;
+    this->m_y_title = y_title;
+    this->update();
+}
+
+int PlotWidget::add_series(const QString& name) {
+    this->m_series.emplace_back();
+    this->m_series.back().name = name;
+    return static_cast<int>(this->m_series.size()) - 1;
+}
+
+void PlotWidget::append(int series, const std::vector<double>& x, const std::vector<double>& y) {
+    if (series < 0 || series >= static_cast<int>(this->m_series.size())) {
+        return;
+    }
+    auto& pyramid = this->m_series[series].pyramid;
+    // a view showing the last sample keeps following the data
+    const bool follow = true == this->m_zoomed && pyramid.size() > 0 && this->m_view_max >= pyramid.x_at(pyramid.size() - 1);
+    const double width = this->m_view_max - this->m_view_min;
+    pyramid.append(x, y);
+    if (true == follow && pyramid.size() > 0) {
+        this->m_view_max = pyramid.x_at(pyramid.size() - 1);
+        this->m_view_min = this->m_view_max - width;
+    }
+    // repaints coalesce, appends faster than the screen cost nothing extra
+    this->update();
+}
+
+void PlotWidget::clear() {
+    this->m_series.clear();
+    this->m_zoomed = false;
+    this->update();
+}
+
+std::size_t PlotWidget::get_total_points() const {
+    std::size_t total = 0;
+    for (const auto& series : this->m_series) {
+        total += series.pyramid.size();
+    }
+    return total;
+}
+
+bool PlotWidget::data_range(double& x_min, double& x_max) const {
+    x_min = std::numeric_limits<double>::max();
+    x_max = std::numeric_limits<double>::lowest();
+    for (const auto& series : this->m_series) {
+        if (0 == series.pyramid.size()) {
+            continue;
+        }
+        x_min = std::min(x_min, series.pyramid.x_at(0));
+        x_max = std::max(x_max, series.pyramid.x_at(series.pyramid.size() - 1));
+    }
+    return x_min <= x_max;
+}
+
+QRectF PlotWidget::plot_rect() const {
+    return QRectF(this->rect()).adjusted(70, 24, -10, -34);
+}
+
+QColor PlotWidget::color_of(std::size_t series) const {
+    static const Qt::GlobalColor colors[] = {
+        Qt::darkBlue, Qt::red, Qt::darkGreen, Qt::magenta, Qt::darkCyan, Qt::darkYellow, Qt::gray, Qt::darkRed
+    };
+    return QColor(colors[series % (sizeof(colors) / sizeof(colors[0]))]);
+}
+
+void PlotWidget::decimate(const Series& series, std::size_t begin, std::size_t end, std::size_t npixel, std::vector<double>& x, std::vector<double>& y) const {
+    if (Decimation::Lttb == this->m_decimation) {
+        series.pyramid.decimate_lttb(begin, end, npixel, x, y);
+    } else {
+        series.pyramid.decimate(begin, end, npixel, x, y);
+    }
+}
+
+void PlotWidget::paintEvent(QPaintEvent* event) {
+    Q_UNUSED(event);
+    const auto start = std::chrono::steady_clock::now();
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+    const QRectF rect = this->plot_rect();
+    painter.setPen(this->palette().color(QPalette::Text));
+    painter.drawText(QRectF(rect.left(), 4, rect.width(), 18), Qt::AlignLeft, this->m_y_title);
+    painter.drawText(QRectF(rect.left(), rect.bottom() + 16, rect.width(), 18), Qt::AlignHCenter, this->m_x_title);
+    this->m_drawn_points = 0;
+    if (Mode::Polar == this->m_mode) {
+        this->draw_polar(painter, rect);
+    } else if (Mode::Histogram == this->m_mode) {
+        painter.drawRect(rect);
+        this->draw_histogram(painter, rect);
+    } else {
+        painter.drawRect(rect);
+        this->draw_lines(painter, rect);
+    }
+    // legend
+    for (std::size_t s = 0; s < this->m_series.size() && this->m_series.size() > 1; s++) {
+        const QRectF legend(rect.right() - 130, rect.top() + 4 + 16 * s, 120, 16);
+        painter.setPen(QPen(this->color_of(s), 1.5));
+        painter.drawLine(QPointF(legend.left(), legend.center().y()), QPointF(legend.left() + 20, legend.center().y()));
+        painter.setPen(this->palette().color(QPalette::Text));
+        painter.drawText(legend.adjusted(24, 0, 0, 0), Qt::AlignLeft | Qt::AlignVCenter, this->m_series[s].name);
+    }
+    this->m_paint_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    emit painted();
+}
+
+void PlotWidget::draw_lines(QPainter& painter, const QRectF& rect) {
+    double x_min = 0.0;
+    double x_max = 0.0;
+    if (false == this->data_range(x_min, x_max)) {
+        return;
+    }
+    if (true == this->m_zoomed) {
+        x_min = this->m_view_min;
+        x_max = this->m_view_max;
+    }
+    if (x_max - x_min < 1.0e-300) {
+        x_min -= 0.5;
+        x_max += 0.5;
+    }
+    const std::size_t npixel = std::max(1, static_cast<int>(rect.width()));
+    std::vector<std::vector<double>> xs(this->m_series.size());
+    std::vector<std::vector<double>> ys(this->m_series.size());
+    double y_min = std::numeric_limits<double>::max();
+    double y_max = std::numeric_limits<double>::lowest();
+    for (std::size_t s = 0; s < this->m_series.size(); s++) {
+        const auto& pyramid = this->m_series[s].pyramid;
+        auto range = pyramid.range(x_min, x_max);
+        // one sample beyond each side keeps the line running to the edges
+        range.first = range.first > 0 ? range.first - 1 : 0;
+        range.second = std::min(pyramid.size(), range.second + 1);
+        this->decimate(this->m_series[s], range.first, range.second, npixel, xs[s], ys[s]);
+        double lo = 0.0;
+        double hi = 0.0;
+        pyramid.bounds(range.first, range.second, lo, hi);
+        if (std::isfinite(lo) && std::isfinite(hi)) {
+            y_min = std::min(y_min, lo);
+            y_max = std::max(y_max, hi);
+        }
+    }
+    if (y_min > y_max) {
+        return;
+    }
+    if (y_max - y_min < 1.0e-12 * std::max(1.0, std::fabs(y_max))) {
+        y_min -= 0.5;
+        y_max += 0.5;
+    }
+    painter.drawText(QRectF(rect.left() - 68, rect.top(), 64, 16), Qt::AlignRight, QString::number(y_max, 'g', 6));
+    painter.drawText(QRectF(rect.left() - 68, rect.bottom() - 16, 64, 16), Qt::AlignRight, QString::number(y_min, 'g', 6));
+    painter.drawText(QRectF(rect.left(), rect.bottom() + 2, 120, 16), Qt::AlignLeft, QString::number(x_min, 'g', 6));
+    painter.drawText(QRectF(rect.right() - 120, rect.bottom() + 2, 120, 16), Qt::AlignRight, QString::number(x_max, 'g', 6));
+
+    painter.save();
+    painter.setClipRect(rect);
+    for (std::size_t s = 0; s < this->m_series.size(); s++) {
+        QPolygonF polyline;
+        polyline.reserve(xs[s].size());
+        for (std::size_t i = 0; i < xs[s].size(); i++) {
+            polyline << QPointF(
+                rect.left() + (xs[s][i] - x_min) / (x_max - x_min) * rect.width(),
+                rect.bottom() - (ys[s][i] - y_min) / (y_max - y_min) * rect.height()
+            );
+        }
+        this->m_drawn_points += polyline.size();
+        painter.setPen(QPen(this->color_of(s), 1.0));
+        painter.drawPolyline(polyline);
+    }
+    painter.restore();
+}
+
+void PlotWidget::draw_histogram(QPainter& painter, const QRectF& rect) {
+    double x_min = 0.0;
+    double x_max = 0.0;
+    if (false == this->data_range(x_min, x_max)) {
+        return;
+    }
+    if (true == this->m_zoomed) {
+        x_min = this->m_view_min;
+        x_max = this->m_view_max;
+    }
+    // the value range over all series in view, from the pyramids
+    std::vector<std::pair<std::size_t, std::size_t>> ranges;
+    double y_min = std::numeric_limits<double>::max();
+    double y_max = std::numeric_limits<double>::lowest();
+    for (const auto& series : this->m_series) {
+        ranges.push_back(series.pyramid.range(x_min, x_max));
+        double lo = 0.0;
+        double hi = 0.0;
+        series.pyramid.bounds(ranges.back().first, ranges.back().second, lo, hi);
+        if (std::isfinite(lo) && std::isfinite(hi)) {
+            y_min = std::min(y_min, lo);
+            y_max = std::max(y_max, hi);
+        }
+    }
+    if (y_min > y_max) {
+        return;
+    }
+    if (y_max - y_min < 1.0e-12 * std::max(1.0, std::fabs(y_max))) {
+        y_min -= 0.5;
+        y_max += 0.5;
+    }
+    const int nbin = std::max(1, static_cast<int>(rect.width() / 4));
+    std::vector<std::vector<std::uint64_t>> counts;
+    std::uint64_t max_count = 1;
+    for (std::size_t s = 0; s < this->m_series.size(); s++) {
+        counts.push_back(this->m_series[s].pyramid.histogram(ranges[s].first, ranges[s].second, nbin, y_min, y_max));
+        max_count = std::max(max_count, *std::max_element(counts.back().begin(), counts.back().end()));
+    }
+    painter.drawText(QRectF(rect.left() - 68, rect.top(), 64, 16), Qt::AlignRight, QString::number(max_count));
+    painter.drawText(QRectF(rect.left() - 68, rect.bottom() - 16, 64, 16), Qt::AlignRight, "0");
+    painter.drawText(QRectF(rect.left(), rect.bottom() + 2, 120, 16), Qt::AlignLeft, QString::number(y_min, 'g', 6));
+    painter.drawText(QRectF(rect.right() - 120, rect.bottom() + 2, 120, 16), Qt::AlignRight, QString::number(y_max, 'g', 6));
+    const double bin_width = rect.width() / nbin;
+    for (std::size_t s = 0; s < counts.size(); s++) {
+        QColor color = this->color_of(s);
+        color.setAlpha(counts.size() > 1 ? 120 : 255);
+        for (int b = 0; b < nbin; b++) {
+            const double height = static_cast<double>(counts[s][b]) / max_count * rect.height();
+            painter.fillRect(QRectF(rect.left() + b * bin_width, rect.bottom() - height, bin_width, height), color);
+        }
+        this->m_drawn_points += nbin;
+    }
+}
+
+void PlotWidget::draw_polar(QPainter& painter, const QRectF& rect) {
+    double r_max = 0.0;
+    for (const auto& series : this->m_series) {
+        double lo = 0.0;
+        double hi = 0.0;
+        series.pyramid.bounds(0, series.pyramid.size(), lo, hi);
+        if (std::isfinite(lo) && std::isfinite(hi)) {
+            r_max = std::max(r_max, std::max(std::fabs(lo), std::fabs(hi)));
+        }
+    }
+    if (r_max <= 0.0) {
+        r_max = 1.0;
+    }
+    const QPointF centre = rect.center();
+    const double radius = 0.5 * std::min(rect.width(), rect.height());
+    const QColor grid_color = this->palette().color(QPalette::Mid);
+    painter.setPen(grid_color);
+    for (int ring = 1; ring <= 4; ring++) {
+        painter.drawEllipse(centre, radius * ring / 4, radius * ring / 4);
+    }
+    for (int angle = 0; angle < 360; angle += 30) {
+        const QPointF end(centre.x() + radius * std::cos(angle * kDegree), centre.y() - radius * std::sin(angle * kDegree));
+        painter.drawLine(centre, end);
+        painter.drawText(QRectF(end.x() - 20, end.y() - 8, 40, 16), Qt::AlignCenter, QString::number(angle));
+    }
+    painter.setPen(this->palette().color(QPalette::Text));
+    painter.drawText(QRectF(centre.x() + 2, centre.y() - radius, 80, 16), Qt::AlignLeft, QString::number(r_max, 'g', 4));
+
+    // the angle runs along the samples, the decimation is over all of
+    // them at the resolution of the circumference
+    const std::size_t npixel = std::max(1, static_cast<int>(2.0 * M_PI * radius));
+    for (std::size_t s = 0; s < this->m_series.size(); s++) {
+        std::vector<double> theta;
+        std::vector<double> r;
+        this->decimate(this->m_series[s], 0, this->m_series[s].pyramid.size(), npixel, theta, r);
+        QPolygonF polyline;
+        polyline.reserve(theta.size());
+        for (std::size_t i = 0; i < theta.size(); i++) {
+            const double length = r[i] / r_max * radius;
+            polyline << QPointF(centre.x() + length * std::cos(theta[i] * kDegree), centre.y() - length * std::sin(theta[i] * kDegree));
+        }
+        this->m_drawn_points += polyline.size();
+        painter.setPen(QPen(this->color_of(s), 1.0));
+        painter.drawPolyline(polyline);
+    }
+}
+
+void PlotWidget::wheelEvent(QWheelEvent* event) {
+    double x_min = 0.0;
+    double x_max = 0.0;
+    if (Mode::Polar == this->m_mode || false == this->data_range(x_min, x_max)) {
+        return;
+    }
+    if (false == this->m_zoomed) {
+        this->m_view_min = x_min;
+        this->m_view_max = x_max;
+    }
+    const QRectF rect = this->plot_rect();
+    const double fraction = std::clamp((event->position().x() - rect.left()) / rect.width(), 0.0, 1.0);
+    const double anchor = this->m_view_min + fraction * (this->m_view_max - this->m_view_min);
+    const double factor = event->angleDelta().y() > 0 ? 0.8 : 1.25;
+    this->m_view_min = anchor - (anchor - this->m_view_min) * factor;
+    this->m_view_max = anchor + (this->m_view_max - anchor) * factor;
+    this->m_zoomed = true;
+    this->update();
+}
+
+void PlotWidget::mousePressEvent(QMouseEvent* event) {
+    this->m_drag_start = event->position();
+    double x_min = 0.0;
+    double x_max = 0.0;
+    if (false == this->m_zoomed && true == this->data_range(x_min, x_max)) {
+        this->m_view_min = x_min;
+        this->m_view_max = x_max;
+    }
+    this->m_drag_view_min = this->m_view_min;
+    this->m_drag_view_max = this->m_view_max;
+}
+
+void PlotWidget::mouseMoveEvent(QMouseEvent* event) {
+    if (Mode::Polar == this->m_mode || false == event->buttons().testFlag(Qt::LeftButton)) {
+        return;
+    }
+    const double shift = (event->position().x() - this->m_drag_start.x()) / this->plot_rect().width()
+        * (this->m_drag_view_max - this->m_drag_view_min);
+    this->m_view_min = this->m_drag_view_min - shift;
+    this->m_view_max = this->m_drag_view_max - shift;
+    this->m_zoomed = true;
+    this->update();
+}
+
+void PlotWidget::mouseDoubleClickEvent(QMouseEvent* event) {
+    Q_UNUSED(event);
+    this->m_zoomed = false;
+    this->update();
+}
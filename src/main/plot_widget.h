@@ -0,0 +1,121 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Plot of long series that stays interactive at any length.
+///
+/// Every series is kept in a SeriesPyramid, so a repaint costs about the
+/// widget width whatever the number of samples and whatever the zoom:
+/// each pixel column is drawn from its exact minimum and maximum, or from
+/// LTTB on top of them. Samples can be appended while the plot is shown;
+/// a view that reaches the last sample follows the new ones.
+///
+/// Modes: lines of y over x; a histogram of the y values in view; polar,
+/// with x the angle in degrees and y the radius. The wheel zooms around
+/// the cursor, dragging pans and a double click shows everything.
+
+#ifndef MAIN_PLOT_WIDGET_H
+#define MAIN_PLOT_WIDGET_H
+
+#include <QString>
+#include <QWidget>
+
+#include <vector>
+
+#include "utils/decimation.h"
+
+class PlotWidget : public QWidget {
+    Q_OBJECT
+public:
+    enum class Mode {
+        Line,
+        Histogram,
+        Polar,
+    };
+    enum class Decimation {
+        MinMax,
+        Lttb,
+    };
+
+    explicit PlotWidget(QWidget* parent = nullptr);
+
+    void set_mode(Mode mode);
+    void set_decimation(Decimation decimation);
+    void set_titles(const QString& x_title, const QString& y_title);
+
+    // returns the index of the new series
+    int add_series(const QString& name);
+    // x must not decrease, empty x continues the sample index
+    void append(int series, const std::vector<double>& x, const std::vector<double>& y);
+    void clear();
+
+    std::size_t get_series_count() const {
+        return m_series.size();
+    }
+    std::size_t get_total_points() const;
+    // points drawn by the last repaint and how long it took
+    std::size_t get_drawn_points() const {
+        return m_drawn_points;
+    }
+    double get_paint_ms() const {
+        return m_paint_ms;
+    }
+
+signals:
+    void painted();
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseDoubleClickEvent(QMouseEvent* event) override;
+
+private:
+    struct Series {
+        QString name;
+        SeriesPyramid pyramid;
+    };
+
+    // the x extent of all series
+    bool data_range(double& x_min, double& x_max) const;
+    QRectF plot_rect() const;
+    void draw_lines(QPainter& painter, const QRectF& rect);
+    void draw_histogram(QPainter& painter, const QRectF& rect);
+    void draw_polar(QPainter& painter, const QRectF& rect);
+    void decimate(const Series& series, std::size_t begin, std::size_t end, std::size_t npixel, std::vector<double>& x, std::vector<double>& y) const;
+    QColor color_of(std::size_t series) const;
+
+    Mode m_mode = Mode::Line;
+    Decimation m_decimation = Decimation::MinMax;
+    QString m_x_title;
+    QString m_y_title;
+    std::vector<Series> m_series;
+    // the x range shown, all when not zoomed
+    bool m_zoomed = false;
+    double m_view_min = 0.0;
+    double m_view_max = 1.0;
+    QPointF m_drag_start;
+    double m_drag_view_min = 0.0;
+    double m_drag_view_max = 1.0;
+    std::size_t m_drawn_points = 0;
+    double m_paint_ms = 0.0;
+};
+
+#endif // MAIN_PLOT_WIDGET_H
@@ -0,0 +1,198 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "main/vdos_dialog.h"
+
+#include <QApplication>
+#include <QFileInfo>
+#include <QFormLayout>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QVBoxLayout>
+#include <QtConcurrent/QtConcurrent>
+
+#include <chrono>
+
+#include "analysis/trajectory.h"
+#include "utils/logger.h"
+
+namespace {
+
+// "1-10 15 20", 1-based and inclusive, into 0-based indices; false on
+// syntax errors
+bool parse_atom_list(const QString& text, std::vector<int>& atoms) {
+    atoms.clear();
+    for (const auto& item : text.split(QRegularExpression("[,\\s]+"), Qt::SkipEmptyParts)) {
+        const auto bounds = item.split('-');
+        bool ok_first = false;
+        bool ok_last = false;
+        const int first = bounds[0].toInt(&ok_first);
+        const int last = 2 == bounds.size() ? bounds[1].toInt(&ok_last) : first;
+        if (false == ok_first || (2 == bounds.size() && false == ok_last) || bounds.size() > 2 || first < 1 || last < first) {
+            return false;
+        }
+        for (int i = first; i <= last; i++) {
+            atoms.push_back(i - 1);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+VdosDialog::VdosDialog(const QString& path, QWidget* parent)
+    : QDialog{parent}, m_path{path}, m_cancelled{std::make_shared<std::atomic<bool>>(false)} {
+    this->setWindowTitle(tr("Vibrational DOS - %1").arg(QFileInfo(path).fileName()));
+    this->resize(900, 650);
+    auto layout = new QVBoxLayout(this);
+    auto form_layout = new QFormLayout();
+    layout->addLayout(form_layout);
+    this->m_atoms_line_edit = new QLineEdit(this);
+    this->m_atoms_line_edit->setPlaceholderText(tr("all, or e.g. 1-10 15"));
+    form_layout->addRow(tr("Atoms"), this->m_atoms_line_edit);
+    this->m_max_lag_spin_box = new QSpinBox(this);
+    this->m_max_lag_spin_box->setRange(16, 1 << 20);
+    this->m_max_lag_spin_box->setValue(2048);
+    form_layout->addRow(tr("Longest lag (frames)"), this->m_max_lag_spin_box);
+    this->m_time_step_spin_box = new QDoubleSpinBox(this);
+    this->m_time_step_spin_box->setDecimals(3);
+    this->m_time_step_spin_box->setRange(0.001, 1.0e6);
+    this->m_time_step_spin_box->setValue(1.0);
+    form_layout->addRow(tr("Time between frames (fs)"), this->m_time_step_spin_box);
+    this->m_compute_button = new QPushButton(tr("Compute"), this);
+    form_layout->addRow(this->m_compute_button);
+    this->m_label = new QLabel(this);
+    layout->addWidget(this->m_label);
+    this->m_progress_bar = new QProgressBar(this);
+    layout->addWidget(this->m_progress_bar);
+    this->m_tab_widget = new QTabWidget(this);
+    layout->addWidget(this->m_tab_widget);
+    this->m_vdos_plot = new CurvePlot(this->m_tab_widget);
+    this->m_tab_widget->addTab(this->m_vdos_plot, tr("VDOS"));
+    this->m_vdos_plot->set_titles(tr("Wavenumber (cm^-1)"), tr("VDOS"));
+    this->m_vacf_plot = new CurvePlot(this->m_tab_widget);
+    this->m_tab_widget->addTab(this->m_vacf_plot, tr("VACF"));
+    this->m_vacf_plot->set_titles(tr("t (fs)"), tr("C(t) / C(0)"));
+
+    connect(this->m_compute_button, &QPushButton::clicked, this, &VdosDialog::compute);
+    connect(this->m_time_step_spin_box, &QDoubleSpinBox::valueChanged, this, &VdosDialog::update_plots);
+    this->compute();
+}
+
+VdosDialog::~VdosDialog() {
+    this->m_cancelled->store(true);
+}
+
+void VdosDialog::compute() {
+    std::vector<int> atoms;
+    if (false == parse_atom_list(this->m_atoms_line_edit->text(), atoms)) {
+        this->m_label->setText(tr("Atoms must be 1-based indices or ranges such as 1-10 15"));
+        return;
+    }
+    this->m_compute_button->setEnabled(false);
+    this->m_label->setText(tr("Reading %1").arg(this->m_path));
+    this->m_progress_bar->setValue(0);
+    const int max_lag = this->m_max_lag_spin_box->value();
+    auto path = this->m_path;
+    auto cancelled = this->m_cancelled;
+    QPointer<VdosDialog> dialog(this);
+    QtConcurrent::run([path, atoms, max_lag, cancelled, dialog]() {
+        const auto start = std::chrono::steady_clock::now();
+        VacfResult result;
+        FrameSpacing spacing;
+        QString error;
+        try {
+            TrajectoryReader reader(path.toStdString());
+            VacfAnalysis vacf(max_lag);
+            vacf.set_atoms(atoms);
+            int last_percent = -1;
+            reader.read([&](Frame& frame) {
+                vacf.add_frame(frame);
+                spacing.add_frame(frame);
+                const int percent = static_cast<int>(100 * reader.get_bytes_read() / std::max<std::uint64_t>(1, reader.get_file_size()));
+                if (percent != last_percent) {
+                    last_percent = percent;
+                    QMetaObject::invokeMethod(qApp, [dialog, percent]() {
+                        if (nullptr != dialog) {
+                            dialog->m_progress_bar->setValue(percent);
+                        }
+                    });
+                }
+                return false == cancelled->load();
+            });
+            result = vacf.result(reader.get_species_table());
+        } catch (const std::exception& e) {
+            error = QString::fromStdString(e.what());
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        QMetaObject::invokeMethod(qApp, [dialog, result, spacing, seconds, error]() {
+            if (nullptr == dialog) {
+                return;
+            }
+            dialog->m_compute_button->setEnabled(true);
+            dialog->m_progress_bar->setValue(100);
+            if (false == error.isEmpty()) {
+                dialog->m_label->setText(error);
+                LOG_ERROR("%s", qPrintable(error));
+                return;
+            }
+            QString text = tr("%1 frames in %2 s").arg(result.nframe).arg(seconds, 0, 'f', 2);
+            if (true == result.from_positions) {
+                text += tr(", no velocities in the file, steps between frames used");
+            }
+            if (result.nskipped > 0) {
+                text += tr(", %1 frames with another number of atoms skipped").arg(result.nskipped);
+            }
+            if (0.0 == spacing.get_time_step() && spacing.get_steps() > 0) {
+                text += tr(", frames %1 MD steps apart, set the time between them").arg(spacing.get_steps());
+            }
+            dialog->m_label->setText(text);
+            dialog->m_result = result;
+            // without frame times the value set by the user is kept
+            const double time_step = spacing.get_time_step();
+            if (time_step > 0.0 && time_step != dialog->m_time_step_spin_box->value()) {
+                // updates the plots through valueChanged
+                dialog->m_time_step_spin_box->setValue(time_step);
+            } else {
+                dialog->update_plots();
+            }
+        });
+    });
+}
+
+void VdosDialog::update_plots() {
+    const double time_step = this->m_time_step_spin_box->value();
+    std::vector<double> times(this->m_result.vacf.size());
+    for (std::size_t m = 0; m < times.size(); m++) {
+        times[m] = m * time_step;
+    }
+    std::vector<std::pair<QString, std::vector<double>>> vacf_curves;
+    std::vector<std::pair<QString, std::vector<double>>> vdos_curves;
+    vacf_curves.emplace_back(tr("all"), this->m_result.vacf);
+    vdos_curves.emplace_back(tr("all"), this->m_result.vdos);
+    for (const auto& species : this->m_result.species_vacf) {
+        vacf_curves.emplace_back(QString::fromStdString(species.first), species.second);
+    }
+    for (const auto& species : this->m_result.species_vdos) {
+        vdos_curves.emplace_back(QString::fromStdString(species.first), species.second);
+    }
+    this->m_vacf_plot->set_curves(times, vacf_curves);
+    this->m_vdos_plot->set_curves(vdos_wavenumbers(this->m_result.vdos.size(), time_step), vdos_curves);
+}
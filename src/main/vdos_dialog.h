@@ -0,0 +1,70 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// View > Plots > Vibrational DOS: the velocity autocorrelation and the
+/// vibrational density of states of a trajectory, of all atoms and of
+/// each species, optionally for a subset of the atoms.
+
+#ifndef MAIN_VDOS_DIALOG_H
+#define MAIN_VDOS_DIALOG_H
+
+#include <QDialog>
+#include <QDoubleSpinBox>
+#include <QLabel>
+#include <QLineEdit>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QTabWidget>
+
+#include <atomic>
+#include <memory>
+
+#include "analysis/vacf.h"
+#include "main/curve_plot.h"
+
+class VdosDialog : public QDialog {
+    Q_OBJECT
+public:
+    VdosDialog(const QString& path, QWidget* parent = nullptr);
+    ~VdosDialog();
+
+private:
+    void compute();
+    // redraws the result for the time step
+    void update_plots();
+
+    QString m_path;
+    QLineEdit* m_atoms_line_edit;
+    QSpinBox* m_max_lag_spin_box;
+    // fs between frames
+    QDoubleSpinBox* m_time_step_spin_box;
+    QPushButton* m_compute_button;
+    QLabel* m_label;
+    QProgressBar* m_progress_bar;
+    QTabWidget* m_tab_widget;
+    CurvePlot* m_vacf_plot;
+    CurvePlot* m_vdos_plot;
+    VacfResult m_result;
+    // the reading stops when the dialog is closed
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+#endif // MAIN_VDOS_DIALOG_H
@@ -20,7 +20,7 @@
 
 #include "atoms3d.h"
 
-#include <iostream>
+#include "utils/logger.h"
 
 Atoms3D::Atoms3D(QWidget* parent, Qt3DCore::QEntity* root_entity)
     : QWidget(parent), m_root_entity(root_entity) {
@@ -47,7 +47,7 @@ Atoms3D::Atoms3D(QWidget* parent, Qt3DCore::QEntity* root_entity)
 "H	5.762761	7.476846	6.820388\n"
 "O	5.815481	6.650009	6.468440\n"
     );
-    std::cout << this->m_crystal->natom() << std::endl;
+    LOG_DEBUG("Atoms3D: %d atoms", this->m_crystal->natom());
     int natom = this->m_crystal->natom();
     for (int i = 0; i < natom; i++) {
         auto sphere_entity = new Qt3DCore::QEntity(this->m_root_entity);
@@ -129,17 +129,13 @@ void Atoms3D::clean_draw() {
 }
 
 void Atoms3D::handle_picker_press(const Qt3DRender::QPickEvent* pick) {
-    std::cout << "Pressed " << "object name: "
-              << pick->entity()->objectName().toStdString()
-              << std::endl;
-    std::cout << "Position"
-              << " ->x " << pick->position().x()
-              << " ->y " << pick->position().y()
-              << std::endl;
-    std::cout << pick->entity()->components().length()
-              << std::endl;
-    std::cout << pick->entity()->components()[4]->objectName().toStdString()
-              << std::endl;
+    LOG_DEBUG("Pressed object name: %s, position ->x %.1f ->y %.1f, components: %d, status component: %s",
+        qPrintable(pick->entity()->objectName()),
+        pick->position().x(),
+        pick->position().y(),
+        static_cast<int>(pick->entity()->components().length()),
+        qPrintable(pick->entity()->components()[4]->objectName())
+    );
     this->set_atom_status_by_id(pick->entity()->id().id(), AtomStatus::Removed);
     if (pick->button() == Qt3DRender::QPickEvent::Buttons::RightButton) {
         this->m_rightpop_menu->popup(QCursor::pos());
@@ -147,17 +143,15 @@ void Atoms3D::handle_picker_press(const Qt3DRender::QPickEvent* pick) {
 }
 
 void Atoms3D::handle_picker_click(const Qt3DRender::QPickEvent* pick) {
-    std::cout << "Clicked " << "object name: "
-              << pick->entity()->objectName().toStdString()
-              << std::endl;
-    std::cout << "Pick Position"
-              << " ->x " << pick->position().x()
-              << " ->y " << pick->position().y()
-              << std::endl;
+    LOG_DEBUG("Clicked object name: %s, pick position ->x %.1f ->y %.1f",
+        qPrintable(pick->entity()->objectName()),
+        pick->position().x(),
+        pick->position().y()
+    );
 }
 
 void Atoms3D::handle_delete_atom() {
-    std::cout << "Delete atom" << std::endl;
+    LOG_DEBUG("Delete atom");
     this->draw_atoms();
 }
 
@@ -27,6 +27,7 @@
 #include <QSplitter>
 
 #include "modeling/tools.h"
+#include "utils/logger.h"
 
 Qt3DWindowCustom::Qt3DWindowCustom(QWidget* parent, QLayout* vlayout, QHBoxLayout* hlayout) {
 
@@ -67,14 +68,14 @@ Qt3DWindowCustom::Qt3DWindowCustom(QWidget* parent, QLayout* vlayout, QHBoxLayou
     mean_x = sum_each_xyz.at(0) / n;
     mean_y = sum_each_xyz.at(1) / n;
     mean_z = sum_each_xyz.at(2) / n;
-    std::cout << "Mean->XYZ: " << mean_x << " " << mean_y << " " << mean_z << std::endl;
+    LOG_DEBUG("Mean->XYZ: %f %f %f", mean_x, mean_y, mean_z);
 
     this->m_camera_entity->setViewCenter(QVector3D(mean_x, mean_y, mean_z));
-    std::cout << "View Center of the camera: "
-              << this->m_camera_entity->viewCenter().x() << " "
-              << this->m_camera_entity->viewCenter().y() << " "
-              << this->m_camera_entity->viewCenter().z()
-              << std::endl;
+    LOG_DEBUG("View Center of the camera: %f %f %f",
+        this->m_camera_entity->viewCenter().x(),
+        this->m_camera_entity->viewCenter().y(),
+        this->m_camera_entity->viewCenter().z()
+    );
     this->m_camera_entity->setPosition(QVector3D(0, 0, mean_z * 5));
     this->m_camera_entity->setUpVector(QVector3D(0, 1, 0));
 
@@ -131,22 +132,18 @@ Qt3DWindowCustom::Qt3DWindowCustom(QWidget* parent, QLayout* vlayout, QHBoxLayou
 
 void Qt3DWindowCustom::handle_picker_press(const Qt3DRender::QPickEvent* pick) {
 
-    std::cout << "Pressed " << "object name: " 
-              << pick->objectName().toStdString() 
-              << std::endl;
-    std::cout << "Position"
-              << " ->x " << pick->position().x()
-              << " ->y " << pick->position().y() 
-              << std::endl;
+    LOG_DEBUG("Pressed object name: %s, position ->x %.1f ->y %.1f",
+        qPrintable(pick->objectName()),
+        pick->position().x(),
+        pick->position().y()
+    );
 }
 
 void Qt3DWindowCustom::handle_picker_click(const Qt3DRender::QPickEvent* pick) {
 
-    std::cout << "Clicked " << "object name: " 
-              << pick->entity()->objectName().toStdString() 
-              << std::endl;
-    std::cout << "Pick Position"
-              << " ->x " << pick->position().x()
-              << " ->y " << pick->position().y() 
-              << std::endl;
+    LOG_DEBUG("Clicked object name: %s, pick position ->x %.1f ->y %.1f",
+        qPrintable(pick->entity()->objectName()),
+        pick->position().x(),
+        pick->position().y()
+    );
 }
@@ -0,0 +1,83 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "modeling_occ/atoms_presentation.h"
+
+#include <algorithm>
+
+#include <BRepPrimAPI_MakeSphere.hxx>
+#include <Graphic3d_ArrayOfPoints.hxx>
+#include <Prs3d_PointAspect.hxx>
+
+#include "utils/trace.h"
+
+std::vector<Handle(AIS_Shape)> build_atom_spheres(
+    const atomsciflow::Crystal& crystal,
+    atomsciflow::AtomicRadius& atomic_radius,
+    AtomicColor& atomic_color) {
+
+    TRACE_SCOPE_CAT("build_atom_spheres", "draw");
+    std::vector<Handle(AIS_Shape)> atom_shapes;
+    atom_shapes.reserve(crystal.atoms.size());
+    gp_Ax2 axis;
+    for (const auto& atom : crystal.atoms) {
+        axis.SetLocation(gp_Pnt(atom.x, atom.y, atom.z));
+        TopoDS_Shape atom_topo = BRepPrimAPI_MakeSphere(
+            axis,
+            atomic_radius.calculated[atom.name]
+        ).Shape();
+        Handle(AIS_Shape) atom_sphere = new AIS_Shape(atom_topo);
+
+        auto rgba = atomic_color.jmol[atom.name];
+        atom_sphere->SetColor(Quantity_Color{rgba[0] / 255., rgba[1] / 255., rgba[2] / 255., Quantity_TOC_sRGB});
+        atom_sphere->Attributes()->SetFaceBoundaryDraw(Standard_False);
+
+        atom_shapes.push_back(atom_sphere);
+    }
+    return atom_shapes;
+}
+
+Handle(AIS_PointCloud) build_atom_points(
+    const atomsciflow::Crystal& crystal,
+    AtomicColor& atomic_color,
+    int stride) {
+
+    TRACE_SCOPE_CAT("build_atom_points", "draw");
+    const int natom = static_cast<int>(crystal.atoms.size());
+    stride = std::max(1, stride);
+    const int npoint = (natom + stride - 1) / stride;
+
+    Handle(Graphic3d_ArrayOfPoints) points = new Graphic3d_ArrayOfPoints(npoint, Graphic3d_ArrayFlags_VertexColor);
+    for (int i = 0; i < natom; i += stride) {
+        const auto& atom = crystal.atoms[i];
+        auto rgba = atomic_color.jmol[atom.name];
+        points->AddVertex(
+            gp_Pnt(atom.x, atom.y, atom.z),
+            Quantity_Color{rgba[0] / 255., rgba[1] / 255., rgba[2] / 255., Quantity_TOC_sRGB}
+        );
+    }
+
+    Handle(AIS_PointCloud) atom_points = new AIS_PointCloud();
+    atom_points->SetPoints(points);
+    atom_points->Attributes()->SetPointAspect(
+        new Prs3d_PointAspect(Aspect_TOM_BALL, Quantity_NOC_WHITE, 2.0)
+    );
+    return atom_points;
+}
@@ -0,0 +1,52 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Construction of the OCCT presentations of the atoms, shared by the
+/// modeling view and the offscreen renderer of the batch mode.
+
+#ifndef MODELING_OCC_ATOMS_PRESENTATION_H
+#define MODELING_OCC_ATOMS_PRESENTATION_H
+
+#include <vector>
+
+#include <AIS_Shape.hxx>
+#include <AIS_PointCloud.hxx>
+
+#include <atomsciflow/base/crystal.h>
+#include <atomsciflow/base/atomic_radius.h>
+
+#include "modeling/atomic_color.h"
+
+// one shaded sphere per atom, sized by the calculated radius and
+// colored with the jmol scheme
+std::vector<Handle(AIS_Shape)> build_atom_spheres(
+    const atomsciflow::Crystal& crystal,
+    atomsciflow::AtomicRadius& atomic_radius,
+    AtomicColor& atomic_color
+);
+
+// every stride-th atom as a ball sprite, used as reduced representation
+Handle(AIS_PointCloud) build_atom_points(
+    const atomsciflow::Crystal& crystal,
+    AtomicColor& atomic_color,
+    int stride = 1
+);
+
+#endif // MODELING_OCC_ATOMS_PRESENTATION_H
@@ -0,0 +1,129 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "modeling_occ/frame_profiler.h"
+
+#include <Graphic3d_FrameStats.hxx>
+#include <OpenGl_FrameStats.hxx>
+
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+
+FrameProfiler::~FrameProfiler() {
+    this->release_queries();
+}
+
+void FrameProfiler::attach(const Handle(V3d_View)& view, const Handle(OpenGl_Context)& gl_context) {
+    this->release_queries();
+    m_view = view;
+    m_gl_context = gl_context;
+
+    // the counters are only gathered by OCCT when asked for
+    m_view->ChangeRenderingParams().CollectedStats = Graphic3d_RenderingParams::PerfCounters(
+        Graphic3d_RenderingParams::PerfCounters_FrameRate
+        | Graphic3d_RenderingParams::PerfCounters_CPU
+        | Graphic3d_RenderingParams::PerfCounters_Groups
+        | Graphic3d_RenderingParams::PerfCounters_GroupArrays
+        | Graphic3d_RenderingParams::PerfCounters_Triangles
+        | Graphic3d_RenderingParams::PerfCounters_Points
+    );
+
+    m_has_gpu_timer = false;
+    if (true == m_gl_context.IsNull() || false == m_gl_context->IsValid()) {
+        return;
+    }
+    m_gl_context->MakeCurrent();
+    if (m_gl_context->core15fwd != nullptr && m_gl_context->core33 != nullptr
+        && (m_gl_context->IsGlGreaterEqual(3, 3) || m_gl_context->CheckExtension("GL_ARB_timer_query"))) {
+        m_gl_context->core15fwd->glGenQueries(2, m_queries);
+        m_has_gpu_timer = true;
+    }
+}
+
+void FrameProfiler::release_queries() {
+    if (true == m_has_gpu_timer && false == m_gl_context.IsNull() && m_gl_context->MakeCurrent()) {
+        m_gl_context->core15fwd->glDeleteQueries(2, m_queries);
+    }
+    m_has_gpu_timer = false;
+    m_query_pending[0] = false;
+    m_query_pending[1] = false;
+}
+
+void FrameProfiler::begin_frame() {
+    m_cpu_timer.start();
+    if (true == m_has_gpu_timer && m_gl_context->MakeCurrent()) {
+        m_gl_context->core15fwd->glBeginQuery(GL_TIME_ELAPSED, m_queries[m_query_index]);
+    }
+}
+
+FrameRecord FrameProfiler::end_frame(int visible_atoms, bool wait_gpu) {
+    FrameRecord record;
+    record.visible_atoms = visible_atoms;
+
+    if (true == m_has_gpu_timer && m_gl_context->MakeCurrent()) {
+        auto gl = m_gl_context->core15fwd;
+        gl->glEndQuery(GL_TIME_ELAPSED);
+        m_query_pending[m_query_index] = true;
+        // read back the query of this frame when waiting is allowed,
+        // otherwise the one issued a frame earlier
+        const int read_index = true == wait_gpu ? m_query_index : 1 - m_query_index;
+        if (true == m_query_pending[read_index]) {
+            GLint available = 0;
+            if (false == wait_gpu) {
+                gl->glGetQueryObjectiv(m_queries[read_index], GL_QUERY_RESULT_AVAILABLE, &available);
+            }
+            if (true == wait_gpu || 0 != available) {
+                GLuint64 elapsed_ns = 0;
+                m_gl_context->core33->glGetQueryObjectui64v(m_queries[read_index], GL_QUERY_RESULT, &elapsed_ns);
+                m_last_gpu_ms = elapsed_ns / 1.0e6;
+                m_query_pending[read_index] = false;
+            }
+        }
+        m_query_index = 1 - m_query_index;
+        record.gpu_ms = m_last_gpu_ms;
+    }
+    record.cpu_ms = m_cpu_timer.nsecsElapsed() / 1.0e6;
+
+    if (false == m_gl_context.IsNull() && false == m_gl_context->FrameStats().IsNull()) {
+        const Graphic3d_FrameStatsData& data = m_gl_context->FrameStats()->LastDataFrame();
+        record.draw_calls = static_cast<int>(data[Graphic3d_FrameStatsCounter_NbElemsNotCulled]);
+        record.triangles = static_cast<int>(data[Graphic3d_FrameStatsCounter_NbTrianglesNotCulled]);
+        record.points = static_cast<int>(data[Graphic3d_FrameStatsCounter_NbPointsNotCulled]);
+    }
+    return record;
+}
+
+FrameRecordCsv::FrameRecordCsv(const std::string& path) {
+    m_stream.open(path);
+    if (true == m_stream.is_open()) {
+        m_stream << "frame,cpu_ms,gpu_ms,draw_calls,triangles,points,visible_atoms\n";
+    }
+}
+
+void FrameRecordCsv::write(int frame, const FrameRecord& record) {
+    m_stream << frame << ","
+             << record.cpu_ms << ","
+             << record.gpu_ms << ","
+             << record.draw_calls << ","
+             << record.triangles << ","
+             << record.points << ","
+             << record.visible_atoms << "\n";
+}
@@ -0,0 +1,90 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef MODELING_OCC_FRAME_PROFILER_H
+#define MODELING_OCC_FRAME_PROFILER_H
+
+#include <string>
+#include <fstream>
+
+#include <QElapsedTimer>
+
+#include <OpenGl_Context.hxx>
+#include <V3d_View.hxx>
+
+/// Per-frame rendering statistics of an OccView.
+struct FrameRecord {
+    double cpu_ms = 0.0;
+    // negative when GPU timer queries are not available
+    double gpu_ms = -1.0;
+    int draw_calls = 0;
+    int triangles = 0;
+    int points = 0;
+    int visible_atoms = 0;
+};
+
+/// Measures the CPU time of a redraw, the GPU time with OpenGL timer
+/// queries where the context supports them, and collects the draw call
+/// and primitive counters of OCCT's frame statistics.
+class FrameProfiler {
+public:
+    FrameProfiler() = default;
+    ~FrameProfiler();
+
+    void attach(const Handle(V3d_View)& view, const Handle(OpenGl_Context)& gl_context);
+
+    void begin_frame();
+    // with wait_gpu false the GPU time of an earlier frame is reported,
+    // so that the GUI thread never stalls on the query result
+    FrameRecord end_frame(int visible_atoms, bool wait_gpu = false);
+
+    bool has_gpu_timer() const {
+        return m_has_gpu_timer;
+    }
+
+private:
+    void release_queries();
+
+    Handle(V3d_View) m_view;
+    Handle(OpenGl_Context) m_gl_context;
+    QElapsedTimer m_cpu_timer;
+
+    bool m_has_gpu_timer = false;
+    unsigned int m_queries[2] = {0, 0};
+    bool m_query_pending[2] = {false, false};
+    int m_query_index = 0;
+    double m_last_gpu_ms = -1.0;
+};
+
+/// Writes FrameRecord rows into a CSV file.
+class FrameRecordCsv {
+public:
+    explicit FrameRecordCsv(const std::string& path);
+
+    bool is_open() const {
+        return m_stream.is_open();
+    }
+    void write(int frame, const FrameRecord& record);
+
+private:
+    std::ofstream m_stream;
+};
+
+#endif // MODELING_OCC_FRAME_PROFILER_H
@@ -0,0 +1,73 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "modeling_occ/isosurface_presentation.h"
+
+#include <Graphic3d_Group.hxx>
+#include <Prs3d_ShadingAspect.hxx>
+
+#include "utils/trace.h"
+
+Handle(Graphic3d_ArrayOfTriangles) build_isosurface_triangles(const Isosurface& surface) {
+    TRACE_SCOPE_CAT("build_isosurface_triangles", "draw");
+    const int nvertex = static_cast<int>(surface.nvertex());
+    const int nedge = static_cast<int>(surface.triangles.size());
+    Handle(Graphic3d_ArrayOfTriangles) triangles = new Graphic3d_ArrayOfTriangles(nvertex, nedge, Graphic3d_ArrayFlags_VertexNormal);
+    for (int v = 0; v < nvertex; v++) {
+        const float* position = &surface.positions[3 * v];
+        const float* normal = &surface.normals[3 * v];
+        triangles->AddVertex(Graphic3d_Vec3(position[0], position[1], position[2]));
+        triangles->SetVertexNormal(v + 1, normal[0], normal[1], normal[2]);
+    }
+    // the edges of OCCT arrays are 1-based
+    for (int e = 0; e + 2 < nedge; e += 3) {
+        triangles->AddTriangleEdges(
+            static_cast<int>(surface.triangles[e]) + 1,
+            static_cast<int>(surface.triangles[e + 1]) + 1,
+            static_cast<int>(surface.triangles[e + 2]) + 1
+        );
+    }
+    return triangles;
+}
+
+IsosurfacePresentation::IsosurfacePresentation(const Quantity_Color& color, double transparency) {
+    Handle(Prs3d_ShadingAspect) shading = new Prs3d_ShadingAspect();
+    shading->SetColor(color);
+    shading->SetTransparency(transparency);
+    myDrawer->SetShadingAspect(shading);
+    myDrawer->SetColor(color);
+    myDrawer->SetTransparency(static_cast<Standard_ShortReal>(transparency));
+    this->SetDisplayMode(0);
+}
+
+void IsosurfacePresentation::set_surface(const Isosurface& surface) {
+    m_ntriangle = surface.ntriangle();
+    m_triangles = 0 == m_ntriangle ? Handle(Graphic3d_ArrayOfTriangles)() : build_isosurface_triangles(surface);
+    this->SetToUpdate();
+}
+
+void IsosurfacePresentation::Compute(const Handle(PrsMgr_PresentationManager)& manager, const Handle(Prs3d_Presentation)& presentation, const Standard_Integer mode) {
+    if (true == m_triangles.IsNull()) {
+        return;
+    }
+    Handle(Graphic3d_Group) group = presentation->NewGroup();
+    group->SetGroupPrimitivesAspect(myDrawer->ShadingAspect()->Aspect());
+    group->AddPrimitiveArray(m_triangles);
+}
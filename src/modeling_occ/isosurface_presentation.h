@@ -0,0 +1,61 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// OCCT presentation of an isosurface: one shaded triangle array with
+/// the vertex normals of the surface, drawn with the atoms.
+
+#ifndef MODELING_OCC_ISOSURFACE_PRESENTATION_H
+#define MODELING_OCC_ISOSURFACE_PRESENTATION_H
+
+#include <AIS_InteractiveObject.hxx>
+#include <Graphic3d_ArrayOfTriangles.hxx>
+#include <Quantity_Color.hxx>
+
+#include "analysis/isosurface.h"
+
+Handle(Graphic3d_ArrayOfTriangles) build_isosurface_triangles(const Isosurface& surface);
+
+class IsosurfacePresentation : public AIS_InteractiveObject {
+    DEFINE_STANDARD_RTTI_INLINE(IsosurfacePresentation, AIS_InteractiveObject)
+public:
+    IsosurfacePresentation(const Quantity_Color& color, double transparency = 0.3);
+
+    // the presentation is recomputed when the context redisplays it
+    void set_surface(const Isosurface& surface);
+
+    std::size_t get_ntriangle() const {
+        return m_ntriangle;
+    }
+
+    Standard_Boolean AcceptDisplayMode(const Standard_Integer mode) const override {
+        return 0 == mode;
+    }
+
+private:
+    void Compute(const Handle(PrsMgr_PresentationManager)& manager, const Handle(Prs3d_Presentation)& presentation, const Standard_Integer mode) override;
+    // the surface is not selectable
+    void ComputeSelection(const Handle(SelectMgr_Selection)& selection, const Standard_Integer mode) override {
+    }
+
+    Handle(Graphic3d_ArrayOfTriangles) m_triangles;
+    std::size_t m_ntriangle = 0;
+};
+
+#endif // MODELING_OCC_ISOSURFACE_PRESENTATION_H
@@ -21,11 +21,27 @@
 #include "modeling_occ/modeling.h"
 
 #include <QAction>
+#include <QApplication>
+#include <QPointer>
+#include <QtConcurrent/QtConcurrent>
 
-#include <BRepPrimAPI_MakeSphere.hxx>
+#include <algorithm>
+#include <cmath>
 
-ModelingControl::ModelingControl(QWidget* parent)
+#include "batch/batch.h"
+#include "modeling_occ/atoms_presentation.h"
+#include "utils/logger.h"
+#include "utils/trace.h"
+
+namespace {
+// point sprites drawn at most for the reduced representation before
+// the frame time feedback takes over
+const int kMaxReducedPoints = 1000000;
+}
+
+ModelingControl::ModelingControl(QWidget* parent, const Handle(Graphic3d_GraphicDriver)& graphic_driver)
     : QWidget{parent} {
+    TRACE_SCOPE("ModelingControl::ModelingControl");
 
     this->m_crystal = std::make_shared<atomsciflow::Crystal>();
     this->m_atomic_radius = std::make_shared<atomsciflow::AtomicRadius>();
@@ -35,42 +51,317 @@ ModelingControl::ModelingControl(QWidget* parent)
     m_layout->setSpacing(0);
     m_layout->setContentsMargins(2, 2, 2, 2);
 
-    m_occview = new OccView(this);
+    m_occview = new OccView(this, graphic_driver);
     m_layout->addWidget(m_occview);
+    QObject::connect(m_occview, &OccView::interaction_started, this, &ModelingControl::on_interaction_started);
+    QObject::connect(m_occview, &OccView::interaction_finished, this, &ModelingControl::on_interaction_finished);
+    QObject::connect(m_occview, &OccView::frame_rendered, this, &ModelingControl::on_frame_rendered);
 
     this->setLayout(m_layout);
 
     this->show();
 
-    this->m_crystal->read_xyz_str(
+    {
+        TRACE_SCOPE_CAT("Crystal::read_xyz_str", "parse");
+        this->m_crystal->read_xyz_str(
 "3\n"
 "cell: 15.000000 0.000000 0.000000 | 0.000000 15.000000 0.000000 | 0.000000 0.000000 15.000000\n"
 "H	6.759403	6.670494	6.820388\n"
 "H	5.762761	7.476846	6.820388\n"
 "O	5.815481	6.650009	6.468440\n"
-    );
+        );
+    }
     this->draw_atoms();
 }
 
 void ModelingControl::draw_atoms() {
-    gp_Ax2 axis;
-    for (const auto& atom : this->m_crystal->atoms) {
-        axis.SetLocation(gp_Pnt(atom.x, atom.y, atom.z));
-        TopoDS_Shape atom_topo = BRepPrimAPI_MakeSphere(
-            axis,
-            this->m_atomic_radius->calculated[atom.name]
-        ).Shape();
-        Handle(AIS_Shape) atom_sphere = new AIS_Shape(atom_topo);
-
-        auto rgba = this->m_atomic_color->jmol[atom.name];
-        atom_sphere->SetColor(Quantity_Color{rgba[0] / 255., rgba[1] / 255., rgba[2] / 255., Quantity_TOC_sRGB});
-        atom_sphere->Attributes()->SetFaceBoundaryDraw(Standard_False);
-
-        m_occview->get_context()->Display(atom_sphere, Standard_True);
+    TRACE_SCOPE_CAT("ModelingControl::draw_atoms", "draw");
+    const auto& settings = m_occview->get_progressive_settings();
+    const int natom = this->m_crystal->natom();
+    const bool progressive = settings.enabled && natom >= settings.min_atoms;
+
+    this->m_reduced_shown = false;
+    if (true == progressive) {
+        // show the subsampled point set first, so that large structures
+        // appear at once and are refined when the spheres are ready
+        this->m_subsample_stride = std::max(this->m_subsample_stride, natom / kMaxReducedPoints);
+        this->build_reduced_atoms();
+        m_occview->get_context()->Display(m_atom_points, Standard_False);
+        m_occview->set_visible_atoms(m_atom_points->GetPoints()->VertexNumber());
         m_occview->fit_all_auto();
+        m_occview->get_context()->UpdateCurrentViewer();
+        this->m_reduced_shown = true;
+    }
+
+    this->build_full_atoms();
+    if (true == progressive && true == m_occview->is_interacting()) {
+        // the refinement is done in on_interaction_finished()
+        return;
+    }
+    this->show_reduced_atoms(false);
+    m_occview->fit_all_auto();
+}
+
+void ModelingControl::build_full_atoms() {
+    this->m_atom_shapes = build_atom_spheres(*this->m_crystal, *this->m_atomic_radius, *this->m_atomic_color);
+}
+
+void ModelingControl::build_reduced_atoms() {
+    if (false == this->m_atom_points.IsNull()) {
+        m_occview->get_context()->Remove(this->m_atom_points, Standard_False);
+    }
+    this->m_atom_points = build_atom_points(*this->m_crystal, *this->m_atomic_color, this->m_subsample_stride);
+}
+
+void ModelingControl::show_reduced_atoms(bool reduced) {
+    TRACE_SCOPE_CAT("ModelingControl::show_reduced_atoms", "draw");
+    auto context = m_occview->get_context();
+    if (true == reduced) {
+        for (const auto& atom_sphere : this->m_atom_shapes) {
+            context->Erase(atom_sphere, Standard_False);
+        }
+        if (false == this->m_atom_points.IsNull()) {
+            context->Display(this->m_atom_points, Standard_False);
+        }
+    } else {
+        if (false == this->m_atom_points.IsNull()) {
+            context->Erase(this->m_atom_points, Standard_False);
+        }
+        for (const auto& atom_sphere : this->m_atom_shapes) {
+            context->Display(atom_sphere, Standard_False);
+        }
+    }
+    this->m_reduced_shown = reduced;
+    if (true == reduced && false == this->m_atom_points.IsNull()) {
+        m_occview->set_visible_atoms(this->m_atom_points->GetPoints()->VertexNumber());
+    } else {
+        m_occview->set_visible_atoms(static_cast<int>(this->m_atom_shapes.size()));
+    }
+    context->UpdateCurrentViewer();
+}
+
+void ModelingControl::on_interaction_started() {
+    const auto& settings = m_occview->get_progressive_settings();
+    if (this->m_crystal->natom() < settings.min_atoms || true == this->m_reduced_shown) {
+        return;
+    }
+    this->build_reduced_atoms();
+    this->show_reduced_atoms(true);
+}
+
+void ModelingControl::on_interaction_finished() {
+    if (false == this->m_reduced_shown) {
+        return;
+    }
+    this->show_reduced_atoms(false);
+}
+
+void ModelingControl::on_frame_rendered(double frame_ms) {
+    if (false == this->m_reduced_shown) {
+        return;
+    }
+    // adapt the subsampling to the frame time target, the new stride
+    // is used when the reduced representation is built the next time
+    const double target_ms = m_occview->get_progressive_settings().interactive_frame_ms;
+    if (frame_ms > target_ms && this->m_subsample_stride < this->m_crystal->natom()) {
+        this->m_subsample_stride *= 2;
+    } else if (frame_ms < 0.25 * target_ms && this->m_subsample_stride > 1) {
+        this->m_subsample_stride /= 2;
+    }
+}
+
+void ModelingControl::open_structure(const std::string& file_path) {
+    TRACE_SCOPE_CAT("ModelingControl::open_structure", "io");
+    std::string key;
+    CachedStructure cached;
+    bool cache_hit = false;
+    bool stored = false;
+    if (nullptr != this->m_structure_cache) {
+        key = this->m_structure_cache->key_of(file_path);
+        cache_hit = this->m_structure_cache->load(key, cached);
+    }
+
+    if (true == cache_hit) {
+        TRACE_SCOPE_CAT("ModelingControl::open_structure cached", "io");
+        this->m_crystal->atoms.resize(cached.natom);
+        for (int i = 0; i < cached.natom; i++) {
+            auto& atom = this->m_crystal->atoms[i];
+            atom.name = cached.species_names[cached.species[i]];
+            atom.x = cached.positions[3 * i + 0];
+            atom.y = cached.positions[3 * i + 1];
+            atom.z = cached.positions[3 * i + 2];
+        }
+        this->m_crystal->cell.clear();
+        if (true == cached.periodic) {
+            for (int i = 0; i < 3; i++) {
+                this->m_crystal->cell.push_back({cached.cell[i][0], cached.cell[i][1], cached.cell[i][2]});
+            }
+        }
+        this->m_bonds.resize(cached.nbond);
+        for (int b = 0; b < cached.nbond; b++) {
+            this->m_bonds[b] = Bond{cached.bonds[2 * b], cached.bonds[2 * b + 1]};
+        }
+        LOG_DEBUG("Loaded %s from the structure cache", file_path.c_str());
+    } else {
+        read_structure_file(*this->m_crystal, file_path);
+        SpeciesTable species_table;
+        auto frame = frame_from_crystal(*this->m_crystal, species_table);
+        this->m_bonds = detect_bonds(frame, species_radii(species_table, *this->m_atomic_radius));
+        // a failed store only costs the next open a parse
+        stored = nullptr != this->m_structure_cache
+            && this->m_structure_cache->store(key, frame, species_table, this->m_bonds);
+    }
+
+    this->hide_atoms();
+    this->m_volumetric.reset();
+    this->m_extractors[0].reset();
+    this->m_extractors[1].reset();
+    this->m_pending = false;
+    this->m_subsample_stride = 1;
+    this->draw_atoms();
+
+    // previewed by the open dialog
+    if (true == stored && false == m_occview->get_view()->Dump(this->m_structure_cache->thumbnail_path(key).c_str())) {
+        LOG_WARNING("Can not save the thumbnail of %s", file_path.c_str());
     }
 }
 
 void ModelingControl::hide_atoms() {
     m_occview->get_context()->EraseAll(m_occview);
 }
+
+void ModelingControl::open_volumetric(const std::string& file_path) {
+    QPointer<ModelingControl> control(this);
+    QtConcurrent::run([file_path, control]() {
+        TRACE_SCOPE_CAT("ModelingControl::open_volumetric", "io");
+        auto volumetric = std::make_shared<VolumetricData>();
+        float isovalue = 0.0f;
+        std::shared_ptr<IsosurfaceExtractor> extractors[2];
+        auto positive = std::make_shared<Isosurface>();
+        auto negative = std::make_shared<Isosurface>();
+        try {
+            *volumetric = read_volumetric(file_path);
+            isovalue = suggest_isovalue(*volumetric);
+            auto index = std::make_shared<const IsosurfaceIndex>(volumetric);
+            extractors[0] = std::make_shared<IsosurfaceExtractor>(index);
+            extractors[1] = std::make_shared<IsosurfaceExtractor>(index, true);
+            *positive = extractors[0]->extract(isovalue);
+            if (volumetric->min_value < -isovalue) {
+                *negative = extractors[1]->extract(-isovalue);
+            }
+        } catch (const std::exception& e) {
+            LOG_ERROR("Can not read %s: %s", file_path.c_str(), e.what());
+            return;
+        }
+        LOG_INFO("Read %s, %d x %d x %d points, isovalue %g, %zu triangles", file_path.c_str(),
+            volumetric->n[0], volumetric->n[1], volumetric->n[2], isovalue, positive->ntriangle() + negative->ntriangle());
+        QMetaObject::invokeMethod(qApp, [control, volumetric, extractors, isovalue, positive, negative]() {
+            if (nullptr != control) {
+                control->set_volumetric(volumetric, extractors[0], extractors[1], isovalue, *positive, *negative);
+            }
+        });
+    });
+}
+
+void ModelingControl::set_volumetric(
+    const std::shared_ptr<VolumetricData>& volumetric,
+    const std::shared_ptr<IsosurfaceExtractor>& positive_extractor,
+    const std::shared_ptr<IsosurfaceExtractor>& negative_extractor,
+    float isovalue,
+    const Isosurface& positive,
+    const Isosurface& negative) {
+    TRACE_SCOPE_CAT("ModelingControl::set_volumetric", "draw");
+    this->m_volumetric = volumetric;
+    this->m_extractors[0] = positive_extractor;
+    this->m_extractors[1] = negative_extractor;
+    this->m_pending = false;
+    this->m_isovalue = isovalue;
+    const auto& frame = volumetric->frame;
+    this->m_crystal->atoms.resize(frame.natom());
+    for (int i = 0; i < frame.natom(); i++) {
+        auto& atom = this->m_crystal->atoms[i];
+        atom.name = volumetric->species_table.names[frame.species[i]];
+        atom.x = frame.positions[3 * i + 0];
+        atom.y = frame.positions[3 * i + 1];
+        atom.z = frame.positions[3 * i + 2];
+    }
+    this->m_crystal->cell = frame.cell;
+    this->m_bonds = detect_bonds(frame, species_radii(volumetric->species_table, *this->m_atomic_radius));
+
+    this->hide_atoms();
+    this->m_subsample_stride = 1;
+    this->draw_atoms();
+    this->display_isosurface(positive, negative);
+    m_occview->fit_all_auto();
+    emit this->volumetric_loaded(std::max(std::fabs(volumetric->min_value), std::fabs(volumetric->max_value)), isovalue);
+}
+
+void ModelingControl::show_isosurface(float isovalue) {
+    if (nullptr == this->m_extractors[0]) {
+        return;
+    }
+    if (true == this->m_extracting) {
+        this->m_pending = true;
+        this->m_pending_isovalue = isovalue;
+        return;
+    }
+    this->extract_isosurface_async(isovalue);
+}
+
+void ModelingControl::extract_isosurface_async(float isovalue) {
+    this->m_extracting = true;
+    QPointer<ModelingControl> control(this);
+    const auto positive_extractor = this->m_extractors[0];
+    const auto negative_extractor = this->m_extractors[1];
+    const bool with_negative = this->m_volumetric->min_value < -isovalue;
+    QtConcurrent::run([control, positive_extractor, negative_extractor, isovalue, with_negative]() {
+        TRACE_SCOPE_CAT("ModelingControl::show_isosurface", "analysis");
+        auto positive = std::make_shared<Isosurface>(positive_extractor->extract(isovalue));
+        double milliseconds = positive_extractor->get_statistics().milliseconds;
+        auto negative = std::make_shared<Isosurface>();
+        if (true == with_negative) {
+            *negative = negative_extractor->extract(-isovalue);
+            milliseconds += negative_extractor->get_statistics().milliseconds;
+        }
+        QMetaObject::invokeMethod(qApp, [control, positive_extractor, isovalue, positive, negative, milliseconds]() {
+            if (nullptr == control) {
+                return;
+            }
+            control->m_extracting = false;
+            // other data may have been opened meanwhile
+            if (positive_extractor == control->m_extractors[0]) {
+                control->m_isovalue = isovalue;
+                control->display_isosurface(*positive, *negative);
+                emit control->isosurface_updated(isovalue, positive->ntriangle() + negative->ntriangle(), milliseconds);
+            }
+            if (true == control->m_pending) {
+                control->m_pending = false;
+                control->show_isosurface(control->m_pending_isovalue);
+            }
+        });
+    });
+}
+
+void ModelingControl::display_isosurface(const Isosurface& positive, const Isosurface& negative) {
+    TRACE_SCOPE_CAT("ModelingControl::display_isosurface", "draw");
+    auto context = m_occview->get_context();
+    const Isosurface* surfaces[2] = {&positive, &negative};
+    const Quantity_Color colors[2] = {
+        Quantity_Color{1.0, 0.85, 0.2, Quantity_TOC_sRGB},
+        Quantity_Color{0.2, 0.5, 1.0, Quantity_TOC_sRGB},
+    };
+    for (int s = 0; s < 2; s++) {
+        if (true == this->m_isosurfaces[s].IsNull()) {
+            this->m_isosurfaces[s] = new IsosurfacePresentation(colors[s]);
+        }
+        this->m_isosurfaces[s]->set_surface(*surfaces[s]);
+        if (0 == surfaces[s]->ntriangle()) {
+            context->Erase(this->m_isosurfaces[s], Standard_False);
+        } else if (true == context->IsDisplayed(this->m_isosurfaces[s])) {
+            context->Redisplay(this->m_isosurfaces[s], Standard_False);
+        } else {
+            context->Display(this->m_isosurfaces[s], 0, -1, Standard_False);
+        }
+    }
+    context->UpdateCurrentViewer();
+}
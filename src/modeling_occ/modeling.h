@@ -24,31 +24,109 @@
 #include <QWidget>
 #include <QVBoxLayout>
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <AIS_ColoredShape.hxx>
+#include <AIS_PointCloud.hxx>
 
 #include <atomsciflow/base/crystal.h>
 #include <atomsciflow/base/atomic_radius.h>
 
+#include "analysis/bonds.h"
+#include "analysis/isosurface.h"
+#include "analysis/volumetric.h"
+#include "cache/structure_cache.h"
 #include "modeling/atomic_color.h"
+#include "modeling_occ/isosurface_presentation.h"
 #include "modeling_occ/occview.h"
 
 class ModelingControl : public QWidget {
     Q_OBJECT
 public:
-    ModelingControl(QWidget* parent = nullptr);
+    ModelingControl(QWidget* parent = nullptr, const Handle(Graphic3d_GraphicDriver)& graphic_driver = nullptr);
     ~ModelingControl() = default;
 
     void draw_atoms();
     void hide_atoms();
 
+    // read xyz or cif, a structure seen before is loaded from the cache
+    void open_structure(const std::string& file_path);
+
+    // reads a CUBE or CHGCAR file in the background, then shows its atoms
+    // and the isosurfaces at a suggested isovalue
+    void open_volumetric(const std::string& file_path);
+    // the surfaces at +isovalue and, for data with both signs, -isovalue;
+    // extracted in the background, a call during an extraction only
+    // replaces the isovalue extracted next, so a slider never queues up
+    void show_isosurface(float isovalue);
+
+    void set_structure_cache(const std::shared_ptr<StructureCache>& structure_cache) {
+        m_structure_cache = structure_cache;
+    }
+
+    std::shared_ptr<StructureCache> get_structure_cache() const {
+        return m_structure_cache;
+    }
+
+    const std::vector<Bond>& get_bonds() const {
+        return m_bonds;
+    }
+
+    OccView* get_occview() {
+        return m_occview;
+    }
+
     std::shared_ptr<atomsciflow::Crystal> m_crystal;
 
+signals:
+    // the largest absolute value of the data and the isovalue shown
+    void volumetric_loaded(float max_abs_value, float isovalue);
+    void isosurface_updated(float isovalue, qulonglong ntriangle, double milliseconds);
+
+private slots:
+    void on_interaction_started();
+    void on_interaction_finished();
+    void on_frame_rendered(double frame_ms);
+
 private:
+    void build_full_atoms();
+    void set_volumetric(
+        const std::shared_ptr<VolumetricData>& volumetric,
+        const std::shared_ptr<IsosurfaceExtractor>& positive_extractor,
+        const std::shared_ptr<IsosurfaceExtractor>& negative_extractor,
+        float isovalue,
+        const Isosurface& positive,
+        const Isosurface& negative);
+    void extract_isosurface_async(float isovalue);
+    void display_isosurface(const Isosurface& positive, const Isosurface& negative);
+    void build_reduced_atoms();
+    void show_reduced_atoms(bool reduced);
 
     QVBoxLayout* m_layout;
 
     std::shared_ptr<atomsciflow::AtomicRadius> m_atomic_radius;
     std::shared_ptr<AtomicColor> m_atomic_color;
+    std::shared_ptr<StructureCache> m_structure_cache;
+    std::vector<Bond> m_bonds;
     OccView* m_occview;
+
+    std::vector<Handle(AIS_Shape)> m_atom_shapes;
+    Handle(AIS_PointCloud) m_atom_points;
+    bool m_reduced_shown = false;
+    // only every m_subsample_stride-th atom is drawn during interaction
+    int m_subsample_stride = 1;
+
+    std::shared_ptr<VolumetricData> m_volumetric;
+    float m_isovalue = 0.0f;
+    // at +isovalue and, flipped, at -isovalue; they keep the blocks of the
+    // last isovalue for the next one
+    std::shared_ptr<IsosurfaceExtractor> m_extractors[2];
+    bool m_extracting = false;
+    bool m_pending = false;
+    float m_pending_isovalue = 0.0f;
+    // at +isovalue and -isovalue
+    Handle(IsosurfacePresentation) m_isosurfaces[2];
 };
 #endif // MODELING_OCC_MODELING_H
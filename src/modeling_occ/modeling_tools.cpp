@@ -24,6 +24,16 @@
 #include <QGroupBox>
 #include <QButtonGroup>
 
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int kSliderSteps = 1000;
+const double kSliderDecades = 4.0;
+
+} // namespace
+
 ModelingTools::ModelingTools(QWidget* parent, ModelingControl* modeling_widget)
     : QWidget(parent) {
 
@@ -72,9 +82,25 @@ ModelingTools::ModelingTools(QWidget* parent, ModelingControl* modeling_widget)
     checkbox_show_atoms->setText(QCoreApplication::translate("ModelingTools", "Show Atoms", nullptr));
     QObject::connect(checkbox_show_atoms, &QCheckBox::stateChanged, this, &ModelingTools::on_checkbox_state_changed);
 
-    auto horizontal_slider = new QSlider(tab_1);
-    grid_layout->addWidget(horizontal_slider, 1, 0, 1, 1);
-    horizontal_slider->setOrientation(Qt::Horizontal);
+    auto isovalue_title = new QLabel(tab_1);
+    grid_layout->addWidget(isovalue_title, 1, 0, 1, 1);
+    isovalue_title->setText(QCoreApplication::translate("ModelingTools", "Isovalue", nullptr));
+
+    m_isovalue_slider = new QSlider(tab_1);
+    grid_layout->addWidget(m_isovalue_slider, 2, 0, 1, 1);
+    m_isovalue_slider->setOrientation(Qt::Horizontal);
+    m_isovalue_slider->setRange(0, kSliderSteps);
+    m_isovalue_slider->setEnabled(false);
+    QObject::connect(m_isovalue_slider, &QSlider::valueChanged, this, &ModelingTools::on_isovalue_slider_moved);
+
+    m_isovalue_label = new QLabel(tab_1);
+    grid_layout->addWidget(m_isovalue_label, 3, 0, 1, 1);
+    m_isovalue_label->setText(QCoreApplication::translate("ModelingTools", "No volumetric data", nullptr));
+
+    if (nullptr != this->m_modeling_widget) {
+        QObject::connect(this->m_modeling_widget, &ModelingControl::volumetric_loaded, this, &ModelingTools::on_volumetric_loaded);
+        QObject::connect(this->m_modeling_widget, &ModelingControl::isosurface_updated, this, &ModelingTools::on_isosurface_updated);
+    }
 
     auto tab_2 = new QWidget(this);
     tab_widget->addTab(tab_2, QObject::tr("Crystal"));
@@ -130,3 +156,40 @@ void ModelingTools::on_checkbox_state_changed(int checked) {
         this->m_modeling_widget->hide_atoms();
     }
 }
+
+void ModelingTools::on_volumetric_loaded(float max_abs_value, float isovalue) {
+    this->m_max_abs_value = max_abs_value;
+    this->m_isovalue_slider->setEnabled(max_abs_value > 0.0f);
+    this->m_isovalue_slider->blockSignals(true);
+    this->m_isovalue_slider->setValue(this->position_of(isovalue));
+    this->m_isovalue_slider->blockSignals(false);
+    this->m_isovalue_label->setText(QString::number(isovalue, 'g', 4));
+}
+
+void ModelingTools::on_isovalue_slider_moved(int position) {
+    if (nullptr == this->m_modeling_widget) {
+        return;
+    }
+    this->m_modeling_widget->show_isosurface(this->isovalue_of(position));
+}
+
+void ModelingTools::on_isosurface_updated(float isovalue, qulonglong ntriangle, double milliseconds) {
+    this->m_isovalue_label->setText(tr("%1, %2 triangles, %3 ms")
+        .arg(isovalue, 0, 'g', 4)
+        .arg(ntriangle)
+        .arg(milliseconds, 0, 'f', 1));
+}
+
+float ModelingTools::isovalue_of(int position) const {
+    const double decades = kSliderDecades * (static_cast<double>(position) / kSliderSteps - 1.0);
+    return static_cast<float>(this->m_max_abs_value * std::pow(10.0, decades));
+}
+
+int ModelingTools::position_of(float isovalue) const {
+    if (this->m_max_abs_value <= 0.0f || isovalue <= 0.0f) {
+        return 0;
+    }
+    const double decades = std::log10(isovalue / this->m_max_abs_value);
+    const int position = static_cast<int>(std::lround((1.0 + decades / kSliderDecades) * kSliderSteps));
+    return std::clamp(position, 0, kSliderSteps);
+}
@@ -26,6 +26,7 @@
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QCheckBox>
 #include <QtWidgets/QGridLayout>
+#include <QtWidgets/QLabel>
 #include <QtWidgets/QSlider>
 #include <QtWidgets/QTabWidget>
 #include <QtWidgets/QTextBrowser>
@@ -50,6 +51,18 @@ signals:
 private slots:
 
     void on_checkbox_state_changed(int arg1);
+    void on_volumetric_loaded(float max_abs_value, float isovalue);
+    void on_isovalue_slider_moved(int position);
+    void on_isosurface_updated(float isovalue, qulonglong ntriangle, double milliseconds);
+
+private:
+    // the slider is logarithmic, from 1e-4 of the largest value up to it
+    float isovalue_of(int position) const;
+    int position_of(float isovalue) const;
+
+    QSlider* m_isovalue_slider;
+    QLabel* m_isovalue_label;
+    float m_max_abs_value = 0.0f;
 };
 
 #endif // MODELING_OCC_MODELING_TOOLS_H
@@ -22,6 +22,15 @@
 
 #include <QMenu>
 #include <QApplication>
+#include <QInputDialog>
+#include <QMessageBox>
+
+#include <cstdio>
+
+#include <Graphic3d_TransformPers.hxx>
+#include <OpenGl_GraphicDriver.hxx>
+
+#include "utils/trace.h"
 
 #if defined(__linux__)
 #include <Xw_Window.hxx>
@@ -31,10 +40,20 @@
 #include <WNT_Window.hxx>
 #endif
 
-OccView::OccView(QWidget* parent) : QWidget{parent} {
+Handle(Graphic3d_GraphicDriver) OccView::create_graphic_driver() {
+    TRACE_SCOPE_CAT("OccView::create_graphic_driver", "draw");
+    Handle(Aspect_DisplayConnection) display_connection = new Aspect_DisplayConnection{};
+    return new OpenGl_GraphicDriver{display_connection};
+}
+
+OccView::OccView(QWidget* parent, const Handle(Graphic3d_GraphicDriver)& graphic_driver) : QWidget{parent} {
+    TRACE_SCOPE_CAT("OccView::OccView", "draw");
 
-    m_display_connection = new Aspect_DisplayConnection{};
-    m_graphic_driver = new OpenGl_GraphicDriver{m_display_connection};
+    m_graphic_driver = graphic_driver;
+    if (true == m_graphic_driver.IsNull()) {
+        m_graphic_driver = create_graphic_driver();
+    }
+    m_display_connection = m_graphic_driver->GetDisplayConnection();
     m_v3d_viewer = new V3d_Viewer{m_graphic_driver};
     m_v3d_view = m_v3d_viewer->CreateView();
 
@@ -76,6 +95,11 @@ OccView::OccView(QWidget* parent) : QWidget{parent} {
 
     m_draw_style = DisplayStyle::BallAndStick;
 
+    m_idle_timer = new QTimer(this);
+    m_idle_timer->setSingleShot(true);
+    m_idle_timer->setInterval(m_progressive_settings.idle_interval_ms);
+    QObject::connect(m_idle_timer, &QTimer::timeout, this, &OccView::finish_interaction);
+
     setAttribute(Qt::WA_PaintOnScreen);
     setAttribute(Qt::WA_NoSystemBackground);
     setAttribute(Qt::WA_StyledBackground);
@@ -89,9 +113,23 @@ OccView::~OccView() {
 }
 
 void OccView::paintEvent(QPaintEvent* event) {
+    TRACE_SCOPE_CAT("OccView::paintEvent", "draw");
     event->accept();
+    if (false == m_frame_profiler_attached) {
+        // the OpenGL context exists once the view has a window
+        auto driver = Handle(OpenGl_GraphicDriver)::DownCast(m_graphic_driver);
+        m_frame_profiler.attach(m_v3d_view, driver->GetSharedContext());
+        m_frame_profiler_attached = true;
+    }
+    m_frame_profiler.begin_frame();
     m_v3d_view->InvalidateImmediate();
     FlushViewEvents(m_ais_context, m_v3d_view, true);
+    auto record = m_frame_profiler.end_frame(m_visible_atoms);
+    m_last_frame_ms = record.cpu_ms;
+    if (false == m_hud_label.IsNull()) {
+        this->update_hud(record);
+    }
+    emit frame_rendered(m_last_frame_ms);
 }
 
 void OccView::resizeEvent(QResizeEvent* event) {
@@ -144,6 +182,9 @@ void OccView::mousePressEvent(QMouseEvent* event) {
     if (UpdateMouseButtons(position, vkey_mouse, vkey_flags, false)) {
         this->update();
     }
+    if (Aspect_VKeyMouse_NONE != vkey_mouse) {
+        this->notify_interaction();
+    }
 }
 
 void OccView::mouseReleaseEvent(QMouseEvent* event) {
@@ -224,6 +265,33 @@ void OccView::mouseReleaseEvent(QMouseEvent* event) {
             FitAllAuto(m_ais_context, m_v3d_view);
         });
 
+        auto performance_menu = context_menu->addMenu("Performance");
+
+        auto show_hud = new QAction("Show HUD", this);
+        performance_menu->addAction(show_hud);
+        show_hud->setToolTip("Show frame time and draw call statistics");
+        show_hud->setCheckable(true);
+        show_hud->setChecked(false == m_hud_label.IsNull());
+        QObject::connect(show_hud, &QAction::triggered, this, &OccView::set_hud_visible);
+
+        action = new QAction("Record Orbit...", this);
+        performance_menu->addAction(action);
+        action->setToolTip("Record per-frame statistics of a camera orbit into a CSV file");
+        QObject::connect(action, &QAction::triggered, this, [&]() {
+            auto csv_path = QFileDialog::getSaveFileName(this, tr("Save Frame Statistics"), "orbit.csv", tr("CSV (*.csv)"));
+            if (true == csv_path.isEmpty()) {
+                return;
+            }
+            bool ok = false;
+            int nframes = QInputDialog::getInt(this, tr("Record Orbit"), tr("Frames"), 360, 1, 100000, 1, &ok);
+            if (false == ok) {
+                return;
+            }
+            if (false == this->record_orbit(csv_path.toStdString(), nframes)) {
+                QMessageBox::warning(this, tr("Record Orbit"), tr("Can not write %1").arg(csv_path));
+            }
+        });
+
         auto style_menu = context_menu->addMenu("Style");
 
         auto ball_and_stick_style = new QAction("Ball and Stick");
@@ -302,6 +370,9 @@ void OccView::mouseMoveEvent(QMouseEvent* event) {
     }
 
     if (UpdateMousePosition(position, vkey_mouse, vkey_flags, false)) {
+        if (Aspect_VKeyMouse_NONE != vkey_mouse) {
+            this->notify_interaction();
+        }
         this->update();
     }
 }
@@ -318,10 +389,112 @@ void OccView::wheelEvent(QWheelEvent* event) {
     int delta_degrees = event->angleDelta().y() / 8.0;
     Standard_Real delta = delta_pixels != 0 ? delta_pixels : (delta_degrees != 0 ? (delta_degrees / 15) : 0);
     if (UpdateZoom(Aspect_ScrollDelta(position, delta))) {
+        this->notify_interaction();
         this->update();
     }
 }
 
+void OccView::set_progressive_settings(const ProgressiveSettings& settings) {
+    m_progressive_settings = settings;
+    m_idle_timer->setInterval(m_progressive_settings.idle_interval_ms);
+    if (false == m_progressive_settings.enabled && true == m_interacting) {
+        m_idle_timer->stop();
+        this->finish_interaction();
+    }
+}
+
+void OccView::notify_interaction() {
+    if (false == m_progressive_settings.enabled) {
+        return;
+    }
+    // every camera change restarts the countdown to the refined frame
+    m_idle_timer->start();
+    if (false == m_interacting) {
+        m_interacting = true;
+        emit interaction_started();
+    }
+}
+
+void OccView::finish_interaction() {
+    if (false == m_interacting) {
+        return;
+    }
+    if (QApplication::mouseButtons() != Qt::NoButton) {
+        // the user holds the camera still while dragging, keep waiting
+        m_idle_timer->start();
+        return;
+    }
+    m_interacting = false;
+    emit interaction_finished();
+    this->update();
+}
+
+void OccView::set_hud_visible(bool visible) {
+    if (true == visible && true == m_hud_label.IsNull()) {
+        m_hud_label = new AIS_TextLabel();
+        m_hud_label->SetColor(Quantity_NOC_GREEN);
+        m_hud_label->SetHeight(14);
+        m_hud_label->SetText("...");
+        m_hud_label->SetTransformPersistence(new Graphic3d_TransformPers(
+            Graphic3d_TMF_2d, Aspect_TOTP_LEFT_UPPER, Graphic3d_Vec2i(10, 60)
+        ));
+        m_hud_label->SetZLayer(Graphic3d_ZLayerId_TopOSD);
+        m_ais_context->Display(m_hud_label, 0, -1, Standard_False);
+    } else if (false == visible && false == m_hud_label.IsNull()) {
+        m_ais_context->Remove(m_hud_label, Standard_False);
+        m_hud_label.Nullify();
+    }
+    this->update();
+}
+
+void OccView::update_hud(const FrameRecord& record) {
+    char gpu_text[32] = "n/a";
+    if (record.gpu_ms >= 0) {
+        std::snprintf(gpu_text, sizeof(gpu_text), "%.2f ms", record.gpu_ms);
+    }
+    char text[256];
+    std::snprintf(text, sizeof(text),
+        "CPU frame: %.2f ms\nGPU frame: %s\nDraw calls: %d\nTriangles: %d\nPoints: %d\nVisible atoms: %d",
+        record.cpu_ms,
+        gpu_text,
+        record.draw_calls,
+        record.triangles,
+        record.points,
+        record.visible_atoms
+    );
+    // shown with the next frame, no extra redraw is requested here
+    m_hud_label->SetText(TCollection_AsciiString(text));
+    m_ais_context->Redisplay(m_hud_label, Standard_False);
+}
+
+bool OccView::record_orbit(const std::string& csv_path, int nframes, double degrees) {
+    FrameRecordCsv csv(csv_path);
+    if (false == csv.is_open() || nframes <= 0) {
+        return false;
+    }
+    if (false == m_frame_profiler_attached) {
+        auto driver = Handle(OpenGl_GraphicDriver)::DownCast(m_graphic_driver);
+        m_frame_profiler.attach(m_v3d_view, driver->GetSharedContext());
+        m_frame_profiler_attached = true;
+    }
+
+    // orbit the eye around the current view center and up direction
+    Handle(Graphic3d_Camera) camera = m_v3d_view->Camera();
+    gp_Trsf rotation;
+    rotation.SetRotation(gp_Ax1(camera->Center(), camera->Up()), degrees / nframes * M_PI / 180.0);
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    for (int i = 0; i < nframes; i++) {
+        camera->Transform(rotation);
+        m_frame_profiler.begin_frame();
+        m_v3d_view->Redraw();
+        csv.write(i, m_frame_profiler.end_frame(m_visible_atoms, true));
+    }
+    QApplication::restoreOverrideCursor();
+    this->update();
+    return true;
+}
+
 void OccView::set_ball_and_stick_style() {
     //TODO: improve Ball & Stick style displaying of structure
     m_ais_context->SetDisplayMode(AIS_Shaded, Standard_True);
@@ -24,20 +24,40 @@
 #include <QWidget>
 #include <QFileDialog>
 #include <QMouseEvent>
+#include <QTimer>
 
 #include <Aspect_DisplayConnection.hxx>
 #include <OpenGl_GraphicDriver.hxx>
 #include <V3d_View.hxx>
 #include <AIS_InteractiveContext.hxx>
 #include <AIS_ViewController.hxx>
+#include <AIS_TextLabel.hxx>
+
+#include "modeling_occ/frame_profiler.h"
+
+/// Settings of the progressive refinement mode. While the camera
+/// moves, a reduced representation is drawn; once the view has been
+/// still for idle_interval_ms, it is refined to full quality.
+struct ProgressiveSettings {
+    bool enabled = true;
+    int idle_interval_ms = 300;
+    // frame time the reduced representation should stay under
+    double interactive_frame_ms = 33.0;
+    // structures with fewer atoms are always drawn in full quality
+    int min_atoms = 20000;
+};
 
 class OccView : public QWidget, protected AIS_ViewController {
     Q_OBJECT
 public:
 
-    OccView(QWidget* parent = nullptr);
+    // the graphic driver may be created beforehand on another thread
+    // with create_graphic_driver(), a new one is created if null
+    OccView(QWidget* parent = nullptr, const Handle(Graphic3d_GraphicDriver)& graphic_driver = nullptr);
     ~OccView();
 
+    static Handle(Graphic3d_GraphicDriver) create_graphic_driver();
+
     const Handle(V3d_View)& get_view() const {
         return m_v3d_view;
     }
@@ -48,6 +68,23 @@ public:
         FitAllAuto(m_ais_context, m_v3d_view);
     }
 
+    void set_progressive_settings(const ProgressiveSettings& settings);
+    const ProgressiveSettings& get_progressive_settings() const {
+        return m_progressive_settings;
+    }
+    bool is_interacting() const {
+        return m_interacting;
+    }
+    double last_frame_ms() const {
+        return m_last_frame_ms;
+    }
+
+    void set_visible_atoms(int visible_atoms) {
+        m_visible_atoms = visible_atoms;
+    }
+    void set_hud_visible(bool visible);
+    bool record_orbit(const std::string& csv_path, int nframes = 360, double degrees = 360.0);
+
     void set_ball_and_stick_style();
     void set_van_der_waals_style();
     void set_stick_style();
@@ -60,6 +97,9 @@ public:
     };
 
 signals:
+    void interaction_started();
+    void interaction_finished();
+    void frame_rendered(double frame_ms);
 
 public slots:
 
@@ -72,8 +112,22 @@ protected:
     virtual void wheelEvent(QWheelEvent* event) override;
 
 private:
+    void notify_interaction();
+    void finish_interaction();
+    void update_hud(const FrameRecord& record);
+
     DisplayStyle m_draw_style;
 
+    ProgressiveSettings m_progressive_settings;
+    bool m_interacting = false;
+    QTimer* m_idle_timer;
+    double m_last_frame_ms = 0.0;
+
+    FrameProfiler m_frame_profiler;
+    bool m_frame_profiler_attached = false;
+    int m_visible_atoms = 0;
+    Handle(AIS_TextLabel) m_hud_label;
+
     Graphic3d_Vec2i m_mouse_click_pos;
     Handle(Aspect_DisplayConnection) m_display_connection;
     Handle(Graphic3d_GraphicDriver) m_graphic_driver;
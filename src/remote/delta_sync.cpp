@@ -0,0 +1,574 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "remote/delta_sync.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <openssl/evp.h>
+
+#include "utils/logger.h"
+#include "utils/trace.h"
+
+namespace fs = boost::filesystem;
+namespace bip = boost::interprocess;
+
+namespace {
+
+const char kManifestMagic[8] = {'A', 'S', 'S', 'M', 'A', 'N', 'I', '1'};
+const std::size_t kIoChunk = 1 << 20;
+
+using Md5 = std::array<unsigned char, 16>;
+
+Md5 md5_of(const unsigned char* data, std::size_t length) {
+    Md5 digest;
+    unsigned int digest_size = 0;
+    EVP_Digest(data, length, digest.data(), &digest_size, EVP_md5(), nullptr);
+    return digest;
+}
+
+std::string hex_of(const unsigned char* data, std::size_t length) {
+    static const char* hex = "0123456789abcdef";
+    std::string text;
+    for (std::size_t i = 0; i < length; i++) {
+        text += hex[data[i] >> 4];
+        text += hex[data[i] & 0xf];
+    }
+    return text;
+}
+
+// blocks compared at fixed offsets when there are no signatures, every
+// block costs one dd on the remote side, so they are kept large
+std::uint32_t aligned_block_size(std::uint64_t file_size) {
+    const std::uint64_t block_size = std::max<std::uint64_t>(1 << 20, (file_size + 4095) / 4096);
+    return static_cast<std::uint32_t>((block_size + 65535) / 65536 * 65536);
+}
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        m_size = fs::file_size(path);
+        if (m_size > 0) {
+            m_file = bip::file_mapping(path.c_str(), bip::read_only);
+            m_region = bip::mapped_region(m_file, bip::read_only);
+            m_region.advise(bip::mapped_region::advice_sequential);
+        }
+    }
+    const unsigned char* data() const {
+        return static_cast<const unsigned char*>(m_region.get_address());
+    }
+    std::uint64_t size() const {
+        return m_size;
+    }
+
+private:
+    std::uint64_t m_size = 0;
+    bip::file_mapping m_file;
+    bip::mapped_region m_region;
+};
+
+std::string sftp_error(SshSession& session) {
+    char* message = nullptr;
+    libssh2_session_last_error(session.get_session(), &message, nullptr, 0);
+    return nullptr == message ? std::string("unknown error") : std::string(message);
+}
+
+bool sftp_stat(SshSession& session, const std::string& path, LIBSSH2_SFTP_ATTRIBUTES& attrs) {
+    return 0 == libssh2_sftp_stat(session.sftp(), path.c_str(), &attrs);
+}
+
+void sftp_write_at(SshSession& session, LIBSSH2_SFTP_HANDLE* handle, std::uint64_t offset, const unsigned char* data, std::uint64_t length) {
+    libssh2_sftp_seek64(handle, offset);
+    while (length > 0) {
+        const auto nwritten = libssh2_sftp_write(handle, reinterpret_cast<const char*>(data), std::min<std::uint64_t>(length, kIoChunk));
+        if (nwritten < 0) {
+            throw SshError("sftp write failed: " + sftp_error(session));
+        }
+        data += nwritten;
+        length -= nwritten;
+    }
+}
+
+// opened for writing, created or truncated
+LIBSSH2_SFTP_HANDLE* sftp_create(SshSession& session, const std::string& path) {
+    auto handle = libssh2_sftp_open(session.sftp(), path.c_str(), LIBSSH2_FXF_WRITE | LIBSSH2_FXF_CREAT | LIBSSH2_FXF_TRUNC, 0644);
+    if (nullptr == handle) {
+        throw SshError("can not open " + path + ": " + sftp_error(session));
+    }
+    return handle;
+}
+
+void sftp_read_at(SshSession& session, LIBSSH2_SFTP_HANDLE* handle, std::uint64_t offset, std::uint64_t length, std::ostream& out) {
+    std::vector<char> buffer(kIoChunk);
+    libssh2_sftp_seek64(handle, offset);
+    while (length > 0) {
+        const auto nread = libssh2_sftp_read(handle, buffer.data(), std::min<std::uint64_t>(length, buffer.size()));
+        if (nread < 0) {
+            throw SshError("sftp read failed: " + sftp_error(session));
+        }
+        if (0 == nread) {
+            break;
+        }
+        out.write(buffer.data(), nread);
+        length -= nread;
+    }
+}
+
+void push_op(std::vector<DeltaOp>& ops, const DeltaOp& op) {
+    if (0 == op.length) {
+        return;
+    }
+    if (false == ops.empty()) {
+        auto& last = ops.back();
+        if (true == op.copy && true == last.copy
+            && last.src_offset + last.length == op.src_offset
+            && last.dst_offset + last.length == op.dst_offset) {
+            last.length += op.length;
+            return;
+        }
+        if (false == op.copy && false == last.copy && last.dst_offset + last.length == op.dst_offset) {
+            last.length += op.length;
+            return;
+        }
+    }
+    ops.push_back(op);
+}
+
+std::uint64_t mtime_of(const std::string& path) {
+    return static_cast<std::uint64_t>(fs::last_write_time(path));
+}
+
+} // namespace
+
+std::uint32_t weak_checksum(const unsigned char* data, std::size_t length) {
+    std::uint32_t a = 0;
+    std::uint32_t b = 0;
+    for (std::size_t i = 0; i < length; i++) {
+        a += data[i];
+        b += static_cast<std::uint32_t>(length - i) * data[i];
+    }
+    return (a & 0xffff) | (b << 16);
+}
+
+std::uint32_t block_size_for(std::uint64_t file_size) {
+    // about sqrt(size) like rsync, balancing signature size against the
+    // bytes resent around a change
+    const auto block_size = static_cast<std::uint32_t>(std::sqrt(static_cast<double>(file_size))) / 8 * 8;
+    return std::min<std::uint32_t>(std::max<std::uint32_t>(block_size, 2048), 131072);
+}
+
+std::vector<BlockSignature> compute_signatures(const unsigned char* data, std::uint64_t size, std::uint32_t block_size) {
+    std::vector<BlockSignature> blocks((size + block_size - 1) / block_size);
+#pragma omp parallel for schedule(static)
+    for (std::int64_t k = 0; k < static_cast<std::int64_t>(blocks.size()); k++) {
+        const auto offset = k * block_size;
+        const auto length = std::min<std::uint64_t>(block_size, size - offset);
+        blocks[k].weak = weak_checksum(data + offset, length);
+        blocks[k].strong = md5_of(data + offset, length);
+    }
+    return blocks;
+}
+
+std::vector<DeltaOp> compute_delta(const unsigned char* data, std::uint64_t size, const FileManifest& manifest) {
+    TRACE_SCOPE_CAT("compute_delta", "remote");
+    std::vector<DeltaOp> ops;
+    const std::uint64_t block_size = manifest.block_size;
+    if (0 == block_size || true == manifest.blocks.empty()) {
+        push_op(ops, DeltaOp{false, 0, 0, size});
+        return ops;
+    }
+    // only full blocks take part in the rolling search, the short last
+    // block of the old file can only match the tail of the new one
+    const std::uint64_t nfull = manifest.size / block_size;
+    const std::uint64_t short_length = manifest.size % block_size;
+    std::unordered_map<std::uint32_t, std::vector<std::uint64_t>> table;
+    for (std::uint64_t k = 0; k < nfull && k < manifest.blocks.size(); k++) {
+        table[manifest.blocks[k].weak].push_back(k);
+    }
+
+    std::uint64_t offset = 0;
+    std::uint64_t literal_start = 0;
+    std::uint32_t a = 0;
+    std::uint32_t b = 0;
+    auto reset_window = [&]() {
+        a = 0;
+        b = 0;
+        for (std::uint64_t i = 0; i < block_size; i++) {
+            a += data[offset + i];
+            b += static_cast<std::uint32_t>(block_size - i) * data[offset + i];
+        }
+    };
+    if (offset + block_size <= size) {
+        reset_window();
+    }
+    while (offset + block_size <= size) {
+        auto found = table.find((a & 0xffff) | (b << 16));
+        if (table.end() != found) {
+            const auto strong = md5_of(data + offset, block_size);
+            bool matched = false;
+            for (const auto k : found->second) {
+                if (manifest.blocks[k].strong == strong) {
+                    push_op(ops, DeltaOp{false, 0, literal_start, offset - literal_start});
+                    push_op(ops, DeltaOp{true, k * block_size, offset, block_size});
+                    matched = true;
+                    break;
+                }
+            }
+            if (true == matched) {
+                offset += block_size;
+                literal_start = offset;
+                if (offset + block_size <= size) {
+                    reset_window();
+                }
+                continue;
+            }
+        }
+        if (offset + block_size < size) {
+            const std::uint32_t out = data[offset];
+            const std::uint32_t in = data[offset + block_size];
+            a = a - out + in;
+            b = b - static_cast<std::uint32_t>(block_size) * out + a;
+        }
+        offset++;
+    }
+    if (short_length > 0 && nfull < manifest.blocks.size() && size - literal_start >= short_length) {
+        const auto tail = size - short_length;
+        if (md5_of(data + tail, short_length) == manifest.blocks[nfull].strong) {
+            push_op(ops, DeltaOp{false, 0, literal_start, tail - literal_start});
+            push_op(ops, DeltaOp{true, nfull * block_size, tail, short_length});
+            literal_start = size;
+        }
+    }
+    push_op(ops, DeltaOp{false, 0, literal_start, size - literal_start});
+    return ops;
+}
+
+DeltaSync::DeltaSync(const std::string& manifest_dir) : m_manifest_dir{manifest_dir} {
+    if (false == fs::exists(m_manifest_dir)) {
+        fs::create_directories(m_manifest_dir);
+    }
+}
+
+std::string DeltaSync::manifest_path(const SshSession& session, const std::string& remote_path) const {
+    const auto name = session.get_endpoint().key() + ":" + remote_path;
+    const auto digest = md5_of(reinterpret_cast<const unsigned char*>(name.data()), name.size());
+    return (fs::path(m_manifest_dir) / (hex_of(digest.data(), digest.size()) + ".manifest")).string();
+}
+
+bool DeltaSync::load_manifest(const std::string& path, FileManifest& manifest) const {
+    std::ifstream in(path, std::ios::binary);
+    char magic[8];
+    std::uint64_t nblock = 0;
+    in.read(magic, 8);
+    in.read(reinterpret_cast<char*>(&manifest.size), sizeof(manifest.size));
+    in.read(reinterpret_cast<char*>(&manifest.mtime), sizeof(manifest.mtime));
+    in.read(reinterpret_cast<char*>(&manifest.local_mtime), sizeof(manifest.local_mtime));
+    in.read(reinterpret_cast<char*>(&manifest.block_size), sizeof(manifest.block_size));
+    in.read(reinterpret_cast<char*>(&nblock), sizeof(nblock));
+    if (false == in.good() || 0 != std::memcmp(magic, kManifestMagic, 8)) {
+        return false;
+    }
+    manifest.blocks.resize(nblock);
+    for (auto& block : manifest.blocks) {
+        in.read(reinterpret_cast<char*>(&block.weak), sizeof(block.weak));
+        in.read(reinterpret_cast<char*>(block.strong.data()), block.strong.size());
+    }
+    return in.good();
+}
+
+void DeltaSync::store_manifest(const std::string& path, const FileManifest& manifest) const {
+    std::ofstream out(path, std::ios::binary);
+    const std::uint64_t nblock = manifest.blocks.size();
+    out.write(kManifestMagic, 8);
+    out.write(reinterpret_cast<const char*>(&manifest.size), sizeof(manifest.size));
+    out.write(reinterpret_cast<const char*>(&manifest.mtime), sizeof(manifest.mtime));
+    out.write(reinterpret_cast<const char*>(&manifest.local_mtime), sizeof(manifest.local_mtime));
+    out.write(reinterpret_cast<const char*>(&manifest.block_size), sizeof(manifest.block_size));
+    out.write(reinterpret_cast<const char*>(&nblock), sizeof(nblock));
+    for (const auto& block : manifest.blocks) {
+        out.write(reinterpret_cast<const char*>(&block.weak), sizeof(block.weak));
+        out.write(reinterpret_cast<const char*>(block.strong.data()), block.strong.size());
+    }
+}
+
+std::vector<std::array<unsigned char, 16>> DeltaSync::remote_block_hashes(SshSession& session, const std::string& remote_path, std::uint32_t block_size) {
+    TRACE_SCOPE_CAT("DeltaSync::remote_block_hashes", "remote");
+    const auto block = std::to_string(block_size);
+    const auto command =
+        "f=" + shell_quote(remote_path) + "; "
+        "n=$(( ($(wc -c < \"$f\") + " + block + " - 1) / " + block + " )); i=0; "
+        "while [ $i -lt $n ]; do dd if=\"$f\" bs=" + block + " skip=$i count=1 2>/dev/null | md5sum; i=$((i+1)); done";
+    const auto result = session.exec(command);
+    std::vector<Md5> hashes;
+    std::istringstream lines(result.out);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.size() < 32) {
+            continue;
+        }
+        Md5 digest;
+        for (int i = 0; i < 16; i++) {
+            digest[i] = static_cast<unsigned char>(std::stoi(line.substr(2 * i, 2), nullptr, 16));
+        }
+        hashes.push_back(digest);
+    }
+    return hashes;
+}
+
+TransferStats DeltaSync::upload(SshSession& session, const std::string& local_path, const std::string& remote_path) {
+    TRACE_SCOPE_CAT("DeltaSync::upload", "remote");
+    TransferStats stats;
+    MappedFile local(local_path);
+    stats.file_bytes = local.size();
+
+    LIBSSH2_SFTP_ATTRIBUTES attrs;
+    const bool remote_exists = sftp_stat(session, remote_path, attrs);
+    const auto manifest_file = this->manifest_path(session, remote_path);
+    FileManifest manifest;
+    const bool have_manifest = remote_exists && this->load_manifest(manifest_file, manifest)
+        && manifest.size == attrs.filesize && manifest.mtime == attrs.mtime;
+
+    std::vector<DeltaOp> ops;
+    if (true == have_manifest) {
+        ops = compute_delta(local.data(), local.size(), manifest);
+    } else if (true == remote_exists && attrs.filesize > 0 && local.size() > 0) {
+        const auto block_size = aligned_block_size(std::max<std::uint64_t>(local.size(), attrs.filesize));
+        const auto hashes = this->remote_block_hashes(session, remote_path, block_size);
+        for (std::uint64_t offset = 0, k = 0; offset < local.size(); offset += block_size, k++) {
+            const auto length = std::min<std::uint64_t>(block_size, local.size() - offset);
+            const bool same = k < hashes.size() && md5_of(local.data() + offset, length) == hashes[k];
+            push_op(ops, DeltaOp{same, offset, offset, length});
+        }
+    } else {
+        push_op(ops, DeltaOp{false, 0, 0, local.size()});
+    }
+
+    const bool unchanged = remote_exists && local.size() == attrs.filesize
+        && ((1 == ops.size() && true == ops[0].copy && 0 == ops[0].src_offset) || 0 == local.size());
+    bool in_place = remote_exists;
+    for (const auto& op : ops) {
+        if (true == op.copy) {
+            in_place = in_place && op.src_offset == op.dst_offset;
+        } else {
+            stats.wire_bytes += op.length;
+        }
+    }
+
+    if (true == unchanged) {
+        stats.skipped = true;
+    } else if (true == in_place) {
+        // all kept blocks are already in place, the changed ranges are
+        // written into the remote file directly
+        auto handle = libssh2_sftp_open(session.sftp(), remote_path.c_str(), LIBSSH2_FXF_WRITE, 0644);
+        if (nullptr == handle) {
+            throw SshError("can not open " + remote_path + ": " + sftp_error(session));
+        }
+        for (const auto& op : ops) {
+            if (false == op.copy) {
+                sftp_write_at(session, handle, op.dst_offset, local.data() + op.dst_offset, op.length);
+            }
+        }
+        if (local.size() < attrs.filesize) {
+            LIBSSH2_SFTP_ATTRIBUTES truncate;
+            std::memset(&truncate, 0, sizeof(truncate));
+            truncate.flags = LIBSSH2_SFTP_ATTR_SIZE;
+            truncate.filesize = local.size();
+            libssh2_sftp_fsetstat(handle, &truncate);
+        }
+        libssh2_sftp_close(handle);
+    } else {
+        // the new file is assembled next to the old one by a script run on
+        // the remote side: kept blocks are cut out of the old file, the
+        // literals are sent into a side file first and cut out of that.
+        // The script goes over SFTP too, a command line holding every op
+        // runs into the argument length limit, and it sticks to tail -c
+        // and head -c, which GNU, BSD and busybox all have, unlike the
+        // byte offset flags of GNU dd
+        const auto partial = remote_path + ".delta-partial";
+        const auto literals = remote_path + ".delta-literals";
+        const auto script_path = remote_path + ".delta-script";
+        std::string script = "set -e\nold=" + shell_quote(remote_path) + "\nlit=" + shell_quote(literals) + "\n{\n";
+        auto handle = sftp_create(session, literals);
+        std::uint64_t literal_offset = 0;
+        for (const auto& op : ops) {
+            if (true == op.copy) {
+                script += "tail -c +" + std::to_string(op.src_offset + 1) + " \"$old\" | head -c " + std::to_string(op.length) + "\n";
+            } else {
+                sftp_write_at(session, handle, literal_offset, local.data() + op.dst_offset, op.length);
+                script += "tail -c +" + std::to_string(literal_offset + 1) + " \"$lit\" | head -c " + std::to_string(op.length) + "\n";
+                literal_offset += op.length;
+            }
+        }
+        libssh2_sftp_close(handle);
+        script += "} > " + shell_quote(partial) + "\n";
+        handle = sftp_create(session, script_path);
+        sftp_write_at(session, handle, 0, reinterpret_cast<const unsigned char*>(script.data()), script.size());
+        libssh2_sftp_close(handle);
+
+        const auto result = session.exec("sh " + shell_quote(script_path));
+        LIBSSH2_SFTP_ATTRIBUTES partial_attrs;
+        std::string failure;
+        if (0 != result.exit_status) {
+            failure = "exit status " + std::to_string(result.exit_status) + ": " + result.err;
+        } else if (false == sftp_stat(session, partial, partial_attrs) || partial_attrs.filesize != local.size()) {
+            failure = "the assembled file has the wrong size";
+        }
+        if (false == failure.empty()) {
+            LOG_WARNING("remote block copy failed for %s (%s), sending the whole file", remote_path.c_str(), failure.c_str());
+            handle = sftp_create(session, partial);
+            sftp_write_at(session, handle, 0, local.data(), local.size());
+            libssh2_sftp_close(handle);
+            stats.wire_bytes += local.size();
+        }
+        if (0 != session.exec("rm -f " + shell_quote(literals) + " " + shell_quote(script_path)
+            + " && mv -f " + shell_quote(partial) + " " + shell_quote(remote_path)).exit_status) {
+            throw SshError("can not move " + partial + " to " + remote_path);
+        }
+    }
+
+    if (false == sftp_stat(session, remote_path, attrs)) {
+        throw SshError("can not stat " + remote_path + ": " + sftp_error(session));
+    }
+    if (false == stats.skipped || false == have_manifest) {
+        manifest.size = attrs.filesize;
+        manifest.mtime = attrs.mtime;
+        manifest.local_mtime = mtime_of(local_path);
+        manifest.block_size = block_size_for(local.size());
+        manifest.blocks = compute_signatures(local.data(), local.size(), manifest.block_size);
+        this->store_manifest(manifest_file, manifest);
+    }
+    LOG_DEBUG("upload %s: %llu of %llu bytes sent", local_path.c_str(),
+        static_cast<unsigned long long>(stats.wire_bytes), static_cast<unsigned long long>(stats.file_bytes));
+    return stats;
+}
+
+TransferStats DeltaSync::download(SshSession& session, const std::string& remote_path, const std::string& local_path) {
+    TRACE_SCOPE_CAT("DeltaSync::download", "remote");
+    TransferStats stats;
+    LIBSSH2_SFTP_ATTRIBUTES attrs;
+    if (false == sftp_stat(session, remote_path, attrs)) {
+        throw SshError("can not stat " + remote_path + ": " + sftp_error(session));
+    }
+    stats.file_bytes = attrs.filesize;
+
+    const auto manifest_file = this->manifest_path(session, remote_path);
+    FileManifest manifest;
+    const bool local_exists = fs::exists(local_path);
+    if (true == local_exists && this->load_manifest(manifest_file, manifest)
+        && manifest.size == attrs.filesize && manifest.mtime == attrs.mtime
+        && manifest.local_mtime == mtime_of(local_path) && fs::file_size(local_path) == attrs.filesize) {
+        stats.skipped = true;
+        return stats;
+    }
+
+    auto handle = libssh2_sftp_open(session.sftp(), remote_path.c_str(), LIBSSH2_FXF_READ, 0);
+    if (nullptr == handle) {
+        throw SshError("can not open " + remote_path + ": " + sftp_error(session));
+    }
+    const auto partial = local_path + ".delta-partial";
+    try {
+        if (true == local_exists && fs::file_size(local_path) > 0 && attrs.filesize > 0) {
+            // patch a copy of the local file with the differing blocks
+            fs::copy_file(local_path, partial, fs::copy_options::overwrite_existing);
+            fs::resize_file(partial, attrs.filesize);
+            const auto block_size = aligned_block_size(std::max<std::uint64_t>(fs::file_size(local_path), attrs.filesize));
+            const auto hashes = this->remote_block_hashes(session, remote_path, block_size);
+            MappedFile local(local_path);
+            std::fstream out(partial, std::ios::binary | std::ios::in | std::ios::out);
+            for (std::uint64_t offset = 0, k = 0; offset < attrs.filesize; offset += block_size, k++) {
+                const auto length = std::min<std::uint64_t>(block_size, attrs.filesize - offset);
+                if (k < hashes.size() && offset + length <= local.size() && md5_of(local.data() + offset, length) == hashes[k]) {
+                    continue;
+                }
+                out.seekp(offset);
+                sftp_read_at(session, handle, offset, length, out);
+                stats.wire_bytes += length;
+            }
+        } else {
+            std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+            sftp_read_at(session, handle, 0, attrs.filesize, out);
+            stats.wire_bytes = attrs.filesize;
+        }
+    } catch (...) {
+        libssh2_sftp_close(handle);
+        throw;
+    }
+    libssh2_sftp_close(handle);
+    fs::rename(partial, local_path);
+
+    MappedFile local(local_path);
+    manifest.size = attrs.filesize;
+    manifest.mtime = attrs.mtime;
+    manifest.local_mtime = mtime_of(local_path);
+    manifest.block_size = block_size_for(local.size());
+    manifest.blocks = compute_signatures(local.data(), local.size(), manifest.block_size);
+    this->store_manifest(manifest_file, manifest);
+    LOG_DEBUG("download %s: %llu of %llu bytes received", remote_path.c_str(),
+        static_cast<unsigned long long>(stats.wire_bytes), static_cast<unsigned long long>(stats.file_bytes));
+    return stats;
+}
+
+TransferStats DeltaSync::upload_dir(SshSession& session, const std::string& local_dir, const std::string& remote_dir) {
+    TransferStats stats;
+    std::vector<fs::path> files;
+    std::string mkdir = "mkdir -p " + shell_quote(remote_dir);
+    for (const auto& entry : fs::recursive_directory_iterator(local_dir)) {
+        const auto relative = fs::relative(entry.path(), local_dir);
+        if (fs::is_directory(entry.path())) {
+            mkdir += " " + shell_quote((fs::path(remote_dir) / relative).generic_string());
+        } else if (fs::is_regular_file(entry.path())) {
+            files.push_back(relative);
+        }
+    }
+    session.exec(mkdir);
+    for (const auto& relative : files) {
+        const auto file_stats = this->upload(session, (fs::path(local_dir) / relative).string(), (fs::path(remote_dir) / relative).generic_string());
+        stats.file_bytes += file_stats.file_bytes;
+        stats.wire_bytes += file_stats.wire_bytes;
+    }
+    return stats;
+}
+
+TransferStats DeltaSync::download_dir(SshSession& session, const std::string& remote_dir, const std::string& local_dir) {
+    TransferStats stats;
+    const auto listing = session.exec("cd " + shell_quote(remote_dir) + " && find . -type f");
+    std::istringstream lines(listing.out);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.size() < 3) {
+            continue;
+        }
+        const auto relative = fs::path(line.substr(2));
+        const auto local_path = fs::path(local_dir) / relative;
+        fs::create_directories(local_path.parent_path());
+        const auto file_stats = this->download(session, (fs::path(remote_dir) / relative).generic_string(), local_path.string());
+        stats.file_bytes += file_stats.file_bytes;
+        stats.wire_bytes += file_stats.wire_bytes;
+    }
+    return stats;
+}
@@ -0,0 +1,100 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// rsync style delta transfer over SFTP.
+///
+/// Files are cut into blocks, each with a rolling weak checksum and an
+/// MD5. After a transfer the signatures of the remote file are kept in a
+/// local manifest together with the remote size and mtime. The next
+/// upload rolls over the local file, looks the weak checksum up in the
+/// manifest and confirms candidates with the MD5; matched blocks are
+/// copied on the remote side and only the literal bytes in between cross
+/// the wire. Without a valid manifest the remote side hashes aligned
+/// blocks with dd | md5sum and only differing blocks are sent. Downloads
+/// compare aligned blocks the same way and fetch differing blocks only.
+
+#ifndef REMOTE_DELTA_SYNC_H
+#define REMOTE_DELTA_SYNC_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "remote/ssh_pool.h"
+
+struct BlockSignature {
+    std::uint32_t weak = 0;
+    std::array<unsigned char, 16> strong;
+};
+
+struct FileManifest {
+    // of the remote file when the signatures were taken
+    std::uint64_t size = 0;
+    std::uint64_t mtime = 0;
+    // of the local copy, a download is skipped while both are unchanged
+    std::uint64_t local_mtime = 0;
+    std::uint32_t block_size = 0;
+    std::vector<BlockSignature> blocks;
+};
+
+// one piece of the new file: copied from the old file at src_offset, or
+// literal bytes taken from the new file at dst_offset
+struct DeltaOp {
+    bool copy;
+    std::uint64_t src_offset;
+    std::uint64_t dst_offset;
+    std::uint64_t length;
+};
+
+std::uint32_t weak_checksum(const unsigned char* data, std::size_t length);
+std::uint32_t block_size_for(std::uint64_t file_size);
+std::vector<BlockSignature> compute_signatures(const unsigned char* data, std::uint64_t size, std::uint32_t block_size);
+// adjacent copies are merged into one op
+std::vector<DeltaOp> compute_delta(const unsigned char* data, std::uint64_t size, const FileManifest& manifest);
+
+struct TransferStats {
+    std::uint64_t file_bytes = 0;
+    std::uint64_t wire_bytes = 0;
+    bool skipped = false;
+};
+
+class DeltaSync {
+public:
+    explicit DeltaSync(const std::string& manifest_dir);
+
+    TransferStats upload(SshSession& session, const std::string& local_path, const std::string& remote_path);
+    TransferStats download(SshSession& session, const std::string& remote_path, const std::string& local_path);
+
+    // every regular file below the directory
+    TransferStats upload_dir(SshSession& session, const std::string& local_dir, const std::string& remote_dir);
+    TransferStats download_dir(SshSession& session, const std::string& remote_dir, const std::string& local_dir);
+
+private:
+    std::string manifest_path(const SshSession& session, const std::string& remote_path) const;
+    bool load_manifest(const std::string& path, FileManifest& manifest) const;
+    void store_manifest(const std::string& path, const FileManifest& manifest) const;
+    // MD5 of the aligned blocks of the remote file, computed remotely
+    std::vector<std::array<unsigned char, 16>> remote_block_hashes(SshSession& session, const std::string& remote_path, std::uint32_t block_size);
+
+    std::string m_manifest_dir;
+};
+
+#endif // REMOTE_DELTA_SYNC_H
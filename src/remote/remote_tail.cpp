@@ -0,0 +1,108 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "remote/remote_tail.h"
+
+#include <algorithm>
+
+#include "utils/trace.h"
+
+RemoteTail::RemoteTail(const SshEndpoint& endpoint, const std::string& remote_path)
+    : m_endpoint{endpoint}, m_remote_path{remote_path} {
+}
+
+RemoteTail::~RemoteTail() {
+    this->close();
+}
+
+void RemoteTail::open() {
+    if (nullptr == m_lease) {
+        m_lease = std::make_unique<SshLease>(SshSessionPool::instance().acquire(m_endpoint));
+    }
+    m_handle = libssh2_sftp_open((*m_lease)->sftp(), m_remote_path.c_str(), LIBSSH2_FXF_READ, 0);
+    if (nullptr == m_handle) {
+        throw SshError("can not open " + m_remote_path + " on " + m_endpoint.key());
+    }
+}
+
+void RemoteTail::close() {
+    if (nullptr != m_handle) {
+        libssh2_sftp_close(m_handle);
+        m_handle = nullptr;
+    }
+}
+
+std::string RemoteTail::read_new(bool& reset, std::size_t max_chunk) {
+    TRACE_SCOPE_CAT("RemoteTail::read_new", "remote");
+    reset = false;
+    try {
+        if (nullptr == m_lease) {
+            m_lease = std::make_unique<SshLease>(SshSessionPool::instance().acquire(m_endpoint));
+        }
+        // the path is stat'ed rather than the handle, a replaced file
+        // keeps the old one alive behind the open handle
+        auto sftp = (*m_lease)->sftp();
+        LIBSSH2_SFTP_ATTRIBUTES attrs;
+        const int status = libssh2_sftp_stat(sftp, m_remote_path.c_str(), &attrs);
+        if (0 != status) {
+            if (LIBSSH2_ERROR_SFTP_PROTOCOL == status && LIBSSH2_FX_NO_SUCH_FILE == libssh2_sftp_last_error(sftp)) {
+                // the job has not written it yet
+                return std::string();
+            }
+            throw SshError("can not stat " + m_remote_path + " on " + m_endpoint.key());
+        }
+        if (nullptr == m_handle) {
+            this->open();
+        }
+        if (attrs.filesize < m_offset) {
+            this->close();
+            this->open();
+            m_offset = 0;
+            reset = true;
+        }
+        if (attrs.filesize == m_offset) {
+            return std::string();
+        }
+        std::string data(std::min<std::uint64_t>(attrs.filesize - m_offset, max_chunk), '\0');
+        std::size_t nread_total = 0;
+        libssh2_sftp_seek64(m_handle, m_offset);
+        while (nread_total < data.size()) {
+            const auto nread = libssh2_sftp_read(m_handle, &data[nread_total], data.size() - nread_total);
+            if (nread < 0) {
+                throw SshError("sftp read of " + m_remote_path + " failed");
+            }
+            if (0 == nread) {
+                break;
+            }
+            nread_total += nread;
+        }
+        data.resize(nread_total);
+        m_offset += nread_total;
+        return data;
+    } catch (const SshError&) {
+        // reconnect on the next call, the offset is kept
+        m_handle = nullptr;
+        if (nullptr != m_lease) {
+            (*m_lease)->disconnect();
+            m_lease.reset();
+        }
+        throw;
+    }
+}
@@ -0,0 +1,66 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Follows a growing remote file, e.g. the output of a running job.
+///
+/// The file stays open on a pooled session between calls, and every call
+/// costs one stat plus a read of the bytes appended since the last one.
+/// The offset survives reconnects. A file that shrank, e.g. because the
+/// job was restarted, is read again from the beginning.
+
+#ifndef REMOTE_REMOTE_TAIL_H
+#define REMOTE_REMOTE_TAIL_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "remote/ssh_pool.h"
+
+class RemoteTail {
+public:
+    RemoteTail(const SshEndpoint& endpoint, const std::string& remote_path);
+    ~RemoteTail();
+
+    RemoteTail(const RemoteTail&) = delete;
+    RemoteTail& operator=(const RemoteTail&) = delete;
+
+    // the bytes appended since the last call, at most max_chunk of them;
+    // reset is set when the file was read again from the beginning. A file
+    // that does not exist yet gives no data, other failures throw SshError
+    // and the next call reconnects
+    std::string read_new(bool& reset, std::size_t max_chunk = 8 << 20);
+
+    std::uint64_t get_offset() const {
+        return m_offset;
+    }
+
+private:
+    void open();
+    void close();
+
+    SshEndpoint m_endpoint;
+    std::string m_remote_path;
+    std::unique_ptr<SshLease> m_lease;
+    LIBSSH2_SFTP_HANDLE* m_handle = nullptr;
+    std::uint64_t m_offset = 0;
+};
+
+#endif // REMOTE_REMOTE_TAIL_H
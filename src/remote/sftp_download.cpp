@@ -0,0 +1,332 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "remote/sftp_download.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <boost/filesystem.hpp>
+
+#include "utils/logger.h"
+#include "utils/trace.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// files below this size are not split
+const std::uint64_t kMinSegment = 32ull << 20;
+// the sidecar is rewritten after this many bytes of a segment
+const std::uint64_t kStateInterval = 16ull << 20;
+
+double now_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// closes the handle on every way out of the scope
+class SftpHandle {
+public:
+    explicit SftpHandle(LIBSSH2_SFTP_HANDLE* handle) : m_handle{handle} {
+    }
+    ~SftpHandle() {
+        this->close();
+    }
+
+    SftpHandle(const SftpHandle&) = delete;
+    SftpHandle& operator=(const SftpHandle&) = delete;
+
+    LIBSSH2_SFTP_HANDLE* get() const {
+        return m_handle;
+    }
+    // before the session goes down
+    void close() {
+        if (nullptr != m_handle) {
+            libssh2_sftp_close(m_handle);
+            m_handle = nullptr;
+        }
+    }
+
+private:
+    LIBSSH2_SFTP_HANDLE* m_handle;
+};
+
+} // namespace
+
+// the local file the segments are written into at their offsets from
+// several threads at once
+class SftpDownloader::PartialFile {
+public:
+    explicit PartialFile(const std::string& path) {
+#if defined(_WIN32)
+        m_handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (INVALID_HANDLE_VALUE == m_handle) {
+            throw std::runtime_error("can not open " + path);
+        }
+#else
+        m_fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (m_fd < 0) {
+            throw std::runtime_error("can not open " + path);
+        }
+#endif
+    }
+    ~PartialFile() {
+#if defined(_WIN32)
+        CloseHandle(m_handle);
+#else
+        close(m_fd);
+#endif
+    }
+
+    PartialFile(const PartialFile&) = delete;
+    PartialFile& operator=(const PartialFile&) = delete;
+
+    // the segments are written out of order, reserving the whole file up
+    // front keeps it unfragmented
+    void reserve(std::uint64_t size) {
+#if defined(_WIN32)
+        LARGE_INTEGER end;
+        end.QuadPart = static_cast<LONGLONG>(size);
+        if (FALSE == SetFilePointerEx(m_handle, end, nullptr, FILE_BEGIN) || FALSE == SetEndOfFile(m_handle)) {
+            throw std::runtime_error("can not resize the partial file");
+        }
+#else
+#if defined(__linux__)
+        if (0 == posix_fallocate(m_fd, 0, size)) {
+            return;
+        }
+#endif
+        if (0 != ftruncate(m_fd, size)) {
+            throw std::runtime_error("can not resize the partial file");
+        }
+#endif
+    }
+
+    void write_at(const char* data, std::size_t length, std::uint64_t offset) {
+        while (length > 0) {
+#if defined(_WIN32)
+            OVERLAPPED overlapped;
+            std::memset(&overlapped, 0, sizeof(overlapped));
+            overlapped.Offset = static_cast<DWORD>(offset & 0xffffffffu);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD nwritten = 0;
+            const auto chunk = static_cast<DWORD>(std::min<std::size_t>(length, 1u << 30));
+            if (FALSE == WriteFile(m_handle, data, chunk, &nwritten, &overlapped)) {
+                throw std::runtime_error("write to the partial file failed");
+            }
+#else
+            const auto nwritten = pwrite(m_fd, data, length, offset);
+            if (nwritten < 0) {
+                throw std::runtime_error("write to the partial file failed");
+            }
+#endif
+            data += nwritten;
+            length -= nwritten;
+            offset += nwritten;
+        }
+    }
+
+private:
+#if defined(_WIN32)
+    HANDLE m_handle;
+#else
+    int m_fd;
+#endif
+};
+
+SftpDownloader::SftpDownloader(const SshEndpoint& endpoint) : m_endpoint{endpoint} {
+}
+
+bool SftpDownloader::load_state(const std::string& path, std::uint64_t size, std::uint64_t mtime) {
+    std::ifstream in(path);
+    std::uint64_t stored_size = 0;
+    std::uint64_t stored_mtime = 0;
+    std::size_t nsegment = 0;
+    if (false == static_cast<bool>(in >> stored_size >> stored_mtime >> nsegment) || stored_size != size || stored_mtime != mtime) {
+        return false;
+    }
+    m_segments.resize(nsegment);
+    for (auto& segment : m_segments) {
+        in >> segment.begin >> segment.end >> segment.done;
+    }
+    return static_cast<bool>(in);
+}
+
+void SftpDownloader::store_state() {
+    // called with m_mutex held
+    const auto tmp = m_state_path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << m_size << " " << m_mtime << " " << m_segments.size() << "\n";
+        for (const auto& segment : m_segments) {
+            out << segment.begin << " " << segment.end << " " << segment.done << "\n";
+        }
+    }
+    fs::rename(tmp, m_state_path);
+}
+
+DownloadResult SftpDownloader::download(const std::string& remote_path, const std::string& local_path) {
+    TRACE_SCOPE_CAT("SftpDownloader::download", "remote");
+    DownloadResult result;
+    LIBSSH2_SFTP_ATTRIBUTES attrs;
+    {
+        auto lease = SshSessionPool::instance().acquire(m_endpoint);
+        if (0 != libssh2_sftp_stat(lease->sftp(), remote_path.c_str(), &attrs)) {
+            throw SshError("can not stat " + remote_path + " on " + m_endpoint.key());
+        }
+    }
+    m_size = attrs.filesize;
+    m_mtime = attrs.mtime;
+    result.bytes_total = m_size;
+
+    const auto partial_path = local_path + ".partial";
+    m_state_path = local_path + ".partial-state";
+    m_segments.clear();
+    result.resumed = fs::exists(partial_path) && this->load_state(m_state_path, m_size, m_mtime);
+    if (false == result.resumed) {
+        const auto nsegment = std::max<std::uint64_t>(1, std::min<std::uint64_t>(
+            static_cast<std::uint64_t>(std::max(1, m_max_streams)), m_size / kMinSegment
+        ));
+        const auto segment_size = (m_size + nsegment - 1) / nsegment;
+        for (std::uint64_t begin = 0; begin < m_size || m_segments.empty(); begin += segment_size) {
+            m_segments.push_back(Segment{begin, std::min(m_size, begin + segment_size), begin});
+            if (0 == segment_size) {
+                break;
+            }
+        }
+    }
+
+    auto file = std::make_unique<PartialFile>(partial_path);
+    if (false == result.resumed) {
+        file->reserve(m_size);
+    }
+
+    std::uint64_t already_done = 0;
+    for (const auto& segment : m_segments) {
+        already_done += segment.done - segment.begin;
+    }
+    m_bytes_done = already_done;
+    m_bytes_resumed = already_done;
+    m_start = now_seconds();
+    m_last_report = m_start;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        this->store_state();
+    }
+
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(m_segments.size());
+    for (std::size_t i = 0; i < m_segments.size(); i++) {
+        if (m_segments[i].done >= m_segments[i].end) {
+            continue;
+        }
+        threads.emplace_back([this, i, &file, &remote_path, &errors]() {
+            try {
+                this->fetch_segment(remote_path, *file, m_segments[i]);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        this->store_state();
+    }
+    file.reset();
+    for (const auto& error : errors) {
+        if (nullptr != error) {
+            // the partial file and the sidecar stay for the next attempt
+            std::rethrow_exception(error);
+        }
+    }
+    for (const auto& segment : m_segments) {
+        if (segment.done < segment.end) {
+            throw SshError(remote_path + " was truncated during the download");
+        }
+    }
+
+    fs::rename(partial_path, local_path);
+    fs::remove(m_state_path);
+    result.seconds = now_seconds() - m_start;
+    result.bytes_transferred = m_bytes_done - already_done;
+    result.bytes_per_second = result.seconds > 0 ? result.bytes_transferred / result.seconds : 0;
+    LOG_INFO("downloaded %s: %.1f MB in %.2f s, %.1f MB/s over %d streams", remote_path.c_str(),
+        result.bytes_transferred / 1.0e6, result.seconds, result.bytes_per_second / 1.0e6, static_cast<int>(threads.size()));
+    return result;
+}
+
+void SftpDownloader::fetch_segment(const std::string& remote_path, PartialFile& file, Segment& segment) {
+    TRACE_SCOPE_CAT("SftpDownloader::fetch_segment", "remote");
+    auto lease = SshSessionPool::instance().acquire(m_endpoint);
+    SftpHandle handle(libssh2_sftp_open(lease->sftp(), remote_path.c_str(), LIBSSH2_FXF_READ, 0));
+    if (nullptr == handle.get()) {
+        throw SshError("can not open " + remote_path + " on " + m_endpoint.key());
+    }
+    std::vector<char> buffer(m_read_buffer);
+    std::uint64_t done = segment.done;
+    std::uint64_t last_state = done;
+    libssh2_sftp_seek64(handle.get(), done);
+    while (done < segment.end) {
+        const auto nread = libssh2_sftp_read(handle.get(), buffer.data(), std::min<std::uint64_t>(buffer.size(), segment.end - done));
+        if (nread < 0) {
+            handle.close();
+            // drop the broken session instead of returning it to the pool
+            lease->disconnect();
+            throw SshError("sftp read of " + remote_path + " failed");
+        }
+        if (0 == nread) {
+            break;
+        }
+        file.write_at(buffer.data(), nread, done);
+        done += nread;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        segment.done = done;
+        m_bytes_done += nread;
+        if (done - last_state >= kStateInterval) {
+            last_state = done;
+            this->store_state();
+        }
+        const double now = now_seconds();
+        if (m_progress_callback && now - m_last_report > 0.25) {
+            m_last_report = now;
+            DownloadProgress progress;
+            progress.bytes_done = m_bytes_done;
+            progress.bytes_total = m_size;
+            progress.bytes_per_second = (m_bytes_done - m_bytes_resumed) / std::max(now - m_start, 1.0e-9);
+            m_progress_callback(progress);
+        }
+    }
+}
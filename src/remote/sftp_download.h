@@ -0,0 +1,105 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Parallel, resumable SFTP downloads of large files.
+///
+/// A file is split into contiguous segments, each fetched on its own
+/// pooled session, so that several TCP windows are in flight at once.
+/// Within a segment, libssh2_sftp_read() is given a large buffer and
+/// keeps that many bytes of read requests outstanding, which hides the
+/// round trip time. The data goes into a preallocated <file>.partial
+/// with positional writes, pwrite or WriteFile at an offset. A <file>.partial-state sidecar records the progress of
+/// every segment, so an interrupted download continues where it stopped
+/// as long as the remote size and mtime are unchanged.
+
+#ifndef REMOTE_SFTP_DOWNLOAD_H
+#define REMOTE_SFTP_DOWNLOAD_H
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "remote/ssh_pool.h"
+
+struct DownloadProgress {
+    std::uint64_t bytes_done = 0;
+    std::uint64_t bytes_total = 0;
+    double bytes_per_second = 0;
+};
+
+struct DownloadResult {
+    std::uint64_t bytes_total = 0;
+    // without the bytes already present when resuming
+    std::uint64_t bytes_transferred = 0;
+    double seconds = 0;
+    double bytes_per_second = 0;
+    bool resumed = false;
+};
+
+class SftpDownloader {
+public:
+    explicit SftpDownloader(const SshEndpoint& endpoint);
+
+    void set_max_streams(int max_streams) {
+        m_max_streams = max_streams;
+    }
+    void set_read_buffer(std::size_t read_buffer) {
+        m_read_buffer = read_buffer;
+    }
+    // called from the transfer threads, at most a few times per second
+    void set_progress_callback(const std::function<void(const DownloadProgress&)>& callback) {
+        m_progress_callback = callback;
+    }
+
+    DownloadResult download(const std::string& remote_path, const std::string& local_path);
+
+private:
+    struct Segment {
+        std::uint64_t begin;
+        std::uint64_t end;
+        std::uint64_t done;
+    };
+
+    class PartialFile;
+
+    void fetch_segment(const std::string& remote_path, PartialFile& file, Segment& segment);
+    bool load_state(const std::string& path, std::uint64_t size, std::uint64_t mtime);
+    void store_state();
+
+    SshEndpoint m_endpoint;
+    int m_max_streams = 4;
+    std::size_t m_read_buffer = 4 << 20;
+    std::function<void(const DownloadProgress&)> m_progress_callback;
+
+    // state of the running download
+    std::mutex m_mutex;
+    std::vector<Segment> m_segments;
+    std::string m_state_path;
+    std::uint64_t m_size = 0;
+    std::uint64_t m_mtime = 0;
+    std::uint64_t m_bytes_done = 0;
+    std::uint64_t m_bytes_resumed = 0;
+    double m_start = 0;
+    double m_last_report = 0;
+};
+
+#endif // REMOTE_SFTP_DOWNLOAD_H
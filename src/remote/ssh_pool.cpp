@@ -0,0 +1,414 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "remote/ssh_pool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <boost/filesystem.hpp>
+
+#include "utils/logger.h"
+#include "utils/trace.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+void close_socket(int sock) {
+#if defined(_WIN32)
+    closesocket(sock);
+#else
+    close(sock);
+#endif
+}
+
+std::string session_error(LIBSSH2_SESSION* session) {
+    char* message = nullptr;
+    libssh2_session_last_error(session, &message, nullptr, 0);
+    return nullptr == message ? std::string("unknown error") : std::string(message);
+}
+
+std::string home_dir() {
+#if defined(_WIN32)
+    const char* home = std::getenv("USERPROFILE");
+#else
+    const char* home = std::getenv("HOME");
+#endif
+    return nullptr == home ? std::string() : std::string(home);
+}
+
+// seconds between keepalive messages on idle sessions
+const int kKeepaliveInterval = 30;
+
+} // namespace
+
+std::string shell_quote(const std::string& text) {
+    std::string quoted = "'";
+    for (const char c : text) {
+        if ('\'' == c) {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
+
+SshSession::SshSession(const SshEndpoint& endpoint) : m_endpoint{endpoint} {
+}
+
+SshSession::~SshSession() {
+    this->disconnect();
+}
+
+void SshSession::connect() {
+    TRACE_SCOPE_CAT("SshSession::connect", "remote");
+    this->disconnect();
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    if (0 != getaddrinfo(m_endpoint.host.c_str(), std::to_string(m_endpoint.port).c_str(), &hints, &addresses)) {
+        throw SshConnectError("can not resolve " + m_endpoint.host);
+    }
+    for (auto address = addresses; nullptr != address; address = address->ai_next) {
+        m_socket = static_cast<int>(socket(address->ai_family, address->ai_socktype, address->ai_protocol));
+        if (m_socket < 0) {
+            continue;
+        }
+        if (0 == ::connect(m_socket, address->ai_addr, address->ai_addrlen)) {
+            break;
+        }
+        close_socket(m_socket);
+        m_socket = -1;
+    }
+    freeaddrinfo(addresses);
+    if (m_socket < 0) {
+        throw SshConnectError("can not connect to " + m_endpoint.key());
+    }
+    // exec requests and SFTP packets are small, do not let Nagle hold them
+    int nodelay = 1;
+    setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&nodelay), sizeof(nodelay));
+
+    m_session = libssh2_session_init();
+    libssh2_session_set_blocking(m_session, 1);
+    if (true == m_endpoint.compress) {
+        libssh2_session_flag(m_session, LIBSSH2_FLAG_COMPRESS, 1);
+    }
+    if (0 != libssh2_session_handshake(m_session, m_socket)) {
+        const auto message = session_error(m_session);
+        this->disconnect();
+        throw SshConnectError("ssh handshake with " + m_endpoint.key() + " failed: " + message);
+    }
+    try {
+        this->check_host_key();
+        this->authenticate();
+    } catch (...) {
+        this->disconnect();
+        throw;
+    }
+    libssh2_keepalive_config(m_session, 1, kKeepaliveInterval);
+    LOG_INFO("ssh session to %s established", m_endpoint.key().c_str());
+}
+
+void SshSession::check_host_key() {
+    const auto known_hosts_path = fs::path(home_dir()) / ".ssh" / "known_hosts";
+    auto known_hosts = libssh2_knownhost_init(m_session);
+    if (nullptr == known_hosts) {
+        throw SshConnectError("can not check the host key of " + m_endpoint.host);
+    }
+    if (fs::exists(known_hosts_path)) {
+        libssh2_knownhost_readfile(known_hosts, known_hosts_path.string().c_str(), LIBSSH2_KNOWNHOST_FILE_OPENSSH);
+    }
+    std::size_t host_key_length = 0;
+    int host_key_type = 0;
+    const char* host_key = libssh2_session_hostkey(m_session, &host_key_length, &host_key_type);
+    int check = LIBSSH2_KNOWNHOST_CHECK_FAILURE;
+    if (nullptr != host_key) {
+        libssh2_knownhost* host = nullptr;
+        check = libssh2_knownhost_checkp(
+            known_hosts, m_endpoint.host.c_str(), m_endpoint.port, host_key, host_key_length,
+            LIBSSH2_KNOWNHOST_TYPE_PLAIN | LIBSSH2_KNOWNHOST_KEYENC_RAW, &host
+        );
+    }
+    libssh2_knownhost_free(known_hosts);
+    if (LIBSSH2_KNOWNHOST_CHECK_MISMATCH == check) {
+        throw SshConnectError("host key of " + m_endpoint.host + " does not match " + known_hosts_path.string());
+    }
+    if (LIBSSH2_KNOWNHOST_CHECK_MATCH != check) {
+        throw SshConnectError("host key of " + m_endpoint.host + " is not in " + known_hosts_path.string()
+            + ", connect once with ssh to add it");
+    }
+}
+
+void SshSession::authenticate() {
+    const char* user = m_endpoint.user.c_str();
+    if (false == m_endpoint.private_key.empty()) {
+        const char* public_key = m_endpoint.public_key.empty() ? nullptr : m_endpoint.public_key.c_str();
+        if (0 == libssh2_userauth_publickey_fromfile(m_session, user, public_key, m_endpoint.private_key.c_str(), m_endpoint.passphrase.c_str())) {
+            return;
+        }
+    } else if (false == m_endpoint.password.empty()) {
+        if (0 == libssh2_userauth_password(m_session, user, m_endpoint.password.c_str())) {
+            return;
+        }
+    } else {
+        auto agent = libssh2_agent_init(m_session);
+        bool authenticated = false;
+        if (nullptr != agent && 0 == libssh2_agent_connect(agent) && 0 == libssh2_agent_list_identities(agent)) {
+            libssh2_agent_publickey* identity = nullptr;
+            libssh2_agent_publickey* previous = nullptr;
+            while (0 == libssh2_agent_get_identity(agent, &identity, previous)) {
+                if (0 == libssh2_agent_userauth(agent, user, identity)) {
+                    authenticated = true;
+                    break;
+                }
+                previous = identity;
+            }
+            libssh2_agent_disconnect(agent);
+        }
+        if (nullptr != agent) {
+            libssh2_agent_free(agent);
+        }
+        if (true == authenticated) {
+            return;
+        }
+    }
+    throw SshConnectError("authentication to " + m_endpoint.key() + " failed: " + session_error(m_session));
+}
+
+void SshSession::disconnect() {
+    if (nullptr != m_sftp) {
+        libssh2_sftp_shutdown(m_sftp);
+        m_sftp = nullptr;
+    }
+    if (nullptr != m_session) {
+        libssh2_session_disconnect(m_session, "bye");
+        libssh2_session_free(m_session);
+        m_session = nullptr;
+    }
+    if (m_socket >= 0) {
+        close_socket(m_socket);
+        m_socket = -1;
+    }
+}
+
+bool SshSession::is_alive() {
+    if (nullptr == m_session) {
+        return false;
+    }
+    int seconds_to_next = 0;
+    return 0 == libssh2_keepalive_send(m_session, &seconds_to_next);
+}
+
+SshExecResult SshSession::exec(const std::string& command) {
+    TRACE_SCOPE_CAT("SshSession::exec", "remote");
+    if (nullptr == m_session) {
+        this->connect();
+    }
+    auto channel = libssh2_channel_open_session(m_session);
+    if (nullptr == channel) {
+        throw SshConnectError("can not open a channel to " + m_endpoint.key() + ": " + session_error(m_session));
+    }
+    SshExecResult result;
+    if (0 != libssh2_channel_exec(channel, command.c_str())) {
+        libssh2_channel_free(channel);
+        throw SshError("can not exec on " + m_endpoint.key() + ": " + session_error(m_session));
+    }
+    // stdout and stderr are drained together without blocking, a command
+    // filling the stderr window must not stall the read of stdout
+    libssh2_session_set_blocking(m_session, 0);
+    char buffer[16384];
+    while (true) {
+        auto nread = libssh2_channel_read(channel, buffer, sizeof(buffer));
+        if (nread > 0) {
+            result.out.append(buffer, nread);
+        }
+        auto nread_err = libssh2_channel_read_stderr(channel, buffer, sizeof(buffer));
+        if (nread_err > 0) {
+            result.err.append(buffer, nread_err);
+        }
+        if (nread > 0 || nread_err > 0) {
+            continue;
+        }
+        if ((nread < 0 && LIBSSH2_ERROR_EAGAIN != nread) || (nread_err < 0 && LIBSSH2_ERROR_EAGAIN != nread_err)) {
+            const auto message = session_error(m_session);
+            libssh2_session_set_blocking(m_session, 1);
+            libssh2_channel_free(channel);
+            throw SshError("reading from " + m_endpoint.key() + " failed: " + message);
+        }
+        if (0 != libssh2_channel_eof(channel)) {
+            break;
+        }
+        this->wait_socket();
+    }
+    libssh2_session_set_blocking(m_session, 1);
+    libssh2_channel_close(channel);
+    libssh2_channel_wait_closed(channel);
+    result.exit_status = libssh2_channel_get_exit_status(channel);
+    libssh2_channel_free(channel);
+    return result;
+}
+
+void SshSession::wait_socket() {
+    timeval timeout{10, 0};
+    fd_set read_fds;
+    fd_set write_fds;
+    FD_ZERO(&read_fds);
+    FD_ZERO(&write_fds);
+    const int directions = libssh2_session_block_directions(m_session);
+    if (0 != (directions & LIBSSH2_SESSION_BLOCK_INBOUND)) {
+        FD_SET(m_socket, &read_fds);
+    }
+    if (0 != (directions & LIBSSH2_SESSION_BLOCK_OUTBOUND)) {
+        FD_SET(m_socket, &write_fds);
+    }
+    select(m_socket + 1, &read_fds, &write_fds, nullptr, &timeout);
+}
+
+LIBSSH2_SFTP* SshSession::sftp() {
+    if (nullptr == m_session) {
+        this->connect();
+    }
+    if (nullptr == m_sftp) {
+        m_sftp = libssh2_sftp_init(m_session);
+        if (nullptr == m_sftp) {
+            throw SshError("can not start sftp on " + m_endpoint.key() + ": " + session_error(m_session));
+        }
+    }
+    return m_sftp;
+}
+
+SshLease::SshLease(SshSessionPool* pool, std::shared_ptr<SshSession> session)
+    : m_pool{pool}, m_session{std::move(session)} {
+}
+
+SshLease::SshLease(SshLease&& other) noexcept
+    : m_pool{other.m_pool}, m_session{std::move(other.m_session)} {
+    other.m_pool = nullptr;
+}
+
+SshLease::~SshLease() {
+    if (nullptr != m_pool && nullptr != m_session) {
+        m_pool->release(m_session, nullptr != m_session->get_session());
+    }
+}
+
+SshSessionPool& SshSessionPool::instance() {
+    static SshSessionPool pool;
+    return pool;
+}
+
+SshSessionPool::SshSessionPool() {
+#if defined(_WIN32)
+    // winsock has to be started before the sessions create their sockets
+    WSADATA wsa_data;
+    if (0 != WSAStartup(MAKEWORD(2, 2), &wsa_data)) {
+        LOG_ERROR("can not start winsock");
+    }
+#endif
+    libssh2_init(0);
+}
+
+SshSessionPool::~SshSessionPool() {
+    this->clear();
+    libssh2_exit();
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+}
+
+void SshSessionPool::set_max_sessions_per_host(int max_sessions) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_max_sessions_per_host = std::max(1, max_sessions);
+}
+
+SshLease SshSessionPool::acquire(const SshEndpoint& endpoint) {
+    std::shared_ptr<SshSession> session;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto& host = m_hosts[endpoint.key()];
+        m_released.wait(lock, [&]() {
+            return false == host.idle.empty() || host.nsession < m_max_sessions_per_host;
+        });
+        if (false == host.idle.empty()) {
+            session = host.idle.back();
+            host.idle.pop_back();
+        } else {
+            session = std::make_shared<SshSession>(endpoint);
+            host.nsession++;
+        }
+    }
+    // connecting happens outside of the pool lock, the lease is created
+    // first so that a failed connect gives the slot back
+    SshLease lease(this, session);
+    if (false == session->is_alive()) {
+        session->connect();
+    }
+    return lease;
+}
+
+void SshSessionPool::release(const std::shared_ptr<SshSession>& session, bool healthy) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& host = m_hosts[session->get_endpoint().key()];
+        if (true == healthy) {
+            host.idle.push_back(session);
+        } else {
+            host.nsession--;
+        }
+    }
+    m_released.notify_one();
+}
+
+SshExecResult SshSessionPool::exec(const SshEndpoint& endpoint, const std::string& command) {
+    auto lease = this->acquire(endpoint);
+    try {
+        return lease->exec(command);
+    } catch (const SshConnectError& e) {
+        LOG_WARNING("%s, reconnecting to %s", e.what(), endpoint.key().c_str());
+        lease->connect();
+        return lease->exec(command);
+    }
+}
+
+void SshSessionPool::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& item : m_hosts) {
+        item.second.nsession -= static_cast<int>(item.second.idle.size());
+        item.second.idle.clear();
+    }
+}
@@ -0,0 +1,185 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Pool of authenticated libssh2 sessions, keyed by user, host and port.
+///
+/// Connecting and authenticating costs several round trips, so sessions
+/// are kept alive and every exec or SFTP operation opens a channel on an
+/// existing session. libssh2 sessions must not be used by two threads at
+/// the same time, so the channels of a session are not multiplexed across
+/// threads: a session is leased to one caller at a time, and the pool
+/// opens up to max_sessions_per_host sessions to the same host for
+/// concurrent callers. A session found dead is reconnected on the next
+/// lease.
+///
+/// Hosts must be in ~/.ssh/known_hosts; a missing or different host key
+/// refuses the connection.
+
+#ifndef REMOTE_SSH_POOL_H
+#define REMOTE_SSH_POOL_H
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <libssh2.h>
+#include <libssh2_sftp.h>
+
+struct SshEndpoint {
+    std::string host;
+    int port = 22;
+    std::string user;
+    // authentication: a key file, a password, or else the ssh-agent
+    std::string private_key;
+    std::string public_key;
+    std::string passphrase;
+    std::string password;
+    // zlib compression of the transport, negotiated at the handshake
+    bool compress = true;
+
+    std::string key() const {
+        return user + "@" + host + ":" + std::to_string(port);
+    }
+};
+
+class SshError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// a failure before the command was started: connect, handshake,
+// authentication or channel open; running the command again is safe
+class SshConnectError : public SshError {
+public:
+    using SshError::SshError;
+};
+
+// single quotes for a POSIX shell, quotes inside are escaped
+std::string shell_quote(const std::string& text);
+
+struct SshExecResult {
+    int exit_status = -1;
+    std::string out;
+    std::string err;
+};
+
+class SshSession {
+public:
+    explicit SshSession(const SshEndpoint& endpoint);
+    ~SshSession();
+
+    SshSession(const SshSession&) = delete;
+    SshSession& operator=(const SshSession&) = delete;
+
+    void connect();
+    void disconnect();
+    // sends a keepalive, false if the connection is gone
+    bool is_alive();
+
+    SshExecResult exec(const std::string& command);
+    // the SFTP subsystem is started once per session
+    LIBSSH2_SFTP* sftp();
+
+    LIBSSH2_SESSION* get_session() {
+        return m_session;
+    }
+    const SshEndpoint& get_endpoint() const {
+        return m_endpoint;
+    }
+
+private:
+    void check_host_key();
+    void authenticate();
+    // waits until the socket is ready in the direction libssh2 blocked on
+    void wait_socket();
+
+    SshEndpoint m_endpoint;
+    int m_socket = -1;
+    LIBSSH2_SESSION* m_session = nullptr;
+    LIBSSH2_SFTP* m_sftp = nullptr;
+};
+
+class SshSessionPool;
+
+/// Exclusive use of a pooled session, returned to the pool on destruction.
+class SshLease {
+public:
+    SshLease(SshSessionPool* pool, std::shared_ptr<SshSession> session);
+    ~SshLease();
+
+    SshLease(SshLease&& other) noexcept;
+    SshLease(const SshLease&) = delete;
+    SshLease& operator=(const SshLease&) = delete;
+
+    SshSession* operator->() {
+        return m_session.get();
+    }
+    SshSession& operator*() {
+        return *m_session;
+    }
+
+private:
+    SshSessionPool* m_pool;
+    std::shared_ptr<SshSession> m_session;
+};
+
+class SshSessionPool {
+public:
+    static SshSessionPool& instance();
+
+    SshLease acquire(const SshEndpoint& endpoint);
+
+    // exec on a pooled session, reconnects and retries once when the
+    // command could not be started; a failure after the start is thrown,
+    // the command may have run
+    SshExecResult exec(const SshEndpoint& endpoint, const std::string& command);
+
+    void set_max_sessions_per_host(int max_sessions);
+    int get_max_sessions_per_host() const {
+        return m_max_sessions_per_host;
+    }
+
+    // closes every idle session
+    void clear();
+
+private:
+    friend class SshLease;
+
+    struct Host {
+        std::vector<std::shared_ptr<SshSession>> idle;
+        int nsession = 0;
+    };
+
+    SshSessionPool();
+    ~SshSessionPool();
+
+    void release(const std::shared_ptr<SshSession>& session, bool healthy);
+
+    std::mutex m_mutex;
+    std::condition_variable m_released;
+    std::map<std::string, Host> m_hosts;
+    int m_max_sessions_per_host = 4;
+};
+
+#endif // REMOTE_SSH_POOL_H
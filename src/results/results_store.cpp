@@ -0,0 +1,687 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "results/results_store.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+
+#include "analysis/trajectory.h"
+#include "calc/output_parsers.h"
+#include "utils/logger.h"
+#include "utils/trace.h"
+
+namespace fs = boost::filesystem;
+namespace bip = boost::interprocess;
+
+namespace {
+
+const std::uint64_t kBlockRows = 4096;
+
+const double kRydbergToEv = 13.605693122994;
+const double kRydbergPerBohrToEvPerAngstrom = 25.71104309541616;
+
+// in the order of number_columns() and label_columns()
+const std::vector<double ResultRecord::*> kNumberFields{
+    &ResultRecord::energy,
+    &ResultRecord::energy_per_atom,
+    &ResultRecord::force,
+    &ResultRecord::pressure,
+    &ResultRecord::band_gap,
+    &ResultRecord::natom,
+    &ResultRecord::time,
+};
+
+const std::vector<std::string ResultRecord::*> kLabelFields{
+    &ResultRecord::job,
+    &ResultRecord::composition,
+    &ResultRecord::code,
+    &ResultRecord::path,
+};
+
+std::string trim(const std::string& str) {
+    const auto begin = str.find_first_not_of(" \t\r\n");
+    if (std::string::npos == begin) {
+        return "";
+    }
+    return str.substr(begin, str.find_last_not_of(" \t\r\n") - begin + 1);
+}
+
+// the leading letters of a species label, "Fe1" or "Ti_sv" is an element
+std::string element_of(const std::string& label) {
+    std::size_t length = 0;
+    while (length < label.size() && std::isalpha(static_cast<unsigned char>(label[length]))) {
+        length++;
+    }
+    return label.substr(0, length);
+}
+
+std::string reduced_formula(const std::map<std::string, int>& counts) {
+    int divisor = 0;
+    for (const auto& item : counts) {
+        divisor = std::gcd(divisor, item.second);
+    }
+    std::string formula;
+    for (const auto& item : counts) {
+        formula += item.first;
+        if (item.second / divisor > 1) {
+            formula += std::to_string(item.second / divisor);
+        }
+    }
+    return formula;
+}
+
+// the atoms per element from the header of a pw.x output or an OUTCAR,
+// which is read only as far as needed
+std::map<std::string, int> read_composition(const std::string& output_path, bool vasp) {
+    std::map<std::string, int> counts;
+    std::ifstream in(output_path);
+    std::string line;
+    if (true == vasp) {
+        //    TITEL  = PAW_PBE Si 05Jan2001
+        //    ions per type =               2   4
+        std::vector<std::string> species;
+        while (std::getline(in, line)) {
+            if (std::string::npos != line.find("TITEL")) {
+                std::istringstream words(line.substr(line.find('=') + 1));
+                std::string potential, name;
+                words >> potential >> name;
+                species.push_back(element_of(name));
+            } else if (std::string::npos != line.find("ions per type")) {
+                std::istringstream words(line.substr(line.find('=') + 1));
+                int count = 0;
+                for (std::size_t s = 0; s < species.size() && words >> count; s++) {
+                    counts[species[s]] += count;
+                }
+                break;
+            }
+        }
+    } else {
+        //      number of atoms/cell      =            2
+        //         1           Si  tau(   1) = (   0.0000000   0.0000000   0.0000000  )
+        int natom = -1;
+        int nfound = 0;
+        while (std::getline(in, line) && nfound != natom) {
+            if (natom < 0 && std::string::npos != line.find("number of atoms/cell")) {
+                natom = std::atoi(line.c_str() + line.find('=') + 1);
+            } else if (natom > 0 && std::string::npos != line.find("tau(")) {
+                std::istringstream words(line);
+                std::string index, name;
+                words >> index >> name;
+                counts[element_of(name)]++;
+                nfound++;
+            }
+        }
+    }
+    return counts;
+}
+
+bool zone_may_match(double min, double max, FilterOp op, double value) {
+    switch (op) {
+    case FilterOp::Less:
+        return min < value;
+    case FilterOp::LessEqual:
+        return min <= value;
+    case FilterOp::Greater:
+        return max > value;
+    case FilterOp::GreaterEqual:
+        return max >= value;
+    case FilterOp::Equal:
+        return min <= value && value <= max;
+    }
+    return true;
+}
+
+template <typename T, typename Compare>
+void and_mask(const T* values, std::size_t n, std::uint8_t* mask, Compare compare) {
+    for (std::size_t i = 0; i < n; i++) {
+        mask[i] &= compare(values[i]) ? 1 : 0;
+    }
+}
+
+// NaN never matches
+template <typename T>
+void apply_filter(const T* values, std::size_t n, FilterOp op, double value, std::uint8_t* mask) {
+    switch (op) {
+    case FilterOp::Less:
+        and_mask(values, n, mask, [value](T x) { return x < value; });
+        break;
+    case FilterOp::LessEqual:
+        and_mask(values, n, mask, [value](T x) { return x <= value; });
+        break;
+    case FilterOp::Greater:
+        and_mask(values, n, mask, [value](T x) { return x > value; });
+        break;
+    case FilterOp::GreaterEqual:
+        and_mask(values, n, mask, [value](T x) { return x >= value; });
+        break;
+    case FilterOp::Equal:
+        and_mask(values, n, mask, [value](T x) { return x == value; });
+        break;
+    }
+}
+
+void write_file_atomically(const fs::path& path, const void* data, std::size_t size) {
+    const auto tmp_path = path.string() + ".tmp";
+    std::FILE* file = std::fopen(tmp_path.c_str(), "wb");
+    if (nullptr == file) {
+        throw std::runtime_error("can not write " + tmp_path);
+    }
+    const auto nwritten = std::fwrite(data, 1, size, file);
+    if (0 != std::fclose(file) || nwritten != size) {
+        throw std::runtime_error("can not write " + tmp_path);
+    }
+    fs::rename(tmp_path, path);
+}
+
+} // namespace
+
+bool read_result_record(const std::string& output_path, ResultRecord& record) {
+    TRACE_SCOPE_CAT("read_result_record", "results");
+    auto parser = make_output_parser(output_path);
+    const auto name = fs::path(output_path).filename().string();
+    const bool vasp = std::string::npos != name.find("OUTCAR") || std::string::npos != name.find("OSZICAR");
+    std::ifstream in(output_path, std::ios::binary);
+    if (false == in.is_open()) {
+        return false;
+    }
+    std::vector<char> buffer(1 << 20);
+    while (in.read(buffer.data(), buffer.size()) || in.gcount() > 0) {
+        parser->feed(buffer.data(), in.gcount());
+    }
+    parser->feed("\n", 1);
+    const auto& data = parser->get_data();
+    const auto& energies = data.ionic_energy.empty() ? data.scf_energy : data.ionic_energy;
+    if (energies.empty()) {
+        return false;
+    }
+
+    // everything in eV and A as VASP reports it
+    const double energy_unit = vasp ? 1.0 : kRydbergToEv;
+    const double force_unit = vasp ? 1.0 : kRydbergPerBohrToEvPerAngstrom;
+    record.energy = energies.back() * energy_unit;
+    if (false == data.force.empty()) {
+        record.force = data.force.back() * force_unit;
+    } else if (std::string::npos != name.find("OUTCAR")) {
+        // older OUTCARs have no "FORCES: max atom" line, the forces of
+        // the last ionic step are streamed from the positions blocks
+        std::vector<double> forces;
+        try {
+            TrajectoryReader reader(output_path, std::make_unique<OutcarFormat>());
+            reader.read([&forces](Frame& frame) {
+                forces.swap(frame.forces);
+                return true;
+            });
+        } catch (const std::exception& e) {
+            LOG_WARNING("%s: %s", output_path.c_str(), e.what());
+        }
+        for (std::size_t i = 0; i + 2 < forces.size(); i += 3) {
+            const double force = std::sqrt(forces[i] * forces[i] + forces[i + 1] * forces[i + 1] + forces[i + 2] * forces[i + 2]);
+            record.force = std::isnan(record.force) ? force : std::max(record.force, force);
+        }
+    }
+    if (false == data.pressure.empty()) {
+        record.pressure = data.pressure.back();
+    }
+    if (false == data.band_gap.empty()) {
+        record.band_gap = data.band_gap.back();
+    }
+    record.code = vasp ? "vasp" : "qe";
+    record.path = fs::absolute(output_path).string();
+
+    const auto counts = read_composition(output_path, vasp);
+    if (false == counts.empty()) {
+        int natom = 0;
+        for (const auto& item : counts) {
+            natom += item.second;
+        }
+        record.natom = natom;
+        record.energy_per_atom = record.energy / natom;
+        record.composition = reduced_formula(counts);
+    }
+    return true;
+}
+
+std::vector<ResultFilter> parse_result_query(const std::string& query) {
+    const auto& numbers = ResultsStore::number_columns();
+    const auto& labels = ResultsStore::label_columns();
+    const auto is_space = [](char c) {
+        return 0 != std::isspace(static_cast<unsigned char>(c));
+    };
+    const auto is_word = [](char c) {
+        return 0 != std::isalnum(static_cast<unsigned char>(c)) || '_' == c;
+    };
+    std::size_t pos = 0;
+    const auto skip_spaces = [&]() {
+        while (pos < query.size() && is_space(query[pos])) {
+            pos++;
+        }
+    };
+    // the separator word "and" at pos, not a prefix of a longer word
+    const auto at_and = [&]() {
+        return 0 == query.compare(pos, 3, "and") && (pos + 3 == query.size() || false == is_word(query[pos + 3]));
+    };
+
+    std::vector<ResultFilter> filters;
+    skip_spaces();
+    while (pos < query.size()) {
+        // column
+        const auto column_begin = pos;
+        while (pos < query.size() && is_word(query[pos])) {
+            pos++;
+        }
+        ResultFilter filter;
+        filter.column = query.substr(column_begin, pos - column_begin);
+        skip_spaces();
+
+        // operator
+        if (pos >= query.size() || std::string::npos == std::string("<>=").find(query[pos])) {
+            throw std::runtime_error("no operator after: " + query.substr(column_begin, pos - column_begin));
+        }
+        const char op = query[pos++];
+        const bool or_equal = '=' != op && pos < query.size() && '=' == query[pos];
+        if (true == or_equal) {
+            pos++;
+        }
+        switch (op) {
+        case '<':
+            filter.op = or_equal ? FilterOp::LessEqual : FilterOp::Less;
+            break;
+        case '>':
+            filter.op = or_equal ? FilterOp::GreaterEqual : FilterOp::Greater;
+            break;
+        default:
+            filter.op = FilterOp::Equal;
+        }
+        skip_spaces();
+
+        // value, quoted or up to the next separator; a quoted value may
+        // hold ',' and " and "
+        std::string value;
+        bool quoted = false;
+        if (pos < query.size() && ('"' == query[pos] || '\'' == query[pos])) {
+            const auto close = query.find(query[pos], pos + 1);
+            if (std::string::npos == close) {
+                throw std::runtime_error("unterminated quote in: " + query.substr(column_begin));
+            }
+            value = query.substr(pos + 1, close - pos - 1);
+            quoted = true;
+            pos = close + 1;
+        } else {
+            const auto value_begin = pos;
+            auto value_end = pos;
+            while (pos < query.size() && ',' != query[pos] && false == at_and()) {
+                while (pos < query.size() && ',' != query[pos] && false == is_space(query[pos])) {
+                    pos++;
+                }
+                value_end = pos;
+                skip_spaces();
+            }
+            value = query.substr(value_begin, value_end - value_begin);
+        }
+        skip_spaces();
+
+        // separator
+        if (pos < query.size()) {
+            if (',' == query[pos]) {
+                pos++;
+            } else if (true == at_and()) {
+                pos += 3;
+            } else {
+                throw std::runtime_error("expected ',' or and before: " + query.substr(pos));
+            }
+            skip_spaces();
+        }
+
+        if (labels.end() != std::find(labels.begin(), labels.end(), filter.column)) {
+            if (FilterOp::Equal != filter.op) {
+                throw std::runtime_error("only = is supported for " + filter.column);
+            }
+            filter.label = value;
+        } else if (numbers.end() != std::find(numbers.begin(), numbers.end(), filter.column)) {
+            char* number_end = nullptr;
+            filter.number = std::strtod(value.c_str(), &number_end);
+            if (true == quoted || value.empty() || number_end != value.c_str() + value.size()) {
+                throw std::runtime_error("not a number: " + value);
+            }
+        } else {
+            throw std::runtime_error("unknown column: " + filter.column);
+        }
+        filters.push_back(filter);
+    }
+    return filters;
+}
+
+const std::vector<std::string>& ResultsStore::number_columns() {
+    static const std::vector<std::string> columns{
+        "energy", "energy_per_atom", "force", "pressure", "band_gap", "natom", "time",
+    };
+    return columns;
+}
+
+const std::vector<std::string>& ResultsStore::label_columns() {
+    static const std::vector<std::string> columns{
+        "job", "composition", "code", "path",
+    };
+    return columns;
+}
+
+ResultsStore::ResultsStore(const std::string& store_dir) : m_store_dir{store_dir} {
+    TRACE_SCOPE_CAT("ResultsStore::ResultsStore", "results");
+    fs::create_directories(m_store_dir);
+    std::ifstream rows_in((fs::path(m_store_dir) / "rows").string());
+    rows_in >> m_nrow;
+
+    for (const auto& name : number_columns()) {
+        m_columns.push_back(std::make_unique<Column>());
+        m_columns.back()->name = name;
+    }
+    for (const auto& name : label_columns()) {
+        m_columns.push_back(std::make_unique<Column>());
+        m_columns.back()->name = name;
+        m_columns.back()->label = true;
+    }
+    // a column shorter than the committed count is a damaged store, the
+    // rows present in every column are kept
+    for (const auto& column : m_columns) {
+        const auto path = this->path_of(*column, ".bin");
+        const std::uint64_t width = column->label ? sizeof(std::uint32_t) : sizeof(double);
+        const std::uint64_t nrow = fs::exists(path) ? fs::file_size(path) / width : 0;
+        if (nrow < m_nrow) {
+            LOG_WARNING("results column %s has %llu of %llu rows", column->name.c_str(),
+                static_cast<unsigned long long>(nrow), static_cast<unsigned long long>(m_nrow));
+            m_nrow = nrow;
+        }
+    }
+    for (const auto& column : m_columns) {
+        this->open_column(*column);
+    }
+}
+
+std::string ResultsStore::path_of(const Column& column, const char* suffix) const {
+    return (fs::path(m_store_dir) / (column.name + suffix)).string();
+}
+
+void ResultsStore::open_column(Column& column) {
+    const auto bin_path = this->path_of(column, ".bin");
+    const std::uint64_t width = column.label ? sizeof(std::uint32_t) : sizeof(double);
+    if (false == fs::exists(bin_path)) {
+        std::ofstream(bin_path, std::ios::binary);
+    }
+    // rows of an interrupted append
+    if (fs::file_size(bin_path) != m_nrow * width) {
+        fs::resize_file(bin_path, m_nrow * width);
+    }
+
+    if (true == column.label) {
+        std::ifstream dict_in(this->path_of(column, ".dict"));
+        std::string label;
+        while (std::getline(dict_in, label)) {
+            column.code_of.emplace(label, static_cast<std::uint32_t>(column.dict.size()));
+            column.dict.push_back(label);
+        }
+    }
+    this->map_column(column);
+
+    const std::uint64_t nblock = (m_nrow + kBlockRows - 1) / kBlockRows;
+    std::ifstream zones_in(this->path_of(column, ".zones"), std::ios::binary);
+    column.zones.resize(nblock);
+    zones_in.read(reinterpret_cast<char*>(column.zones.data()), nblock * sizeof(Zone));
+    if (static_cast<std::uint64_t>(zones_in.gcount()) != nblock * sizeof(Zone)) {
+        // rebuilt from the values
+        for (std::uint64_t block = 0; block < nblock; block++) {
+            Zone zone{std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()};
+            for (std::uint64_t row = block * kBlockRows; row < std::min(m_nrow, (block + 1) * kBlockRows); row++) {
+                const double value = this->value_at(column, row);
+                if (false == std::isnan(value)) {
+                    zone.min = std::min(zone.min, value);
+                    zone.max = std::max(zone.max, value);
+                }
+            }
+            column.zones[block] = zone;
+        }
+    }
+}
+
+void ResultsStore::map_column(Column& column) {
+    column.region = bip::mapped_region();
+    if (0 == m_nrow) {
+        return;
+    }
+    column.file = bip::file_mapping(this->path_of(column, ".bin").c_str(), bip::read_only);
+    column.region = bip::mapped_region(column.file, bip::read_only);
+}
+
+double ResultsStore::value_at(const Column& column, std::uint64_t row) const {
+    if (true == column.label) {
+        return static_cast<const std::uint32_t*>(column.region.get_address())[row];
+    }
+    return static_cast<const double*>(column.region.get_address())[row];
+}
+
+const ResultsStore::Column& ResultsStore::find_column(const std::string& name) const {
+    for (const auto& column : m_columns) {
+        if (column->name == name) {
+            return *column;
+        }
+    }
+    throw std::runtime_error("unknown column: " + name);
+}
+
+void ResultsStore::append(const std::vector<ResultRecord>& records) {
+    TRACE_SCOPE_CAT("ResultsStore::append", "results");
+    if (records.empty()) {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    const double now = static_cast<double>(std::time(nullptr));
+    const std::uint64_t nrow = m_nrow + records.size();
+
+    std::size_t number_index = 0;
+    std::size_t label_index = 0;
+    for (const auto& column_ptr : m_columns) {
+        auto& column = *column_ptr;
+        std::vector<double> values(records.size());
+        std::vector<std::uint32_t> codes;
+        std::string new_labels;
+        if (false == column.label) {
+            const auto field = kNumberFields[number_index++];
+            for (std::size_t i = 0; i < records.size(); i++) {
+                values[i] = records[i].*field;
+                if (&ResultRecord::time == field && std::isnan(values[i])) {
+                    values[i] = now;
+                }
+            }
+        } else {
+            const auto field = kLabelFields[label_index++];
+            codes.resize(records.size());
+            for (std::size_t i = 0; i < records.size(); i++) {
+                // labels are single lines in the dictionary file
+                auto label = records[i].*field;
+                std::replace(label.begin(), label.end(), '\n', ' ');
+                auto found = column.code_of.find(label);
+                if (column.code_of.end() == found) {
+                    found = column.code_of.emplace(label, static_cast<std::uint32_t>(column.dict.size())).first;
+                    column.dict.push_back(label);
+                    new_labels += label + "\n";
+                }
+                codes[i] = found->second;
+                values[i] = found->second;
+            }
+        }
+
+        if (false == new_labels.empty()) {
+            std::ofstream dict_out(this->path_of(column, ".dict"), std::ios::app | std::ios::binary);
+            dict_out << new_labels;
+        }
+        // an append that failed part way left rows in the columns before
+        // the failing one, they are cut off so that every column starts
+        // at the committed count again
+        const auto bin_path = this->path_of(column, ".bin");
+        const std::uint64_t width = column.label ? sizeof(std::uint32_t) : sizeof(double);
+        if (fs::file_size(bin_path) != m_nrow * width) {
+            fs::resize_file(bin_path, m_nrow * width);
+        }
+        std::FILE* file = std::fopen(bin_path.c_str(), "ab");
+        if (nullptr == file) {
+            throw std::runtime_error("can not append to " + bin_path);
+        }
+        std::size_t nwritten = 0;
+        if (true == column.label) {
+            nwritten = std::fwrite(codes.data(), sizeof(std::uint32_t), codes.size(), file);
+        } else {
+            nwritten = std::fwrite(values.data(), sizeof(double), values.size(), file);
+        }
+        if (0 != std::fclose(file) || nwritten != records.size()) {
+            throw std::runtime_error("can not append to " + bin_path);
+        }
+
+        column.zones.resize((nrow + kBlockRows - 1) / kBlockRows, Zone{
+            std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()
+        });
+        for (std::size_t i = 0; i < records.size(); i++) {
+            if (false == std::isnan(values[i])) {
+                auto& zone = column.zones[(m_nrow + i) / kBlockRows];
+                zone.min = std::min(zone.min, values[i]);
+                zone.max = std::max(zone.max, values[i]);
+            }
+        }
+        write_file_atomically(this->path_of(column, ".zones"), column.zones.data(), column.zones.size() * sizeof(Zone));
+    }
+
+    // the rows become visible with the count
+    const auto rows = std::to_string(nrow);
+    write_file_atomically(fs::path(m_store_dir) / "rows", rows.data(), rows.size());
+    m_nrow = nrow;
+    for (const auto& column : m_columns) {
+        this->map_column(*column);
+    }
+}
+
+std::uint64_t ResultsStore::size() const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_nrow;
+}
+
+std::vector<std::uint64_t> ResultsStore::select(const std::vector<ResultFilter>& filters) const {
+    TRACE_SCOPE_CAT("ResultsStore::select", "results");
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+    // labels are compared by their code
+    struct Condition {
+        const Column* column;
+        FilterOp op;
+        double value;
+    };
+    std::vector<Condition> conditions;
+    for (const auto& filter : filters) {
+        const auto& column = this->find_column(filter.column);
+        if (true == column.label) {
+            const auto found = column.code_of.find(filter.label);
+            if (column.code_of.end() == found) {
+                return {};
+            }
+            conditions.push_back({&column, FilterOp::Equal, static_cast<double>(found->second)});
+        } else {
+            conditions.push_back({&column, filter.op, filter.number});
+        }
+    }
+
+    const std::int64_t nblock = static_cast<std::int64_t>((m_nrow + kBlockRows - 1) / kBlockRows);
+    std::vector<std::vector<std::uint64_t>> block_rows(nblock);
+#pragma omp parallel for schedule(dynamic, 4)
+    for (std::int64_t block = 0; block < nblock; block++) {
+        bool may_match = true;
+        for (const auto& condition : conditions) {
+            const auto& zone = condition.column->zones[block];
+            if (false == zone_may_match(zone.min, zone.max, condition.op, condition.value)) {
+                may_match = false;
+                break;
+            }
+        }
+        if (false == may_match) {
+            continue;
+        }
+        const std::uint64_t first = block * kBlockRows;
+        const std::size_t n = std::min(kBlockRows, m_nrow - first);
+        std::uint8_t mask[kBlockRows];
+        std::fill(mask, mask + n, 1);
+        for (const auto& condition : conditions) {
+            if (true == condition.column->label) {
+                const auto codes = static_cast<const std::uint32_t*>(condition.column->region.get_address()) + first;
+                apply_filter(codes, n, condition.op, condition.value, mask);
+            } else {
+                const auto values = static_cast<const double*>(condition.column->region.get_address()) + first;
+                apply_filter(values, n, condition.op, condition.value, mask);
+            }
+        }
+        for (std::size_t i = 0; i < n; i++) {
+            if (0 != mask[i]) {
+                block_rows[block].push_back(first + i);
+            }
+        }
+    }
+
+    std::vector<std::uint64_t> rows;
+    for (const auto& block : block_rows) {
+        rows.insert(rows.end(), block.begin(), block.end());
+    }
+    return rows;
+}
+
+ResultRecord ResultsStore::get_record(std::uint64_t row) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    ResultRecord record;
+    if (row >= m_nrow) {
+        return record;
+    }
+    std::size_t number_index = 0;
+    std::size_t label_index = 0;
+    for (const auto& column : m_columns) {
+        const double value = this->value_at(*column, row);
+        if (true == column->label) {
+            record.*kLabelFields[label_index++] = column->dict[static_cast<std::uint32_t>(value)];
+        } else {
+            record.*kNumberFields[number_index++] = value;
+        }
+    }
+    return record;
+}
+
+std::vector<double> ResultsStore::get_numbers(const std::string& column_name, const std::vector<std::uint64_t>& rows) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    const auto& column = this->find_column(column_name);
+    std::vector<double> values;
+    values.reserve(rows.size());
+    for (const auto row : rows) {
+        values.push_back(row < m_nrow ? this->value_at(column, row) : std::numeric_limits<double>::quiet_NaN());
+    }
+    return values;
+}
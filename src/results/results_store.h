@@ -0,0 +1,143 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Local store of calculation results under the config dir.
+///
+/// Every column is an append-only file of float64 values or of uint32
+/// codes into a dictionary of labels:
+///
+///     rows              number of committed rows, written last
+///     <column>.bin      one value per row
+///     <column>.dict     labels of the code column, one per line
+///     <column>.zones    min and max of every block of 4096 rows
+///
+/// A query skips the blocks whose zone map can not match and scans the
+/// remaining ones column by column on the memory mapped files. Rows
+/// past the committed count, left by an interrupted append, are cut off
+/// when the store is opened.
+
+#ifndef RESULTS_RESULTS_STORE_H
+#define RESULTS_RESULTS_STORE_H
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+struct ResultRecord {
+    // eV
+    double energy = std::numeric_limits<double>::quiet_NaN();
+    double energy_per_atom = std::numeric_limits<double>::quiet_NaN();
+    // eV/A, max atom for VASP, total for pw.x
+    double force = std::numeric_limits<double>::quiet_NaN();
+    // kbar
+    double pressure = std::numeric_limits<double>::quiet_NaN();
+    // eV
+    double band_gap = std::numeric_limits<double>::quiet_NaN();
+    double natom = std::numeric_limits<double>::quiet_NaN();
+    // seconds since the epoch, set by append when missing
+    double time = std::numeric_limits<double>::quiet_NaN();
+
+    std::string job;
+    // reduced formula, elements in alphabetical order, e.g. O2Si
+    std::string composition;
+    std::string code;
+    std::string path;
+};
+
+// reads the final energy, force, pressure, gap and composition of a
+// pw.x output or OUTCAR, false when the file holds no energy
+bool read_result_record(const std::string& output_path, ResultRecord& record);
+
+enum class FilterOp {
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    Equal,
+};
+
+struct ResultFilter {
+    std::string column;
+    FilterOp op = FilterOp::Equal;
+    double number = 0.0;
+    // compared instead of number for the label columns
+    std::string label;
+};
+
+// "energy < -100, composition = O2Si", conditions are separated by ','
+// or "and", labels holding either are quoted: job = "relax and scf";
+// throws std::runtime_error on syntax errors
+std::vector<ResultFilter> parse_result_query(const std::string& query);
+
+class ResultsStore {
+public:
+    // the names of the float64 and of the label columns
+    static const std::vector<std::string>& number_columns();
+    static const std::vector<std::string>& label_columns();
+
+    explicit ResultsStore(const std::string& store_dir);
+
+    void append(const std::vector<ResultRecord>& records);
+
+    // the matching rows in ascending order, throws std::runtime_error on
+    // unknown columns
+    std::vector<std::uint64_t> select(const std::vector<ResultFilter>& filters) const;
+
+    std::uint64_t size() const;
+    ResultRecord get_record(std::uint64_t row) const;
+    // the values of one column for the rows, e.g. to plot them
+    std::vector<double> get_numbers(const std::string& column, const std::vector<std::uint64_t>& rows) const;
+
+private:
+    struct Zone {
+        double min;
+        double max;
+    };
+
+    struct Column {
+        std::string name;
+        bool label = false;
+        std::vector<Zone> zones;
+        std::vector<std::string> dict;
+        std::map<std::string, std::uint32_t> code_of;
+        boost::interprocess::file_mapping file;
+        boost::interprocess::mapped_region region;
+    };
+
+    std::string path_of(const Column& column, const char* suffix) const;
+    void open_column(Column& column);
+    void map_column(Column& column);
+    const Column& find_column(const std::string& name) const;
+    double value_at(const Column& column, std::uint64_t row) const;
+
+    std::string m_store_dir;
+    std::uint64_t m_nrow = 0;
+    std::vector<std::unique_ptr<Column>> m_columns;
+    mutable std::shared_mutex m_mutex;
+};
+
+#endif // RESULTS_RESULTS_STORE_H
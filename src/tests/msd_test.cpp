@@ -0,0 +1,127 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// The FFT mean-squared displacement against the direct sum over time
+/// origins, for single series and for wrapped periodic trajectories.
+
+#include <random>
+
+#include "analysis/msd.h"
+#include "tests/test.h"
+
+namespace {
+
+// MSD(m) = 1 / (T - m) * sum over t < T - m of |r(t + m) - r(t)|^2
+std::vector<double> brute_force_msd(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& z) {
+    const std::size_t nframe = x.size();
+    std::vector<double> msd(nframe, 0.0);
+    for (std::size_t m = 0; m < nframe; m++) {
+        for (std::size_t t = 0; t + m < nframe; t++) {
+            const double dx = x[t + m] - x[t];
+            const double dy = y[t + m] - y[t];
+            const double dz = z[t + m] - z[t];
+            msd[m] += dx * dx + dy * dy + dz * dz;
+        }
+        msd[m] /= nframe - m;
+    }
+    return msd;
+}
+
+} // namespace
+
+TEST(atom_msd_matches_brute_force) {
+    std::mt19937 generator(42);
+    std::normal_distribution<double> step(0.0, 0.3);
+    // lengths around powers of two, where the zero padding changes
+    for (const std::size_t nframe : {1, 2, 7, 64, 65, 300}) {
+        std::vector<double> x(nframe), y(nframe), z(nframe);
+        // a drifting random walk far from the origin
+        double position[3] = {1000.0, -500.0, 20.0};
+        for (std::size_t t = 0; t < nframe; t++) {
+            position[0] += step(generator) + 0.05;
+            position[1] += step(generator);
+            position[2] += step(generator);
+            x[t] = position[0];
+            y[t] = position[1];
+            z[t] = position[2];
+        }
+        const auto fast = atom_msd(x.data(), y.data(), z.data(), nframe);
+        const auto slow = brute_force_msd(x, y, z);
+        CHECK(fast.size() == nframe);
+        for (std::size_t m = 0; m < nframe && m < fast.size(); m++) {
+            CHECK_NEAR(fast[m], slow[m], 1e-8 * (1.0 + slow[m]));
+        }
+    }
+}
+
+TEST(msd_analysis_unwraps_periodic_frames) {
+    const double box = 5.0;
+    const int natom = 4;
+    const std::size_t nframe = 120;
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<double> step(-0.4, 0.4);
+
+    std::vector<std::vector<double>> unwrapped(3 * natom, std::vector<double>(nframe));
+    std::vector<double> position(3 * natom, 1.0);
+    MsdAnalysis analysis;
+    for (std::size_t t = 0; t < nframe; t++) {
+        Frame frame;
+        frame.cell = {{box, 0.0, 0.0}, {0.0, box, 0.0}, {0.0, 0.0, box}};
+        frame.species = {0, 0, 1, 1};
+        frame.positions.resize(3 * natom);
+        for (int k = 0; k < 3 * natom; k++) {
+            position[k] += step(generator);
+            unwrapped[k][t] = position[k];
+            // the files hold the positions wrapped into the cell
+            frame.positions[k] = position[k] - box * std::floor(position[k] / box);
+        }
+        analysis.add_frame(frame);
+    }
+
+    SpeciesTable species_table;
+    species_table.index_of("A");
+    species_table.index_of("B");
+    const auto result = analysis.result(species_table);
+    CHECK(result.nframe == nframe);
+    CHECK(result.msd.size() == nframe);
+    CHECK(result.species_msd.size() == 2);
+
+    std::vector<double> expected(nframe, 0.0);
+    for (int i = 0; i < natom; i++) {
+        const auto msd = brute_force_msd(unwrapped[3 * i], unwrapped[3 * i + 1], unwrapped[3 * i + 2]);
+        for (std::size_t m = 0; m < nframe; m++) {
+            expected[m] += msd[m] / natom;
+        }
+    }
+    for (std::size_t m = 0; m < nframe && m < result.msd.size(); m++) {
+        CHECK_NEAR(result.msd[m], expected[m], 1e-8 * (1.0 + expected[m]));
+    }
+}
+
+TEST(fit_diffusion_recovers_linear_msd) {
+    // MSD = 6 D t with D = 0.25 and a time step of 2
+    std::vector<double> msd(100);
+    for (std::size_t m = 0; m < msd.size(); m++) {
+        msd[m] = 6.0 * 0.25 * 2.0 * m + 0.1;
+    }
+    const auto fit = fit_diffusion(msd, 2.0);
+    CHECK_NEAR(fit.diffusion, 0.25, 1e-12);
+    CHECK_NEAR(fit.intercept, 0.1, 1e-9);
+}
@@ -0,0 +1,77 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// A minimal test registry for atomscistudio_tests, no framework needed.
+///
+///     TEST(msd_matches_brute_force) {
+///         CHECK_NEAR(fast[m], slow[m], 1e-9);
+///     }
+///
+/// Every TEST registers itself; the runner executes all of them, or the
+/// ones named on the command line, and fails when any check fails.
+
+#ifndef TESTS_TEST_H
+#define TESTS_TEST_H
+
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct TestCase {
+    std::string name;
+    std::function<void()> body;
+};
+
+std::vector<TestCase>& test_registry();
+// counts a failed check of the running test
+void test_fail(const char* file, int line, const std::string& message);
+
+struct TestRegistration {
+    TestRegistration(const char* name, const std::function<void()>& body) {
+        test_registry().push_back({name, body});
+    }
+};
+
+#define TEST(name) \
+    static void test_##name(); \
+    static const TestRegistration test_registration_##name(#name, test_##name); \
+    static void test_##name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            test_fail(__FILE__, __LINE__, #condition); \
+        } \
+    } while (0)
+
+// |actual - expected| <= tolerance, NaN never passes
+#define CHECK_NEAR(actual, expected, tolerance) \
+    do { \
+        const double check_actual = (actual); \
+        const double check_expected = (expected); \
+        if (!(std::fabs(check_actual - check_expected) <= (tolerance))) { \
+            test_fail(__FILE__, __LINE__, std::string(#actual) + " = " + std::to_string(check_actual) \
+                + ", expected " + std::to_string(check_expected)); \
+        } \
+    } while (0)
+
+#endif // TESTS_TEST_H
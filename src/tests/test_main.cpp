@@ -0,0 +1,67 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// atomscistudio_tests: runs the registered tests, all of them or the
+/// ones named as arguments, and exits non-zero when a check failed.
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+#include "tests/test.h"
+
+namespace {
+
+int g_nfailed_checks = 0;
+
+} // namespace
+
+std::vector<TestCase>& test_registry() {
+    static std::vector<TestCase> registry;
+    return registry;
+}
+
+void test_fail(const char* file, int line, const std::string& message) {
+    std::cerr << file << ":" << line << ": " << message << std::endl;
+    g_nfailed_checks++;
+}
+
+int main(int argc, char* argv[]) {
+    const std::vector<std::string> selected(argv + 1, argv + argc);
+    int nrun = 0;
+    int nfailed = 0;
+    for (const auto& test : test_registry()) {
+        if (false == selected.empty() && selected.end() == std::find(selected.begin(), selected.end(), test.name)) {
+            continue;
+        }
+        const int nfailed_before = g_nfailed_checks;
+        try {
+            test.body();
+        } catch (const std::exception& e) {
+            test_fail(test.name.c_str(), 0, std::string("uncaught exception: ") + e.what());
+        }
+        const bool passed = nfailed_before == g_nfailed_checks;
+        std::cout << (passed ? "PASS " : "FAIL ") << test.name << std::endl;
+        nrun++;
+        nfailed += passed ? 0 : 1;
+    }
+    std::cout << nrun - nfailed << " of " << nrun << " tests passed" << std::endl;
+    return 0 == nfailed && nrun > 0 ? 0 : 1;
+}
@@ -0,0 +1,52 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// The frame spacing the dynamics and VDOS dialogs start from.
+
+#include "analysis/trajectory.h"
+#include "tests/test.h"
+
+TEST(frame_spacing_from_frame_times) {
+    FrameSpacing spacing;
+    Frame frame;
+    frame.step = 100;
+    frame.time = 50.0;
+    spacing.add_frame(frame);
+    frame.step = 110;
+    frame.time = 55.0;
+    spacing.add_frame(frame);
+    frame.step = 130;
+    frame.time = 70.0;
+    spacing.add_frame(frame);
+    CHECK_NEAR(spacing.get_time_step(), 5.0, 1e-12);
+    CHECK(10 == spacing.get_steps());
+}
+
+TEST(frame_spacing_without_frame_times) {
+    // LAMMPS dumps carry step numbers only, the time step is not guessed
+    FrameSpacing spacing;
+    Frame frame;
+    frame.step = 0;
+    spacing.add_frame(frame);
+    frame.step = 20;
+    spacing.add_frame(frame);
+    CHECK(0.0 == spacing.get_time_step());
+    CHECK(20 == spacing.get_steps());
+}
@@ -0,0 +1,117 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// The VACF and VDOS of harmonic oscillators, where both are known
+/// analytically.
+///
+/// Atom a moves as cos(w t + phi_a) with the phases phi_a = pi a / N.
+/// Summed over the N atoms, the cos(2 w t + w m + 2 phi_a) terms of the
+/// products cancel exactly, so C(m) / C(0) = cos(w m) for every lag and
+/// any trajectory length, and the VDOS peaks at w.
+
+#include <algorithm>
+#include <cmath>
+
+#include "analysis/vacf.h"
+#include "tests/test.h"
+
+namespace {
+
+const int kMaxLag = 256;
+const int kNatom = 4;
+// the oscillator sits on bin 20 of the VDOS
+const int kPeakBin = 20;
+const double kOmega = 2.0 * M_PI * kPeakBin / (2.0 * kMaxLag);
+
+// several full segments and a short last one
+const int kNframe = 4 * kMaxLag + 100;
+
+Frame oscillator_frame(int t, bool velocities) {
+    Frame frame;
+    frame.species.assign(kNatom, 0);
+    frame.positions.assign(3 * kNatom, 0.0);
+    if (true == velocities) {
+        frame.velocities.assign(3 * kNatom, 0.0);
+    }
+    for (int a = 0; a < kNatom; a++) {
+        const double phase = kOmega * t + M_PI * a / kNatom;
+        // along x and z, y stays at rest
+        frame.positions[3 * a + 0] = 10.0 * a + std::sin(phase) / kOmega;
+        frame.positions[3 * a + 2] = std::sin(phase) / kOmega;
+        if (true == velocities) {
+            frame.velocities[3 * a + 0] = std::cos(phase);
+            frame.velocities[3 * a + 2] = std::cos(phase);
+        }
+    }
+    return frame;
+}
+
+void check_oscillator(const VacfResult& result, std::size_t nframe) {
+    CHECK(result.nframe == nframe);
+    CHECK(result.vacf.size() == kMaxLag);
+    for (std::size_t m = 0; m < result.vacf.size(); m++) {
+        CHECK_NEAR(result.vacf[m], std::cos(kOmega * m), 1e-9);
+    }
+    CHECK(result.vdos.size() == kMaxLag);
+    const auto peak = std::max_element(result.vdos.begin(), result.vdos.end()) - result.vdos.begin();
+    CHECK(kPeakBin == peak);
+    double area = 0.0;
+    for (const double value : result.vdos) {
+        area += value;
+    }
+    CHECK_NEAR(area, 1.0, 1e-12);
+    CHECK(1 == result.species_vacf.size());
+}
+
+} // namespace
+
+TEST(vacf_of_oscillators_is_cosine) {
+    VacfAnalysis analysis(kMaxLag);
+    for (int t = 0; t < kNframe; t++) {
+        analysis.add_frame(oscillator_frame(t, true));
+    }
+    SpeciesTable species_table;
+    species_table.index_of("H");
+    const auto result = analysis.result(species_table);
+    CHECK(false == result.from_positions);
+    check_oscillator(result, kNframe);
+}
+
+TEST(vacf_from_positions_is_cosine) {
+    // the steps between frames are cosines of the midpoint times, with
+    // another amplitude and phase, which C(m) / C(0) does not see
+    VacfAnalysis analysis(kMaxLag);
+    for (int t = 0; t <= kNframe; t++) {
+        analysis.add_frame(oscillator_frame(t, false));
+    }
+    SpeciesTable species_table;
+    species_table.index_of("H");
+    const auto result = analysis.result(species_table);
+    CHECK(true == result.from_positions);
+    // one more frame read than velocities
+    check_oscillator(result, kNframe + 1);
+}
+
+TEST(vdos_wavenumbers_of_the_peak) {
+    // period 2 * kMaxLag / kPeakBin fs
+    const auto wavenumbers = vdos_wavenumbers(kMaxLag, 1.0);
+    const double frequency = kOmega / (2.0 * M_PI);
+    CHECK_NEAR(wavenumbers[kPeakBin], frequency / 2.99792458e-5, 1e-6);
+}
@@ -0,0 +1,306 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "utils/decimation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const std::size_t kFactor = 4;
+
+std::size_t bucket_size(std::size_t level) {
+    std::size_t size = kFactor;
+    for (std::size_t k = 0; k < level; k++) {
+        size *= kFactor;
+    }
+    return size;
+}
+
+void merge(double min, std::size_t min_index, double max, std::size_t max_index, double& out_min, std::size_t& out_min_index, double& out_max, std::size_t& out_max_index) {
+    // NaN never compares, it is left out
+    if (min < out_min) {
+        out_min = min;
+        out_min_index = min_index;
+    }
+    if (max > out_max) {
+        out_max = max;
+        out_max_index = max_index;
+    }
+}
+
+} // namespace
+
+void lttb(const double* x, const double* y, std::size_t n, std::size_t threshold, std::vector<double>& out_x, std::vector<double>& out_y) {
+    out_x.clear();
+    out_y.clear();
+    if (threshold >= n || threshold < 3) {
+        out_x.assign(x, x + n);
+        out_y.assign(y, y + n);
+        return;
+    }
+    out_x.reserve(threshold);
+    out_y.reserve(threshold);
+    const double every = static_cast<double>(n - 2) / (threshold - 2);
+    std::size_t a = 0;
+    out_x.push_back(x[0]);
+    out_y.push_back(y[0]);
+    for (std::size_t bucket = 0; bucket < threshold - 2; bucket++) {
+        // the mean of the next bucket, the last point for the last one
+        std::size_t next_begin = static_cast<std::size_t>((bucket + 1) * every) + 1;
+        std::size_t next_end = std::min(n, static_cast<std::size_t>((bucket + 2) * every) + 1);
+        if (next_begin >= next_end) {
+            next_begin = n - 1;
+            next_end = n;
+        }
+        double mean_x = 0.0;
+        double mean_y = 0.0;
+        for (std::size_t i = next_begin; i < next_end; i++) {
+            mean_x += x[i];
+            mean_y += y[i];
+        }
+        mean_x /= next_end - next_begin;
+        mean_y /= next_end - next_begin;
+
+        const std::size_t begin = static_cast<std::size_t>(bucket * every) + 1;
+        const std::size_t end = std::min(n - 1, static_cast<std::size_t>((bucket + 1) * every) + 1);
+        double max_area = -1.0;
+        std::size_t kept = begin;
+        for (std::size_t i = begin; i < end; i++) {
+            const double area = std::fabs((x[a] - mean_x) * (y[i] - y[a]) - (x[a] - x[i]) * (mean_y - y[a]));
+            if (area > max_area) {
+                max_area = area;
+                kept = i;
+            }
+        }
+        out_x.push_back(x[kept]);
+        out_y.push_back(y[kept]);
+        a = kept;
+    }
+    out_x.push_back(x[n - 1]);
+    out_y.push_back(y[n - 1]);
+}
+
+void decimate_min_max(const double* x, const double* y, std::size_t n, std::size_t nbucket, std::vector<double>& out_x, std::vector<double>& out_y) {
+    out_x.clear();
+    out_y.clear();
+    if (n <= 2 * nbucket || 0 == nbucket) {
+        out_x.assign(x, x + n);
+        out_y.assign(y, y + n);
+        return;
+    }
+    out_x.reserve(2 * nbucket);
+    out_y.reserve(2 * nbucket);
+    for (std::size_t bucket = 0; bucket < nbucket; bucket++) {
+        const std::size_t begin = bucket * n / nbucket;
+        const std::size_t end = (bucket + 1) * n / nbucket;
+        std::size_t min_index = begin;
+        std::size_t max_index = begin;
+        for (std::size_t i = begin + 1; i < end; i++) {
+            if (y[i] < y[min_index]) {
+                min_index = i;
+            }
+            if (y[i] > y[max_index]) {
+                max_index = i;
+            }
+        }
+        const std::size_t first = std::min(min_index, max_index);
+        const std::size_t second = std::max(min_index, max_index);
+        out_x.push_back(x[first]);
+        out_y.push_back(y[first]);
+        if (second != first) {
+            out_x.push_back(x[second]);
+            out_y.push_back(y[second]);
+        }
+    }
+}
+
+void SeriesPyramid::append(const std::vector<double>& x, const std::vector<double>& y) {
+    const std::size_t first_new = m_y.size();
+    if (false == x.empty() && m_x.empty()) {
+        // indices so far, x from now on
+        for (std::size_t i = 0; i < first_new; i++) {
+            m_x.push_back(static_cast<double>(i));
+        }
+    }
+    if (false == x.empty() || false == m_x.empty()) {
+        for (std::size_t i = 0; i < y.size(); i++) {
+            m_x.push_back(i < x.size() ? x[i] : static_cast<double>(first_new + i));
+        }
+    }
+    m_y.insert(m_y.end(), y.begin(), y.end());
+
+    // rebuild the buckets from the one holding the first new sample, each
+    // level from the one below
+    const std::size_t n = m_y.size();
+    for (std::size_t level = 0; bucket_size(level) <= n; level++) {
+        if (level == m_levels.size()) {
+            m_levels.emplace_back();
+        }
+        auto& buckets = m_levels[level];
+        const std::size_t size = bucket_size(level);
+        const std::size_t first_bucket = first_new / size;
+        const std::size_t nbucket = n / size;
+        buckets.resize(nbucket);
+        for (std::size_t b = first_bucket; b < nbucket; b++) {
+            Bucket bucket{std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), b * size, b * size};
+            if (0 == level) {
+                for (std::size_t i = b * size; i < (b + 1) * size; i++) {
+                    merge(m_y[i], i, m_y[i], i, bucket.min, bucket.min_index, bucket.max, bucket.max_index);
+                }
+            } else {
+                const auto& children = m_levels[level - 1];
+                for (std::size_t c = b * kFactor; c < (b + 1) * kFactor; c++) {
+                    merge(children[c].min, children[c].min_index, children[c].max, children[c].max_index, bucket.min, bucket.min_index, bucket.max, bucket.max_index);
+                }
+            }
+            buckets[b] = bucket;
+        }
+    }
+}
+
+void SeriesPyramid::clear() {
+    m_x.clear();
+    m_y.clear();
+    m_levels.clear();
+}
+
+std::pair<std::size_t, std::size_t> SeriesPyramid::range(double x_min, double x_max) const {
+    const std::size_t n = m_y.size();
+    if (m_x.empty()) {
+        const double lower = std::max(0.0, std::ceil(x_min));
+        const double upper = std::min(static_cast<double>(n), std::floor(x_max) + 1.0);
+        if (upper <= lower) {
+            return {0, 0};
+        }
+        return {static_cast<std::size_t>(lower), static_cast<std::size_t>(upper)};
+    }
+    const auto begin = std::lower_bound(m_x.begin(), m_x.end(), x_min);
+    const auto end = std::upper_bound(begin, m_x.end(), x_max);
+    return {static_cast<std::size_t>(begin - m_x.begin()), static_cast<std::size_t>(end - m_x.begin())};
+}
+
+void SeriesPyramid::extremes(std::size_t begin, std::size_t end, Bucket& extreme) const {
+    if (begin >= end) {
+        return;
+    }
+    // the coarsest level with a whole bucket inside [begin, end)
+    std::size_t level = m_levels.size();
+    while (level > 0) {
+        const std::size_t size = bucket_size(level - 1);
+        if ((begin + size - 1) / size < end / size) {
+            break;
+        }
+        level--;
+    }
+    if (0 == level) {
+        for (std::size_t i = begin; i < end; i++) {
+            merge(m_y[i], i, m_y[i], i, extreme.min, extreme.min_index, extreme.max, extreme.max_index);
+        }
+        return;
+    }
+    const auto& buckets = m_levels[level - 1];
+    const std::size_t size = bucket_size(level - 1);
+    const std::size_t first = (begin + size - 1) / size;
+    const std::size_t last = end / size;
+    for (std::size_t b = first; b < last; b++) {
+        merge(buckets[b].min, buckets[b].min_index, buckets[b].max, buckets[b].max_index, extreme.min, extreme.min_index, extreme.max, extreme.max_index);
+    }
+    this->extremes(begin, first * size, extreme);
+    this->extremes(last * size, end, extreme);
+}
+
+void SeriesPyramid::bounds(std::size_t begin, std::size_t end, double& y_min, double& y_max) const {
+    Bucket extreme{std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), begin, begin};
+    this->extremes(begin, std::min(end, m_y.size()), extreme);
+    y_min = extreme.min;
+    y_max = extreme.max;
+}
+
+void SeriesPyramid::decimate(std::size_t begin, std::size_t end, std::size_t npixel, std::vector<double>& out_x, std::vector<double>& out_y) const {
+    out_x.clear();
+    out_y.clear();
+    end = std::min(end, m_y.size());
+    if (begin >= end) {
+        return;
+    }
+    const std::size_t n = end - begin;
+    if (n <= 2 * npixel || 0 == npixel) {
+        for (std::size_t i = begin; i < end; i++) {
+            out_x.push_back(this->x_at(i));
+            out_y.push_back(m_y[i]);
+        }
+        return;
+    }
+    out_x.reserve(2 * npixel);
+    out_y.reserve(2 * npixel);
+    for (std::size_t pixel = 0; pixel < npixel; pixel++) {
+        const std::size_t column_begin = begin + pixel * n / npixel;
+        const std::size_t column_end = begin + (pixel + 1) * n / npixel;
+        Bucket extreme{std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), column_begin, column_begin};
+        this->extremes(column_begin, column_end, extreme);
+        if (false == std::isfinite(extreme.min) && false == std::isfinite(extreme.max)) {
+            continue;
+        }
+        const std::size_t first = std::min(extreme.min_index, extreme.max_index);
+        const std::size_t second = std::max(extreme.min_index, extreme.max_index);
+        out_x.push_back(this->x_at(first));
+        out_y.push_back(m_y[first]);
+        if (second != first) {
+            out_x.push_back(this->x_at(second));
+            out_y.push_back(m_y[second]);
+        }
+    }
+}
+
+void SeriesPyramid::decimate_lttb(std::size_t begin, std::size_t end, std::size_t npixel, std::vector<double>& out_x, std::vector<double>& out_y) const {
+    std::vector<double> x;
+    std::vector<double> y;
+    this->decimate(begin, end, 2 * npixel, x, y);
+    lttb(x.data(), y.data(), x.size(), 2 * npixel, out_x, out_y);
+}
+
+std::vector<std::uint64_t> SeriesPyramid::histogram(std::size_t begin, std::size_t end, int nbin, double y_min, double y_max) const {
+    std::vector<std::uint64_t> counts(std::max(1, nbin), 0);
+    end = std::min(end, m_y.size());
+    if (begin >= end || false == (y_max > y_min)) {
+        return counts;
+    }
+    const int last = static_cast<int>(counts.size()) - 1;
+    const double scale = counts.size() / (y_max - y_min);
+#pragma omp parallel
+    {
+        std::vector<std::uint64_t> local(counts.size(), 0);
+#pragma omp for schedule(static) nowait
+        for (long i = static_cast<long>(begin); i < static_cast<long>(end); i++) {
+            const double value = (m_y[i] - y_min) * scale;
+            if (value >= 0.0 && value <= last + 1) {
+                local[std::min(last, static_cast<int>(value))]++;
+            }
+        }
+#pragma omp critical
+        for (std::size_t b = 0; b < counts.size(); b++) {
+            counts[b] += local[b];
+        }
+    }
+    return counts;
+}
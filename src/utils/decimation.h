@@ -0,0 +1,95 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Decimation of long series down to the resolution of a plot.
+///
+/// SeriesPyramid keeps the samples together with levels of buckets of
+/// 4, 16, 64, ... samples holding the minimum and the maximum of each
+/// bucket and where they occur. The extremes of any index range come from
+/// a few buckets per level instead of a scan, so every pixel column of a
+/// view gets its exact minimum and maximum in O(log n) whatever the zoom.
+/// Appends only rebuild the buckets at the tail.
+
+#ifndef UTILS_DECIMATION_H
+#define UTILS_DECIMATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Largest-Triangle-Three-Buckets: keeps the first and last points and
+// from each of threshold - 2 buckets the point forming the largest
+// triangle with the point kept before it and the mean of the next bucket
+void lttb(const double* x, const double* y, std::size_t n, std::size_t threshold, std::vector<double>& out_x, std::vector<double>& out_y);
+
+// the minimum and the maximum of each of nbucket equal index buckets, in
+// the order they occur, by scanning the samples
+void decimate_min_max(const double* x, const double* y, std::size_t n, std::size_t nbucket, std::vector<double>& out_x, std::vector<double>& out_y);
+
+class SeriesPyramid {
+public:
+    // x must not decrease, empty x uses the sample index
+    void append(const std::vector<double>& x, const std::vector<double>& y);
+    void clear();
+
+    std::size_t size() const {
+        return m_y.size();
+    }
+    double x_at(std::size_t i) const {
+        return m_x.empty() ? static_cast<double>(i) : m_x[i];
+    }
+    const std::vector<double>& get_y() const {
+        return m_y;
+    }
+
+    // the index range [begin, end) of the samples with x_min <= x <= x_max
+    std::pair<std::size_t, std::size_t> range(double x_min, double x_max) const;
+    // the extremes of the samples [begin, end)
+    void bounds(std::size_t begin, std::size_t end, double& y_min, double& y_max) const;
+
+    // the minimum and maximum of each of npixel columns of [begin, end),
+    // all samples when there are fewer than 2 * npixel
+    void decimate(std::size_t begin, std::size_t end, std::size_t npixel, std::vector<double>& out_x, std::vector<double>& out_y) const;
+    // min/max to 4 * npixel points, then LTTB to 2 * npixel
+    void decimate_lttb(std::size_t begin, std::size_t end, std::size_t npixel, std::vector<double>& out_x, std::vector<double>& out_y) const;
+
+    // counts of the y values of [begin, end) in nbin bins over [y_min, y_max]
+    std::vector<std::uint64_t> histogram(std::size_t begin, std::size_t end, int nbin, double y_min, double y_max) const;
+
+private:
+    struct Bucket {
+        double min;
+        double max;
+        std::size_t min_index;
+        std::size_t max_index;
+    };
+
+    // merges the extremes of [begin, end) into extreme, descending from
+    // the coarsest level that fits
+    void extremes(std::size_t begin, std::size_t end, Bucket& extreme) const;
+
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    // level k has buckets of 4^(k + 1) samples
+    std::vector<std::vector<Bucket>> m_levels;
+};
+
+#endif // UTILS_DECIMATION_H
@@ -0,0 +1,53 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#ifndef UTILS_HASH_H
+#define UTILS_HASH_H
+
+#include <cstddef>
+#include <string>
+
+#include <openssl/evp.h>
+
+/// Incremental SHA-256, hex encoded.
+class Sha256 {
+public:
+    Sha256();
+    ~Sha256();
+
+    Sha256(const Sha256&) = delete;
+    Sha256& operator=(const Sha256&) = delete;
+
+    Sha256& update(const void* data, std::size_t length);
+    Sha256& update(const std::string& text) {
+        return this->update(text.data(), text.size());
+    }
+    // the content of the file, read through a memory mapping
+    Sha256& update_file(const std::string& path);
+
+    std::string hex_digest();
+
+    static std::string of_file(const std::string& path);
+
+private:
+    EVP_MD_CTX* m_ctx;
+};
+
+#endif // UTILS_HASH_H
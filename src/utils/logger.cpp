@@ -0,0 +1,189 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "utils/logger.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <iostream>
+
+namespace {
+
+const char* level_name(LogLevel level) {
+    switch (level) {
+        case LogLevel::Trace:
+            return "TRACE";
+        case LogLevel::Debug:
+            return "DEBUG";
+        case LogLevel::Info:
+            return "INFO";
+        case LogLevel::Warning:
+            return "WARNING";
+        case LogLevel::Error:
+            return "ERROR";
+        default:
+            return "";
+    }
+}
+
+std::uint64_t steady_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+} // namespace
+
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() {
+    m_sink_thread = std::thread(&Logger::sink_loop, this);
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(m_sink_mutex);
+        m_stop = true;
+    }
+    m_sink_cv.notify_one();
+    if (m_sink_thread.joinable()) {
+        m_sink_thread.join();
+    }
+}
+
+Logger::Ring* Logger::thread_ring() {
+    thread_local std::shared_ptr<Ring> ring;
+    if (nullptr == ring) {
+        ring = std::make_shared<Ring>();
+        std::lock_guard<std::mutex> lock(m_rings_mutex);
+        ring->tid = static_cast<int>(m_rings.size()) + 1;
+        m_rings.push_back(ring);
+    }
+    return ring.get();
+}
+
+void Logger::log(LogLevel level, const char* format, ...) {
+    Ring* ring = this->thread_ring();
+    const std::uint32_t head = ring->head.load(std::memory_order_relaxed);
+    const std::uint32_t tail = ring->tail.load(std::memory_order_acquire);
+    if (head - tail >= Ring::kCapacity) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    LogRecord& record = ring->records[head % Ring::kCapacity];
+    record.time_ns = steady_now_ns();
+    record.level = level;
+    record.tid = ring->tid;
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(record.message, sizeof(record.message), format, args);
+    va_end(args);
+    ring->head.store(head + 1, std::memory_order_release);
+
+    // wake the sink only on the first message of a batch
+    if (false == m_pending.exchange(true, std::memory_order_acq_rel)) {
+        m_sink_cv.notify_one();
+    }
+}
+
+bool Logger::drain() {
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(m_rings_mutex);
+        rings = m_rings;
+    }
+    std::lock_guard<std::mutex> file_lock(m_file_mutex);
+    bool written = false;
+    for (const auto& ring : rings) {
+        std::uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+        const std::uint32_t head = ring->head.load(std::memory_order_acquire);
+        while (tail != head) {
+            this->write_record(ring->records[tail % Ring::kCapacity]);
+            tail++;
+            ring->tail.store(tail, std::memory_order_release);
+            written = true;
+        }
+    }
+    if (true == written) {
+        std::clog.flush();
+        if (m_file.is_open()) {
+            m_file.flush();
+        }
+    }
+    return written;
+}
+
+void Logger::write_record(const LogRecord& record) {
+    char prefix[64];
+    std::snprintf(prefix, sizeof(prefix), "[%.6f][%s][%d] ",
+        record.time_ns / 1.0e9, level_name(record.level), record.tid);
+    std::clog << prefix << record.message << '\n';
+    if (m_file.is_open()) {
+        m_file << prefix << record.message << '\n';
+    }
+}
+
+void Logger::sink_loop() {
+    std::unique_lock<std::mutex> lock(m_sink_mutex);
+    while (true) {
+        // the timeout picks up messages which raced with the wake-up flag
+        m_sink_cv.wait_for(lock, std::chrono::milliseconds(50), [this]() {
+            return m_stop || m_pending.load(std::memory_order_acquire) || m_flush_requests != m_flush_done;
+        });
+        m_pending.store(false, std::memory_order_release);
+        const std::uint64_t flush_requests = m_flush_requests;
+        const bool stop = m_stop;
+        lock.unlock();
+        this->drain();
+        lock.lock();
+        m_flush_done = flush_requests;
+        m_flushed_cv.notify_all();
+        if (true == stop) {
+            break;
+        }
+    }
+    if (m_dropped.load() > 0) {
+        std::clog << "[logger] " << m_dropped.load() << " messages dropped" << std::endl;
+    }
+}
+
+void Logger::set_file(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_file_mutex);
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+    if (false == path.empty()) {
+        m_file.open(path, std::ios::app);
+    }
+}
+
+void Logger::flush() {
+    std::unique_lock<std::mutex> lock(m_sink_mutex);
+    const std::uint64_t request = ++m_flush_requests;
+    m_sink_cv.notify_one();
+    m_flushed_cv.wait(lock, [&]() {
+        return m_flush_done >= request || m_stop;
+    });
+}
@@ -0,0 +1,173 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Levelled asynchronous logger.
+///
+/// LOG_DEBUG(...) and friends take printf-style arguments. The message
+/// is formatted into a slot of a lock-free ring buffer owned by the
+/// calling thread and written out by a background sink thread, so that
+/// the caller never waits on terminal or file I/O. When a ring is full
+/// the message is dropped and counted instead of blocking.
+///
+/// Messages below ATOMSCISTUDIO_LOG_LEVEL are removed at compile time,
+/// their arguments are not even evaluated.
+
+#ifndef UTILS_LOGGER_H
+#define UTILS_LOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define ATOMSCISTUDIO_LOG_LEVEL_TRACE 0
+#define ATOMSCISTUDIO_LOG_LEVEL_DEBUG 1
+#define ATOMSCISTUDIO_LOG_LEVEL_INFO 2
+#define ATOMSCISTUDIO_LOG_LEVEL_WARNING 3
+#define ATOMSCISTUDIO_LOG_LEVEL_ERROR 4
+#define ATOMSCISTUDIO_LOG_LEVEL_OFF 5
+
+#ifndef ATOMSCISTUDIO_LOG_LEVEL
+#define ATOMSCISTUDIO_LOG_LEVEL ATOMSCISTUDIO_LOG_LEVEL_INFO
+#endif
+
+enum class LogLevel : int {
+    Trace = ATOMSCISTUDIO_LOG_LEVEL_TRACE,
+    Debug = ATOMSCISTUDIO_LOG_LEVEL_DEBUG,
+    Info = ATOMSCISTUDIO_LOG_LEVEL_INFO,
+    Warning = ATOMSCISTUDIO_LOG_LEVEL_WARNING,
+    Error = ATOMSCISTUDIO_LOG_LEVEL_ERROR,
+    Off = ATOMSCISTUDIO_LOG_LEVEL_OFF,
+};
+
+struct LogRecord {
+    std::uint64_t time_ns;
+    LogLevel level;
+    int tid;
+    char message[240];
+};
+
+class Logger {
+public:
+    static Logger& instance();
+
+    ~Logger();
+
+    void log(LogLevel level, const char* format, ...)
+#if defined(__GNUC__)
+        __attribute__((format(printf, 3, 4)))
+#endif
+        ;
+
+    // runtime filter on top of the compile-time one
+    void set_level(LogLevel level) {
+        m_level.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+    bool is_enabled(LogLevel level) const {
+        return static_cast<int>(level) >= m_level.load(std::memory_order_relaxed);
+    }
+
+    // additionally append the messages to a file, empty path to stop
+    void set_file(const std::string& path);
+    // block until everything logged so far has been written out
+    void flush();
+
+    std::uint64_t dropped() const {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    // single-producer single-consumer ring, the producer is the owning
+    // thread and the consumer is the sink thread
+    struct Ring {
+        static constexpr std::uint32_t kCapacity = 1024;
+        int tid;
+        std::atomic<std::uint32_t> head{0};
+        std::atomic<std::uint32_t> tail{0};
+        LogRecord records[kCapacity];
+    };
+
+    Logger();
+    Ring* thread_ring();
+    bool drain();
+    void sink_loop();
+    void write_record(const LogRecord& record);
+
+    std::atomic<int> m_level{ATOMSCISTUDIO_LOG_LEVEL};
+    std::atomic<std::uint64_t> m_dropped{0};
+
+    std::mutex m_rings_mutex;
+    std::vector<std::shared_ptr<Ring>> m_rings;
+
+    std::mutex m_sink_mutex;
+    std::condition_variable m_sink_cv;
+    std::condition_variable m_flushed_cv;
+    std::atomic<bool> m_pending{false};
+    std::uint64_t m_flush_requests = 0;
+    std::uint64_t m_flush_done = 0;
+    bool m_stop = false;
+    std::mutex m_file_mutex;
+    std::ofstream m_file;
+    std::thread m_sink_thread;
+};
+
+#define ATOMSCISTUDIO_LOG(level, ...) \
+    do { \
+        if (Logger::instance().is_enabled(level)) { \
+            Logger::instance().log(level, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#if ATOMSCISTUDIO_LOG_LEVEL <= ATOMSCISTUDIO_LOG_LEVEL_TRACE
+#define LOG_TRACE(...) ATOMSCISTUDIO_LOG(LogLevel::Trace, __VA_ARGS__)
+#else
+#define LOG_TRACE(...) ((void)0)
+#endif
+
+#if ATOMSCISTUDIO_LOG_LEVEL <= ATOMSCISTUDIO_LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) ATOMSCISTUDIO_LOG(LogLevel::Debug, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if ATOMSCISTUDIO_LOG_LEVEL <= ATOMSCISTUDIO_LOG_LEVEL_INFO
+#define LOG_INFO(...) ATOMSCISTUDIO_LOG(LogLevel::Info, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if ATOMSCISTUDIO_LOG_LEVEL <= ATOMSCISTUDIO_LOG_LEVEL_WARNING
+#define LOG_WARNING(...) ATOMSCISTUDIO_LOG(LogLevel::Warning, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) ((void)0)
+#endif
+
+#if ATOMSCISTUDIO_LOG_LEVEL <= ATOMSCISTUDIO_LOG_LEVEL_ERROR
+#define LOG_ERROR(...) ATOMSCISTUDIO_LOG(LogLevel::Error, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+#endif // UTILS_LOGGER_H
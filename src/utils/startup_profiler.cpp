@@ -0,0 +1,63 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "utils/startup_profiler.h"
+
+#include <cstdio>
+
+StartupProfiler& StartupProfiler::instance() {
+    static StartupProfiler profiler;
+    return profiler;
+}
+
+StartupProfiler::StartupProfiler()
+    : m_start{std::chrono::steady_clock::now()}, m_main_thread{std::this_thread::get_id()} {
+}
+
+void StartupProfiler::mark(const std::string& stage) {
+    if (false == m_enabled) {
+        return;
+    }
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stages.push_back(Stage{stage, ms, std::this_thread::get_id() == m_main_thread});
+}
+
+void StartupProfiler::report() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (false == m_enabled || true == m_reported) {
+        return;
+    }
+    m_reported = true;
+
+    std::fprintf(stderr, "Startup profile (ms since main):\n");
+    std::fprintf(stderr, "  %10s %10s  %s\n", "time", "delta", "stage");
+    double last_ms = 0.0;
+    for (const auto& stage : m_stages) {
+        if (true == stage.main_thread) {
+            std::fprintf(stderr, "  %10.1f %10.1f  %s\n", stage.ms, stage.ms - last_ms, stage.name.c_str());
+            last_ms = stage.ms;
+        } else {
+            // stages of worker threads overlap the main thread ones
+            std::fprintf(stderr, "  %10.1f %10s  %s (background)\n", stage.ms, "", stage.name.c_str());
+        }
+    }
+    std::fflush(stderr);
+}
@@ -0,0 +1,67 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Time-to-first-frame report of the start-up stages, enabled with the
+/// --startup-profile command line flag.
+
+#ifndef UTILS_STARTUP_PROFILER_H
+#define UTILS_STARTUP_PROFILER_H
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class StartupProfiler {
+public:
+    static StartupProfiler& instance();
+
+    void enable() {
+        m_enabled = true;
+    }
+    bool is_enabled() const {
+        return m_enabled;
+    }
+
+    // record the time of a stage since the profiler was created in main(),
+    // may be called from any thread
+    void mark(const std::string& stage);
+    // print the stages once, later calls do nothing
+    void report();
+
+private:
+    struct Stage {
+        std::string name;
+        double ms;
+        bool main_thread;
+    };
+
+    StartupProfiler();
+
+    bool m_enabled = false;
+    bool m_reported = false;
+    std::chrono::steady_clock::time_point m_start;
+    std::thread::id m_main_thread;
+    std::mutex m_mutex;
+    std::vector<Stage> m_stages;
+};
+
+#endif // UTILS_STARTUP_PROFILER_H
@@ -0,0 +1,123 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "utils/trace.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+namespace {
+
+void write_json_string(std::ofstream& out, const char* str) {
+    out << '"';
+    for (const char* c = str; *c != '\0'; c++) {
+        switch (*c) {
+            case '"':
+                out << "\\\"";
+                break;
+            case '\\':
+                out << "\\\\";
+                break;
+            case '\n':
+                out << "\\n";
+                break;
+            default:
+                out << *c;
+                break;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+std::uint64_t Tracer::now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+Tracer::ThreadBuffer* Tracer::thread_buffer() {
+    // the buffer is shared with the tracer, so that events of threads
+    // which have already exited still end up in the trace
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if (nullptr == buffer) {
+        buffer = std::make_shared<ThreadBuffer>();
+        buffer->events.reserve(4096);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        buffer->tid = static_cast<int>(m_buffers.size()) + 1;
+        m_buffers.push_back(buffer);
+    }
+    return buffer.get();
+}
+
+void Tracer::record(const char* name, const char* category, std::uint64_t begin_ns, std::uint64_t end_ns) {
+    auto buffer = this->thread_buffer();
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    buffer->events.push_back(TraceEvent{name, category, begin_ns, end_ns});
+}
+
+bool Tracer::write_chrome_trace(const std::string& path) {
+    std::ofstream out(path);
+    if (false == out.is_open()) {
+        return false;
+    }
+
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        buffers = m_buffers;
+    }
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& buffer : buffers) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        for (const auto& event : buffer->events) {
+            out << (true == first ? "\n" : ",\n");
+            first = false;
+            out << "{\"name\":";
+            write_json_string(out, event.name);
+            out << ",\"cat\":";
+            write_json_string(out, event.category);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"ts\":" << event.begin_ns / 1000.0
+                << ",\"dur\":" << (event.end_ns - event.begin_ns) / 1000.0
+                << "}";
+        }
+    }
+    out << "\n]}\n";
+    return out.good();
+}
+
+void Tracer::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& buffer : m_buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        buffer->events.clear();
+    }
+}
@@ -0,0 +1,107 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Scoped-span tracing written out in the Chrome trace-event format,
+/// which can be opened in chrome://tracing or Perfetto.
+///
+/// Spans are recorded with TRACE_SCOPE("name") and buffered per thread.
+/// Unless the project is configured with ATOMSCISTUDIO_ENABLE_TRACE=ON
+/// the macros expand to nothing.
+
+#ifndef UTILS_TRACE_H
+#define UTILS_TRACE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TraceEvent {
+    // names and categories must be string literals, only the pointer is kept
+    const char* name;
+    const char* category;
+    std::uint64_t begin_ns;
+    std::uint64_t end_ns;
+};
+
+class Tracer {
+public:
+    static Tracer& instance();
+
+    static std::uint64_t now_ns();
+
+    void record(const char* name, const char* category, std::uint64_t begin_ns, std::uint64_t end_ns);
+
+    bool write_chrome_trace(const std::string& path);
+    void clear();
+
+    static bool enabled() {
+#if defined(ATOMSCISTUDIO_ENABLE_TRACE)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+private:
+    struct ThreadBuffer {
+        int tid;
+        std::mutex mutex; // only contended while a trace is written out
+        std::vector<TraceEvent> events;
+    };
+
+    Tracer() = default;
+    ThreadBuffer* thread_buffer();
+
+    std::mutex m_mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> m_buffers;
+};
+
+class TraceScope {
+public:
+    TraceScope(const char* name, const char* category)
+        : m_name{name}, m_category{category}, m_begin_ns{Tracer::now_ns()} {
+    }
+    ~TraceScope() {
+        Tracer::instance().record(m_name, m_category, m_begin_ns, Tracer::now_ns());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_name;
+    const char* m_category;
+    std::uint64_t m_begin_ns;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+#if defined(ATOMSCISTUDIO_ENABLE_TRACE)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__){name, "atomscistudio"}
+#define TRACE_SCOPE_CAT(name, category) TraceScope TRACE_CONCAT(trace_scope_, __LINE__){name, category}
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_SCOPE_CAT(name, category) ((void)0)
+#endif
+
+#endif // UTILS_TRACE_H
@@ -0,0 +1,163 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+#include "utils/work_stealing_pool.h"
+
+#include <algorithm>
+
+#include "utils/logger.h"
+
+namespace {
+
+// index of the worker running on this thread, -1 elsewhere
+thread_local int t_worker_index = -1;
+thread_local const WorkStealingPool* t_worker_pool = nullptr;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(int nthread) {
+    if (nthread <= 0) {
+        nthread = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int i = 0; i < nthread; i++) {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 0; i < nthread; i++) {
+        m_workers.emplace_back(&WorkStealingPool::run, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::submit(std::function<void()> task, std::function<void(std::exception_ptr)> on_exception) {
+    const bool from_worker = this == t_worker_pool && t_worker_index >= 0;
+    const int index = true == from_worker ? t_worker_index : static_cast<int>(m_next++ % m_queues.size());
+    {
+        // tasks from outside go to the front, so that the owner takes
+        // them in submission order after its own nested tasks
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        Task entry{std::move(task), std::move(on_exception)};
+        if (true == from_worker) {
+            m_queues[index]->tasks.push_back(std::move(entry));
+        } else {
+            m_queues[index]->tasks.push_front(std::move(entry));
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued++;
+        m_pending++;
+    }
+    m_wake.notify_one();
+}
+
+bool WorkStealingPool::pop(int index, Task& task) {
+    {
+        auto& own = *m_queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (false == own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    const int nqueue = static_cast<int>(m_queues.size());
+    for (int offset = 1; offset < nqueue; offset++) {
+        auto& victim = *m_queues[(index + offset) % nqueue];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (false == victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(int index) {
+    t_worker_index = index;
+    t_worker_pool = this;
+    while (true) {
+        {
+            // m_queued is raised after the task is in a deque, so a
+            // worker woken up here always finds something to pop, unless
+            // another worker was faster
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this]() {
+                return true == m_stop || m_queued > 0;
+            });
+            if (0 == m_queued && true == m_stop) {
+                return;
+            }
+        }
+        Task task;
+        if (false == this->pop(index, task)) {
+            std::this_thread::yield();
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queued--;
+        }
+        try {
+            task.run();
+        } catch (...) {
+            this->report(task, std::current_exception());
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (0 == --m_pending) {
+            m_idle.notify_all();
+        }
+    }
+}
+
+void WorkStealingPool::report(const Task& task, std::exception_ptr error) {
+    if (task.on_exception) {
+        try {
+            task.on_exception(error);
+            return;
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::exception& e) {
+        LOG_ERROR("task failed: %s", e.what());
+    } catch (...) {
+        LOG_ERROR("task failed with an unknown exception");
+    }
+}
+
+void WorkStealingPool::wait_idle() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this]() {
+        return 0 == m_pending;
+    });
+}
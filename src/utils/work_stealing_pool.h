@@ -0,0 +1,91 @@
+/************************************************************************
+ *
+ * Atom Science Studio
+ * Copyright (C) 2022  Deqi Tang
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ ***********************************************************************/
+
+/// Thread pool with one task deque per worker.
+///
+/// A task submitted from a worker goes to the back of that worker's own
+/// deque, tasks from other threads are spread round robin over the
+/// fronts. Workers take from the back of their own deque and, when it is
+/// empty, steal from the front of the others, so that nested submissions
+/// stay local and outside submissions run roughly in order. An exception
+/// leaving a task is handed to the task's on_exception instead of ending
+/// the worker.
+
+#ifndef UTILS_WORK_STEALING_POOL_H
+#define UTILS_WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool {
+public:
+    // 0 threads: one per hardware thread
+    explicit WorkStealingPool(int nthread = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // on_exception is called on the worker with what the task threw,
+    // without it the exception is logged
+    void submit(std::function<void()> task, std::function<void(std::exception_ptr)> on_exception = nullptr);
+    // blocks until every submitted task has finished
+    void wait_idle();
+
+    int size() const {
+        return static_cast<int>(m_workers.size());
+    }
+
+private:
+    struct Task {
+        std::function<void()> run;
+        std::function<void(std::exception_ptr)> on_exception;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(int index);
+    bool pop(int index, Task& task);
+    void report(const Task& task, std::exception_ptr error);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::atomic<std::size_t> m_next{0};
+    // in a deque, not yet taken by a worker
+    std::size_t m_queued = 0;
+    // submitted but not finished
+    std::size_t m_pending = 0;
+    bool m_stop = false;
+};
+
+#endif // UTILS_WORK_STEALING_POOL_H